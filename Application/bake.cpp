@@ -0,0 +1,237 @@
+/*____________________________________________________________________
+|
+| File: bake.cpp
+|
+| Description: Baked lighting for objects that never move, lit by
+|   lights that never change.  The lighting at each corner of an
+|   object's triangles is computed once at load time with rays cast
+|   against the collision geometry and the ground:
+|
+|   Ambient occlusion: rays go out over the hemisphere above the
+|     corner, more of them toward the normal (cosine weighted, spread
+|     evenly by a Hammersley sequence).  The ambient light is scaled by
+|     the fraction that get BAKE_AO_DISTANCE away.
+|   Direct light: each directional light adds its diffuse color times
+|     N.L, if a ray toward it gets BAKE_SHADOW_DISTANCE away.
+|
+|   Each ray starts a little off the surface so it doesn't hit the
+|   triangle it starts on.  The ground is tested by stepping along the
+|   ray.  The material is taken to be white (as every material lit by
+|   these lights is).
+|
+| Functions: Bake_Object
+|             Ray_Blocked
+|            Bake_Get_Stats
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+#include <math.h>
+
+#include "dp.h"
+
+#include "timer.h"
+#include "lwo2.h"
+#include "collision.h"
+#include "bake.h"
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define SURFACE_OFFSET 0.1f     // feet a ray starts off the surface
+#define PI             3.14159265f
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static bool  Ray_Blocked (gx3dVector *origin, gx3dVector *direction, float distance, CollisionGroundFunc ground);
+
+/*___________________
+|
+| Global variables
+|__________________*/
+
+static BakeStats stats;
+
+/*____________________________________________________________________
+|
+| Function: Bake_Object
+|
+| Input: Called from Program_Run()
+| Output: Returns # of triangle corners of an object and the lighting
+|   at each in *colors, or -1 if the file can't be read.
+|___________________________________________________________________*/
+
+int Bake_Object (
+  const char          *lwo_filename,
+  gx3dMatrix          *world_matrix,
+  gx3dColor            ambient,
+  gx3dLightData       *lights,
+  int                  num_lights,
+  CollisionGroundFunc  ground,
+  gx3dColor          **colors )
+{
+  int i, j, k, num_corners, unblocked;
+  unsigned bits;
+  float length, dot, r, phi, sample [BAKE_AO_RAYS][3];
+  gx3dVector *n, t, b, origin, direction, to_light;
+  gx3dMatrix m, feet;
+  gx3dColor *c;
+  Lwo2File file;
+  Lwo2Vertex *vertex;
+  double start;
+
+  *colors = 0;
+  if (NOT Lwo2_Read (lwo_filename, &file))
+    return (-1);
+
+  start = Timer_Now_Ms ();
+
+  // Corners in world space, in feet like gx3d reads them (normals come out in world space too)
+  gx3d_GetScaleMatrix (&feet, LWO2_FEET_PER_UNIT, LWO2_FEET_PER_UNIT, LWO2_FEET_PER_UNIT);
+  gx3d_MultiplyMatrix (&feet, world_matrix, &m);
+  num_corners = Lwo2_Get_Mesh (&file, &m, &vertex) * 3;
+  Lwo2_Free (&file);
+
+  // Cosine weighted directions around +z
+  for (i=0; i<BAKE_AO_RAYS; i++) {
+    // Radical inverse of i in base 2
+    bits = (unsigned)i;
+    bits = (bits << 16) | (bits >> 16);
+    bits = ((bits & 0x55555555) << 1) | ((bits & 0xAAAAAAAA) >> 1);
+    bits = ((bits & 0x33333333) << 2) | ((bits & 0xCCCCCCCC) >> 2);
+    bits = ((bits & 0x0F0F0F0F) << 4) | ((bits & 0xF0F0F0F0) >> 4);
+    bits = ((bits & 0x00FF00FF) << 8) | ((bits & 0xFF00FF00) >> 8);
+    r   = sqrtf ((i + 0.5f) / BAKE_AO_RAYS);
+    phi = 2 * PI * (float)((double)bits / 4294967296.0);
+    sample[i][0] = r * cosf (phi);
+    sample[i][1] = r * sinf (phi);
+    sample[i][2] = sqrtf (1 - r * r);
+  }
+
+  if (num_corners)
+    *colors = (gx3dColor *) malloc (num_corners * sizeof(gx3dColor));
+  for (i=0; i<num_corners; i++) {
+    n = &vertex[i].normal;
+    origin.x = vertex[i].position.x + n->x * SURFACE_OFFSET;
+    origin.y = vertex[i].position.y + n->y * SURFACE_OFFSET;
+    origin.z = vertex[i].position.z + n->z * SURFACE_OFFSET;
+
+    // Two directions across the normal
+    if (fabsf (n->x) < 0.9f) {
+      t.x = 0;
+      t.y = n->z;
+      t.z = -n->y;
+    }
+    else {
+      t.x = -n->z;
+      t.y = 0;
+      t.z = n->x;
+    }
+    length = sqrtf (t.x * t.x + t.y * t.y + t.z * t.z);
+    if (length == 0) {
+      // No normal (degenerate triangle), light it by the ambient light alone
+      (*colors)[i] = ambient;
+      continue;
+    }
+    t.x /= length;
+    t.y /= length;
+    t.z /= length;
+    gx3d_VectorCrossProduct (n, &t, &b);
+
+    // Ambient occlusion
+    unblocked = 0;
+    for (j=0; j<BAKE_AO_RAYS; j++) {
+      direction.x = t.x * sample[j][0] + b.x * sample[j][1] + n->x * sample[j][2];
+      direction.y = t.y * sample[j][0] + b.y * sample[j][1] + n->y * sample[j][2];
+      direction.z = t.z * sample[j][0] + b.z * sample[j][1] + n->z * sample[j][2];
+      if (NOT Ray_Blocked (&origin, &direction, BAKE_AO_DISTANCE, ground))
+        unblocked++;
+    }
+    c = &(*colors)[i];
+    c->r = ambient.r * unblocked / BAKE_AO_RAYS;
+    c->g = ambient.g * unblocked / BAKE_AO_RAYS;
+    c->b = ambient.b * unblocked / BAKE_AO_RAYS;
+    c->a = 1;
+    stats.rays += BAKE_AO_RAYS;
+
+    // Direct light
+    for (k=0; k<num_lights; k++) {
+      if (lights[k].light_type != gx3d_LIGHT_TYPE_DIRECTION)
+        continue;
+      to_light.x = -lights[k].direction.dst.x;
+      to_light.y = -lights[k].direction.dst.y;
+      to_light.z = -lights[k].direction.dst.z;
+      length = sqrtf (to_light.x * to_light.x + to_light.y * to_light.y + to_light.z * to_light.z);
+      if (length == 0)
+        continue;
+      to_light.x /= length;
+      to_light.y /= length;
+      to_light.z /= length;
+      dot = n->x * to_light.x + n->y * to_light.y + n->z * to_light.z;
+      if (dot <= 0)
+        continue;
+      stats.rays++;
+      if (Ray_Blocked (&origin, &to_light, BAKE_SHADOW_DISTANCE, ground))
+        continue;
+      c->r += lights[k].direction.diffuse_color.r * dot;
+      c->g += lights[k].direction.diffuse_color.g * dot;
+      c->b += lights[k].direction.diffuse_color.b * dot;
+    }
+    if (c->r > 1) c->r = 1;
+    if (c->g > 1) c->g = 1;
+    if (c->b > 1) c->b = 1;
+  }
+  free (vertex);
+
+  stats.objects++;
+  stats.corners += num_corners;
+  stats.ms += Timer_Elapsed_Ms (start);
+
+  return (num_corners);
+}
+
+/*____________________________________________________________________
+|
+| Function: Ray_Blocked
+|
+| Input: Called from Bake_Object()
+| Output: Returns true if a ray hits the collision geometry or goes
+|   under the ground within a distance.
+|___________________________________________________________________*/
+
+static bool Ray_Blocked (gx3dVector *origin, gx3dVector *direction, float distance, CollisionGroundFunc ground)
+{
+  float d;
+
+  if (ground AND (direction->y < 0))
+    for (d=BAKE_GROUND_STEP; d<=distance; d+=BAKE_GROUND_STEP)
+      if (origin->y + direction->y * d < (*ground) (origin->x + direction->x * d, origin->z + direction->z * d))
+        return (true);
+
+  return (Collision_Ray_Hit (origin, direction, distance));
+}
+
+/*____________________________________________________________________
+|
+| Function: Bake_Get_Stats
+|
+| Input: Called from Program_Run()
+| Output: Returns statistics since the program started.
+|___________________________________________________________________*/
+
+void Bake_Get_Stats (BakeStats *bake_stats)
+{
+  *bake_stats = stats;
+}
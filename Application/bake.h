@@ -0,0 +1,37 @@
+/*____________________________________________________________________
+|
+| File: bake.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+#define BAKE_AO_RAYS         16       // rays per corner for ambient occlusion
+#define BAKE_AO_DISTANCE     40       // feet, anything farther away doesn't darken a corner
+#define BAKE_SHADOW_DISTANCE 1000     // feet, anything farther away doesn't cast a shadow
+#define BAKE_GROUND_STEP     5        // feet between tests of a ray against the ground
+
+// Statistics since the program started
+struct BakeStats {
+  int   objects;
+  int   corners;            // # of triangle corners lit
+  int   rays;               // # cast
+  float ms;                 // time spent baking
+};
+
+// Computes the lighting at each corner of the triangles of an object placed with a world matrix (in the order of
+//  Lwo2_Get_Mesh()): the ambient light times how much of the sky each corner sees (ambient occlusion), plus each
+//  directional light times N.L where nothing is in the way.  Rays are cast against the collision geometry (see
+//  Collision_Build()) and the ground.  Returns # of corners and a malloc'd array of colors (0-1) in *colors,
+//  or -1 if the file can't be read.
+int Bake_Object (
+  const char          *lwo_filename,
+  gx3dMatrix          *world_matrix,
+  gx3dColor            ambient,
+  gx3dLightData       *lights,          // point lights are skipped
+  int                  num_lights,
+  CollisionGroundFunc  ground,          // 0 for none
+  gx3dColor          **colors );        // caller frees with free()
+
+// Returns statistics since the program started
+void Bake_Get_Stats (BakeStats *stats);
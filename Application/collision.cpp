@@ -0,0 +1,1014 @@
+/*____________________________________________________________________
+|
+| File: collision.cpp
+|
+| Description: Collision of an upright capsule (the player) against
+|   static triangles (the fence, props and buildings).  The triangles
+|   are read from their LWO2 files at load time and put into a
+|   bounding volume hierarchy, split at the middle of the longest axis
+|   until a node holds a few triangles.
+|
+|   The capsule is swept as a stack of spheres spaced no more than a
+|   radius apart.  Each move gathers the triangles near the swept
+|   capsule from the hierarchy, finds the earliest time any sphere
+|   touches a triangle face, edge or vertex, moves up to it and slides
+|   the rest of the way along the plane of contact, a few times over.
+|   Any overlap left at the start of a move (from the ground pushing
+|   the capsule up, say) is pushed out first.
+|
+|   Triangles are two-sided.
+|
+|   Rays can also be cast against the triangles (for baking lighting),
+|   walking the hierarchy and testing the triangles in each leaf hit.
+|
+| Functions: Collision_Add_Object
+|            Collision_Build
+|             Build_Node
+|            Collision_Move
+|             Get_Spheres
+|             Gather
+|             Depenetrate
+|             Sweep_Sphere_Triangle
+|             Lowest_Root
+|             Closest_Point_Triangle
+|            Collision_Penetration
+|            Collision_Ray_Hit
+|             Ray_Box
+|             Ray_Triangle
+|            Collision_Test
+|            Collision_Get_Stats
+|            Collision_Free
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+#include <math.h>
+#include <float.h>
+
+#include "dp.h"
+
+#include "timer.h"
+#include "lwo2.h"
+#include "collision.h"
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+struct Triangle {
+  gx3dVector v [3];
+  gx3dVector normal;
+  gx3dVector center;   // bounding sphere
+  float      radius;
+};
+
+struct Node {
+  gx3dVector min, max;
+  int        first;   // first triangle of a leaf, or left child (right child is first+1)
+  int        count;   // # of triangles in a leaf, 0 for an interior node
+};
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static void Build_Node (int node, int first, int count, gx3dVector *centers, int *index, int depth);
+static int  Get_Spheres (CollisionCapsule *capsule, float *offsets);
+static int  Gather (gx3dVector *center, gx3dVector *velocity, float radius);
+static void Depenetrate (gx3dVector *position, CollisionCapsule *capsule);
+static bool Sweep_Sphere_Triangle (gx3dVector *center, float radius, gx3dVector *velocity, Triangle *tri, float *t, gx3dVector *contact);
+static bool Lowest_Root (float a, float b, float c, float max, float *root);
+static void Closest_Point_Triangle (gx3dVector *p, Triangle *tri, gx3dVector *closest);
+static bool Ray_Box (gx3dVector *origin, gx3dVector *inverse, float max_distance, gx3dVector *min, gx3dVector *max);
+static bool Ray_Triangle (gx3dVector *origin, gx3dVector *direction, float max_distance, Triangle *tri);
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define LEAF_SIZE     4
+#define MAX_DEPTH     40
+#define MAX_SPHERES   16
+#define MAX_SLIDES    4
+#define MAX_PUSHES    4
+#define VERY_CLOSE    0.05f   // distance kept from anything touched (feet)
+#define RAY_EPSILON   0.000001f
+
+/*___________________
+|
+| Macros
+|__________________*/
+
+#define DOT(_a_,_b_)     ((_a_).x * (_b_).x + (_a_).y * (_b_).y + (_a_).z * (_b_).z)
+#define SUB(_a_,_b_,_r_) { (_r_).x = (_a_).x - (_b_).x; (_r_).y = (_a_).y - (_b_).y; (_r_).z = (_a_).z - (_b_).z; }
+
+/*___________________
+|
+| Global variables
+|__________________*/
+
+static Triangle *triangles     = 0;
+static int       num_triangles = 0;
+static Node     *nodes         = 0;
+static int       num_nodes     = 0;
+
+// Triangles gathered for the current move
+static int      *gathered      = 0;
+static int       max_gathered  = 0;
+
+static CollisionStats stats;
+
+/*____________________________________________________________________
+|
+| Function: Collision_Add_Object
+|
+| Input: Called from Program_Run()
+| Output: Adds the triangles of an object to the next build.  Returns
+|   false if the file can't be read.
+|___________________________________________________________________*/
+
+bool Collision_Add_Object (const char *lwo_filename, gx3dMatrix *world_matrix)
+{
+  int i, j, n;
+  float len;
+  gx3dVector *v, e1, e2;
+  Triangle *tri;
+
+  n = Lwo2_Read_Triangles (lwo_filename, world_matrix, &v);
+  if (n == -1)
+    return (false);
+
+  triangles = (Triangle *) realloc (triangles, (num_triangles + n) * sizeof(Triangle));
+  for (i=0; i<n; i++) {
+    tri = &triangles[num_triangles];
+    tri->v[0] = v[i*3+0];
+    tri->v[1] = v[i*3+1];
+    tri->v[2] = v[i*3+2];
+    SUB (tri->v[1], tri->v[0], e1);
+    SUB (tri->v[2], tri->v[0], e2);
+    gx3d_VectorCrossProduct (&e1, &e2, &tri->normal);
+    len = sqrtf (DOT (tri->normal, tri->normal));
+    // Skip slivers
+    if (len < 0.0001f)
+      continue;
+    tri->normal.x /= len;
+    tri->normal.y /= len;
+    tri->normal.z /= len;
+    tri->center.x = (tri->v[0].x + tri->v[1].x + tri->v[2].x) / 3;
+    tri->center.y = (tri->v[0].y + tri->v[1].y + tri->v[2].y) / 3;
+    tri->center.z = (tri->v[0].z + tri->v[1].z + tri->v[2].z) / 3;
+    tri->radius = 0;
+    for (j=0; j<3; j++) {
+      SUB (tri->v[j], tri->center, e1);
+      len = DOT (e1, e1);
+      if (len > tri->radius)
+        tri->radius = len;
+    }
+    tri->radius = sqrtf (tri->radius);
+    num_triangles++;
+  }
+  free (v);
+
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: Collision_Build
+|
+| Input: Called from Program_Run()
+| Output: Builds the hierarchy from the triangles added so far and
+|   puts the triangles in hierarchy order.
+|___________________________________________________________________*/
+
+void Collision_Build ()
+{
+  int i;
+  int *index;
+  gx3dVector *centers;
+  Triangle *sorted;
+  double start;
+
+  start = Timer_Now_Ms ();
+  memset (&stats, 0, sizeof(stats));
+  free (nodes);
+  nodes = 0;
+  num_nodes = 0;
+  if (num_triangles == 0)
+    return;
+
+  index   = (int *)        malloc (num_triangles * sizeof(int));
+  centers = (gx3dVector *) malloc (num_triangles * sizeof(gx3dVector));
+  for (i=0; i<num_triangles; i++) {
+    index[i] = i;
+    centers[i] = triangles[i].center;
+  }
+
+  nodes = (Node *) malloc (2 * num_triangles * sizeof(Node));
+  num_nodes = 1;
+  Build_Node (0, 0, num_triangles, centers, index, 0);
+
+  sorted = (Triangle *) malloc (num_triangles * sizeof(Triangle));
+  for (i=0; i<num_triangles; i++)
+    sorted[i] = triangles[index[i]];
+  free (triangles);
+  triangles = sorted;
+
+  free (index);
+  free (centers);
+
+  stats.triangles = num_triangles;
+  stats.nodes     = num_nodes;
+  stats.build_ms  = Timer_Elapsed_Ms (start);
+}
+
+/*____________________________________________________________________
+|
+| Function: Build_Node
+|
+| Input: Called from Collision_Build(), Build_Node()
+| Output: Fills in a node for triangles index[first] to
+|   index[first+count-1], splitting it if it has too many.
+|___________________________________________________________________*/
+
+static void Build_Node (int node, int first, int count, gx3dVector *centers, int *index, int depth)
+{
+  int i, j, k, axis, left, t;
+  float split, c;
+  gx3dVector cmin, cmax;
+  Node *n = &nodes[node];
+
+  // Bounds of the triangles and of their centers
+  n->min.x = n->min.y = n->min.z = cmin.x = cmin.y = cmin.z =  FLT_MAX;
+  n->max.x = n->max.y = n->max.z = cmax.x = cmax.y = cmax.z = -FLT_MAX;
+  for (i=first; i<first+count; i++) {
+    for (j=0; j<3; j++) {
+      gx3dVector *v = &triangles[index[i]].v[j];
+      if (v->x < n->min.x) n->min.x = v->x;
+      if (v->y < n->min.y) n->min.y = v->y;
+      if (v->z < n->min.z) n->min.z = v->z;
+      if (v->x > n->max.x) n->max.x = v->x;
+      if (v->y > n->max.y) n->max.y = v->y;
+      if (v->z > n->max.z) n->max.z = v->z;
+    }
+    k = index[i];
+    if (centers[k].x < cmin.x) cmin.x = centers[k].x;
+    if (centers[k].y < cmin.y) cmin.y = centers[k].y;
+    if (centers[k].z < cmin.z) cmin.z = centers[k].z;
+    if (centers[k].x > cmax.x) cmax.x = centers[k].x;
+    if (centers[k].y > cmax.y) cmax.y = centers[k].y;
+    if (centers[k].z > cmax.z) cmax.z = centers[k].z;
+  }
+
+  if ((count <= LEAF_SIZE) OR (depth == MAX_DEPTH)) {
+    n->first = first;
+    n->count = count;
+    return;
+  }
+
+  // Split the centers at the middle of the longest axis
+  axis = 0;
+  if (cmax.y - cmin.y > cmax.x - cmin.x)
+    axis = 1;
+  if (cmax.z - cmin.z > (axis ? cmax.y - cmin.y : cmax.x - cmin.x))
+    axis = 2;
+  split = (axis == 0) ? (cmin.x + cmax.x) / 2 : ((axis == 1) ? (cmin.y + cmax.y) / 2 : (cmin.z + cmax.z) / 2);
+  for (i=first, left=first; i<first+count; i++) {
+    k = index[i];
+    c = (axis == 0) ? centers[k].x : ((axis == 1) ? centers[k].y : centers[k].z);
+    if (c < split) {
+      t = index[left];
+      index[left++] = index[i];
+      index[i] = t;
+    }
+  }
+  // All on one side (centers all the same)?  Split in half.
+  if ((left == first) OR (left == first + count))
+    left = first + count / 2;
+
+  n->first = num_nodes;
+  n->count = 0;
+  num_nodes += 2;
+  Build_Node (n->first,     first, left - first,         centers, index, depth + 1);
+  Build_Node (n->first + 1, left,  first + count - left, centers, index, depth + 1);
+}
+
+/*____________________________________________________________________
+|
+| Function: Collision_Move
+|
+| Input: Called from Program_Run() (through Position_Update()),
+|   Collision_Test()
+| Output: Moves a capsule from one position towards another, sliding
+|   along anything in the way.
+|___________________________________________________________________*/
+
+void Collision_Move (
+  gx3dVector       *from,
+  gx3dVector       *to,
+  CollisionCapsule *capsule,
+  gx3dVector       *result )
+{
+  int i, j, n, num_spheres, slide;
+  float offsets [MAX_SPHERES], t, len, d;
+  bool hit;
+  gx3dVector pos, vel, center, contact, normal, hit_normal;
+  double start;
+
+  start = Timer_Now_Ms ();
+  stats.moves++;
+
+  pos = *from;
+  vel.x = to->x - from->x;
+  vel.y = to->y - from->y;
+  vel.z = to->z - from->z;
+  num_spheres = Get_Spheres (capsule, offsets);
+
+  if (num_nodes) {
+    Depenetrate (&pos, capsule);
+
+    for (slide=0; slide<MAX_SLIDES; slide++) {
+      len = sqrtf (DOT (vel, vel));
+      if (len < 0.0001f)
+        break;
+
+      // Earliest contact of any sphere with the triangles near it along the move
+      t = 1;
+      hit = false;
+      for (i=0; i<num_spheres; i++) {
+        center = pos;
+        center.y += offsets[i];
+        n = Gather (&center, &vel, capsule->radius);
+        stats.triangles_tested += n;
+        for (j=0; j<n; j++)
+          if (Sweep_Sphere_Triangle (&center, capsule->radius, &vel, &triangles[gathered[j]], &t, &contact)) {
+            hit = true;
+            // Away from the contact point, at the time of contact
+            hit_normal.x = center.x + vel.x * t - contact.x;
+            hit_normal.y = center.y + vel.y * t - contact.y;
+            hit_normal.z = center.z + vel.z * t - contact.z;
+          }
+      }
+
+      if (NOT hit) {
+        pos.x += vel.x;
+        pos.y += vel.y;
+        pos.z += vel.z;
+        break;
+      }
+
+      // Move up to the contact, staying a little away from it
+      d = t * len - VERY_CLOSE;
+      if (d > 0) {
+        pos.x += vel.x / len * d;
+        pos.y += vel.y / len * d;
+        pos.z += vel.z / len * d;
+      }
+
+      // Slide the rest of the way along the plane of contact
+      d = sqrtf (DOT (hit_normal, hit_normal));
+      if (d == 0)
+        break;
+      normal.x = hit_normal.x / d;
+      normal.y = hit_normal.y / d;
+      normal.z = hit_normal.z / d;
+      vel.x *= 1 - t;
+      vel.y *= 1 - t;
+      vel.z *= 1 - t;
+      d = DOT (vel, normal);
+      vel.x -= normal.x * d;
+      vel.y -= normal.y * d;
+      vel.z -= normal.z * d;
+    }
+  }
+  else {
+    pos.x += vel.x;
+    pos.y += vel.y;
+    pos.z += vel.z;
+  }
+  *result = pos;
+  stats.move_ms += Timer_Elapsed_Ms (start);
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_Spheres
+|
+| Input: Called from Collision_Move(), Depenetrate(),
+|   Collision_Penetration()
+| Output: Returns # of spheres covering a capsule and their y offsets,
+|   spaced no more than a radius apart.
+|___________________________________________________________________*/
+
+static int Get_Spheres (CollisionCapsule *capsule, float *offsets)
+{
+  int i, n;
+  float height;
+
+  height = capsule->top - capsule->bottom;
+  n = (int)ceil (height / capsule->radius) + 1;
+  if (n < 1)
+    n = 1;
+  if (n > MAX_SPHERES)
+    n = MAX_SPHERES;
+  for (i=0; i<n; i++)
+    offsets[i] = (n == 1) ? capsule->bottom : capsule->bottom + height * i / (n - 1);
+
+  return (n);
+}
+
+/*____________________________________________________________________
+|
+| Function: Gather
+|
+| Input: Called from Collision_Move(), Depenetrate(),
+|   Collision_Penetration()
+| Output: Puts the triangles in leaves overlapping the box around a
+|   sphere moving by velocity (0 if not moving) into gathered[] and
+|   returns how many.
+|___________________________________________________________________*/
+
+static int Gather (gx3dVector *center, gx3dVector *velocity, float radius)
+{
+  int i, n, sp, stack [MAX_DEPTH * 2 + 2];
+  gx3dVector min, max;
+  Node *node;
+
+  radius += VERY_CLOSE;
+  min = max = *center;
+  if (velocity) {
+    if (velocity->x < 0) min.x += velocity->x; else max.x += velocity->x;
+    if (velocity->y < 0) min.y += velocity->y; else max.y += velocity->y;
+    if (velocity->z < 0) min.z += velocity->z; else max.z += velocity->z;
+  }
+  min.x -= radius;
+  min.y -= radius;
+  min.z -= radius;
+  max.x += radius;
+  max.y += radius;
+  max.z += radius;
+
+  n  = 0;
+  sp = 0;
+  stack[sp++] = 0;
+  while (sp) {
+    node = &nodes[stack[--sp]];
+    if ((node->min.x > max.x) OR (node->max.x < min.x) OR
+        (node->min.y > max.y) OR (node->max.y < min.y) OR
+        (node->min.z > max.z) OR (node->max.z < min.z))
+      continue;
+    if (node->count) {
+      if (n + node->count > max_gathered) {
+        max_gathered = max_gathered ? max_gathered * 2 : 1024;
+        if (max_gathered < n + node->count)
+          max_gathered = n + node->count;
+        gathered = (int *) realloc (gathered, max_gathered * sizeof(int));
+      }
+      for (i=0; i<node->count; i++)
+        gathered[n++] = node->first + i;
+    }
+    else {
+      stack[sp++] = node->first;
+      stack[sp++] = node->first + 1;
+    }
+  }
+
+  return (n);
+}
+
+/*____________________________________________________________________
+|
+| Function: Depenetrate
+|
+| Input: Called from Collision_Move()
+| Output: Pushes a capsule out of any triangles it overlaps.
+|___________________________________________________________________*/
+
+static void Depenetrate (gx3dVector *position, CollisionCapsule *capsule)
+{
+  int i, j, n, num_spheres, pass;
+  float offsets [MAX_SPHERES], d2, d, push;
+  bool pushed;
+  gx3dVector center, closest, away;
+  Triangle *tri;
+
+  num_spheres = Get_Spheres (capsule, offsets);
+  for (pass=0; pass<MAX_PUSHES; pass++) {
+    pushed = false;
+    for (i=0; i<num_spheres; i++) {
+      center = *position;
+      center.y += offsets[i];
+      n = Gather (&center, 0, capsule->radius);
+      for (j=0; j<n; j++) {
+        tri = &triangles[gathered[j]];
+        center = *position;
+        center.y += offsets[i];
+        Closest_Point_Triangle (&center, tri, &closest);
+        SUB (center, closest, away);
+        d2 = DOT (away, away);
+        if (d2 >= capsule->radius * capsule->radius)
+          continue;
+        d = sqrtf (d2);
+        if (d > 0.0001f)
+          push = (capsule->radius - d + VERY_CLOSE) / d;
+        else {
+          // Center is on the triangle, push along the normal
+          away = tri->normal;
+          push = capsule->radius + VERY_CLOSE;
+        }
+        position->x += away.x * push;
+        position->y += away.y * push;
+        position->z += away.z * push;
+        pushed = true;
+      }
+    }
+    if (NOT pushed)
+      break;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Sweep_Sphere_Triangle
+|
+| Input: Called from Collision_Move()
+| Output: Returns true if a sphere moving by velocity touches a triangle
+|   before time *t (0-1), setting *t and the point of contact.  A sphere
+|   already overlapping the triangle is left to Depenetrate().
+|___________________________________________________________________*/
+
+static bool Sweep_Sphere_Triangle (
+  gx3dVector *center,
+  float       radius,
+  gx3dVector *velocity,
+  Triangle   *tri,
+  float      *t,
+  gx3dVector *contact )
+{
+  int i;
+  float dist, nv, t0, a, b, c, r2, vv, root, edge_len2, edge_dot_vel, edge_dot_base, f;
+  bool found;
+  gx3dVector n, p, e0, e1, e2, q0, q1, q2, c0, c1, c2, edge, base;
+
+  // Does the sphere get near the bounding sphere of the triangle before *t?
+  vv = DOT (*velocity, *velocity);
+  SUB (tri->center, *center, p);
+  f = DOT (p, *velocity) / vv;
+  if (f < 0)
+    f = 0;
+  else if (f > *t)
+    f = *t;
+  p.x -= velocity->x * f;
+  p.y -= velocity->y * f;
+  p.z -= velocity->z * f;
+  if (DOT (p, p) > (radius + tri->radius) * (radius + tri->radius))
+    return (false);
+
+  // Plane of the triangle, facing the sphere
+  n = tri->normal;
+  SUB (*center, tri->v[0], p);
+  dist = DOT (n, p);
+  nv   = DOT (n, *velocity);
+  if (dist < 0) {
+    n.x = -n.x;
+    n.y = -n.y;
+    n.z = -n.z;
+    dist = -dist;
+    nv   = -nv;
+  }
+  // Unless already within a radius of the plane (overlapping the face is left to Depenetrate()), see
+  //  when the sphere touches the plane and if it touches the face there
+  if (dist >= radius) {
+    // Moving away from or along the plane?
+    if (nv >= 0)
+      return (false);
+    t0 = (dist - radius) / -nv;
+    if (t0 >= *t)
+      return (false);
+    p.x = center->x - n.x * radius + velocity->x * t0;
+    p.y = center->y - n.y * radius + velocity->y * t0;
+    p.z = center->z - n.z * radius + velocity->z * t0;
+    SUB (tri->v[1], tri->v[0], e0);
+    SUB (tri->v[2], tri->v[1], e1);
+    SUB (tri->v[0], tri->v[2], e2);
+    SUB (p, tri->v[0], q0);
+    SUB (p, tri->v[1], q1);
+    SUB (p, tri->v[2], q2);
+    gx3d_VectorCrossProduct (&e0, &q0, &c0);
+    gx3d_VectorCrossProduct (&e1, &q1, &c1);
+    gx3d_VectorCrossProduct (&e2, &q2, &c2);
+    if ((DOT (c0, tri->normal) >= 0) AND (DOT (c1, tri->normal) >= 0) AND (DOT (c2, tri->normal) >= 0)) {
+      *t = t0;
+      *contact = p;
+      return (true);
+    }
+  }
+
+  // Touches a vertex or an edge?
+  found = false;
+  r2 = radius * radius;
+  for (i=0; i<3; i++) {
+    SUB (*center, tri->v[i], base);
+    a = vv;
+    b = 2 * DOT (*velocity, base);
+    c = DOT (base, base) - r2;
+    if (Lowest_Root (a, b, c, *t, &root)) {
+      *t = root;
+      *contact = tri->v[i];
+      found = true;
+    }
+  }
+  for (i=0; i<3; i++) {
+    SUB (tri->v[(i+1)%3], tri->v[i], edge);
+    SUB (tri->v[i], *center, base);
+    edge_len2     = DOT (edge, edge);
+    edge_dot_vel  = DOT (edge, *velocity);
+    edge_dot_base = DOT (edge, base);
+    a = edge_len2 * -vv + edge_dot_vel * edge_dot_vel;
+    b = edge_len2 * (2 * DOT (*velocity, base)) - 2 * edge_dot_vel * edge_dot_base;
+    c = edge_len2 * (r2 - DOT (base, base)) + edge_dot_base * edge_dot_base;
+    if (Lowest_Root (a, b, c, *t, &root)) {
+      // Within the edge?
+      f = (edge_dot_vel * root - edge_dot_base) / edge_len2;
+      if ((f >= 0) AND (f <= 1)) {
+        *t = root;
+        contact->x = tri->v[i].x + edge.x * f;
+        contact->y = tri->v[i].y + edge.y * f;
+        contact->z = tri->v[i].z + edge.z * f;
+        found = true;
+      }
+    }
+  }
+
+  return (found);
+}
+
+/*____________________________________________________________________
+|
+| Function: Lowest_Root
+|
+| Input: Called from Sweep_Sphere_Triangle()
+| Output: Returns true if the lower root of a*x*x + b*x + c = 0 (the
+|   time the sphere first touches) is between 0 and max, and the root.
+|   A sphere already touching is left to Depenetrate().
+|___________________________________________________________________*/
+
+static bool Lowest_Root (float a, float b, float c, float max, float *root)
+{
+  float d, sq, r1, r2;
+
+  if (a == 0)
+    return (false);
+  d = b * b - 4 * a * c;
+  if (d < 0)
+    return (false);
+  sq = sqrtf (d);
+  r1 = (-b - sq) / (2 * a);
+  r2 = (-b + sq) / (2 * a);
+  if (r2 < r1)
+    r1 = r2;
+  if ((r1 < 0) OR (r1 >= max))
+    return (false);
+  *root = r1;
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: Closest_Point_Triangle
+|
+| Input: Called from Depenetrate(), Collision_Penetration()
+| Output: Returns the point on a triangle closest to p.
+|___________________________________________________________________*/
+
+static void Closest_Point_Triangle (gx3dVector *p, Triangle *tri, gx3dVector *closest)
+{
+  float d1, d2, d3, d4, d5, d6, va, vb, vc, v, w, denom;
+  gx3dVector ab, ac, ap, bp, cp, bc;
+  gx3dVector *a = &tri->v[0], *b = &tri->v[1], *c = &tri->v[2];
+
+  SUB (*b, *a, ab);
+  SUB (*c, *a, ac);
+  SUB (*p, *a, ap);
+  d1 = DOT (ab, ap);
+  d2 = DOT (ac, ap);
+  if ((d1 <= 0) AND (d2 <= 0)) {
+    *closest = *a;
+    return;
+  }
+  SUB (*p, *b, bp);
+  d3 = DOT (ab, bp);
+  d4 = DOT (ac, bp);
+  if ((d3 >= 0) AND (d4 <= d3)) {
+    *closest = *b;
+    return;
+  }
+  vc = d1 * d4 - d3 * d2;
+  if ((vc <= 0) AND (d1 >= 0) AND (d3 <= 0)) {
+    v = d1 / (d1 - d3);
+    closest->x = a->x + ab.x * v;
+    closest->y = a->y + ab.y * v;
+    closest->z = a->z + ab.z * v;
+    return;
+  }
+  SUB (*p, *c, cp);
+  d5 = DOT (ab, cp);
+  d6 = DOT (ac, cp);
+  if ((d6 >= 0) AND (d5 <= d6)) {
+    *closest = *c;
+    return;
+  }
+  vb = d5 * d2 - d1 * d6;
+  if ((vb <= 0) AND (d2 >= 0) AND (d6 <= 0)) {
+    w = d2 / (d2 - d6);
+    closest->x = a->x + ac.x * w;
+    closest->y = a->y + ac.y * w;
+    closest->z = a->z + ac.z * w;
+    return;
+  }
+  va = d3 * d6 - d5 * d4;
+  if ((va <= 0) AND (d4 - d3 >= 0) AND (d5 - d6 >= 0)) {
+    SUB (*c, *b, bc);
+    w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    closest->x = b->x + bc.x * w;
+    closest->y = b->y + bc.y * w;
+    closest->z = b->z + bc.z * w;
+    return;
+  }
+  // Inside the face
+  denom = 1 / (va + vb + vc);
+  v = vb * denom;
+  w = vc * denom;
+  closest->x = a->x + ab.x * v + ac.x * w;
+  closest->y = a->y + ab.y * v + ac.y * w;
+  closest->z = a->z + ab.z * v + ac.z * w;
+}
+
+/*____________________________________________________________________
+|
+| Function: Collision_Penetration
+|
+| Input: Called from Collision_Test()
+| Output: Returns how far a capsule at a position overlaps the geometry
+|   (the deepest any of its spheres goes into a triangle), 0 if not at
+|   all.
+|___________________________________________________________________*/
+
+float Collision_Penetration (gx3dVector *position, CollisionCapsule *capsule)
+{
+  int i, j, n, num_spheres;
+  float offsets [MAX_SPHERES], d, depth;
+  gx3dVector center, closest, away;
+
+  if (num_nodes == 0)
+    return (0);
+
+  num_spheres = Get_Spheres (capsule, offsets);
+  depth = 0;
+  for (i=0; i<num_spheres; i++) {
+    center = *position;
+    center.y += offsets[i];
+    n = Gather (&center, 0, capsule->radius);
+    for (j=0; j<n; j++) {
+      Closest_Point_Triangle (&center, &triangles[gathered[j]], &closest);
+      SUB (center, closest, away);
+      d = capsule->radius - sqrtf (DOT (away, away));
+      if (d > depth)
+        depth = d;
+    }
+  }
+
+  return (depth);
+}
+
+/*____________________________________________________________________
+|
+| Function: Collision_Ray_Hit
+|
+| Input: Called from Bake_Object()
+| Output: Returns true if a ray hits any triangle within a distance.
+|   Doesn't change any state, so may be called from several threads
+|   at once.
+|___________________________________________________________________*/
+
+bool Collision_Ray_Hit (gx3dVector *origin, gx3dVector *direction, float max_distance)
+{
+  int i, sp, stack [MAX_DEPTH * 2 + 2];
+  gx3dVector inverse;
+  Node *node;
+
+  if (num_nodes == 0)
+    return (false);
+
+  // Infinite for an axis the ray doesn't move along (the slab test then only checks the origin is inside)
+  inverse.x = (direction->x != 0) ? 1 / direction->x : FLT_MAX;
+  inverse.y = (direction->y != 0) ? 1 / direction->y : FLT_MAX;
+  inverse.z = (direction->z != 0) ? 1 / direction->z : FLT_MAX;
+
+  sp = 0;
+  stack[sp++] = 0;
+  while (sp) {
+    node = &nodes[stack[--sp]];
+    if (NOT Ray_Box (origin, &inverse, max_distance, &node->min, &node->max))
+      continue;
+    if (node->count) {
+      for (i=0; i<node->count; i++)
+        if (Ray_Triangle (origin, direction, max_distance, &triangles[node->first + i]))
+          return (true);
+    }
+    else {
+      stack[sp++] = node->first;
+      stack[sp++] = node->first + 1;
+    }
+  }
+
+  return (false);
+}
+
+/*____________________________________________________________________
+|
+| Function: Ray_Box
+|
+| Input: Called from Collision_Ray_Hit()
+| Output: Returns true if a ray (given by 1 / its direction) passes
+|   through a box within a distance.
+|___________________________________________________________________*/
+
+static bool Ray_Box (gx3dVector *origin, gx3dVector *inverse, float max_distance, gx3dVector *min, gx3dVector *max)
+{
+  float t0, t1, tmin, tmax;
+
+  tmin = 0;
+  tmax = max_distance;
+
+  t0 = (min->x - origin->x) * inverse->x;
+  t1 = (max->x - origin->x) * inverse->x;
+  if (t0 > t1) { float t = t0; t0 = t1; t1 = t; }
+  if (t0 > tmin) tmin = t0;
+  if (t1 < tmax) tmax = t1;
+
+  t0 = (min->y - origin->y) * inverse->y;
+  t1 = (max->y - origin->y) * inverse->y;
+  if (t0 > t1) { float t = t0; t0 = t1; t1 = t; }
+  if (t0 > tmin) tmin = t0;
+  if (t1 < tmax) tmax = t1;
+
+  t0 = (min->z - origin->z) * inverse->z;
+  t1 = (max->z - origin->z) * inverse->z;
+  if (t0 > t1) { float t = t0; t0 = t1; t1 = t; }
+  if (t0 > tmin) tmin = t0;
+  if (t1 < tmax) tmax = t1;
+
+  return (tmin <= tmax);
+}
+
+/*____________________________________________________________________
+|
+| Function: Ray_Triangle
+|
+| Input: Called from Collision_Ray_Hit()
+| Output: Returns true if a ray hits either side of a triangle within a
+|   distance (Moller-Trumbore).
+|___________________________________________________________________*/
+
+static bool Ray_Triangle (gx3dVector *origin, gx3dVector *direction, float max_distance, Triangle *tri)
+{
+  float det, u, v, t;
+  gx3dVector e1, e2, p, s, q;
+
+  SUB (tri->v[1], tri->v[0], e1);
+  SUB (tri->v[2], tri->v[0], e2);
+  gx3d_VectorCrossProduct (direction, &e2, &p);
+  det = DOT (e1, p);
+  if (fabsf (det) < RAY_EPSILON)
+    return (false);
+
+  SUB (*origin, tri->v[0], s);
+  u = DOT (s, p) / det;
+  if ((u < 0) OR (u > 1))
+    return (false);
+  gx3d_VectorCrossProduct (&s, &e1, &q);
+  v = DOT (*direction, q) / det;
+  if ((v < 0) OR (u + v > 1))
+    return (false);
+  t = DOT (e2, q) / det;
+
+  return ((t > 0) AND (t <= max_distance));
+}
+
+/*____________________________________________________________________
+|
+| Function: Collision_Test
+|
+| Input: Called from Program_Run()
+| Output: Walks a capsule along each path the way the player moves:
+|   a step towards the end, then onto the ground.  Fails a walk if the
+|   capsule ever overlaps the geometry by more than VERY_CLOSE or gets
+|   within a step of the end.  Writes the results and the average time
+|   per move to the debug file.  Returns true if every walk passes.
+|___________________________________________________________________*/
+
+bool Collision_Test (
+  CollisionCapsule   *capsule,
+  CollisionWalk      *walks,
+  int                 num_walks,
+  float               step,
+  CollisionGroundFunc ground,
+  float               eye_height )
+{
+  int i, s, max_steps, failed, moves, steps;
+  float len, d, depth, worst, ms;
+  char str [200];
+  gx3dVector pos, to, dir;
+  CollisionStats before;
+
+  before = stats;
+  failed = 0;
+  steps  = 0;
+  worst  = 0;
+  for (i=0; i<num_walks; i++) {
+    pos = walks[i].start;
+    pos.y = (*ground) (pos.x, pos.z) + eye_height;
+    dir.x = walks[i].end.x - pos.x;
+    dir.z = walks[i].end.z - pos.z;
+    max_steps = (int)(sqrtf (dir.x * dir.x + dir.z * dir.z) / step) * 2;
+    depth = 0;
+    for (s=0; s<max_steps; s++) {
+      // Head for the end
+      dir.x = walks[i].end.x - pos.x;
+      dir.z = walks[i].end.z - pos.z;
+      len = sqrtf (dir.x * dir.x + dir.z * dir.z);
+      if (len <= step)
+        break;
+      to.x = pos.x + dir.x / len * step;
+      to.z = pos.z + dir.z / len * step;
+      to.y = pos.y;
+      Collision_Move (&pos, &to, capsule, &pos);
+      // Then onto the ground
+      to = pos;
+      to.y = (*ground) (pos.x, pos.z) + eye_height;
+      Collision_Move (&pos, &to, capsule, &pos);
+      steps++;
+      d = Collision_Penetration (&pos, capsule);
+      if (d > depth)
+        depth = d;
+    }
+    if (depth > worst)
+      worst = depth;
+    if ((depth > VERY_CLOSE) OR (s < max_steps)) {
+      failed++;
+      sprintf (str, "Collision test: walk %d FAILED (overlap %.3f ft, %s)", i, depth, (s < max_steps) ? "got through" : "stopped");
+      debug_WriteFile (str);
+    }
+  }
+
+  moves = stats.moves - before.moves;
+  ms    = stats.move_ms - before.move_ms;
+  sprintf (str, "Collision test: %s, %d of %d walks passed, %d moves, %.4f ms per move, deepest overlap %.3f ft",
+    failed ? "FAILED" : "passed", num_walks - failed, num_walks, moves, moves ? ms / moves : 0, worst);
+  debug_WriteFile (str);
+
+  return (failed == 0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Collision_Get_Stats
+|
+| Input: Called from Program_Run()
+| Output: Returns statistics since Collision_Build().
+|___________________________________________________________________*/
+
+void Collision_Get_Stats (CollisionStats *collision_stats)
+{
+  *collision_stats = stats;
+}
+
+/*____________________________________________________________________
+|
+| Function: Collision_Free
+|
+| Input: Called from Program_Run()
+| Output: Frees the geometry.
+|___________________________________________________________________*/
+
+void Collision_Free ()
+{
+  free (triangles);
+  free (nodes);
+  free (gathered);
+  triangles = 0;
+  nodes     = 0;
+  gathered  = 0;
+  num_triangles = num_nodes = max_gathered = 0;
+}
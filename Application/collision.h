@@ -0,0 +1,69 @@
+/*____________________________________________________________________
+|
+| File: collision.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+// Upright capsule, given relative to a position (usually the eye)
+struct CollisionCapsule {
+  float radius;
+  float top;      // y offset of the center of the top of the capsule
+  float bottom;   // y offset of the center of the bottom of the capsule (below top)
+};
+
+// A scripted walk for Collision_Test()
+struct CollisionWalk {
+  gx3dVector start;
+  gx3dVector end;
+};
+
+struct CollisionStats {
+  int   triangles;
+  int   nodes;
+  float build_ms;
+  int   moves;            // # of calls to Collision_Move()
+  int   triangles_tested;
+  float move_ms;          // total time spent in Collision_Move()
+};
+
+// Returns ground height at x,z
+typedef float (*CollisionGroundFunc) (float x, float z);
+
+// Adds the triangles of an object, placed with a world matrix, to the next Collision_Build().  Returns false on error.
+bool Collision_Add_Object (const char *lwo_filename, gx3dMatrix *world_matrix);
+
+// Builds the bounding volume hierarchy from the triangles added so far
+void Collision_Build ();
+
+// Moves a capsule from one position towards another, sliding along anything in the way
+void Collision_Move (
+  gx3dVector       *from,
+  gx3dVector       *to,
+  CollisionCapsule *capsule,
+  gx3dVector       *result );   // can be the same as from or to
+
+// Returns how far a capsule at a position overlaps the geometry (0 if not at all)
+float Collision_Penetration (gx3dVector *position, CollisionCapsule *capsule);
+
+// Returns true if a ray (direction normalized) hits any triangle within a distance.  May be called from several
+//  threads at once.
+bool Collision_Ray_Hit (gx3dVector *origin, gx3dVector *direction, float max_distance);
+
+// Walks a capsule along each path in steps, following the ground, checking that it never overlaps the
+//  geometry and never gets to the end (each walk should cross a wall).  Writes the results to the debug
+//  file and returns true if every walk passes.
+bool Collision_Test (
+  CollisionCapsule   *capsule,
+  CollisionWalk      *walks,
+  int                 num_walks,
+  float               step,
+  CollisionGroundFunc ground,
+  float               eye_height );   // height of the position above the ground
+
+// Returns statistics since Collision_Build()
+void Collision_Get_Stats (CollisionStats *stats);
+
+// Frees the geometry
+void Collision_Free ();
@@ -0,0 +1,305 @@
+/*____________________________________________________________________
+|
+| File: egganim.cpp
+|
+| Description: Egg bobbing and spinning.  Every egg has a resting
+|   position, a phase and a bob height in the egg store.  At a given
+|   time an egg is at
+|
+|     y     = rest y + amplitude * (sin (bob_rate * t + phase) * 0.5 + 0.5)
+|     angle = spin_rate * t + phase
+|
+|   and its world matrix is scale * rotate y (angle) * rotate x (tilt)
+|   * translate.  Eggs are animated 4 at a time with SSE2, using a
+|   polynomial sin instead of the C library, and the matrices are
+|   written straight into the store.
+|
+|   Only the y rotation changes from egg to egg, so the constant part
+|   (scale * rotate x) is built once per update with the gx3d calls,
+|   along with a 90 degree y rotation that gives the sign convention
+|   gx3d uses for the sin terms.
+|
+| Functions: EggAnim_Update
+|             Sin4
+|            EggAnim_Benchmark
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+#include <math.h>
+#include <emmintrin.h>
+
+#include "dp.h"
+
+#include "timer.h"
+#include "eggstore.h"
+#include "egganim.h"
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static inline __m128 Sin4 (__m128 x);
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define PI     3.14159265f
+#define TWO_PI 6.28318531f
+
+/*____________________________________________________________________
+|
+| Function: EggAnim_Update
+|
+| Input: Called from Program_Run(), EggAnim_Benchmark()
+| Output: Sets the world matrix and bounding sphere of every egg in a
+|   store for the given time.
+|___________________________________________________________________*/
+
+void EggAnim_Update (EggStore *store, EggAnimParams *params, unsigned time)
+{
+  int i, k, m, n, e[4];
+  float bob_base, spin_base, y[4];
+  double seconds;
+  gx3dMatrix tilt, scale, quarter;
+  __m128 px, py, pz, phase, amp, s, c, a;
+  __m128 r00, r01, r02, r20, r21, r22, r30, r31, r32, zero, one, half;
+  __m128 t00, t01, t02, t20, t21, t22, u00, u01, u02, u20, u21, u22, row1;
+  __m128 vbob, vspin, vquarter;
+
+  n = store->count;
+  if (n == 0)
+    return;
+
+  // Base angles are reduced in double so precision doesn't drop off as the game runs
+  seconds   = (double)time / 1000;
+  bob_base  = (float)fmod (seconds * params->bob_rate, (double)TWO_PI);
+  spin_base = (float)fmod (seconds * params->spin_rate * (PI / 180), (double)TWO_PI);
+
+  // Constant part of the matrix: T = scale * rotate x (tilt)
+  gx3d_GetScaleMatrix (&scale, params->scale, params->scale, params->scale);
+  gx3d_GetRotateXMatrix (&tilt, params->tilt);
+  gx3d_MultiplyMatrix (&scale, &tilt, &tilt);
+  // rotate y (angle) * T has rows  cos * T0 + sin * q02 * T2,  T1,  sin * q20 * T0 + cos * T2
+  gx3d_GetRotateYMatrix (&quarter, 90);
+
+  t00 = _mm_set1_ps (tilt._00);
+  t01 = _mm_set1_ps (tilt._01);
+  t02 = _mm_set1_ps (tilt._02);
+  t20 = _mm_set1_ps (tilt._20);
+  t21 = _mm_set1_ps (tilt._21);
+  t22 = _mm_set1_ps (tilt._22);
+  u00 = _mm_set1_ps (quarter._02 * tilt._20);
+  u01 = _mm_set1_ps (quarter._02 * tilt._21);
+  u02 = _mm_set1_ps (quarter._02 * tilt._22);
+  u20 = _mm_set1_ps (quarter._20 * tilt._00);
+  u21 = _mm_set1_ps (quarter._20 * tilt._01);
+  u22 = _mm_set1_ps (quarter._20 * tilt._02);
+  row1 = _mm_set_ps (0, tilt._12, tilt._11, tilt._10);
+
+  zero     = _mm_setzero_ps ();
+  one      = _mm_set1_ps (1);
+  half     = _mm_set1_ps (0.5f);
+  vbob     = _mm_set1_ps (bob_base);
+  vspin    = _mm_set1_ps (spin_base);
+  vquarter = _mm_set1_ps (PI / 2);
+
+  for (i=0; i<n; i+=4) {
+    // Gather 4 eggs (the last group repeats the last egg to fill the unused lanes)
+    m = n - i;
+    if (m > 4)
+      m = 4;
+    for (k=0; k<4; k++)
+      e[k] = (k < m) ? i + k : n - 1;
+    px    = _mm_set_ps (store->position[e[3]].x, store->position[e[2]].x, store->position[e[1]].x, store->position[e[0]].x);
+    py    = _mm_set_ps (store->position[e[3]].y, store->position[e[2]].y, store->position[e[1]].y, store->position[e[0]].y);
+    pz    = _mm_set_ps (store->position[e[3]].z, store->position[e[2]].z, store->position[e[1]].z, store->position[e[0]].z);
+    phase = _mm_set_ps (store->phase[e[3]], store->phase[e[2]], store->phase[e[1]], store->phase[e[0]]);
+    amp   = _mm_set_ps (store->amplitude[e[3]], store->amplitude[e[2]], store->amplitude[e[1]], store->amplitude[e[0]]);
+
+    // Bob
+    s  = Sin4 (_mm_add_ps (vbob, phase));
+    py = _mm_add_ps (py, _mm_mul_ps (amp, _mm_add_ps (_mm_mul_ps (s, half), half)));
+
+    // Spin
+    a = _mm_add_ps (vspin, phase);
+    s = Sin4 (a);
+    c = Sin4 (_mm_add_ps (a, vquarter));
+    r00 = _mm_add_ps (_mm_mul_ps (c, t00), _mm_mul_ps (s, u00));
+    r01 = _mm_add_ps (_mm_mul_ps (c, t01), _mm_mul_ps (s, u01));
+    r02 = _mm_add_ps (_mm_mul_ps (c, t02), _mm_mul_ps (s, u02));
+    r20 = _mm_add_ps (_mm_mul_ps (c, t20), _mm_mul_ps (s, u20));
+    r21 = _mm_add_ps (_mm_mul_ps (c, t21), _mm_mul_ps (s, u21));
+    r22 = _mm_add_ps (_mm_mul_ps (c, t22), _mm_mul_ps (s, u22));
+    _mm_storeu_ps (y, py);
+
+    // Rows of 4 eggs to rows of each egg
+    r30 = px;
+    r31 = py;
+    r32 = pz;
+    s   = zero;
+    _MM_TRANSPOSE4_PS (r00, r01, r02, s);
+    c   = zero;
+    _MM_TRANSPOSE4_PS (r20, r21, r22, c);
+    a   = one;
+    _MM_TRANSPOSE4_PS (r30, r31, r32, a);
+
+#define STORE_EGG(_k_,_row0_,_row2_,_row3_)                     \
+    _mm_storeu_ps (&store->matrix[i+(_k_)]._00, _row0_);        \
+    _mm_storeu_ps (&store->matrix[i+(_k_)]._10, row1);          \
+    _mm_storeu_ps (&store->matrix[i+(_k_)]._20, _row2_);        \
+    _mm_storeu_ps (&store->matrix[i+(_k_)]._30, _row3_);
+
+    STORE_EGG (0, r00, r20, r30)
+    if (m > 1) {
+      STORE_EGG (1, r01, r21, r31)
+    }
+    if (m > 2) {
+      STORE_EGG (2, r02, r22, r32)
+    }
+    if (m > 3) {
+      STORE_EGG (3, s, c, a)
+    }
+#undef STORE_EGG
+
+    for (k=0; k<m; k++) {
+      store->sphere[i+k].center.x = store->position[i+k].x;
+      store->sphere[i+k].center.y = y[k] + params->sphere_height;
+      store->sphere[i+k].center.z = store->position[i+k].z;
+      store->sphere[i+k].radius   = params->sphere_radius;
+    }
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Sin4
+|
+| Input: Called from EggAnim_Update()
+| Output: Returns sin of 4 angles (radians).  The angles are brought
+|   into -PI/2..PI/2 and a 9th degree polynomial is used from there
+|   (max error about 4e-6).
+|___________________________________________________________________*/
+
+static inline __m128 Sin4 (__m128 x)
+{
+  __m128 k, sign, x2, p;
+
+  // Reduce to -PI..PI
+  k = _mm_cvtepi32_ps (_mm_cvtps_epi32 (_mm_mul_ps (x, _mm_set1_ps (1 / TWO_PI))));
+  x = _mm_sub_ps (x, _mm_mul_ps (k, _mm_set1_ps (TWO_PI)));
+  // sin (x) = sin (PI - x), so fold |x| into 0..PI/2 and put the sign back after
+  sign = _mm_and_ps (x, _mm_castsi128_ps (_mm_set1_epi32 (0x80000000)));
+  x    = _mm_xor_ps (x, sign);
+  x    = _mm_min_ps (x, _mm_sub_ps (_mm_set1_ps (PI), x));
+
+  x2 = _mm_mul_ps (x, x);
+  p  = _mm_set1_ps (1.0f / 362880);
+  p  = _mm_add_ps (_mm_mul_ps (p, x2), _mm_set1_ps (-1.0f / 5040));
+  p  = _mm_add_ps (_mm_mul_ps (p, x2), _mm_set1_ps (1.0f / 120));
+  p  = _mm_add_ps (_mm_mul_ps (p, x2), _mm_set1_ps (-1.0f / 6));
+  p  = _mm_add_ps (_mm_mul_ps (p, x2), _mm_set1_ps (1));
+  p  = _mm_mul_ps (p, x);
+
+  return (_mm_xor_ps (p, sign));
+}
+
+/*____________________________________________________________________
+|
+| Function: EggAnim_Benchmark
+|
+| Input: Called from Program_Run()
+| Output: Animates 4,000 eggs for 100 frames, first one egg at a time
+|   with sin() and the gx3d matrix calls the way the game used to,
+|   then with EggAnim_Update().  Writes both times and the largest
+|   difference between the matrices to the debug file.
+|___________________________________________________________________*/
+
+void EggAnim_Benchmark ()
+{
+  int i, j, n, frames, frame;
+  unsigned time;
+  float scalar_ms, simd_ms, err, d, angle, bob;
+  float *p, *q;
+  double seconds;
+  char str [200];
+  gx3dVector v;
+  gx3dMatrix m, m1, m2, m3, m4, *reference;
+  double start;
+  EggAnimParams params;
+  EggStore store;
+
+  n      = 4000;
+  frames = 100;
+  params.scale         = 2;
+  params.tilt          = -15;
+  params.spin_rate     = 100;
+  params.bob_rate      = 1;
+  params.sphere_radius = 10;
+  params.sphere_height = 15;
+
+  EggStore_Init (&store, n);
+  reference = (gx3dMatrix *) malloc (n * sizeof(gx3dMatrix));
+  for (i=0; i<n; i++) {
+    v.x = (float)(i % 64) * 100;
+    v.y = (float)(i % 7) * 10;
+    v.z = (float)(i / 64) * 100;
+    EggStore_Add (&store, &v);
+    store.phase[i]     = (float)i * 0.37f;
+    store.amplitude[i] = 20;
+  }
+
+  // One egg at a time
+  start = Timer_Now_Ms ();
+  for (frame=0; frame<frames; frame++) {
+    time    = 123456 + frame * 16;
+    seconds = (double)time / 1000;
+    for (i=0; i<n; i++) {
+      bob   = (float)sin (seconds * params.bob_rate + store.phase[i]);
+      angle = (float)(seconds * params.spin_rate + store.phase[i] * (180 / PI));
+      gx3d_GetScaleMatrix (&m1, params.scale, params.scale, params.scale);
+      gx3d_GetRotateYMatrix (&m2, angle);
+      gx3d_MultiplyMatrix (&m1, &m2, &m);
+      gx3d_GetRotateXMatrix (&m3, params.tilt);
+      gx3d_MultiplyMatrix (&m, &m3, &m);
+      gx3d_GetTranslateMatrix (&m4, store.position[i].x, store.position[i].y + store.amplitude[i] * (bob * 0.5f + 0.5f), store.position[i].z);
+      gx3d_MultiplyMatrix (&m, &m4, &reference[i]);
+    }
+  }
+  scalar_ms = Timer_Elapsed_Ms (start);
+
+  // 4 at a time
+  start = Timer_Now_Ms ();
+  for (frame=0; frame<frames; frame++)
+    EggAnim_Update (&store, &params, 123456 + frame * 16);
+  simd_ms = Timer_Elapsed_Ms (start);
+
+  // Both left the last frame's matrices
+  err = 0;
+  for (i=0; i<n; i++) {
+    p = &reference[i]._00;
+    q = &store.matrix[i]._00;
+    for (j=0; j<16; j++) {
+      d = (float)fabs (p[j] - q[j]);
+      if (d > err)
+        err = d;
+    }
+  }
+
+  sprintf (str, "Egg animation: %d eggs x %d frames, per egg %.3f ms, SSE %.3f ms, max matrix difference %f",
+    n, frames, scalar_ms, simd_ms, err);
+  debug_WriteFile (str);
+
+  free (reference);
+  EggStore_Free (&store);
+}
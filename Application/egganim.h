@@ -0,0 +1,23 @@
+/*____________________________________________________________________
+|
+| File: egganim.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+// Animation shared by every egg (per-egg phase and bob height are in the egg store)
+struct EggAnimParams {
+  float scale;          // uniform scale of the egg object
+  float tilt;           // x rotation (degrees)
+  float spin_rate;      // y rotation speed (degrees per second)
+  float bob_rate;       // bob speed (radians per second)
+  float sphere_radius;  // bounding sphere radius
+  float sphere_height;  // height of the bounding sphere center above the egg
+};
+
+// Sets the world matrix and bounding sphere of every egg in a store for the given time (in milliseconds)
+void EggAnim_Update (EggStore *store, EggAnimParams *params, unsigned time);
+
+// Times animating thousands of eggs against the per-egg matrix calls and writes the results to the debug file
+void EggAnim_Benchmark ();
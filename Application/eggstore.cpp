@@ -0,0 +1,270 @@
+/*____________________________________________________________________
+|
+| File: eggstore.cpp
+|
+| Description: Entity storage for eggs and other collectibles.  Each
+|   component is a dense array with the live eggs packed at the front,
+|   so systems loop over exactly the live eggs.  Removing an egg moves
+|   the last egg into its place.
+|
+|   Eggs are referred to by handles that stay valid while eggs move
+|   around in the arrays.  A handle is a slot # plus the generation of
+|   the slot, which changes each time the slot is reused, so a handle
+|   to a removed egg never finds a newer egg.
+|
+| Functions: EggStore_Init
+|            EggStore_Add
+|            EggStore_Remove
+|            EggStore_Index
+|            EggStore_Free
+|            EggStore_Benchmark
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+
+#include "dp.h"
+
+#include "timer.h"
+#include "eggstore.h"
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define SLOT_BITS       20
+#define SLOT_MASK       ((1 << SLOT_BITS) - 1)
+#define GENERATION_MASK (0xFFFFFFFF >> SLOT_BITS)   // 12 bits, so a slot's handles repeat after 4095 reuses
+
+/*___________________
+|
+| Macros
+|__________________*/
+
+#define MAKE_HANDLE(_slot_,_generation_) (((_generation_) << SLOT_BITS) | (_slot_))
+#define HANDLE_SLOT(_h_)                 ((_h_) & SLOT_MASK)
+#define HANDLE_GENERATION(_h_)           ((_h_) >> SLOT_BITS)
+
+/*____________________________________________________________________
+|
+| Function: EggStore_Init
+|
+| Input: Called from Program_Run(), EggStore_Benchmark()
+| Output: Allocates an empty store.
+|___________________________________________________________________*/
+
+void EggStore_Init (EggStore *store, int max_eggs)
+{
+  int i;
+
+  if (max_eggs > SLOT_MASK + 1)
+    max_eggs = SLOT_MASK + 1;
+
+  memset (store, 0, sizeof(EggStore));
+  store->max_eggs        = max_eggs;
+  store->handle          = (EggHandle *)     malloc (max_eggs * sizeof(EggHandle));
+  store->position        = (gx3dVector *)    malloc (max_eggs * sizeof(gx3dVector));
+  store->phase           = (float *)         malloc (max_eggs * sizeof(float));
+  store->amplitude       = (float *)         malloc (max_eggs * sizeof(float));
+  store->matrix          = (gx3dMatrix *)    malloc (max_eggs * sizeof(gx3dMatrix));
+  store->sphere          = (gx3dSphere *)    malloc (max_eggs * sizeof(gx3dSphere));
+  store->on_screen       = (unsigned char *) calloc (max_eggs, 1);
+  store->slot_index      = (int *)           malloc (max_eggs * sizeof(int));
+  store->slot_generation = (unsigned *)      malloc (max_eggs * sizeof(unsigned));
+  store->free_slot       = (int *)           malloc (max_eggs * sizeof(int));
+
+  // Hand out low slots first
+  for (i=0; i<max_eggs; i++) {
+    store->slot_index[i]      = -1;
+    store->slot_generation[i] = 1;
+    store->free_slot[i]       = max_eggs - 1 - i;
+  }
+  store->num_free = max_eggs;
+}
+
+/*____________________________________________________________________
+|
+| Function: EggStore_Add
+|
+| Input: Called from Program_Run(), EggStore_Benchmark()
+| Output: Adds an egg to the end of the arrays.  Returns its handle or
+|   EGG_NULL_HANDLE if the store is full.
+|___________________________________________________________________*/
+
+EggHandle EggStore_Add (EggStore *store, gx3dVector *position)
+{
+  int i, slot;
+
+  if (store->num_free == 0)
+    return (EGG_NULL_HANDLE);
+
+  slot = store->free_slot[--store->num_free];
+  i = store->count++;
+  store->slot_index[slot] = i;
+  store->handle[i]        = MAKE_HANDLE (slot, store->slot_generation[slot]);
+  store->position[i]      = *position;
+  store->phase[i]         = 0;
+  store->amplitude[i]     = 0;
+  gx3d_GetTranslateMatrix (&store->matrix[i], position->x, position->y, position->z);
+  store->sphere[i].center = *position;
+  store->sphere[i].radius = 0;
+  store->on_screen[i]     = 0;
+
+  return (store->handle[i]);
+}
+
+/*____________________________________________________________________
+|
+| Function: EggStore_Remove
+|
+| Input: Called from Program_Run(), EggStore_Benchmark()
+| Output: Removes an egg by moving the last egg into its place.
+|   Returns false if the handle is stale.
+|___________________________________________________________________*/
+
+bool EggStore_Remove (EggStore *store, EggHandle egg)
+{
+  int i, last, slot;
+
+  i = EggStore_Index (store, egg);
+  if (i == -1)
+    return (false);
+
+  last = --store->count;
+  if (i != last) {
+    store->handle[i]    = store->handle[last];
+    store->position[i]  = store->position[last];
+    store->phase[i]     = store->phase[last];
+    store->amplitude[i] = store->amplitude[last];
+    store->matrix[i]    = store->matrix[last];
+    store->sphere[i]    = store->sphere[last];
+    store->on_screen[i] = store->on_screen[last];
+    store->slot_index[HANDLE_SLOT (store->handle[i])] = i;
+  }
+
+  // Free the slot, never using generation 0 so no handle is ever EGG_NULL_HANDLE
+  slot = HANDLE_SLOT (egg);
+  store->slot_index[slot] = -1;
+  store->slot_generation[slot] = (store->slot_generation[slot] + 1) & GENERATION_MASK;
+  if (store->slot_generation[slot] == 0)
+    store->slot_generation[slot] = 1;
+  store->free_slot[store->num_free++] = slot;
+  store->num_removed++;
+
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: EggStore_Index
+|
+| Input: Called from ____
+| Output: Returns index of an egg in the component arrays or -1 if the
+|   handle is stale.
+|___________________________________________________________________*/
+
+int EggStore_Index (EggStore *store, EggHandle egg)
+{
+  int slot = HANDLE_SLOT (egg);
+
+  if ((slot >= store->max_eggs) OR (store->slot_generation[slot] != HANDLE_GENERATION (egg)))
+    return (-1);
+  return (store->slot_index[slot]);
+}
+
+/*____________________________________________________________________
+|
+| Function: EggStore_Free
+|
+| Input: Called from Program_Run(), EggStore_Benchmark()
+| Output: Frees a store.
+|___________________________________________________________________*/
+
+void EggStore_Free (EggStore *store)
+{
+  free (store->handle);
+  free (store->position);
+  free (store->phase);
+  free (store->amplitude);
+  free (store->matrix);
+  free (store->sphere);
+  free (store->on_screen);
+  free (store->slot_index);
+  free (store->slot_generation);
+  free (store->free_slot);
+  memset (store, 0, sizeof(EggStore));
+}
+
+/*____________________________________________________________________
+|
+| Function: EggStore_Benchmark
+|
+| Input: Called from Program_Run()
+| Output: Fills a store with 50,000 eggs, removes every other one by
+|   handle, iterates over the rest and checks that handles still find
+|   the right eggs.  Writes the results to the debug file.
+|___________________________________________________________________*/
+
+void EggStore_Benchmark ()
+{
+  int i, n, index, errors;
+  float add_ms, remove_ms, iterate_ms, sum;
+  char str [200];
+  EggHandle *handles;
+  gx3dVector v;
+  double start;
+  EggStore store;
+
+  n = 50000;
+  EggStore_Init (&store, n);
+  handles = (EggHandle *) malloc (n * sizeof(EggHandle));
+
+  start = Timer_Now_Ms ();
+  for (i=0; i<n; i++) {
+    v.x = (float)i;
+    v.y = 0;
+    v.z = 0;
+    handles[i] = EggStore_Add (&store, &v);
+  }
+  add_ms = Timer_Elapsed_Ms (start);
+
+  start = Timer_Now_Ms ();
+  for (i=0; i<n; i+=2)
+    EggStore_Remove (&store, handles[i]);
+  remove_ms = Timer_Elapsed_Ms (start);
+
+  start = Timer_Now_Ms ();
+  sum = 0;
+  for (i=0; i<store.count; i++)
+    sum += store.position[i].x;
+  iterate_ms = Timer_Elapsed_Ms (start);
+
+  // Removed handles must be stale, the rest must find their own egg
+  errors = 0;
+  for (i=0; i<n; i++) {
+    index = EggStore_Index (&store, handles[i]);
+    if (i & 1) {
+      if ((index == -1) OR (store.position[index].x != (float)i))
+        errors++;
+    }
+    else if (index != -1)
+      errors++;
+  }
+  if (EggStore_Remove (&store, handles[0]))
+    errors++;
+
+  sprintf (str, "Egg store: %d eggs, add %.3f ms, remove half %.3f ms, iterate %d live %.3f ms (sum %.0f), %d errors",
+    n, add_ms, remove_ms, store.count, iterate_ms, sum, errors);
+  debug_WriteFile (str);
+
+  free (handles);
+  EggStore_Free (&store);
+}
@@ -0,0 +1,52 @@
+/*____________________________________________________________________
+|
+| File: eggstore.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+// Handle to an egg, stays valid until the egg is removed.  A stale handle is
+// caught until its slot has been reused 4095 times (a 12-bit generation that
+// skips 0), after which the same handle value comes round again
+typedef unsigned EggHandle;
+
+#define EGG_NULL_HANDLE 0
+
+// Live eggs are packed into the first count entries of each component array
+struct EggStore {
+  int            count;         // # of live eggs
+  int            max_eggs;
+  int            num_removed;   // # removed since EggStore_Init()
+  // Components
+  EggHandle     *handle;        // handle of each egg
+  gx3dVector    *position;      // resting position
+  float         *phase;         // animation phase (radians)
+  float         *amplitude;     // height of the bob
+  gx3dMatrix    *matrix;        // world matrix, updated each frame
+  gx3dSphere    *sphere;        // world bounding sphere, updated each frame
+  unsigned char *on_screen;     // drawn this frame?
+  // Handle lookup
+  int           *slot_index;    // index of the egg in each slot, -1 if free
+  unsigned      *slot_generation;
+  int           *free_slot;
+  int            num_free;
+};
+
+// Allocates an empty store
+void EggStore_Init (EggStore *store, int max_eggs);
+
+// Adds an egg, returns its handle or EGG_NULL_HANDLE if the store is full
+EggHandle EggStore_Add (EggStore *store, gx3dVector *position);
+
+// Removes an egg (the last egg moves into its place), returns false if the handle is stale
+bool EggStore_Remove (EggStore *store, EggHandle egg);
+
+// Returns index of an egg in the component arrays or -1 if the handle is stale
+int EggStore_Index (EggStore *store, EggHandle egg);
+
+// Frees a store
+void EggStore_Free (EggStore *store);
+
+// Times adding, removing and iterating a large store and writes the results to the debug file
+void EggStore_Benchmark ();
@@ -0,0 +1,341 @@
+/*____________________________________________________________________
+|
+| File: foliage.cpp
+|
+| Description: Layers of static billboard instances (grass, fields,
+|   trees).  Each layer has a max draw distance and a fade start
+|   distance.  Between the two, a stable subset of the instances is
+|   dropped based on a hash of the instance, so density falls off
+|   smoothly with distance without instances popping from frame to
+|   frame.
+|
+| Functions: Foliage_Create_Layer
+|            Foliage_Add_Instance
+|            Foliage_Set_Layer_Distance
+|            Foliage_Get_Layer_Distance
+|            Foliage_Num_Layers
+|            Foliage_Layer_Name
+|            Foliage_Submit
+|            Foliage_Get_Stats
+|            Foliage_Free
+|             Hash_Instance
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+#include <math.h>
+
+#include "dp.h"
+
+#include "occlusion.h"
+#include "renderqueue.h"
+#include "foliage.h"
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+struct FoliageLayer {
+  char         name[32];
+  gx3dObject  *obj;
+  int          material;
+  float        scale;
+  float        rotate_y;
+  float        radius;          // radius of a sphere around any instance
+  float        fade_start;
+  float        max_distance;
+  int          num_instances;
+  int          max_instances;
+  gx3dVector  *position;
+  float       *threshold;       // instance is drawn while density is above this (0-1)
+  gx3dMatrix  *matrix;          // world matrix of each instance
+};
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static float Hash_Instance (int layer, int instance);
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define DEFAULT_FADE_START   2000
+#define DEFAULT_MAX_DISTANCE 4000
+
+/*___________________
+|
+| Global variables
+|__________________*/
+
+static FoliageLayer layers [FOLIAGE_MAX_LAYERS];
+static int          num_layers = 0;
+static FoliageStats stats;
+
+/*____________________________________________________________________
+|
+| Function: Foliage_Create_Layer
+|
+| Input: Called from Program_Run()
+| Output: Creates a new empty layer.  Returns layer id or -1 on error.
+|___________________________________________________________________*/
+
+int Foliage_Create_Layer (
+  const char  *name,
+  gx3dObject  *obj,
+  int          material,
+  float        scale,
+  float        rotate_y )
+{
+  FoliageLayer *l;
+  gx3dVector *c;
+
+  if (num_layers == FOLIAGE_MAX_LAYERS)
+    return (-1);
+
+  l = &layers[num_layers];
+  memset (l, 0, sizeof(FoliageLayer));
+  strncpy (l->name, name, sizeof(l->name)-1);
+  l->obj          = obj;
+  l->material     = material;
+  l->scale        = scale;
+  l->rotate_y     = rotate_y;
+  l->fade_start   = DEFAULT_FADE_START;
+  l->max_distance = DEFAULT_MAX_DISTANCE;
+
+  // Rotation invariant radius around the instance position
+  c = &obj->bound_sphere.center;
+  l->radius = scale * ((float)sqrt (c->x * c->x + c->y * c->y + c->z * c->z) + obj->bound_sphere.radius);
+
+  return (num_layers++);
+}
+
+/*____________________________________________________________________
+|
+| Function: Foliage_Add_Instance
+|
+| Input: Called from Program_Run()
+| Output: Adds an instance to a layer.
+|___________________________________________________________________*/
+
+void Foliage_Add_Instance (int layer, float x, float y, float z)
+{
+  int n;
+  FoliageLayer *l;
+  gx3dMatrix m, m1, m2, m3;
+
+  if ((layer < 0) OR (layer >= num_layers))
+    return;
+  l = &layers[layer];
+
+  // Grow arrays?
+  if (l->num_instances == l->max_instances) {
+    n = l->max_instances ? l->max_instances * 2 : 64;
+    l->position  = (gx3dVector *) realloc (l->position,  n * sizeof(gx3dVector));
+    l->threshold = (float *)      realloc (l->threshold, n * sizeof(float));
+    l->matrix    = (gx3dMatrix *) realloc (l->matrix,    n * sizeof(gx3dMatrix));
+    l->max_instances = n;
+  }
+
+  n = l->num_instances++;
+  l->position[n].x = x;
+  l->position[n].y = y;
+  l->position[n].z = z;
+  l->threshold[n]  = Hash_Instance (layer, n);
+
+  // Instances never move so build the world matrix now
+  gx3d_GetScaleMatrix (&m1, l->scale, l->scale, l->scale);
+  gx3d_GetRotateYMatrix (&m2, l->rotate_y);
+  gx3d_MultiplyMatrix (&m1, &m2, &m);
+  gx3d_GetTranslateMatrix (&m3, x, y, z);
+  gx3d_MultiplyMatrix (&m, &m3, &l->matrix[n]);
+}
+
+/*____________________________________________________________________
+|
+| Function: Foliage_Set_Layer_Distance
+|
+| Input: Called from ____
+| Output: Sets fade start and max draw distance of a layer.
+|___________________________________________________________________*/
+
+void Foliage_Set_Layer_Distance (int layer, float fade_start, float max_distance)
+{
+  if ((layer < 0) OR (layer >= num_layers))
+    return;
+
+  if (max_distance < 0)
+    max_distance = 0;
+  if (fade_start > max_distance)
+    fade_start = max_distance;
+  layers[layer].fade_start   = fade_start;
+  layers[layer].max_distance = max_distance;
+}
+
+/*____________________________________________________________________
+|
+| Function: Foliage_Get_Layer_Distance
+|
+| Input: Called from ____
+| Output: Returns fade start and max draw distance of a layer.
+|___________________________________________________________________*/
+
+void Foliage_Get_Layer_Distance (int layer, float *fade_start, float *max_distance)
+{
+  if ((layer < 0) OR (layer >= num_layers))
+    return;
+
+  *fade_start   = layers[layer].fade_start;
+  *max_distance = layers[layer].max_distance;
+}
+
+/*____________________________________________________________________
+|
+| Function: Foliage_Num_Layers
+|
+| Input: Called from ____
+| Output: Returns # of layers.
+|___________________________________________________________________*/
+
+int Foliage_Num_Layers ()
+{
+  return (num_layers);
+}
+
+/*____________________________________________________________________
+|
+| Function: Foliage_Layer_Name
+|
+| Input: Called from ____
+| Output: Returns name of a layer.
+|___________________________________________________________________*/
+
+const char *Foliage_Layer_Name (int layer)
+{
+  if ((layer < 0) OR (layer >= num_layers))
+    return ("");
+  return (layers[layer].name);
+}
+
+/*____________________________________________________________________
+|
+| Function: Foliage_Submit
+|
+| Input: Called from Record_Foliage() (on a recording thread)
+| Output: Records all instances within range of the camera that survive
+|   the density falloff and the occlusion test.
+|___________________________________________________________________*/
+
+void Foliage_Submit (int buffer, gx3dVector *camera_position)
+{
+  int i, j;
+  float dx, dy, dz, d2, fade2, max2, t, density;
+  FoliageLayer *l;
+  gx3dSphere sphere;
+
+  memset (&stats, 0, sizeof(stats));
+
+  for (i=0; i<num_layers; i++) {
+    l = &layers[i];
+    stats.instances += l->num_instances;
+    if (l->num_instances == 0)
+      continue;
+
+    fade2 = l->fade_start * l->fade_start;
+    max2  = l->max_distance * l->max_distance;
+    sphere.radius = l->radius;
+
+    for (j=0; j<l->num_instances; j++) {
+      dx = l->position[j].x - camera_position->x;
+      dy = l->position[j].y - camera_position->y;
+      dz = l->position[j].z - camera_position->z;
+      d2 = dx*dx + dy*dy + dz*dz;
+      if (d2 >= max2) {
+        stats.distance_culled++;
+        continue;
+      }
+      // Thin out between fade start and max distance
+      if (d2 > fade2) {
+        t = ((float)sqrt (d2) - l->fade_start) / (l->max_distance - l->fade_start);
+        density = 1 - t * t * (3 - 2 * t);
+        if (l->threshold[j] >= density) {
+          stats.faded++;
+          continue;
+        }
+      }
+      sphere.center = l->position[j];
+      if (NOT Occlusion_Sphere_Visible (&sphere)) {
+        stats.occluded++;
+        continue;
+      }
+      RenderQueue_Record (buffer, RQ_PASS_ALPHA, l->material, l->obj, &l->matrix[j]);
+      stats.drawn++;
+    }
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Foliage_Get_Stats
+|
+| Input: Called from ____
+| Output: Returns statistics for the last call to Foliage_Submit().
+|___________________________________________________________________*/
+
+void Foliage_Get_Stats (FoliageStats *foliage_stats)
+{
+  *foliage_stats = stats;
+}
+
+/*____________________________________________________________________
+|
+| Function: Foliage_Free
+|
+| Input: Called from Program_Run()
+| Output: Frees all layers.
+|___________________________________________________________________*/
+
+void Foliage_Free ()
+{
+  int i;
+
+  for (i=0; i<num_layers; i++) {
+    free (layers[i].position);
+    free (layers[i].threshold);
+    free (layers[i].matrix);
+  }
+  num_layers = 0;
+}
+
+/*____________________________________________________________________
+|
+| Function: Hash_Instance
+|
+| Input: Called from Foliage_Add_Instance()
+| Output: Returns a stable pseudo random value in [0,1) for an instance.
+|___________________________________________________________________*/
+
+static float Hash_Instance (int layer, int instance)
+{
+  unsigned h;
+
+  h = (unsigned)instance * 0x9E3779B1u + (unsigned)layer * 0x85EBCA77u;
+  h ^= h >> 16;
+  h *= 0x7FEB352Du;
+  h ^= h >> 15;
+  h *= 0x846CA68Bu;
+  h ^= h >> 16;
+
+  return ((float)(h >> 8) * (1.0f / 16777216));
+}
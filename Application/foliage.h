@@ -0,0 +1,48 @@
+/*____________________________________________________________________
+|
+| File: foliage.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+#define FOLIAGE_MAX_LAYERS 16
+
+// Per-frame statistics
+struct FoliageStats {
+  int instances;            // total # of instances in all layers
+  int drawn;                // # drawn
+  int distance_culled;      // # beyond the layer max distance
+  int faded;                // # dropped by the density falloff
+  int occluded;             // # hidden by the occlusion buffer
+};
+
+// Creates a new layer of instances of an object, returns layer id or -1 on error
+int Foliage_Create_Layer (
+  const char  *name,
+  gx3dObject  *obj,
+  int          material,    // render queue material
+  float        scale,       // uniform scale of each instance
+  float        rotate_y );  // y rotation of each instance (degrees)
+
+// Adds an instance to a layer
+void Foliage_Add_Instance (int layer, float x, float y, float z);
+
+// Sets the distance at which a layer starts thinning out and the distance beyond which nothing is drawn
+void Foliage_Set_Layer_Distance (int layer, float fade_start, float max_distance);
+
+// Gets layer distances
+void Foliage_Get_Layer_Distance (int layer, float *fade_start, float *max_distance);
+
+// Returns the number of layers, and the name of a layer
+int   Foliage_Num_Layers ();
+const char *Foliage_Layer_Name (int layer);
+
+// Records all visible instances into a render queue command buffer (may run on a recording thread)
+void Foliage_Submit (int buffer, gx3dVector *camera_position);
+
+// Returns statistics for the last call to Foliage_Submit()
+void Foliage_Get_Stats (FoliageStats *stats);
+
+// Free all layers
+void Foliage_Free ();
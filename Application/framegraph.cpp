@@ -0,0 +1,364 @@
+/*____________________________________________________________________
+|
+| File: framegraph.cpp
+|
+| Description: Frame graph.  The frame is described once as a list of
+|   passes, each naming the resources (color buffer, depth buffer,
+|   occlusion buffer, render queue, ...) it reads and writes and the
+|   state it's drawn with.  Each frame the passes turned on are culled
+|   and run:
+|
+|   Order: passes that touch the same resource (one writing it) run in
+|     the order they were added, except that a pass reading a resource
+|     no pass before it writes is moved after the passes that do.
+|     Passes that share nothing keep the order added.  The order is
+|     worked out once, when a pass is added after the last frame.
+|   Culling: walking back from the last pass, a pass is kept if it
+|     writes a resource still needed (starting with the output).  The
+|     resources it reads are then needed, and the resources it writes
+|     are not needed before it if it covers them (like a full screen
+|     overlay), so everything drawn under it is culled.
+|   State: alpha blending and testing are set for each pass, and a
+|     screen view pass gets a fixed camera and the view matrix back
+|     after.  Redundant changes are dropped by render.cpp.
+|   Timing: each pass is timed on the CPU.
+|
+| Functions: FrameGraph_Add_Resource
+|            FrameGraph_Add_Pass
+|            FrameGraph_Set_Output
+|            FrameGraph_Enable_Pass
+|            FrameGraph_Execute
+|             Order_Passes
+|            FrameGraph_Get_Stats
+|            FrameGraph_Write_Stats
+|            FrameGraph_Free
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+#include <stdio.h>
+
+#include "dp.h"
+
+#include "timer.h"
+#include "render.h"
+#include "framegraph.h"
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+struct Pass {
+  const char     *name;
+  FrameGraphFunc  func;
+  void           *data;
+  unsigned        reads, writes, flags;
+  int             alpha_reference;
+  bool            enabled;
+  bool            executed;
+  float           ms;
+};
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static void  Order_Passes ();
+
+/*___________________
+|
+| Global variables
+|__________________*/
+
+static Pass        pass [FRAMEGRAPH_MAX_PASSES];
+static int         num_passes = 0;
+static const char *resource_name [FRAMEGRAPH_MAX_RESOURCES];
+static int         num_resources = 0;
+static unsigned    output = 0;
+
+// Pass ids in the order they run
+static int  order [FRAMEGRAPH_MAX_PASSES];
+static bool ordered = false;
+
+static FrameGraphStats stats;
+
+/*____________________________________________________________________
+|
+| Function: FrameGraph_Add_Resource
+|
+| Input: Called from Program_Run()
+| Output: Returns the bit of a new resource or 0 if there are too many.
+|___________________________________________________________________*/
+
+unsigned FrameGraph_Add_Resource (const char *name)
+{
+  if (num_resources == FRAMEGRAPH_MAX_RESOURCES)
+    return (0);
+  resource_name[num_resources] = name;
+  return (1u << num_resources++);
+}
+
+/*____________________________________________________________________
+|
+| Function: FrameGraph_Add_Pass
+|
+| Input: Called from Program_Run()
+| Output: Returns pass id of a new pass (enabled) or -1 on error.
+|___________________________________________________________________*/
+
+int FrameGraph_Add_Pass (
+  const char     *name,
+  FrameGraphFunc  func,
+  void           *data,
+  unsigned        reads,
+  unsigned        writes,
+  unsigned        flags,
+  int             alpha_reference )
+{
+  Pass *p;
+
+  if ((num_passes == FRAMEGRAPH_MAX_PASSES) OR (func == 0))
+    return (-1);
+
+  p = &pass[num_passes];
+  p->name            = name;
+  p->func            = func;
+  p->data            = data;
+  p->reads           = reads;
+  p->writes          = writes;
+  p->flags           = flags;
+  p->alpha_reference = alpha_reference;
+  p->enabled         = true;
+  p->executed        = false;
+  p->ms              = 0;
+  ordered = false;
+
+  return (num_passes++);
+}
+
+/*____________________________________________________________________
+|
+| Function: FrameGraph_Set_Output
+|
+| Input: Called from Program_Run()
+| Output: Sets the resources the frame produces.
+|___________________________________________________________________*/
+
+void FrameGraph_Set_Output (unsigned resources)
+{
+  output = resources;
+}
+
+/*____________________________________________________________________
+|
+| Function: FrameGraph_Enable_Pass
+|
+| Input: Called from Program_Run()
+| Output: Turns a pass on or off.
+|___________________________________________________________________*/
+
+void FrameGraph_Enable_Pass (int id, bool enable)
+{
+  if ((id >= 0) AND (id < num_passes))
+    pass[id].enabled = enable;
+}
+
+/*____________________________________________________________________
+|
+| Function: FrameGraph_Execute
+|
+| Input: Called from Program_Run()
+| Output: Culls the passes not needed for the output and runs the rest.
+|___________________________________________________________________*/
+
+void FrameGraph_Execute ()
+{
+  int i;
+  unsigned needed;
+  gx3dMatrix view;
+  gx3dVector from = { 0, 0, 1 }, to = { 0, 0, 0 }, world_up = { 0, 1, 0 };
+  double start, pass_start;
+  Pass *p;
+
+  if (NOT ordered)
+    Order_Passes ();
+
+  start = Timer_Now_Ms ();
+
+  // Cull, walking back from the output
+  needed = output;
+  for (i=num_passes-1; i>=0; i--) {
+    p = &pass[order[i]];
+    p->executed = false;
+    p->ms = 0;
+    if (NOT p->enabled)
+      continue;
+    if ((p->writes & needed) OR (p->flags & FRAMEGRAPH_KEEP)) {
+      p->executed = true;
+      if (p->flags & FRAMEGRAPH_COVERS)
+        needed &= ~p->writes;
+      needed |= p->reads;
+    }
+  }
+
+  // Run
+  for (i=0; i<num_passes; i++) {
+    p = &pass[order[i]];
+    if (NOT p->executed)
+      continue;
+    pass_start = Timer_Now_Ms ();
+    if (p->flags & FRAMEGRAPH_ALPHA_BLEND)
+      Render_Enable_Alpha_Blending ();
+    else
+      Render_Disable_Alpha_Blending ();
+    if (p->flags & FRAMEGRAPH_ALPHA_TEST)
+      Render_Enable_Alpha_Testing (p->alpha_reference);
+    else
+      Render_Disable_Alpha_Testing ();
+    if (p->flags & FRAMEGRAPH_SCREEN_VIEW) {
+      Render_Get_View_Matrix (&view);
+      Render_Set_Camera (&from, &to, &world_up);
+    }
+    (*p->func) (p->data);
+    if (p->flags & FRAMEGRAPH_SCREEN_VIEW)
+      Render_Set_View_Matrix (&view);
+    p->ms = Timer_Elapsed_Ms (pass_start);
+  }
+
+  // Statistics, in the order the passes ran
+  memset (&stats, 0, sizeof(stats));
+  stats.passes = num_passes;
+  for (i=0; i<num_passes; i++) {
+    p = &pass[order[i]];
+    stats.pass[i].name     = p->name;
+    stats.pass[i].enabled  = p->enabled;
+    stats.pass[i].executed = p->executed;
+    stats.pass[i].ms       = p->ms;
+    if (p->executed)
+      stats.executed++;
+    else if (p->enabled)
+      stats.culled++;
+  }
+  stats.total_ms = Timer_Elapsed_Ms (start);
+}
+
+/*____________________________________________________________________
+|
+| Function: Order_Passes
+|
+| Input: Called from FrameGraph_Execute()
+| Output: Sorts the passes so each runs after the passes it depends on,
+|   keeping the order they were added in where it can.  If they depend
+|   on each other in a circle they run in the order added.
+|___________________________________________________________________*/
+
+static void Order_Passes ()
+{
+  int i, j, k, n;
+  unsigned written_before [FRAMEGRAPH_MAX_PASSES];   // resources written by the passes added before each
+  bool placed [FRAMEGRAPH_MAX_PASSES], ready;
+  static bool after [FRAMEGRAPH_MAX_PASSES][FRAMEGRAPH_MAX_PASSES];  // after[i][j] if j must run after i
+
+  written_before[0] = 0;
+  for (i=1; i<num_passes; i++)
+    written_before[i] = written_before[i-1] | pass[i-1].writes;
+
+  memset (after, 0, sizeof(after));
+  for (i=0; i<num_passes; i++)
+    for (j=0; j<num_passes; j++) {
+      // Passes where one writes what the other uses run in the order added
+      if (i < j)
+        after[i][j] = ((pass[i].writes & (pass[j].reads | pass[j].writes)) OR (pass[i].reads & written_before[i] & pass[j].writes));
+      // A pass reading what only passes added after it write runs after them
+      else if (i > j)
+        after[i][j] = ((pass[i].writes & pass[j].reads & ~written_before[j]) != 0);
+    }
+
+  // Each time, place the first pass added whose passes before it are all placed
+  memset (placed, 0, sizeof(placed));
+  for (n=0; n<num_passes; n++) {
+    for (i=0; i<num_passes; i++) {
+      if (placed[i])
+        continue;
+      ready = true;
+      for (k=0; (k<num_passes) AND ready; k++)
+        if (after[k][i] AND NOT placed[k])
+          ready = false;
+      if (ready)
+        break;
+    }
+    if (i == num_passes) {
+      debug_WriteFile ("FrameGraph_Execute(): passes depend on each other in a circle, running them in the order added");
+      for (i=0; i<num_passes; i++)
+        order[i] = i;
+      ordered = true;
+      return;
+    }
+    placed[i] = true;
+    order[n] = i;
+  }
+  ordered = true;
+}
+
+/*____________________________________________________________________
+|
+| Function: FrameGraph_Get_Stats
+|
+| Input: Called from FrameGraph_Write_Stats()
+| Output: Returns statistics for the last frame.
+|___________________________________________________________________*/
+
+void FrameGraph_Get_Stats (FrameGraphStats *frame_stats)
+{
+  *frame_stats = stats;
+}
+
+/*____________________________________________________________________
+|
+| Function: FrameGraph_Write_Stats
+|
+| Input: Called from Program_Run()
+| Output: Writes the statistics for the last frame to the debug file.
+|___________________________________________________________________*/
+
+void FrameGraph_Write_Stats ()
+{
+  int i;
+  char str [200];
+
+  sprintf (str, "Frame graph: %d passes, %d run, %d culled, %.3f ms", stats.passes, stats.executed, stats.culled, stats.total_ms);
+  debug_WriteFile (str);
+  for (i=0; i<stats.passes; i++) {
+    if (stats.pass[i].executed)
+      sprintf (str, "  %-12s %.3f ms", stats.pass[i].name, stats.pass[i].ms);
+    else
+      sprintf (str, "  %-12s %s", stats.pass[i].name, stats.pass[i].enabled ? "culled" : "off");
+    debug_WriteFile (str);
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: FrameGraph_Free
+|
+| Input: Called from Program_Run()
+| Output: Removes all passes and resources.
+|___________________________________________________________________*/
+
+void FrameGraph_Free ()
+{
+  num_passes    = 0;
+  num_resources = 0;
+  output  = 0;
+  ordered = false;
+  memset (&stats, 0, sizeof(stats));
+}
@@ -0,0 +1,70 @@
+/*____________________________________________________________________
+|
+| File: framegraph.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+#define FRAMEGRAPH_MAX_PASSES    32
+#define FRAMEGRAPH_MAX_RESOURCES 32
+
+// State a pass is drawn with (alpha blending and testing are off unless asked for)
+#define FRAMEGRAPH_ALPHA_BLEND  0x1
+#define FRAMEGRAPH_ALPHA_TEST   0x2
+#define FRAMEGRAPH_SCREEN_VIEW  0x4     // camera at (0,0,1) looking at the origin, the view matrix is restored after
+// How a pass can be culled
+#define FRAMEGRAPH_COVERS       0x8     // overwrites all of its outputs, so nothing written to them before is needed
+#define FRAMEGRAPH_KEEP         0x10    // never culled
+
+// Draws a pass
+typedef void (*FrameGraphFunc) (void *data);
+
+struct FrameGraphPassStats {
+  const char *name;
+  bool        enabled;
+  bool        executed;     // false if disabled or culled
+  float       ms;           // time spent in the pass (CPU time, the GPU may finish later)
+};
+
+// Statistics for the last call to FrameGraph_Execute()
+struct FrameGraphStats {
+  int                 passes;
+  int                 executed;
+  int                 culled;       // enabled but not needed for the output
+  float               total_ms;
+  FrameGraphPassStats pass [FRAMEGRAPH_MAX_PASSES];   // in the order they run
+};
+
+// Adds a resource passes read and write (like the color buffer), returns its bit or 0 if there are too many
+unsigned FrameGraph_Add_Resource (const char *name);
+
+// Adds a pass, returns pass id or -1 on error.  Passes run in the order added, except that a pass reading a
+//  resource no pass added before it writes runs after the passes that do.  New passes are enabled.
+int FrameGraph_Add_Pass (
+  const char     *name,
+  FrameGraphFunc  func,
+  void           *data,
+  unsigned        reads,            // resource bits
+  unsigned        writes,
+  unsigned        flags,            // FRAMEGRAPH_ flags
+  int             alpha_reference );// for FRAMEGRAPH_ALPHA_TEST
+
+// Sets the resources the frame exists to produce.  Passes that don't contribute to them are culled.
+void FrameGraph_Set_Output (unsigned resources);
+
+// Turns a pass on or off for the frames that follow
+void FrameGraph_Enable_Pass (int pass, bool enable);
+
+// Culls the passes not needed for the output, then runs the rest in order with the state each asks for.
+//  Call between Render_Begin() and Render_End().
+void FrameGraph_Execute ();
+
+// Returns statistics for the last call to FrameGraph_Execute()
+void FrameGraph_Get_Stats (FrameGraphStats *stats);
+
+// Writes the statistics to the debug file
+void FrameGraph_Write_Stats ();
+
+// Removes all passes and resources
+void FrameGraph_Free ();
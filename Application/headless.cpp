@@ -0,0 +1,318 @@
+/*____________________________________________________________________
+|
+| File: headless.cpp
+|
+| Description: Runs the renderer with no window, no gx3d and no GPU,
+|   so it can be profiled anywhere (a Linux build machine, a CI job).
+|   A scene made from the game's objects (sky, ground, hills, a ring of
+|   fence and a field of eggs) is drawn for a number of frames through
+|   the render front end, with a camera walking in from where the game
+|   starts.  It is drawn once with the null backend, which counts the
+|   commands, and once with the software backend, which rasterizes them
+|   on the CPU, writes the last frame to headless.bmp and then times
+|   that frame at a few sizes.  Everything is reported on stdout.
+|
+|   It is not part of the Windows project.  To build it with g++, from
+|   the Application directory:
+|
+|     g++ -O2 -std=c++14 -pthread -msse2 -o headless headless.cpp
+|       portable.cpp render.cpp rendernull.cpp rendersoft.cpp lwo2.cpp
+|       timer.cpp
+|
+|   and run it from the directory Objects is in:
+|
+|     Application/headless [frames [width height]]
+|
+| Functions: main
+|             Load_Scene
+|             Draw_Scene
+|             Free_Scene
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include "portable.h"
+
+#include "render.h"
+#include "rendernull.h"
+#include "rendersoft.h"
+#include "timer.h"
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define DEFAULT_FRAMES  60
+#define DEFAULT_WIDTH   640
+#define DEFAULT_HEIGHT  480
+
+#define FOV             89        // degrees, near and far planes as in the game
+#define NEAR_PLANE      0.1f
+#define FAR_PLANE       80000
+
+#define NUM_FENCE       48        // fence posts in a ring around the field
+#define FENCE_RADIUS    4000
+#define NUM_HILLS       8
+#define HILL_RADIUS     6000
+#define EGG_ROWS        20        // eggs in a grid in front of the camera
+#define EGG_COLUMNS     20
+#define EGG_SPACING     40
+
+#define WALK_PER_FRAME  10        // feet the camera moves forward each frame
+
+#define IMAGE_FILENAME  "headless.bmp"
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+struct Scene {
+  gx3dObject  *obj_sky, *obj_ground, *obj_hill, *obj_fence, *obj_egg;
+  gx3dTexture  tex_sky, tex_ground, tex_hill, tex_fence, tex_egg;
+  gx3dLight    light;
+  gx3dMatrix   hill [NUM_HILLS];
+  gx3dMatrix   fence [NUM_FENCE];
+  gx3dMatrix   egg [EGG_ROWS * EGG_COLUMNS];
+};
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static bool Load_Scene (Scene *scene);
+static void Draw_Scene (Scene *scene, int frame);
+static void Free_Scene (Scene *scene);
+
+/*____________________________________________________________________
+|
+| Function: main
+|
+| Input: Called from the command line
+| Output: Draws the scene with the null and then the software backend
+|   and writes what each did to stdout.  Returns 0 on success.
+|___________________________________________________________________*/
+
+int main (int argc, char *argv[])
+{
+  int i, frames, width, height;
+  int bench_widths [2]  = { 640, 1280 };
+  int bench_heights [2] = { 480, 720 };
+  double start;
+  char str [300];
+  Scene scene;
+  RenderStats render_stats;
+
+  frames = (argc > 1) ? atoi (argv[1]) : DEFAULT_FRAMES;
+  width  = (argc > 3) ? atoi (argv[2]) : DEFAULT_WIDTH;
+  height = (argc > 3) ? atoi (argv[3]) : DEFAULT_HEIGHT;
+  if ((frames < 1) OR (width < 1) OR (height < 1)) {
+    printf ("usage: headless [frames [width height]]\n");
+    return (1);
+  }
+
+  // Null backend: count what a frame of the scene asks for
+  Render_Set_Backend (RenderNull_Backend ());
+  Render_Set_Projection (FOV, NEAR_PLANE, FAR_PLANE, (float)width / height);
+  if (NOT Load_Scene (&scene)) {
+    printf ("Can't load the scene (run from the directory Objects is in)\n");
+    return (1);
+  }
+  RenderNull_Reset ();
+  for (i=0; i<frames; i++)
+    Draw_Scene (&scene, i);
+  Render_Get_Stats (&render_stats);
+  sprintf (str, "Render front end: %d draw calls, %d instanced batches of %d instances, %d of %d state changes sent",
+    render_stats.draw_calls, render_stats.instanced_batches, render_stats.instances, render_stats.state_changes, render_stats.state_requests);
+  debug_WriteFile (str);
+  RenderNull_Write_Stats ();
+  Free_Scene (&scene);
+
+  // Software backend: rasterize the same frames
+  if (NOT RenderSoft_Init (width, height)) {
+    printf ("Can't allocate a %dx%d frame buffer\n", width, height);
+    RenderNull_Free ();
+    return (1);
+  }
+  Render_Set_Backend (RenderSoft_Backend ());
+  if (NOT Load_Scene (&scene)) {
+    printf ("Can't load the scene\n");
+    RenderNull_Free ();
+    RenderSoft_Free ();
+    return (1);
+  }
+  start = Timer_Now_Ms ();
+  for (i=0; i<frames; i++)
+    Draw_Scene (&scene, i);
+  sprintf (str, "Software backend: %d frames in %.1f ms", frames, Timer_Elapsed_Ms (start));
+  debug_WriteFile (str);
+  RenderSoft_Write_Stats ();
+  if (RenderSoft_Write_Image (IMAGE_FILENAME)) {
+    sprintf (str, "Last frame written to %s", IMAGE_FILENAME);
+    debug_WriteFile (str);
+  }
+  RenderSoft_Benchmark (bench_widths, bench_heights, 2, frames, 0);
+  Free_Scene (&scene);
+
+  Render_Set_Backend (RenderNull_Backend ());
+  RenderSoft_Free ();
+  RenderNull_Free ();
+
+  return (0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Load_Scene
+|
+| Input: Called from main()
+| Output: Loads the objects, textures and light of the scene with the
+|   current backend and places everything.  Returns true on success.
+|___________________________________________________________________*/
+
+static bool Load_Scene (Scene *scene)
+{
+  int i, j;
+  float angle;
+  gx3dMatrix m;
+  gx3dLightData light_data;
+
+  memset (scene, 0, sizeof(Scene));
+
+  scene->obj_sky    = Render_Load_Object ("Objects/skydome.lwo");
+  scene->obj_ground = Render_Load_Object ("Objects/ground.lwo");
+  scene->obj_hill   = Render_Load_Object ("Objects/hill.lwo");
+  scene->obj_fence  = Render_Load_Object ("Objects/fence.lwo");
+  scene->obj_egg    = Render_Load_Object ("Objects/egg.lwo");
+  if ((scene->obj_sky == 0) OR (scene->obj_ground == 0) OR (scene->obj_hill == 0) OR
+      (scene->obj_fence == 0) OR (scene->obj_egg == 0)) {
+    Free_Scene (scene);
+    return (false);
+  }
+  scene->tex_sky    = Render_Load_Texture ("Objects/Images/sky.bmp", 0);
+  scene->tex_ground = Render_Load_Texture ("Objects/Images/grass2.bmp", 0);
+  scene->tex_hill   = Render_Load_Texture ("Objects/Images/hill.bmp", 0);
+  scene->tex_fence  = Render_Load_Texture ("Objects/Images/wood.bmp", 0);
+  scene->tex_egg    = Render_Load_Texture ("Objects/Images/egg.bmp", 0);
+
+  // The game's main light
+  memset (&light_data, 0, sizeof(light_data));
+  light_data.light_type = gx3d_LIGHT_TYPE_DIRECTION;
+  light_data.direction.diffuse_color.r = 1;
+  light_data.direction.diffuse_color.g = 1;
+  light_data.direction.diffuse_color.b = 1;
+  light_data.direction.specular_color  = light_data.direction.diffuse_color;
+  light_data.direction.dst.x = -1;
+  light_data.direction.dst.y = -1;
+  light_data.direction.dst.z = 0;
+  scene->light = Render_Init_Light (&light_data);
+
+  // Hills and fence in rings around the field
+  for (i=0; i<NUM_HILLS; i++) {
+    angle = 2 * 3.14159265f * i / NUM_HILLS;
+    gx3d_GetScaleMatrix (&scene->hill[i], 20, 20, 20);
+    gx3d_GetTranslateMatrix (&m, HILL_RADIUS * sinf (angle), 0, HILL_RADIUS * cosf (angle));
+    gx3d_MultiplyMatrix (&scene->hill[i], &m, &scene->hill[i]);
+  }
+  for (i=0; i<NUM_FENCE; i++) {
+    angle = 2 * 3.14159265f * i / NUM_FENCE;
+    gx3d_GetTranslateMatrix (&scene->fence[i], FENCE_RADIUS * sinf (angle), -5, FENCE_RADIUS * cosf (angle));
+  }
+
+  // Eggs in a grid the camera walks into
+  for (i=0; i<EGG_ROWS; i++)
+    for (j=0; j<EGG_COLUMNS; j++)
+      gx3d_GetTranslateMatrix (&scene->egg[i*EGG_COLUMNS+j],
+        (j - EGG_COLUMNS / 2) * EGG_SPACING, 0, -4800 + i * EGG_SPACING);
+
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: Draw_Scene
+|
+| Input: Called from main()
+| Output: Draws one frame of the scene, with the camera moved forward
+|   frame steps from the game's starting position.
+|___________________________________________________________________*/
+
+static void Draw_Scene (Scene *scene, int frame)
+{
+  gx3dMatrix m;
+  gx3dVector from, to, world_up = { 0, 1, 0 };
+  gxColor clear_color = { 0, 0, 0, 0 };
+  gx3dColor white = { 1, 1, 1, 1 };
+  gx3dMaterialData material = {
+    { 1, 1, 1, 1 },   // ambient color
+    { 1, 1, 1, 1 },   // diffuse color
+    { 1, 1, 1, 1 },   // specular color
+    { 0, 0, 0, 0 },   // emissive color
+    10                // specular sharpness
+  };
+
+  from.x = -200;
+  from.y = 100;
+  from.z = -4930 + (float)(frame * WALK_PER_FRAME);
+  to.x = from.x - 0.07f;
+  to.y = from.y - 0.05f;
+  to.z = from.z + 1;
+  Render_Set_Camera (&from, &to, &world_up);
+
+  Render_Begin_Frame ();
+  Render_Clear (clear_color);
+  if (Render_Begin ()) {
+    Render_Set_Material (&material);
+    Render_Set_Ambient_Light (white);
+
+    // Sky and ground, unlit
+    Render_Disable_Light (scene->light);
+    gx3d_GetTranslateMatrix (&m, 0, 0, 0);
+    Render_Set_Object_Matrix (scene->obj_sky, &m);
+    Render_Set_Texture (0, scene->tex_sky);
+    Render_Draw_Object (scene->obj_sky);
+    Render_Set_Object_Matrix (scene->obj_ground, &m);
+    Render_Set_Texture (0, scene->tex_ground);
+    Render_Draw_Object (scene->obj_ground);
+
+    // Everything else, lit
+    Render_Enable_Light (scene->light);
+    Render_Draw_Instanced (scene->obj_hill, scene->tex_hill, scene->hill, NUM_HILLS);
+    Render_Draw_Instanced (scene->obj_fence, scene->tex_fence, scene->fence, NUM_FENCE);
+    Render_Draw_Instanced (scene->obj_egg, scene->tex_egg, scene->egg, EGG_ROWS * EGG_COLUMNS);
+
+    Render_End ();
+  }
+  Render_Flip ();
+}
+
+/*____________________________________________________________________
+|
+| Function: Free_Scene
+|
+| Input: Called from main(), Load_Scene()
+| Output: Frees whatever of the scene was loaded.
+|___________________________________________________________________*/
+
+static void Free_Scene (Scene *scene)
+{
+  gx3dObject  *obj [5] = { scene->obj_sky, scene->obj_ground, scene->obj_hill, scene->obj_fence, scene->obj_egg };
+  gx3dTexture  tex [5] = { scene->tex_sky, scene->tex_ground, scene->tex_hill, scene->tex_fence, scene->tex_egg };
+  int i;
+
+  for (i=0; i<5; i++) {
+    if (obj[i])
+      Render_Free_Object (obj[i]);
+    if (tex[i])
+      Render_Free_Texture (tex[i]);
+  }
+  memset (scene, 0, sizeof(Scene));
+}
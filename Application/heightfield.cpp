@@ -0,0 +1,474 @@
+/*____________________________________________________________________
+|
+| File: heightfield.cpp
+|
+| Description: Ground heights on a regular grid.  The triangles of the
+|   ground and hill objects are read from their LWO2 files at load time
+|   and rasterized from above into a grid of height samples, keeping
+|   the highest surface at each sample.  Height and normal queries are
+|   a bilinear lookup into the 4 samples around a point.
+|
+|   Mostly vertical triangles (walls) cover no area from above and add
+|   nothing.  Samples no triangle covers get the lowest height found.
+|
+| Functions: Heightfield_Add_Object
+|            Heightfield_Build
+|             Rasterize_Triangle
+|            Heightfield_Height
+|            Heightfield_Normal
+|            Heightfield_Heights
+|            Heightfield_Get_Stats
+|            Heightfield_Free
+|            Heightfield_Benchmark
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+#include <math.h>
+#include <float.h>
+#include <emmintrin.h>
+
+#include "dp.h"
+
+#include "timer.h"
+#include "lwo2.h"
+#include "heightfield.h"
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static void Rasterize_Triangle (gx3dVector *v);
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define MAX_SAMPLES   (2048*2048)
+#define MIN_AREA      0.01f     // triangles covering less than this from above are skipped
+#define EDGE_EPSILON  -0.0001f  // so samples on shared edges aren't missed
+
+/*___________________
+|
+| Macros
+|__________________*/
+
+#define SAMPLE(_x_,_z_) heights[(_z_) * size_x + (_x_)]
+#define MIN3(_a_,_b_,_c_) ((_a_) < (_b_) ? ((_a_) < (_c_) ? (_a_) : (_c_)) : ((_b_) < (_c_) ? (_b_) : (_c_)))
+#define MAX3(_a_,_b_,_c_) ((_a_) > (_b_) ? ((_a_) > (_c_) ? (_a_) : (_c_)) : ((_b_) > (_c_) ? (_b_) : (_c_)))
+
+/*___________________
+|
+| Global variables
+|__________________*/
+
+// Triangles waiting for Heightfield_Build()
+static gx3dVector *triangles     = 0;   // 3 vertices per triangle
+static int         num_triangles = 0;
+
+// Grid
+static float *heights = 0;
+static int    size_x = 0, size_z = 0;
+static float  origin_x, origin_z;       // world x,z of sample 0,0
+static float  cell_size, inv_cell_size;
+
+static HeightfieldStats stats;
+
+/*____________________________________________________________________
+|
+| Function: Heightfield_Add_Object
+|
+| Input: Called from Program_Run()
+| Output: Adds the triangles of an object to the next build.  Returns
+|   false if the file can't be read.
+|___________________________________________________________________*/
+
+bool Heightfield_Add_Object (const char *lwo_filename, gx3dMatrix *world_matrix)
+{
+  int n;
+  gx3dVector *v;
+
+  n = Lwo2_Read_Triangles (lwo_filename, world_matrix, &v);
+  if (n == -1)
+    return (false);
+
+  if (n) {
+    triangles = (gx3dVector *) realloc (triangles, (num_triangles + n) * 3 * sizeof(gx3dVector));
+    memcpy (&triangles[num_triangles * 3], v, n * 3 * sizeof(gx3dVector));
+    num_triangles += n;
+    free (v);
+  }
+
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: Heightfield_Build
+|
+| Input: Called from Program_Run()
+| Output: Builds the heightfield from the triangles added so far and
+|   frees them.
+|___________________________________________________________________*/
+
+void Heightfield_Build (float size)
+{
+  int i;
+  float min_x, min_z, max_x, max_z, lowest;
+  double start;
+
+  start = Timer_Now_Ms ();
+  free (heights);
+  heights = 0;
+  size_x = size_z = 0;
+  memset (&stats, 0, sizeof(stats));
+  if (num_triangles == 0)
+    return;
+
+  // Bounds of all triangles
+  min_x = min_z =  FLT_MAX;
+  max_x = max_z = -FLT_MAX;
+  for (i=0; i<num_triangles*3; i++) {
+    if (triangles[i].x < min_x) min_x = triangles[i].x;
+    if (triangles[i].z < min_z) min_z = triangles[i].z;
+    if (triangles[i].x > max_x) max_x = triangles[i].x;
+    if (triangles[i].z > max_z) max_z = triangles[i].z;
+  }
+
+  // Size the grid, using bigger cells if there would be too many samples
+  cell_size = size;
+  for (;;) {
+    size_x = (int)ceil ((max_x - min_x) / cell_size) + 1;
+    size_z = (int)ceil ((max_z - min_z) / cell_size) + 1;
+    if (size_x < 2) size_x = 2;
+    if (size_z < 2) size_z = 2;
+    if (size_x * size_z <= MAX_SAMPLES)
+      break;
+    cell_size *= 2;
+  }
+  inv_cell_size = 1 / cell_size;
+  origin_x = min_x;
+  origin_z = min_z;
+
+  heights = (float *) malloc (size_x * size_z * sizeof(float));
+  for (i=0; i<size_x*size_z; i++)
+    heights[i] = -FLT_MAX;
+  for (i=0; i<num_triangles; i++)
+    Rasterize_Triangle (&triangles[i*3]);
+
+  // Fill the holes
+  lowest = FLT_MAX;
+  for (i=0; i<size_x*size_z; i++)
+    if ((heights[i] != -FLT_MAX) AND (heights[i] < lowest))
+      lowest = heights[i];
+  if (lowest == FLT_MAX)
+    lowest = 0;
+  for (i=0; i<size_x*size_z; i++)
+    if (heights[i] == -FLT_MAX)
+      heights[i] = lowest;
+
+  stats.size_x    = size_x;
+  stats.size_z    = size_z;
+  stats.cell_size = cell_size;
+  stats.triangles = num_triangles;
+
+  free (triangles);
+  triangles = 0;
+  num_triangles = 0;
+  stats.build_ms = Timer_Elapsed_Ms (start);
+}
+
+/*____________________________________________________________________
+|
+| Function: Rasterize_Triangle
+|
+| Input: Called from Heightfield_Build()
+| Output: Raises the samples inside a triangle (seen from above) to the
+|   height of the triangle there.
+|___________________________________________________________________*/
+
+static void Rasterize_Triangle (gx3dVector *v)
+{
+  int x, z, x0, x1, z0, z1;
+  float area, inv_area, px, pz, w0, w1, w2, y;
+
+  // Twice the signed area on the x,z plane
+  area = (v[1].x - v[0].x) * (v[2].z - v[0].z) - (v[2].x - v[0].x) * (v[1].z - v[0].z);
+  if (fabs (area) < MIN_AREA)
+    return;
+  inv_area = 1 / area;
+
+  // Samples in the bounding rectangle
+  x0 = (int)ceil  ((MIN3 (v[0].x, v[1].x, v[2].x) - origin_x) * inv_cell_size);
+  x1 = (int)floor ((MAX3 (v[0].x, v[1].x, v[2].x) - origin_x) * inv_cell_size);
+  z0 = (int)ceil  ((MIN3 (v[0].z, v[1].z, v[2].z) - origin_z) * inv_cell_size);
+  z1 = (int)floor ((MAX3 (v[0].z, v[1].z, v[2].z) - origin_z) * inv_cell_size);
+  if (x0 < 0) x0 = 0;
+  if (z0 < 0) z0 = 0;
+  if (x1 > size_x - 1) x1 = size_x - 1;
+  if (z1 > size_z - 1) z1 = size_z - 1;
+
+  for (z=z0; z<=z1; z++) {
+    pz = origin_z + z * cell_size;
+    for (x=x0; x<=x1; x++) {
+      px = origin_x + x * cell_size;
+      // Barycentric weights
+      w1 = ((px - v[0].x) * (v[2].z - v[0].z) - (v[2].x - v[0].x) * (pz - v[0].z)) * inv_area;
+      w2 = ((v[1].x - v[0].x) * (pz - v[0].z) - (px - v[0].x) * (v[1].z - v[0].z)) * inv_area;
+      w0 = 1 - w1 - w2;
+      if ((w0 < EDGE_EPSILON) OR (w1 < EDGE_EPSILON) OR (w2 < EDGE_EPSILON))
+        continue;
+      y = w0 * v[0].y + w1 * v[1].y + w2 * v[2].y;
+      if (y > SAMPLE (x, z))
+        SAMPLE (x, z) = y;
+    }
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Heightfield_Height
+|
+| Input: Called from Program_Run(), Position_Update() (through a
+|   pointer), Heightfield_Benchmark()
+| Output: Returns ground height at x,z.
+|___________________________________________________________________*/
+
+float Heightfield_Height (float x, float z)
+{
+  int ix, iz;
+  float fx, fz, h0, h1;
+  float *h;
+
+  if (heights == 0)
+    return (0);
+
+  fx = (x - origin_x) * inv_cell_size;
+  fz = (z - origin_z) * inv_cell_size;
+  if (fx < 0) fx = 0;
+  if (fz < 0) fz = 0;
+  if (fx > (float)(size_x - 1)) fx = (float)(size_x - 1);
+  if (fz > (float)(size_z - 1)) fz = (float)(size_z - 1);
+  ix = (int)fx;
+  iz = (int)fz;
+  if (ix > size_x - 2) ix = size_x - 2;
+  if (iz > size_z - 2) iz = size_z - 2;
+  fx -= ix;
+  fz -= iz;
+
+  h  = &SAMPLE (ix, iz);
+  h0 = h[0]      + (h[1]          - h[0])      * fx;
+  h1 = h[size_x] + (h[size_x + 1] - h[size_x]) * fx;
+  return (h0 + (h1 - h0) * fz);
+}
+
+/*____________________________________________________________________
+|
+| Function: Heightfield_Normal
+|
+| Input: Called from ____
+| Output: Returns the ground normal at x,z (the normal of the bilinear
+|   surface through the 4 samples around x,z).
+|___________________________________________________________________*/
+
+void Heightfield_Normal (float x, float z, gx3dVector *normal)
+{
+  int ix, iz;
+  float fx, fz, dx, dz, len;
+  float *h;
+
+  normal->x = 0;
+  normal->y = 1;
+  normal->z = 0;
+  if (heights == 0)
+    return;
+
+  fx = (x - origin_x) * inv_cell_size;
+  fz = (z - origin_z) * inv_cell_size;
+  if (fx < 0) fx = 0;
+  if (fz < 0) fz = 0;
+  if (fx > (float)(size_x - 1)) fx = (float)(size_x - 1);
+  if (fz > (float)(size_z - 1)) fz = (float)(size_z - 1);
+  ix = (int)fx;
+  iz = (int)fz;
+  if (ix > size_x - 2) ix = size_x - 2;
+  if (iz > size_z - 2) iz = size_z - 2;
+  fx -= ix;
+  fz -= iz;
+
+  // Slope along x and z
+  h  = &SAMPLE (ix, iz);
+  dx = ((h[1] - h[0]) * (1 - fz) + (h[size_x + 1] - h[size_x]) * fz) * inv_cell_size;
+  dz = ((h[size_x] - h[0]) * (1 - fx) + (h[size_x + 1] - h[1]) * fx) * inv_cell_size;
+
+  len = 1 / sqrtf (dx * dx + 1 + dz * dz);
+  normal->x = -dx * len;
+  normal->y = len;
+  normal->z = -dz * len;
+}
+
+/*____________________________________________________________________
+|
+| Function: Heightfield_Heights
+|
+| Input: Called from Program_Run(), Heightfield_Benchmark()
+| Output: Returns the ground height under each point, working on 4
+|   points at a time.
+|___________________________________________________________________*/
+
+void Heightfield_Heights (gx3dVector *points, int count, float *out)
+{
+  int i, k, offset [4];
+  float h [4][4];
+  __m128 fx, fz, ix, iz, zero, max_x, max_z, max_ix, max_iz, ox, oz, inv;
+  __m128 h00, h10, h01, h11, h0, h1;
+  __m128i index;
+
+  if (heights == 0) {
+    for (i=0; i<count; i++)
+      out[i] = 0;
+    return;
+  }
+
+  zero   = _mm_setzero_ps ();
+  max_x  = _mm_set1_ps ((float)(size_x - 1));
+  max_z  = _mm_set1_ps ((float)(size_z - 1));
+  max_ix = _mm_set1_ps ((float)(size_x - 2));
+  max_iz = _mm_set1_ps ((float)(size_z - 2));
+  ox     = _mm_set1_ps (origin_x);
+  oz     = _mm_set1_ps (origin_z);
+  inv    = _mm_set1_ps (inv_cell_size);
+
+  for (i=0; i+4<=count; i+=4) {
+    fx = _mm_set_ps (points[i+3].x, points[i+2].x, points[i+1].x, points[i].x);
+    fz = _mm_set_ps (points[i+3].z, points[i+2].z, points[i+1].z, points[i].z);
+    fx = _mm_min_ps (_mm_max_ps (_mm_mul_ps (_mm_sub_ps (fx, ox), inv), zero), max_x);
+    fz = _mm_min_ps (_mm_max_ps (_mm_mul_ps (_mm_sub_ps (fz, oz), inv), zero), max_z);
+    // Truncation is floor for values >= 0
+    ix = _mm_min_ps (_mm_cvtepi32_ps (_mm_cvttps_epi32 (fx)), max_ix);
+    iz = _mm_min_ps (_mm_cvtepi32_ps (_mm_cvttps_epi32 (fz)), max_iz);
+    fx = _mm_sub_ps (fx, ix);
+    fz = _mm_sub_ps (fz, iz);
+
+    // Gather the 4 samples around each point
+    index = _mm_cvttps_epi32 (_mm_add_ps (_mm_mul_ps (iz, _mm_set1_ps ((float)size_x)), ix));
+    _mm_storeu_si128 ((__m128i *)offset, index);
+    for (k=0; k<4; k++) {
+      h[0][k] = heights[offset[k]];
+      h[1][k] = heights[offset[k] + 1];
+      h[2][k] = heights[offset[k] + size_x];
+      h[3][k] = heights[offset[k] + size_x + 1];
+    }
+    h00 = _mm_loadu_ps (h[0]);
+    h10 = _mm_loadu_ps (h[1]);
+    h01 = _mm_loadu_ps (h[2]);
+    h11 = _mm_loadu_ps (h[3]);
+
+    h0 = _mm_add_ps (h00, _mm_mul_ps (_mm_sub_ps (h10, h00), fx));
+    h1 = _mm_add_ps (h01, _mm_mul_ps (_mm_sub_ps (h11, h01), fx));
+    _mm_storeu_ps (&out[i], _mm_add_ps (h0, _mm_mul_ps (_mm_sub_ps (h1, h0), fz)));
+  }
+  for (; i<count; i++)
+    out[i] = Heightfield_Height (points[i].x, points[i].z);
+}
+
+/*____________________________________________________________________
+|
+| Function: Heightfield_Get_Stats
+|
+| Input: Called from Program_Run()
+| Output: Returns statistics for the last call to Heightfield_Build().
+|___________________________________________________________________*/
+
+void Heightfield_Get_Stats (HeightfieldStats *heightfield_stats)
+{
+  *heightfield_stats = stats;
+}
+
+/*____________________________________________________________________
+|
+| Function: Heightfield_Free
+|
+| Input: Called from Program_Run()
+| Output: Frees the heightfield and any triangles waiting for a build.
+|___________________________________________________________________*/
+
+void Heightfield_Free ()
+{
+  free (heights);
+  free (triangles);
+  heights = 0;
+  triangles = 0;
+  num_triangles = 0;
+  size_x = size_z = 0;
+}
+
+/*____________________________________________________________________
+|
+| Function: Heightfield_Benchmark
+|
+| Input: Called from Program_Run()
+| Output: Queries 1,000,000 points spread over the heightfield one at a
+|   time and in a batch, and writes the time per query and the largest
+|   difference between the two to the debug file.
+|___________________________________________________________________*/
+
+void Heightfield_Benchmark ()
+{
+  int i, n;
+  float single_ms, batch_ms, err, d, sum;
+  float *single, *batch;
+  char str [200];
+  gx3dVector *points;
+  double start;
+
+  if (heights == 0) {
+    debug_WriteFile ("Heightfield: nothing to benchmark");
+    return;
+  }
+
+  n = 1000000;
+  points = (gx3dVector *) malloc (n * sizeof(gx3dVector));
+  single = (float *)      malloc (n * sizeof(float));
+  batch  = (float *)      malloc (n * sizeof(float));
+  srand (1);
+  for (i=0; i<n; i++) {
+    points[i].x = origin_x + (float)rand () / RAND_MAX * (size_x - 1) * cell_size;
+    points[i].y = 0;
+    points[i].z = origin_z + (float)rand () / RAND_MAX * (size_z - 1) * cell_size;
+  }
+
+  start = Timer_Now_Ms ();
+  for (i=0; i<n; i++)
+    single[i] = Heightfield_Height (points[i].x, points[i].z);
+  single_ms = Timer_Elapsed_Ms (start);
+
+  start = Timer_Now_Ms ();
+  Heightfield_Heights (points, n, batch);
+  batch_ms = Timer_Elapsed_Ms (start);
+
+  err = sum = 0;
+  for (i=0; i<n; i++) {
+    d = (float)fabs (single[i] - batch[i]);
+    if (d > err)
+      err = d;
+    sum += single[i];
+  }
+
+  sprintf (str, "Heightfield: %d queries, single %.2f ns each, batched %.2f ns each, max difference %f (average height %.2f)",
+    n, single_ms * 1000000 / n, batch_ms * 1000000 / n, err, sum / n);
+  debug_WriteFile (str);
+
+  free (points);
+  free (single);
+  free (batch);
+}
@@ -0,0 +1,38 @@
+/*____________________________________________________________________
+|
+| File: heightfield.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+struct HeightfieldStats {
+  int   size_x, size_z;   // # of samples on each side
+  float cell_size;
+  int   triangles;        // # of triangles rasterized
+  float build_ms;
+};
+
+// Adds the triangles of an object, placed with a world matrix, to the next Heightfield_Build().  Returns false on error.
+bool Heightfield_Add_Object (const char *lwo_filename, gx3dMatrix *world_matrix);
+
+// Builds the heightfield from the triangles added so far, keeping the highest surface at each sample
+void Heightfield_Build (float cell_size);
+
+// Returns ground height at x,z (0 if there is no heightfield, edge heights outside it)
+float Heightfield_Height (float x, float z);
+
+// Returns the ground normal at x,z
+void Heightfield_Normal (float x, float z, gx3dVector *normal);
+
+// Returns the ground height under each point
+void Heightfield_Heights (gx3dVector *points, int count, float *heights);
+
+// Returns statistics for the last call to Heightfield_Build()
+void Heightfield_Get_Stats (HeightfieldStats *stats);
+
+// Frees the heightfield
+void Heightfield_Free ();
+
+// Times single and batched queries on the current heightfield and writes the results to the debug file
+void Heightfield_Benchmark ();
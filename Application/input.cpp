@@ -0,0 +1,225 @@
+/*____________________________________________________________________
+|
+| File: input.cpp
+|
+| Description: Input for the game loop.  Each frame every event waiting
+|   on the event queue is taken at once (up to INPUT_MAX_EVENTS), rather
+|   than one a frame, so a burst of events doesn't lag behind and a key
+|   release is seen the frame it happens.
+|
+|   Each event is stamped with the shared timer as it comes off
+|   the queue (the events themselves carry no time), kept in the order
+|   they happened.  Keys bound to actions press and release action bits
+|   as the events are taken, so the actions held are always those after
+|   the last event.  An action pressed and released again within one
+|   drain still counts for that frame.  Losing focus releases them all.
+|
+|   The game passes the stamp of an event it acts on to Input_Shown()
+|   once the result is on screen, to measure how long that took.
+|
+| Functions: Input_Init
+|            Input_Bind
+|            Input_Drain
+|            Input_Actions
+|            Input_Now_Ms
+|            Input_Shown
+|            Input_Get_Stats
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+
+#include "dp.h"
+
+#include "timer.h"
+#include "input.h"
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+struct Binding {
+  int      keycode;
+  unsigned action;
+};
+
+/*___________________
+|
+| Global variables
+|__________________*/
+
+static Binding       binding [INPUT_MAX_BINDINGS];
+static int           num_bindings = 0;
+
+static InputEvent    event_list [INPUT_MAX_EVENTS];
+static unsigned      held    = 0;     // actions held now
+static unsigned      tapped  = 0;     // actions pressed and released in the last drain
+static double        start;           // Timer_Now_Ms() at Input_Init()
+static double        last_drain_ms = -1;
+static double        total_response_ms;
+
+static InputStats    stats;
+
+/*____________________________________________________________________
+|
+| Function: Input_Init
+|
+| Input: Called from Program_Run()
+| Output: Starts timing events and removes all bindings.
+|___________________________________________________________________*/
+
+void Input_Init ()
+{
+  start = Timer_Now_Ms ();
+  num_bindings  = 0;
+  held          = 0;
+  tapped        = 0;
+  last_drain_ms = -1;
+  total_response_ms = 0;
+  memset (&stats, 0, sizeof(stats));
+}
+
+/*____________________________________________________________________
+|
+| Function: Input_Bind
+|
+| Input: Called from Program_Run()
+| Output: Binds a key to an action.
+|___________________________________________________________________*/
+
+void Input_Bind (int keycode, unsigned action)
+{
+  if (num_bindings == INPUT_MAX_BINDINGS) {
+    debug_WriteFile ("Input_Bind(): too many bindings");
+    return;
+  }
+  binding[num_bindings].keycode = keycode;
+  binding[num_bindings].action  = action;
+  num_bindings++;
+}
+
+/*____________________________________________________________________
+|
+| Function: Input_Drain
+|
+| Input: Called from Program_Run()
+| Output: Returns # of events taken off the event queue and the events
+|   in *events, oldest first.
+|___________________________________________________________________*/
+
+int Input_Drain (InputEvent **events)
+{
+  int i, n;
+  unsigned pressed;
+  double now;
+  InputEvent *e;
+
+  now = Input_Now_Ms ();
+  if ((last_drain_ms >= 0) AND (now - last_drain_ms > stats.max_wait_ms))
+    stats.max_wait_ms = now - last_drain_ms;
+  last_drain_ms = now;
+
+  pressed = 0;
+  tapped  = 0;
+  for (n=0; n<INPUT_MAX_EVENTS; n++) {
+    e = &event_list[n];
+    if (NOT evGetEvent (&e->event))
+      break;
+    e->ms = Input_Now_Ms ();
+    // Keys let go of in another window are never seen released
+    if (e->event.type == evTYPE_WINDOW_INACTIVE)
+      held = 0;
+    for (i=0; i<num_bindings; i++) {
+      if (binding[i].keycode != e->event.keycode)
+        continue;
+      if (e->event.type == evTYPE_RAW_KEY_PRESS) {
+        held    |= binding[i].action;
+        pressed |= binding[i].action;
+      }
+      else if (e->event.type == evTYPE_RAW_KEY_RELEASE) {
+        if (pressed & binding[i].action & ~tapped) {
+          tapped |= binding[i].action;
+          stats.taps++;
+        }
+        held &= ~binding[i].action;
+      }
+    }
+  }
+
+  stats.drains++;
+  stats.events += n;
+  if (n > stats.max_events)
+    stats.max_events = n;
+  if (n == INPUT_MAX_EVENTS)
+    stats.full_drains++;
+
+  *events = event_list;
+  return (n);
+}
+
+/*____________________________________________________________________
+|
+| Function: Input_Actions
+|
+| Input: Called from Program_Run()
+| Output: Returns the actions held or tapped in the last drain.
+|___________________________________________________________________*/
+
+unsigned Input_Actions ()
+{
+  return (held | tapped);
+}
+
+/*____________________________________________________________________
+|
+| Function: Input_Now_Ms
+|
+| Input: Called from Program_Run(), Input_Drain()
+| Output: Returns milliseconds since Input_Init().
+|___________________________________________________________________*/
+
+double Input_Now_Ms ()
+{
+  return (Timer_Now_Ms () - start);
+}
+
+/*____________________________________________________________________
+|
+| Function: Input_Shown
+|
+| Input: Called from Program_Run()
+| Output: Counts the time from an event to now, when its result is on
+|   screen.
+|___________________________________________________________________*/
+
+void Input_Shown (double event_ms)
+{
+  double ms = Input_Now_Ms () - event_ms;
+
+  total_response_ms += ms;
+  if (ms > stats.max_response_ms)
+    stats.max_response_ms = ms;
+  stats.responses++;
+}
+
+/*____________________________________________________________________
+|
+| Function: Input_Get_Stats
+|
+| Input: Called from Program_Run()
+| Output: Returns statistics since Input_Init().
+|___________________________________________________________________*/
+
+void Input_Get_Stats (InputStats *input_stats)
+{
+  stats.response_ms = stats.responses ? total_response_ms / stats.responses : 0;
+  *input_stats = stats;
+}
@@ -0,0 +1,58 @@
+/*____________________________________________________________________
+|
+| File: input.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+#define INPUT_MAX_EVENTS    256   // taken per call to Input_Drain(), the rest wait for the next
+#define INPUT_MAX_BINDINGS  32
+
+// Actions keys can be bound to (bits)
+#define INPUT_ACTION_FORWARD  0x1
+#define INPUT_ACTION_BACK     0x2
+#define INPUT_ACTION_RIGHT    0x4
+#define INPUT_ACTION_LEFT     0x8
+#define INPUT_ACTION_RUN      0x10
+
+// An event and when it was taken off the event queue
+struct InputEvent {
+  evEvent  event;
+  double   ms;                // milliseconds since Input_Init(), from the shared timer
+};
+
+// Statistics since Input_Init()
+struct InputStats {
+  int    drains;
+  int    events;
+  int    max_events;          // most taken by one drain
+  int    full_drains;         // # that took INPUT_MAX_EVENTS and left the rest
+  int    taps;                // # of actions pressed and released within one drain
+  double max_wait_ms;         // longest time between drains (how long an event can wait to be seen)
+  int    responses;           // # of calls to Input_Shown()
+  double response_ms;         // mean time from an event to its result on screen
+  double max_response_ms;
+};
+
+// Starts timing events, removes all bindings
+void Input_Init ();
+
+// Binds a key (raw key code) to an action
+void Input_Bind (int keycode, unsigned action);
+
+// Takes every event waiting on the event queue, in the order they happened, and updates the actions held.
+//  Returns # of events and the events in *events (good until the next call).
+int Input_Drain (InputEvent **events);
+
+// Returns the actions held, plus any pressed and released again within the last drain (so a tap counts for a frame)
+unsigned Input_Actions ();
+
+// Returns milliseconds since Input_Init(), on the same clock as InputEvent ms
+double Input_Now_Ms ();
+
+// Counts the time from an event (its ms) to now, call once its result is on screen
+void Input_Shown (double event_ms);
+
+// Returns statistics since Input_Init()
+void Input_Get_Stats (InputStats *stats);
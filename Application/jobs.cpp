@@ -0,0 +1,898 @@
+/*____________________________________________________________________
+|
+| File: jobs.cpp
+|
+| Description: Work-stealing job system.  Each thread running jobs
+|   (the thread that called Jobs_Init() and one job thread for each
+|   other processor) has its own queue of jobs waiting to run, a deque
+|   after Chase and Lev: the thread pushes and pops jobs at the bottom,
+|   newest first, and a thread with nothing to do steals the oldest job
+|   from the top of another thread's deque.  Only a steal and a pop of
+|   the last job left compete, with a compare and swap on the top.
+|
+|   Jobs come from a pool per thread, used round and round, so creating
+|   one doesn't allocate.  A thread can't have more than JOBS_POOL_SIZE
+|   jobs unfinished: creating one fails if the next job in the pool
+|   hasn't finished since it was last used.  A job is finished once it has run and so have
+|   its children.  Jobs that depend on it are then queued by whichever
+|   thread finished it.  Parallel for splits its range in half, queues
+|   the top half as a child job and keeps splitting the bottom half, so
+|   threads that steal take the biggest pieces left.
+|
+|   A job thread that finds nothing to run anywhere yields for a while,
+|   then sleeps until a job is queued.  Jobs_Wait() never sleeps: the
+|   waiting thread runs jobs until the one it waits on is finished.
+|
+|   Uses only standard C++ threads and atomics.  To run the benchmark
+|   on its own (on Linux, say):
+|     g++ -O2 -std=c++14 -pthread -DJOBS_BENCHMARK_MAIN jobs.cpp timer.cpp
+|
+| Functions: Jobs_Init
+|             Job_Thread
+|             Sleep_Until_Work
+|             Work_Waiting
+|            Jobs_Num_Threads
+|            Jobs_Create
+|            Jobs_Depends
+|            Jobs_Submit
+|             Push
+|             Pop
+|             Steal
+|             Get_Job
+|             Run
+|             Finish
+|            Jobs_Wait
+|            Jobs_Parallel_For
+|             Range_Job
+|            Jobs_Get_Stats
+|            Jobs_Benchmark
+|             Bench_Range
+|             Bench_Empty
+|             Bench_Link
+|            Jobs_Free
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#ifdef _WIN32
+#include <first_header.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "timer.h"
+#include "jobs.h"
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define CACHE_LINE  64
+#define DEQUE_SIZE  4096      // jobs waiting in one thread's deque (a power of 2)
+#define IDLE_YIELDS 1000      // times a job thread yields finding nothing to do before it sleeps
+
+#define BENCH_ITEMS      (1 << 20)    // items in the parallel for
+#define BENCH_GRAIN      1024
+#define BENCH_BATCH      2048         // small jobs in flight at once
+#define BENCH_SMALL_JOBS (50 * BENCH_BATCH)
+#define BENCH_CHAINS     64
+#define BENCH_CHAIN_LENGTH 32
+#define BENCH_LINK_ITEMS 8000         // work done by each job in a chain
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+struct alignas(CACHE_LINE) Job {
+  JobFunc           func;
+  Job              *parent;
+  std::atomic<int>  unfinished;   // 1 until it has run, plus # of unfinished children
+  std::atomic<int>  waiting;      // # of jobs it depends on not finished, plus 1 until submitted
+  std::atomic_flag  lock;         // guards after list
+  bool              finished;     // after list has been queued
+  std::atomic<bool> done;         // finished and no longer touched by Finish()
+  int               num_after;
+  Job              *after [JOBS_MAX_AFTER];
+  alignas(16) char  data [JOBS_DATA_SIZE];
+};
+
+struct alignas(CACHE_LINE) JobThread {
+  alignas(CACHE_LINE) std::atomic<long long> top;       // stolen from
+  alignas(CACHE_LINE) std::atomic<long long> bottom;    // pushed and popped by the owner
+  std::atomic<Job *>     deque [DEQUE_SIZE];
+  char                  *pool_memory;
+  Job                   *pool;
+  unsigned               next_job;
+  unsigned               random;
+  std::atomic<unsigned>  jobs, steals, sleeps, run_inline;
+};
+
+struct Range {
+  JobRangeFunc func;
+  void        *data;
+  int          first, last, grain;
+};
+
+struct BenchLink {
+  float *out;
+  int    index;     // where it writes its result, it starts from the result before it unless it's first in its chain
+  int    n;
+};
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static void  Job_Thread (int index);
+static void  Sleep_Until_Work (JobThread *t);
+static bool  Work_Waiting ();
+static void  Push (Job *job);
+static Job  *Pop (JobThread *t);
+static Job  *Steal (JobThread *t);
+static Job  *Get_Job ();
+static void  Run (Job *job);
+static void  Finish (Job *job);
+static void  Range_Job (Job *job, void *data);
+static void  Bench_Range (int first, int last, void *data);
+static void  Bench_Empty (Job *job, void *data);
+static void  Bench_Link (Job *job, void *data);
+
+/*___________________
+|
+| Global variables
+|__________________*/
+
+static JobThread               threads [JOBS_MAX_THREADS];
+static std::thread             job_threads [JOBS_MAX_THREADS];
+static int                     num_threads = 0;
+static thread_local int        thread_index = -1;   // this thread's entry in threads[], -1 if it doesn't run jobs
+
+static std::atomic<bool>       quit;
+static std::mutex              sleep_mutex;
+static std::condition_variable wake;
+static std::atomic<int>        sleepers;
+
+/*____________________________________________________________________
+|
+| Function: Jobs_Init
+|
+| Input: Called from Program_Run(), Jobs_Benchmark()
+| Output: Starts the job threads.
+|___________________________________________________________________*/
+
+void Jobs_Init (int n)
+{
+  int i, j;
+  JobThread *t;
+
+  if (num_threads)
+    Jobs_Free ();
+
+  if (n <= 0)
+    n = (int)std::thread::hardware_concurrency ();
+  if (n < 1)
+    n = 1;
+  if (n > JOBS_MAX_THREADS)
+    n = JOBS_MAX_THREADS;
+
+  for (i=0; i<n; i++) {
+    t = &threads[i];
+    t->top    = 0;
+    t->bottom = 0;
+    if (t->pool == 0) {
+      t->pool_memory = (char *) malloc (JOBS_POOL_SIZE * sizeof(Job) + CACHE_LINE);
+      t->pool = (Job *) (((size_t)t->pool_memory + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1));
+    }
+    // Every job in the pool is free
+    for (j=0; j<JOBS_POOL_SIZE; j++)
+      t->pool[j].done.store (true, std::memory_order_relaxed);
+    t->next_job   = 0;
+    t->random     = 2463534242u + i;
+    t->jobs       = 0;
+    t->steals     = 0;
+    t->sleeps     = 0;
+    t->run_inline = 0;
+  }
+  quit        = false;
+  sleepers    = 0;
+  num_threads = n;
+
+  thread_index = 0;
+  for (i=1; i<n; i++)
+    job_threads[i] = std::thread (Job_Thread, i);
+}
+
+/*____________________________________________________________________
+|
+| Function: Job_Thread
+|
+| Input: Called from Jobs_Init() (thread)
+| Output: Runs jobs until Jobs_Free() is called.
+|___________________________________________________________________*/
+
+static void Job_Thread (int index)
+{
+  int idle = 0;
+  Job *job;
+
+  thread_index = index;
+  while (!quit) {
+    job = Get_Job ();
+    if (job) {
+      Run (job);
+      idle = 0;
+    }
+    else if (++idle < IDLE_YIELDS)
+      std::this_thread::yield ();
+    else {
+      Sleep_Until_Work (&threads[index]);
+      idle = 0;
+    }
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Sleep_Until_Work
+|
+| Input: Called from Job_Thread()
+| Output: Sleeps until a job is queued, unless one is waiting already.
+|___________________________________________________________________*/
+
+static void Sleep_Until_Work (JobThread *t)
+{
+  std::unique_lock<std::mutex> lock (sleep_mutex);
+
+  // A thread queueing a job after this sees it and wakes this thread
+  sleepers++;
+  if (!quit && !Work_Waiting ()) {
+    t->sleeps.fetch_add (1, std::memory_order_relaxed);
+    wake.wait (lock);
+  }
+  sleepers--;
+}
+
+/*____________________________________________________________________
+|
+| Function: Work_Waiting
+|
+| Input: Called from Sleep_Until_Work()
+| Output: Returns true if any thread has a job waiting.
+|___________________________________________________________________*/
+
+static bool Work_Waiting ()
+{
+  int i;
+
+  for (i=0; i<num_threads; i++)
+    if (threads[i].bottom.load () > threads[i].top.load ())
+      return (true);
+
+  return (false);
+}
+
+/*____________________________________________________________________
+|
+| Function: Jobs_Num_Threads
+|
+| Input: Called from Record_Sections(), Jobs_Benchmark()
+| Output: Returns # of threads running jobs, 0 if not started.
+|___________________________________________________________________*/
+
+int Jobs_Num_Threads ()
+{
+  return (num_threads);
+}
+
+/*____________________________________________________________________
+|
+| Function: Jobs_Create
+|
+| Input: Called from Jobs_Parallel_For(), Range_Job(),
+|   Jobs_Benchmark() and game systems
+| Output: Returns a new job, 0 if this thread doesn't run jobs, the
+|   data doesn't fit or the next job in this thread's pool is still in
+|   flight (JOBS_POOL_SIZE of its jobs are unfinished).
+|___________________________________________________________________*/
+
+Job *Jobs_Create (JobFunc func, void *data, unsigned size_data, Job *parent)
+{
+  JobThread *t;
+  Job *job;
+
+  if ((thread_index < 0) || (size_data > JOBS_DATA_SIZE))
+    return (0);
+
+  t = &threads[thread_index];
+  job = &t->pool[t->next_job & (JOBS_POOL_SIZE - 1)];
+  // Still queued, running or waited on from the last time around the pool
+  if (!job->done.load (std::memory_order_acquire))
+    return (0);
+  t->next_job++;
+  job->func      = func;
+  job->parent    = parent;
+  job->unfinished.store (1, std::memory_order_relaxed);
+  job->waiting.store (1, std::memory_order_relaxed);
+  job->lock.clear ();
+  job->finished  = false;
+  job->done.store (false, std::memory_order_relaxed);
+  job->num_after = 0;
+  if (size_data)
+    memcpy (job->data, data, size_data);
+  if (parent)
+    parent->unfinished.fetch_add (1, std::memory_order_relaxed);
+
+  return (job);
+}
+
+/*____________________________________________________________________
+|
+| Function: Jobs_Depends
+|
+| Input: Called from Jobs_Benchmark() and game systems
+| Output: Makes job wait for before to finish.  Returns false if too
+|   many jobs wait on before already.
+|___________________________________________________________________*/
+
+bool Jobs_Depends (Job *job, Job *before)
+{
+  bool ok = true;
+
+  while (before->lock.test_and_set (std::memory_order_acquire))
+    std::this_thread::yield ();
+  if (before->finished)
+    ;
+  else if (before->num_after == JOBS_MAX_AFTER)
+    ok = false;
+  else {
+    job->waiting.fetch_add (1, std::memory_order_relaxed);
+    before->after[before->num_after++] = job;
+  }
+  before->lock.clear (std::memory_order_release);
+
+  return (ok);
+}
+
+/*____________________________________________________________________
+|
+| Function: Jobs_Submit
+|
+| Input: Called from Jobs_Parallel_For(), Range_Job(),
+|   Jobs_Benchmark() and game systems
+| Output: Queues a job, or leaves it for the last job it depends on
+|   to queue.
+|___________________________________________________________________*/
+
+void Jobs_Submit (Job *job)
+{
+  if (job->waiting.fetch_sub (1, std::memory_order_acq_rel) == 1)
+    Push (job);
+}
+
+/*____________________________________________________________________
+|
+| Function: Push
+|
+| Input: Called from Jobs_Submit(), Finish()
+| Output: Puts a job at the bottom of this thread's deque (runs it if
+|   the deque is full) and wakes a sleeping job thread.
+|___________________________________________________________________*/
+
+static void Push (Job *job)
+{
+  long long b, t;
+  JobThread *th = &threads[thread_index];
+
+  b = th->bottom.load (std::memory_order_relaxed);
+  t = th->top.load (std::memory_order_acquire);
+  if (b - t >= DEQUE_SIZE) {
+    th->run_inline.fetch_add (1, std::memory_order_relaxed);
+    Run (job);
+    return;
+  }
+  th->deque[b & (DEQUE_SIZE - 1)].store (job, std::memory_order_relaxed);
+  th->bottom.store (b + 1);
+
+  // Sleep_Until_Work() counts itself a sleeper before it looks for work, so one of them sees the other
+  if (sleepers.load () > 0) {
+    std::lock_guard<std::mutex> lock (sleep_mutex);
+    wake.notify_one ();
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Pop
+|
+| Input: Called from Get_Job()
+| Output: Takes the job at the bottom of this thread's deque, if any.
+|___________________________________________________________________*/
+
+static Job *Pop (JobThread *th)
+{
+  long long b, t;
+  Job *job;
+
+  b = th->bottom.load (std::memory_order_relaxed) - 1;
+  th->bottom.store (b);
+  t = th->top.load ();
+
+  if (t > b) {
+    // Empty
+    th->bottom.store (b + 1, std::memory_order_relaxed);
+    return (0);
+  }
+  job = th->deque[b & (DEQUE_SIZE - 1)].load (std::memory_order_relaxed);
+  if (t == b) {
+    // The last one, a thread stealing may get it first
+    if (!th->top.compare_exchange_strong (t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+      job = 0;
+    th->bottom.store (b + 1, std::memory_order_relaxed);
+  }
+
+  return (job);
+}
+
+/*____________________________________________________________________
+|
+| Function: Steal
+|
+| Input: Called from Get_Job()
+| Output: Takes the job at the top of another thread's deque, if any
+|   (and no other thread takes it first).
+|___________________________________________________________________*/
+
+static Job *Steal (JobThread *th)
+{
+  long long b, t;
+  Job *job;
+
+  t = th->top.load ();
+  b = th->bottom.load ();
+  if (t >= b)
+    return (0);
+
+  job = th->deque[t & (DEQUE_SIZE - 1)].load (std::memory_order_relaxed);
+  if (!th->top.compare_exchange_strong (t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    return (0);
+
+  return (job);
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_Job
+|
+| Input: Called from Job_Thread(), Jobs_Wait()
+| Output: Returns a job from this thread's deque or else one stolen
+|   from another thread (starting with one picked at random), 0 if
+|   there is none.
+|___________________________________________________________________*/
+
+static Job *Get_Job ()
+{
+  int i, victim;
+  JobThread *th = &threads[thread_index];
+  Job *job;
+
+  job = Pop (th);
+  if (job)
+    return (job);
+
+  if (num_threads > 1) {
+    // xorshift
+    th->random ^= th->random << 13;
+    th->random ^= th->random >> 17;
+    th->random ^= th->random << 5;
+    victim = th->random % num_threads;
+    for (i=0; i<num_threads; i++, victim=(victim+1)%num_threads) {
+      if (victim == thread_index)
+        continue;
+      job = Steal (&threads[victim]);
+      if (job) {
+        th->steals.fetch_add (1, std::memory_order_relaxed);
+        return (job);
+      }
+    }
+  }
+
+  return (0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Run
+|
+| Input: Called from Job_Thread(), Push(), Jobs_Wait()
+| Output: Runs a job.
+|___________________________________________________________________*/
+
+static void Run (Job *job)
+{
+  (*job->func) (job, job->data);
+  threads[thread_index].jobs.fetch_add (1, std::memory_order_relaxed);
+  Finish (job);
+}
+
+/*____________________________________________________________________
+|
+| Function: Finish
+|
+| Input: Called from Run(), Finish()
+| Output: Counts a job or one of its children done.  Once it and all
+|   its children are, queues the jobs waiting on it and counts it done
+|   in its parent.
+|___________________________________________________________________*/
+
+static void Finish (Job *job)
+{
+  int i, n;
+  Job *parent, *after [JOBS_MAX_AFTER];
+
+  parent = job->parent;
+  if (job->unfinished.fetch_sub (1, std::memory_order_acq_rel) != 1)
+    return;
+
+  while (job->lock.test_and_set (std::memory_order_acquire))
+    std::this_thread::yield ();
+  job->finished = true;
+  n = job->num_after;
+  for (i=0; i<n; i++)
+    after[i] = job->after[i];
+  job->lock.clear (std::memory_order_release);
+  // Jobs_Wait() may return and the job be reused from here on
+  job->done.store (true, std::memory_order_release);
+
+  for (i=0; i<n; i++)
+    if (after[i]->waiting.fetch_sub (1, std::memory_order_acq_rel) == 1)
+      Push (after[i]);
+  if (parent)
+    Finish (parent);
+}
+
+/*____________________________________________________________________
+|
+| Function: Jobs_Wait
+|
+| Input: Called from Jobs_Parallel_For(), Jobs_Benchmark() and game
+|   systems
+| Output: Runs jobs until job (and its children) has finished.
+|___________________________________________________________________*/
+
+void Jobs_Wait (Job *job)
+{
+  Job *other;
+
+  while (!job->done.load (std::memory_order_acquire)) {
+    other = Get_Job ();
+    if (other)
+      Run (other);
+    else
+      std::this_thread::yield ();
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Jobs_Parallel_For
+|
+| Input: Called from Record_Sections(), Jobs_Benchmark() and game
+|   systems
+| Output: Calls func for ranges of items from 0 to count-1 on all the
+|   job threads and waits for them all.  Calls it once for all of them
+|   on this thread if it doesn't run jobs.
+|___________________________________________________________________*/
+
+void Jobs_Parallel_For (int count, int grain, JobRangeFunc func, void *data)
+{
+  Range range;
+  Job *job;
+
+  if (count <= 0)
+    return;
+  if (grain < 1)
+    grain = 1;
+
+  range.func  = func;
+  range.data  = data;
+  range.first = 0;
+  range.last  = count;
+  range.grain = grain;
+  job = Jobs_Create (Range_Job, &range, sizeof(range), 0);
+  if (job == 0) {
+    (*func) (0, count, data);
+    return;
+  }
+  Jobs_Submit (job);
+  Jobs_Wait (job);
+}
+
+/*____________________________________________________________________
+|
+| Function: Range_Job
+|
+| Input: Called from Run()
+| Output: Queues the top half of its range as a child job until the
+|   range is down to the grain size, then does what's left.
+|___________________________________________________________________*/
+
+static void Range_Job (Job *job, void *data)
+{
+  Range *range = (Range *)data;
+  Range top;
+  Job *child;
+
+  while (range->last - range->first > range->grain) {
+    top = *range;
+    top.first = range->first + (range->last - range->first) / 2;
+    child = Jobs_Create (Range_Job, &top, sizeof(top), job);
+    if (child == 0)
+      break;
+    Jobs_Submit (child);
+    range->last = top.first;
+  }
+  (*range->func) (range->first, range->last, range->data);
+}
+
+/*____________________________________________________________________
+|
+| Function: Jobs_Get_Stats
+|
+| Input: Called from Program_Run(), Jobs_Benchmark()
+| Output: Returns statistics since Jobs_Init().
+|___________________________________________________________________*/
+
+void Jobs_Get_Stats (JobsStats *stats)
+{
+  int i;
+
+  memset (stats, 0, sizeof(JobsStats));
+  stats->threads = num_threads;
+  for (i=0; i<num_threads; i++) {
+    stats->jobs       += threads[i].jobs.load (std::memory_order_relaxed);
+    stats->steals     += threads[i].steals.load (std::memory_order_relaxed);
+    stats->sleeps     += threads[i].sleeps.load (std::memory_order_relaxed);
+    stats->run_inline += threads[i].run_inline.load (std::memory_order_relaxed);
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Jobs_Benchmark
+|
+| Input: Called from Program_Run(), main() (JOBS_BENCHMARK_MAIN)
+| Output: Times parallel for, small jobs and chains of dependent jobs
+|   on 1 thread up to one per processor, checks parallel for and the
+|   chains get the same results on any number of threads as they do run
+|   in order on this thread, and writes the results.  Leaves the job
+|   threads as they were.
+|___________________________________________________________________*/
+
+void Jobs_Benchmark (JobsWriteFunc write)
+{
+  int i, j, n, max_threads, old_threads;
+  float ms, for_ms, small_ms, chain_ms, base_for_ms = 0, base_chain_ms = 0;
+  float *out, *expected, *chain_expected;
+  char str [256];
+  bool same, chains_same;
+  Job *root, *job, *prev;
+  BenchLink link;
+  JobsStats stats;
+  double start;
+
+  old_threads = num_threads;
+  max_threads = (int)std::thread::hardware_concurrency ();
+  if (max_threads < 1)
+    max_threads = 1;
+  if (max_threads > JOBS_MAX_THREADS)
+    max_threads = JOBS_MAX_THREADS;
+
+  out      = (float *) malloc (BENCH_ITEMS * sizeof(float));
+  expected = (float *) malloc (BENCH_ITEMS * sizeof(float));
+  chain_expected = (float *) malloc (BENCH_CHAINS * BENCH_CHAIN_LENGTH * sizeof(float));
+  link.out = (float *) malloc (BENCH_CHAINS * BENCH_CHAIN_LENGTH * sizeof(float));
+  link.n   = BENCH_LINK_ITEMS;
+  if ((out == 0) || (expected == 0) || (chain_expected == 0) || (link.out == 0)) {
+    free (out);
+    free (expected);
+    free (chain_expected);
+    free (link.out);
+    return;
+  }
+  Bench_Range (0, BENCH_ITEMS, expected);
+  // Each chain run in order
+  memset (link.out, 0, BENCH_CHAINS * BENCH_CHAIN_LENGTH * sizeof(float));
+  for (link.index=0; link.index<BENCH_CHAINS*BENCH_CHAIN_LENGTH; link.index++)
+    Bench_Link (0, &link);
+  memcpy (chain_expected, link.out, BENCH_CHAINS * BENCH_CHAIN_LENGTH * sizeof(float));
+
+  for (n=1; ; n*=2) {
+    if (n > max_threads)
+      n = max_threads;
+    Jobs_Init (n);
+
+    // Parallel for
+    memset (out, 0, BENCH_ITEMS * sizeof(float));
+    start = Timer_Now_Ms ();
+    Jobs_Parallel_For (BENCH_ITEMS, BENCH_GRAIN, Bench_Range, out);
+    for_ms = Timer_Elapsed_Ms (start);
+    same = (memcmp (out, expected, BENCH_ITEMS * sizeof(float)) == 0);
+
+    // Small jobs, as children of a job submitted after them
+    start = Timer_Now_Ms ();
+    for (i=0; i<BENCH_SMALL_JOBS; i+=BENCH_BATCH) {
+      root = Jobs_Create (Bench_Empty, 0, 0, 0);
+      for (j=0; j<BENCH_BATCH; j++) {
+        job = Jobs_Create (Bench_Empty, 0, 0, root);
+        if (job)
+          Jobs_Submit (job);
+      }
+      Jobs_Submit (root);
+      Jobs_Wait (root);
+    }
+    small_ms = Timer_Elapsed_Ms (start);
+
+    // Chains of jobs, each waiting on the one before
+    memset (link.out, 0, BENCH_CHAINS * BENCH_CHAIN_LENGTH * sizeof(float));
+    start = Timer_Now_Ms ();
+    root = Jobs_Create (Bench_Empty, 0, 0, 0);
+    for (i=0; i<BENCH_CHAINS; i++) {
+      prev = 0;
+      for (j=0; j<BENCH_CHAIN_LENGTH; j++) {
+        link.index = i * BENCH_CHAIN_LENGTH + j;
+        job = Jobs_Create (Bench_Link, &link, sizeof(link), root);
+        if (prev)
+          Jobs_Depends (job, prev);
+        Jobs_Submit (job);
+        prev = job;
+      }
+    }
+    Jobs_Submit (root);
+    Jobs_Wait (root);
+    chain_ms = Timer_Elapsed_Ms (start);
+    chains_same = (memcmp (link.out, chain_expected, BENCH_CHAINS * BENCH_CHAIN_LENGTH * sizeof(float)) == 0);
+
+    Jobs_Get_Stats (&stats);
+    if (n == 1) {
+      base_for_ms   = for_ms;
+      base_chain_ms = chain_ms;
+    }
+    ms = for_ms > 0 ? for_ms : 0.001f;
+    sprintf (str, "Jobs benchmark, %2d threads: parallel for %7.2f ms (%5.2fx)%s, small jobs %6.3f us each, %d chains of %d jobs %7.2f ms (%5.2fx)%s, %u steals",
+      n, for_ms, base_for_ms / ms, same ? "" : " WRONG RESULT",
+      small_ms * 1000 / BENCH_SMALL_JOBS,
+      BENCH_CHAINS, BENCH_CHAIN_LENGTH, chain_ms, base_chain_ms / (chain_ms > 0 ? chain_ms : 0.001f),
+      chains_same ? "" : " WRONG ORDER", stats.steals);
+    (*write) (str);
+
+    if (n == max_threads)
+      break;
+  }
+
+  free (out);
+  free (expected);
+  free (chain_expected);
+  free (link.out);
+
+  if (old_threads)
+    Jobs_Init (old_threads);
+  else
+    Jobs_Free ();
+}
+
+/*____________________________________________________________________
+|
+| Function: Bench_Range
+|
+| Input: Called from Jobs_Benchmark(), Range_Job()
+| Output: Does some arithmetic for each item in a range.
+|___________________________________________________________________*/
+
+static void Bench_Range (int first, int last, void *data)
+{
+  int i, k;
+  float x, *out = (float *)data;
+
+  for (i=first; i<last; i++) {
+    x = (float)i;
+    for (k=0; k<16; k++)
+      x = sqrtf (x + k);
+    out[i] = x;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Bench_Empty
+|
+| Input: Called from Run()
+| Output: Does nothing.
+|___________________________________________________________________*/
+
+static void Bench_Empty (Job *, void *)
+{
+}
+
+/*____________________________________________________________________
+|
+| Function: Bench_Link
+|
+| Input: Called from Run(), Jobs_Benchmark()
+| Output: Does some arithmetic, as one job in a chain, starting from
+|   the result of the job before it (so it's wrong if run out of order).
+|___________________________________________________________________*/
+
+static void Bench_Link (Job *, void *data)
+{
+  int i;
+  float x;
+  BenchLink *link = (BenchLink *)data;
+
+  x = (link->index % BENCH_CHAIN_LENGTH) ? link->out[link->index - 1] : 0;
+  for (i=0; i<link->n; i++)
+    x += sqrtf ((float)i);
+  link->out[link->index] = x;
+}
+
+/*____________________________________________________________________
+|
+| Function: Jobs_Free
+|
+| Input: Called from Program_Run(), Jobs_Init(), Jobs_Benchmark()
+| Output: Stops the job threads.  Jobs still queued are not run.
+|___________________________________________________________________*/
+
+void Jobs_Free ()
+{
+  int i;
+
+  if (num_threads == 0)
+    return;
+
+  quit = true;
+  {
+    std::lock_guard<std::mutex> lock (sleep_mutex);
+    wake.notify_all ();
+  }
+  for (i=1; i<num_threads; i++)
+    job_threads[i].join ();
+
+  for (i=0; i<num_threads; i++) {
+    free (threads[i].pool_memory);
+    threads[i].pool_memory = 0;
+    threads[i].pool        = 0;
+  }
+  num_threads  = 0;
+  thread_index = -1;
+}
+
+#ifdef JOBS_BENCHMARK_MAIN
+
+static void Write_Line (const char *str)
+{
+  puts (str);
+}
+
+int main ()
+{
+  Jobs_Benchmark (Write_Line);
+  return (0);
+}
+
+#endif
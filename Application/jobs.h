@@ -0,0 +1,66 @@
+/*____________________________________________________________________
+|
+| File: jobs.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+#define JOBS_MAX_THREADS  16      // including the thread that calls Jobs_Init()
+#define JOBS_POOL_SIZE    4096    // jobs each thread can have created and not yet finished (a power of 2)
+#define JOBS_DATA_SIZE    64      // bytes of data copied into a job
+#define JOBS_MAX_AFTER    8       // jobs that can depend on one job
+
+struct Job;
+
+// Does the work of a job, data is the job's copy of the data it was created with
+typedef void (*JobFunc) (Job *job, void *data);
+
+// Does the work for items first to last-1 of a parallel for
+typedef void (*JobRangeFunc) (int first, int last, void *data);
+
+// Writes a line of benchmark results
+typedef void (*JobsWriteFunc) (const char *str);
+
+// Statistics since Jobs_Init()
+struct JobsStats {
+  int      threads;
+  unsigned jobs;            // # of jobs run
+  unsigned steals;          // # of jobs taken from another thread's queue
+  unsigned sleeps;          // # of times a job thread ran out of work and slept
+  unsigned run_inline;      // # of jobs run when submitted because the thread's queue was full
+};
+
+// Starts num_threads-1 job threads (0 for one per processor), the calling thread is the other one
+void Jobs_Init (int num_threads);
+
+// Returns # of threads running jobs (including the one that called Jobs_Init()), 0 if not started
+int Jobs_Num_Threads ();
+
+// Creates a job, copying size_data bytes of data (up to JOBS_DATA_SIZE) into it.  A job with a parent
+//  counts as part of it: the parent isn't finished until it is.  Only the thread that called Jobs_Init()
+//  and jobs may create and submit jobs.  Returns 0 if this thread has JOBS_POOL_SIZE jobs unfinished.
+Job *Jobs_Create (JobFunc func, void *data, unsigned size_data, Job *parent);
+
+// Makes job wait for before to finish (call before submitting job), returns false if too many jobs wait on before
+bool Jobs_Depends (Job *job, Job *before);
+
+// Queues a job to run once everything it depends on has finished
+void Jobs_Submit (Job *job);
+
+// Runs other jobs until job (and its children) has finished
+void Jobs_Wait (Job *job);
+
+// Calls func for items 0 to count-1 split into ranges of at least grain items, on all job threads, and
+//  waits for them all
+void Jobs_Parallel_For (int count, int grain, JobRangeFunc func, void *data);
+
+// Returns statistics since Jobs_Init()
+void Jobs_Get_Stats (JobsStats *stats);
+
+// Times parallel for, many small jobs and chains of dependent jobs on 1 thread up to one per processor,
+//  writing the results with write.  Restarts the job threads.
+void Jobs_Benchmark (JobsWriteFunc write);
+
+// Stops the job threads
+void Jobs_Free ();
@@ -0,0 +1,866 @@
+/*____________________________________________________________________
+|
+| File: lwo2.cpp
+|
+| Description: Reads, writes and merges Lightwave LWO2 object files at
+|   the chunk level, so meshes can be combined at load time and then
+|   loaded with gx3d_ReadLWO2File().
+|
+|   Only single layer files are merged.  Chunks that hold per-point or
+|   per-polygon data (PNTS, VMAP, VMAD, POLS, PTAG) are repeated for
+|   each copy with their point and polygon indices offset.  Everything
+|   else (TAGS, LAYR, SURF, CLIP, ...) is copied once.  A layer may have
+|   several POLS chunks (faces, patches, ...); polygon indices in PTAG
+|   and VMAD chunks refer to the POLS chunk before them.
+|
+| Functions: Lwo2_Read
+|            Lwo2_Write
+|            Lwo2_Num_Points
+|            Lwo2_Merge
+|             Merge_Chunk
+|            Lwo2_Get_Triangles
+|            Lwo2_Read_Triangles
+|            Lwo2_Get_Mesh
+|             Add_Mesh_Layer
+|            Lwo2_Free
+|             Get_U2
+|             Get_U4
+|             Get_F4
+|             Get_VX
+|             Put_Bytes
+|             Put_U2
+|             Put_U4
+|             Put_F4
+|             Put_VX
+|             Name_Size
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#ifdef _WIN32
+#include <first_header.h>
+#endif
+#include <stdio.h>
+#include <math.h>
+#include <float.h>
+
+#include "portable.h"
+
+#include "lwo2.h"
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+// Growable byte buffer
+struct Buffer {
+  unsigned char *data;
+  int            size;
+  int            max;
+};
+
+// Texture coordinates of a point on one polygon (VMAD entry)
+struct CornerUV {
+  unsigned point, polygon;
+  float    u, v;
+};
+
+// One layer of a file being turned into a mesh
+struct MeshLayer {
+  gx3dVector *point;
+  float      *uv;                 // 2 per point
+  int         num_points;
+  bool        have_uv;
+  int        *polygon_start;      // into index[]
+  int        *polygon_size;       // # of corners, or 0 if not a FACE polygon
+  int         num_polygons, max_polygons;
+  unsigned   *index;
+  int         num_indices, max_indices;
+  CornerUV   *corner_uv;
+  int         num_corner_uvs, max_corner_uvs;
+};
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static void Add_Mesh_Layer (MeshLayer *layer, Lwo2Vertex **vertices, int *num_triangles, int *max_triangles);
+static bool Merge_Chunk (Lwo2Chunk *src, gx3dMatrix *matrices, int count, int num_points, int num_polygons, Lwo2Chunk *dst);
+static unsigned Get_U2 (unsigned char **p);
+static unsigned Get_U4 (unsigned char **p);
+static float    Get_F4 (unsigned char **p);
+static unsigned Get_VX (unsigned char **p);
+static void Put_Bytes (Buffer *b, void *data, int n);
+static void Put_U2 (Buffer *b, unsigned n);
+static void Put_U4 (Buffer *b, unsigned n);
+static void Put_F4 (Buffer *b, float f);
+static void Put_VX (Buffer *b, unsigned n);
+static int  Name_Size (unsigned char *p);
+
+/*___________________
+|
+| Macros
+|__________________*/
+
+#define CHUNK_IS(_c_,_id_) (memcmp ((_c_)->id, _id_, 4) == 0)
+
+/*____________________________________________________________________
+|
+| Function: Lwo2_Read
+|
+| Input: Called from ____
+| Output: Reads the chunks of an LWO2 file.  Returns true on success.
+|___________________________________________________________________*/
+
+bool Lwo2_Read (const char *filename, Lwo2File *file)
+{
+  int n, size, max_chunks;
+  unsigned char *data, *p, *end;
+  FILE *fp;
+  Lwo2Chunk *c;
+
+  memset (file, 0, sizeof(Lwo2File));
+
+  fp = fopen (filename, "rb");
+  if (fp == NULL)
+    return (false);
+  fseek (fp, 0, SEEK_END);
+  size = (int)ftell (fp);
+  fseek (fp, 0, SEEK_SET);
+  data = (unsigned char *) malloc (size);
+  n = (int)fread (data, 1, size, fp);
+  fclose (fp);
+
+  if ((n != size) OR (size < 12) OR memcmp (data, "FORM", 4) OR memcmp (data+8, "LWO2", 4)) {
+    free (data);
+    return (false);
+  }
+
+  p = data + 12;
+  end = data + size;
+  max_chunks = 0;
+  while (p + 8 <= end) {
+    if (file->num_chunks == max_chunks) {
+      max_chunks = max_chunks ? max_chunks * 2 : 16;
+      file->chunk = (Lwo2Chunk *) realloc (file->chunk, max_chunks * sizeof(Lwo2Chunk));
+    }
+    c = &file->chunk[file->num_chunks];
+    memcpy (c->id, p, 4);
+    p += 4;
+    c->size = (int)Get_U4 (&p);
+    if (p + c->size > end)
+      break;
+    c->data = (unsigned char *) malloc (c->size ? c->size : 1);
+    memcpy (c->data, p, c->size);
+    p += c->size + (c->size & 1);
+    file->num_chunks++;
+  }
+  free (data);
+
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: Lwo2_Write
+|
+| Input: Called from ____
+| Output: Writes an LWO2 file.  Returns true on success.
+|___________________________________________________________________*/
+
+bool Lwo2_Write (const char *filename, Lwo2File *file)
+{
+  int i;
+  unsigned form_size;
+  bool ok;
+  FILE *fp;
+  Buffer b;
+
+  memset (&b, 0, sizeof(b));
+  form_size = 4;
+  for (i=0; i<file->num_chunks; i++)
+    form_size += 8 + file->chunk[i].size + (file->chunk[i].size & 1);
+
+  Put_Bytes (&b, (void *)"FORM", 4);
+  Put_U4 (&b, form_size);
+  Put_Bytes (&b, (void *)"LWO2", 4);
+  for (i=0; i<file->num_chunks; i++) {
+    Put_Bytes (&b, file->chunk[i].id, 4);
+    Put_U4 (&b, file->chunk[i].size);
+    Put_Bytes (&b, file->chunk[i].data, file->chunk[i].size);
+    if (file->chunk[i].size & 1)
+      Put_Bytes (&b, (void *)"", 1);
+  }
+
+  ok = false;
+  fp = fopen (filename, "wb");
+  if (fp) {
+    ok = (fwrite (b.data, 1, b.size, fp) == (size_t)b.size);
+    fclose (fp);
+  }
+  free (b.data);
+
+  return (ok);
+}
+
+/*____________________________________________________________________
+|
+| Function: Lwo2_Num_Points
+|
+| Input: Called from ____
+| Output: Returns # of points in the (first) layer of a file.
+|___________________________________________________________________*/
+
+int Lwo2_Num_Points (Lwo2File *file)
+{
+  int i;
+
+  for (i=0; i<file->num_chunks; i++)
+    if (CHUNK_IS (&file->chunk[i], "PNTS"))
+      return (file->chunk[i].size / 12);
+
+  return (0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Lwo2_Merge
+|
+| Input: Called from ____
+| Output: Builds dst from count transformed copies of src.  Returns
+|   false if src has more than one layer or can't be parsed.
+|___________________________________________________________________*/
+
+bool Lwo2_Merge (
+  Lwo2File   *src,
+  gx3dMatrix *matrices,
+  int         count,
+  Lwo2File   *dst )
+{
+  int i, num_layers, num_points, num_polygons, n;
+  unsigned char *p, *end;
+  Lwo2Chunk *c;
+
+  memset (dst, 0, sizeof(Lwo2File));
+
+  // Count layers and points
+  num_layers = num_points = 0;
+  for (i=0; i<src->num_chunks; i++) {
+    c = &src->chunk[i];
+    if (CHUNK_IS (c, "LAYR"))
+      num_layers++;
+    else if (CHUNK_IS (c, "PNTS"))
+      num_points = c->size / 12;
+  }
+  if ((num_layers > 1) OR (num_points == 0) OR (count <= 0))
+    return (false);
+
+  dst->chunk = (Lwo2Chunk *) calloc (src->num_chunks, sizeof(Lwo2Chunk));
+  num_polygons = 0;
+  for (i=0; i<src->num_chunks; i++) {
+    c = &src->chunk[i];
+    // Polygons in this POLS chunk (the ones the PTAG and VMAD chunks after it index)
+    if (CHUNK_IS (c, "POLS")) {
+      num_polygons = 0;
+      p = c->data + 4;
+      end = c->data + c->size;
+      while (p < end) {
+        n = Get_U2 (&p) & 0x3FF;
+        while (n--)
+          Get_VX (&p);
+        num_polygons++;
+      }
+    }
+    if (NOT Merge_Chunk (c, matrices, count, num_points, num_polygons, &dst->chunk[i])) {
+      dst->num_chunks = i;
+      Lwo2_Free (dst);
+      return (false);
+    }
+    dst->num_chunks++;
+  }
+
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: Merge_Chunk
+|
+| Input: Called from Lwo2_Merge()
+| Output: Builds the merged version of one chunk.  Returns true on
+|   success.
+|___________________________________________________________________*/
+
+static bool Merge_Chunk (
+  Lwo2Chunk  *src,
+  gx3dMatrix *matrices,
+  int         count,
+  int         num_points,
+  int         num_polygons,
+  Lwo2Chunk  *dst )
+{
+  int i, j, n, dim, header;
+  unsigned point_offset, polygon_offset;
+  unsigned char *p, *q, *end;
+  gx3dVector v, min, max;
+  Buffer b;
+
+  memcpy (dst->id, src->id, 4);
+  memset (&b, 0, sizeof(b));
+
+  // Points
+  if (CHUNK_IS (src, "PNTS")) {
+    for (i=0; i<count; i++) {
+      p = src->data;
+      for (j=0; j<num_points; j++) {
+        v.x = Get_F4 (&p);
+        v.y = Get_F4 (&p);
+        v.z = Get_F4 (&p);
+        gx3d_MultiplyVectorMatrix (&v, &matrices[i], &v);
+        Put_F4 (&b, v.x);
+        Put_F4 (&b, v.y);
+        Put_F4 (&b, v.z);
+      }
+    }
+  }
+  // Bounding box of the merged points
+  else if (CHUNK_IS (src, "BBOX")) {
+    min.x = min.y = min.z =  FLT_MAX;
+    max.x = max.y = max.z = -FLT_MAX;
+    for (i=0; i<count; i++) {
+      for (j=0; j<8; j++) {
+        q = src->data + ((j & 1) ? 12 : 0);
+        v.x = Get_F4 (&q);
+        q = src->data + ((j & 2) ? 16 : 4);
+        v.y = Get_F4 (&q);
+        q = src->data + ((j & 4) ? 20 : 8);
+        v.z = Get_F4 (&q);
+        gx3d_MultiplyVectorMatrix (&v, &matrices[i], &v);
+        if (v.x < min.x) min.x = v.x;
+        if (v.y < min.y) min.y = v.y;
+        if (v.z < min.z) min.z = v.z;
+        if (v.x > max.x) max.x = v.x;
+        if (v.y > max.y) max.y = v.y;
+        if (v.z > max.z) max.z = v.z;
+      }
+    }
+    Put_F4 (&b, min.x);
+    Put_F4 (&b, min.y);
+    Put_F4 (&b, min.z);
+    Put_F4 (&b, max.x);
+    Put_F4 (&b, max.y);
+    Put_F4 (&b, max.z);
+  }
+  // Vertex maps: type, dimension, name then (point, values) - values are copied unchanged
+  else if (CHUNK_IS (src, "VMAP") OR CHUNK_IS (src, "VMAD")) {
+    p = src->data + 4;
+    dim = Get_U2 (&p);
+    header = 6 + Name_Size (p);
+    if (header > src->size)
+      return (false);
+    Put_Bytes (&b, src->data, header);
+    for (i=0; i<count; i++) {
+      point_offset   = i * num_points;
+      polygon_offset = i * num_polygons;
+      p = src->data + header;
+      end = src->data + src->size;
+      while (p < end) {
+        Put_VX (&b, Get_VX (&p) + point_offset);
+        if (CHUNK_IS (src, "VMAD"))
+          Put_VX (&b, Get_VX (&p) + polygon_offset);
+        Put_Bytes (&b, p, dim * 4);
+        p += dim * 4;
+      }
+    }
+  }
+  // Polygons: type then (# points + flags, points)
+  else if (CHUNK_IS (src, "POLS")) {
+    Put_Bytes (&b, src->data, 4);
+    for (i=0; i<count; i++) {
+      point_offset = i * num_points;
+      p = src->data + 4;
+      end = src->data + src->size;
+      while (p < end) {
+        n = Get_U2 (&p);
+        Put_U2 (&b, n);
+        for (n&=0x3FF; n; n--)
+          Put_VX (&b, Get_VX (&p) + point_offset);
+      }
+    }
+  }
+  // Polygon tags: type then (polygon, tag)
+  else if (CHUNK_IS (src, "PTAG")) {
+    Put_Bytes (&b, src->data, 4);
+    for (i=0; i<count; i++) {
+      polygon_offset = i * num_polygons;
+      p = src->data + 4;
+      end = src->data + src->size;
+      while (p < end) {
+        Put_VX (&b, Get_VX (&p) + polygon_offset);
+        Put_U2 (&b, Get_U2 (&p));
+      }
+    }
+  }
+  else
+    Put_Bytes (&b, src->data, src->size);
+
+  dst->size = b.size;
+  dst->data = b.data ? b.data : (unsigned char *) malloc (1);
+
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: Lwo2_Get_Triangles
+|
+| Input: Called from Lwo2_Read_Triangles()
+| Output: Returns # of triangles in the FACE polygons of a file and a
+|   malloc'd array of their vertices, or 0 if there are none.  Other
+|   polygon types (curves, patches, bones, ...) are skipped.
+|___________________________________________________________________*/
+
+int Lwo2_Get_Triangles (
+  Lwo2File    *file,
+  gx3dMatrix  *matrix,
+  gx3dVector **vertices )
+{
+  int i, j, n, num_points, num_triangles, max_triangles;
+  unsigned index [3];
+  unsigned char *p, *end;
+  bool face;
+  gx3dVector *points;
+  Lwo2Chunk *c;
+
+  *vertices = 0;
+  points = 0;
+  num_points = num_triangles = max_triangles = 0;
+  face = false;
+  for (i=0; i<file->num_chunks; i++) {
+    c = &file->chunk[i];
+    if (CHUNK_IS (c, "PNTS")) {
+      num_points = c->size / 12;
+      points = (gx3dVector *) realloc (points, num_points * sizeof(gx3dVector));
+      p = c->data;
+      for (j=0; j<num_points; j++) {
+        points[j].x = Get_F4 (&p);
+        points[j].y = Get_F4 (&p);
+        points[j].z = Get_F4 (&p);
+        if (matrix)
+          gx3d_MultiplyVectorMatrix (&points[j], matrix, &points[j]);
+      }
+    }
+    else if (CHUNK_IS (c, "POLS") AND (c->size >= 4)) {
+      face = (memcmp (c->data, "FACE", 4) == 0);
+      p = c->data + 4;
+      end = c->data + c->size;
+      while (p < end) {
+        n = Get_U2 (&p) & 0x3FF;
+        for (j=0; j<n; j++) {
+          // Fan from the first vertex
+          index[j < 2 ? j : 2] = Get_VX (&p);
+          if (face AND (j >= 2) AND (index[0] < (unsigned)num_points) AND (index[1] < (unsigned)num_points) AND (index[2] < (unsigned)num_points)) {
+            if (num_triangles == max_triangles) {
+              max_triangles = max_triangles ? max_triangles * 2 : 1024;
+              *vertices = (gx3dVector *) realloc (*vertices, max_triangles * 3 * sizeof(gx3dVector));
+            }
+            (*vertices)[num_triangles*3+0] = points[index[0]];
+            (*vertices)[num_triangles*3+1] = points[index[1]];
+            (*vertices)[num_triangles*3+2] = points[index[2]];
+            num_triangles++;
+          }
+          if (j >= 2)
+            index[1] = index[2];
+        }
+      }
+    }
+  }
+  free (points);
+
+  return (num_triangles);
+}
+
+/*____________________________________________________________________
+|
+| Function: Lwo2_Read_Triangles
+|
+| Input: Called from Heightfield_Add_Object(), Collision_Add_Object()
+| Output: Returns # of triangles in a file, scaled to feet the way
+|   gx3d_ReadLWO2File() does and then placed with a world matrix, and a
+|   malloc'd array of their vertices.  Returns -1 if the file can't be
+|   read.
+|___________________________________________________________________*/
+
+int Lwo2_Read_Triangles (
+  const char  *filename,
+  gx3dMatrix  *world_matrix,
+  gx3dVector **vertices )
+{
+  int n;
+  gx3dMatrix m;
+  Lwo2File file;
+
+  *vertices = 0;
+  if (NOT Lwo2_Read (filename, &file))
+    return (-1);
+
+  gx3d_GetScaleMatrix (&m, LWO2_FEET_PER_UNIT, LWO2_FEET_PER_UNIT, LWO2_FEET_PER_UNIT);
+  gx3d_MultiplyMatrix (&m, world_matrix, &m);
+  n = Lwo2_Get_Triangles (&file, &m, vertices);
+  Lwo2_Free (&file);
+
+  return (n);
+}
+
+/*____________________________________________________________________
+|
+| Function: Lwo2_Get_Mesh
+|
+| Input: Called from RenderSoft_Backend() load_object
+| Output: Returns # of triangles in the FACE polygons of a file and a
+|   malloc'd array of their vertices, with normals and texture
+|   coordinates, or 0 if there are none.
+|___________________________________________________________________*/
+
+int Lwo2_Get_Mesh (
+  Lwo2File    *file,
+  gx3dMatrix  *matrix,
+  Lwo2Vertex **vertices )
+{
+  int i, j, n, dim, num_triangles, max_triangles;
+  unsigned point;
+  unsigned char *p, *end;
+  bool face;
+  Lwo2Chunk *c;
+  MeshLayer layer;
+
+  *vertices = 0;
+  num_triangles = max_triangles = 0;
+  memset (&layer, 0, sizeof(layer));
+  for (i=0; i<file->num_chunks; i++) {
+    c = &file->chunk[i];
+    // A new layer (points always start one)
+    if (CHUNK_IS (c, "LAYR") OR CHUNK_IS (c, "PNTS")) {
+      if (layer.num_points) {
+        Add_Mesh_Layer (&layer, vertices, &num_triangles, &max_triangles);
+        layer.num_points = layer.num_polygons = layer.num_indices = layer.num_corner_uvs = 0;
+        layer.have_uv = false;
+      }
+      if (CHUNK_IS (c, "PNTS")) {
+        layer.num_points = c->size / 12;
+        layer.point = (gx3dVector *) realloc (layer.point, (layer.num_points + 1) * sizeof(gx3dVector));
+        layer.uv    = (float *) realloc (layer.uv, (layer.num_points + 1) * 2 * sizeof(float));
+        memset (layer.uv, 0, layer.num_points * 2 * sizeof(float));
+        p = c->data;
+        for (j=0; j<layer.num_points; j++) {
+          layer.point[j].x = Get_F4 (&p);
+          layer.point[j].y = Get_F4 (&p);
+          layer.point[j].z = Get_F4 (&p);
+          if (matrix)
+            gx3d_MultiplyVectorMatrix (&layer.point[j], matrix, &layer.point[j]);
+        }
+      }
+    }
+    // Texture coordinates per point (the first map only)
+    else if (CHUNK_IS (c, "VMAP") AND (c->size >= 6) AND (memcmp (c->data, "TXUV", 4) == 0) AND (NOT layer.have_uv)) {
+      p = c->data + 4;
+      dim = Get_U2 (&p);
+      p += Name_Size (p);
+      end = c->data + c->size;
+      while ((dim == 2) AND (p < end)) {
+        point = Get_VX (&p);
+        if (point < (unsigned)layer.num_points) {
+          layer.uv[point*2+0] = Get_F4 (&p);
+          layer.uv[point*2+1] = 1 - Get_F4 (&p);
+        }
+        else
+          p += 8;
+      }
+      layer.have_uv = true;
+    }
+    // Texture coordinates per polygon, where a point has different coordinates on different polygons
+    else if (CHUNK_IS (c, "VMAD") AND (c->size >= 6) AND (memcmp (c->data, "TXUV", 4) == 0)) {
+      p = c->data + 4;
+      dim = Get_U2 (&p);
+      p += Name_Size (p);
+      end = c->data + c->size;
+      while ((dim == 2) AND (p < end)) {
+        if (layer.num_corner_uvs == layer.max_corner_uvs) {
+          layer.max_corner_uvs = layer.max_corner_uvs ? layer.max_corner_uvs * 2 : 64;
+          layer.corner_uv = (CornerUV *) realloc (layer.corner_uv, layer.max_corner_uvs * sizeof(CornerUV));
+        }
+        layer.corner_uv[layer.num_corner_uvs].point   = Get_VX (&p);
+        layer.corner_uv[layer.num_corner_uvs].polygon = Get_VX (&p);
+        layer.corner_uv[layer.num_corner_uvs].u       = Get_F4 (&p);
+        layer.corner_uv[layer.num_corner_uvs].v       = 1 - Get_F4 (&p);
+        layer.num_corner_uvs++;
+      }
+    }
+    else if (CHUNK_IS (c, "POLS") AND (c->size >= 4)) {
+      face = (memcmp (c->data, "FACE", 4) == 0);
+      p = c->data + 4;
+      end = c->data + c->size;
+      while (p < end) {
+        n = Get_U2 (&p) & 0x3FF;
+        if (layer.num_polygons == layer.max_polygons) {
+          layer.max_polygons = layer.max_polygons ? layer.max_polygons * 2 : 256;
+          layer.polygon_start = (int *) realloc (layer.polygon_start, layer.max_polygons * sizeof(int));
+          layer.polygon_size  = (int *) realloc (layer.polygon_size,  layer.max_polygons * sizeof(int));
+        }
+        if (layer.num_indices + n > layer.max_indices) {
+          layer.max_indices = (layer.num_indices + n) * 2;
+          layer.index = (unsigned *) realloc (layer.index, layer.max_indices * sizeof(unsigned));
+        }
+        layer.polygon_start[layer.num_polygons] = layer.num_indices;
+        layer.polygon_size[layer.num_polygons]  = face ? n : 0;
+        for (j=0; j<n; j++) {
+          layer.index[layer.num_indices] = Get_VX (&p);
+          // Skip polygons with bad points
+          if (layer.index[layer.num_indices++] >= (unsigned)layer.num_points)
+            layer.polygon_size[layer.num_polygons] = 0;
+        }
+        layer.num_polygons++;
+      }
+    }
+  }
+  if (layer.num_points)
+    Add_Mesh_Layer (&layer, vertices, &num_triangles, &max_triangles);
+
+  free (layer.point);
+  free (layer.uv);
+  free (layer.polygon_start);
+  free (layer.polygon_size);
+  free (layer.index);
+  free (layer.corner_uv);
+
+  return (num_triangles);
+}
+
+/*____________________________________________________________________
+|
+| Function: Add_Mesh_Layer
+|
+| Input: Called from Lwo2_Get_Mesh()
+| Output: Adds the triangles of one layer to the mesh.  The normal at
+|   each corner is the sum of the (area weighted) normals of the
+|   polygons around the point that face within LWO2_SMOOTH_ANGLE of
+|   the corner's own polygon.
+|___________________________________________________________________*/
+
+static void Add_Mesh_Layer (MeshLayer *layer, Lwo2Vertex **vertices, int *num_triangles, int *max_triangles)
+{
+  int i, j, k, q, n, *first, *around;
+  unsigned *index;
+  float length, smooth_cos;
+  gx3dVector *normal, *unit, *a, *b, sum;
+  Lwo2Vertex corner [3];
+
+  smooth_cos = (float)cos (LWO2_SMOOTH_ANGLE * 3.14159265 / 180);
+
+  // Polygon normals (Newell's method, length is twice the area)
+  normal = (gx3dVector *) calloc (layer->num_polygons + 1, sizeof(gx3dVector));
+  unit   = (gx3dVector *) calloc (layer->num_polygons + 1, sizeof(gx3dVector));
+  for (i=0; i<layer->num_polygons; i++) {
+    n = layer->polygon_size[i];
+    index = &layer->index[layer->polygon_start[i]];
+    for (j=0; j<n; j++) {
+      a = &layer->point[index[j]];
+      b = &layer->point[index[(j+1) % n]];
+      normal[i].x += (a->y - b->y) * (a->z + b->z);
+      normal[i].y += (a->z - b->z) * (a->x + b->x);
+      normal[i].z += (a->x - b->x) * (a->y + b->y);
+    }
+    length = sqrtf (normal[i].x * normal[i].x + normal[i].y * normal[i].y + normal[i].z * normal[i].z);
+    if (length > 0) {
+      unit[i].x = normal[i].x / length;
+      unit[i].y = normal[i].y / length;
+      unit[i].z = normal[i].z / length;
+    }
+  }
+
+  // Polygons around each point
+  first  = (int *) calloc (layer->num_points + 1, sizeof(int));
+  around = (int *) malloc ((layer->num_indices + 1) * sizeof(int));
+  for (i=0; i<layer->num_polygons; i++)
+    for (j=0; j<layer->polygon_size[i]; j++)
+      first[layer->index[layer->polygon_start[i]+j] + 1]++;
+  for (i=0; i<layer->num_points; i++)
+    first[i+1] += first[i];
+  for (i=0; i<layer->num_polygons; i++)
+    for (j=0; j<layer->polygon_size[i]; j++)
+      around[first[layer->index[layer->polygon_start[i]+j]]++] = i;
+  for (i=layer->num_points; i>0; i--)
+    first[i] = first[i-1];
+  first[0] = 0;
+
+  for (i=0; i<layer->num_polygons; i++) {
+    n = layer->polygon_size[i];
+    index = &layer->index[layer->polygon_start[i]];
+    for (j=0; j<n; j++) {
+      // Fan from the first corner: 0, j-1, j
+      k = (j < 2) ? j : 2;
+      corner[k].position = layer->point[index[j]];
+      corner[k].u = layer->uv[index[j]*2+0];
+      corner[k].v = layer->uv[index[j]*2+1];
+      for (q=0; q<layer->num_corner_uvs; q++)
+        if ((layer->corner_uv[q].polygon == (unsigned)i) AND (layer->corner_uv[q].point == index[j])) {
+          corner[k].u = layer->corner_uv[q].u;
+          corner[k].v = layer->corner_uv[q].v;
+          break;
+        }
+      sum.x = sum.y = sum.z = 0;
+      for (q=first[index[j]]; q<first[index[j]+1]; q++)
+        if (unit[around[q]].x * unit[i].x + unit[around[q]].y * unit[i].y + unit[around[q]].z * unit[i].z >= smooth_cos) {
+          sum.x += normal[around[q]].x;
+          sum.y += normal[around[q]].y;
+          sum.z += normal[around[q]].z;
+        }
+      length = sqrtf (sum.x * sum.x + sum.y * sum.y + sum.z * sum.z);
+      if (length > 0) {
+        sum.x /= length;
+        sum.y /= length;
+        sum.z /= length;
+      }
+      corner[k].normal = sum;
+      if (j >= 2) {
+        if (*num_triangles == *max_triangles) {
+          *max_triangles = *max_triangles ? *max_triangles * 2 : 1024;
+          *vertices = (Lwo2Vertex *) realloc (*vertices, *max_triangles * 3 * sizeof(Lwo2Vertex));
+        }
+        memcpy (&(*vertices)[*num_triangles * 3], corner, 3 * sizeof(Lwo2Vertex));
+        (*num_triangles)++;
+        corner[1] = corner[2];
+      }
+    }
+  }
+
+  free (normal);
+  free (unit);
+  free (first);
+  free (around);
+}
+
+/*____________________________________________________________________
+|
+| Function: Lwo2_Free
+|
+| Input: Called from ____
+| Output: Frees a file.
+|___________________________________________________________________*/
+
+void Lwo2_Free (Lwo2File *file)
+{
+  int i;
+
+  for (i=0; i<file->num_chunks; i++)
+    free (file->chunk[i].data);
+  free (file->chunk);
+  memset (file, 0, sizeof(Lwo2File));
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_U2, Get_U4, Get_F4, Get_VX
+|
+| Input: Called from Lwo2 functions
+| Output: Reads a big endian value and advances the pointer.  A VX is
+|   a 2 byte index, or a 4 byte index if the first byte is 0xFF.
+|___________________________________________________________________*/
+
+static unsigned Get_U2 (unsigned char **p)
+{
+  unsigned n = ((*p)[0] << 8) | (*p)[1];
+  *p += 2;
+  return (n);
+}
+
+static unsigned Get_U4 (unsigned char **p)
+{
+  unsigned n = ((unsigned)(*p)[0] << 24) | ((*p)[1] << 16) | ((*p)[2] << 8) | (*p)[3];
+  *p += 4;
+  return (n);
+}
+
+static float Get_F4 (unsigned char **p)
+{
+  float f;
+  unsigned n = Get_U4 (p);
+  memcpy (&f, &n, 4);
+  return (f);
+}
+
+static unsigned Get_VX (unsigned char **p)
+{
+  if ((*p)[0] == 0xFF)
+    return (Get_U4 (p) & 0xFFFFFF);
+  return (Get_U2 (p));
+}
+
+/*____________________________________________________________________
+|
+| Function: Put_Bytes, Put_U2, Put_U4, Put_F4, Put_VX
+|
+| Input: Called from Lwo2 functions
+| Output: Appends big endian values to a buffer.
+|___________________________________________________________________*/
+
+static void Put_Bytes (Buffer *b, void *data, int n)
+{
+  if (b->size + n > b->max) {
+    b->max = b->max ? b->max * 2 : 4096;
+    if (b->max < b->size + n)
+      b->max = b->size + n;
+    b->data = (unsigned char *) realloc (b->data, b->max);
+  }
+  memcpy (b->data + b->size, data, n);
+  b->size += n;
+}
+
+static void Put_U2 (Buffer *b, unsigned n)
+{
+  unsigned char c[2] = { (unsigned char)(n >> 8), (unsigned char)n };
+  Put_Bytes (b, c, 2);
+}
+
+static void Put_U4 (Buffer *b, unsigned n)
+{
+  unsigned char c[4] = { (unsigned char)(n >> 24), (unsigned char)(n >> 16), (unsigned char)(n >> 8), (unsigned char)n };
+  Put_Bytes (b, c, 4);
+}
+
+static void Put_F4 (Buffer *b, float f)
+{
+  unsigned n;
+  memcpy (&n, &f, 4);
+  Put_U4 (b, n);
+}
+
+static void Put_VX (Buffer *b, unsigned n)
+{
+  if (n < 0xFF00)
+    Put_U2 (b, n);
+  else
+    Put_U4 (b, n | 0xFF000000);
+}
+
+/*____________________________________________________________________
+|
+| Function: Name_Size
+|
+| Input: Called from Merge_Chunk()
+| Output: Returns size of a null terminated name, padded to even.
+|___________________________________________________________________*/
+
+static int Name_Size (unsigned char *p)
+{
+  int n = (int)strlen ((char *)p) + 1;
+  return (n + (n & 1));
+}
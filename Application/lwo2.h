@@ -0,0 +1,73 @@
+/*____________________________________________________________________
+|
+| File: lwo2.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+// gx3d_ReadLWO2File() reads Lightwave units (meters) as feet, scaling by this
+#define LWO2_FEET_PER_UNIT 3.28084f
+
+// One chunk of an LWO2 file (data is in file byte order, without the pad byte)
+struct Lwo2Chunk {
+  char           id[4];
+  int            size;
+  unsigned char *data;
+};
+
+// Contents of an LWO2 file
+struct Lwo2File {
+  int        num_chunks;
+  Lwo2Chunk *chunk;
+};
+
+// Reads a file into memory, returns true on success
+bool Lwo2_Read (const char *filename, Lwo2File *file);
+
+// Writes a file, returns true on success
+bool Lwo2_Write (const char *filename, Lwo2File *file);
+
+// Returns # of points in a single layer file
+int Lwo2_Num_Points (Lwo2File *file);
+
+// Builds a single layer file holding count copies of a single layer file, each transformed by a matrix
+bool Lwo2_Merge (
+  Lwo2File   *src,
+  gx3dMatrix *matrices,
+  int         count,
+  Lwo2File   *dst );
+
+// Returns # of triangles in the FACE polygons of a single layer file (fanned from the first vertex), each
+//  transformed by a matrix (0 for none), and a malloc'd array of 3 vertices per triangle in *vertices
+int Lwo2_Get_Triangles (
+  Lwo2File    *file,
+  gx3dMatrix  *matrix,
+  gx3dVector **vertices );  // caller frees with free()
+
+// Corner of a textured triangle
+struct Lwo2Vertex {
+  gx3dVector position;
+  gx3dVector normal;        // smoothed except across edges sharper than LWO2_SMOOTH_ANGLE
+  float      u, v;          // texture coordinates, v down
+};
+
+// Polygons meeting at a sharper angle than this get separate normals
+#define LWO2_SMOOTH_ANGLE 60
+
+// Returns # of triangles in the FACE polygons of a file (all layers, fanned from the first vertex), each
+//  transformed by a matrix (0 for none), and a malloc'd array of 3 vertices per triangle in *vertices with
+//  normals and the first TXUV map of each layer
+int Lwo2_Get_Mesh (
+  Lwo2File    *file,
+  gx3dMatrix  *matrix,
+  Lwo2Vertex **vertices );  // caller frees with free()
+
+// Reads a file and returns its triangles in world space (see Lwo2_Get_Triangles()), or -1 if the file can't be read
+int Lwo2_Read_Triangles (
+  const char  *filename,
+  gx3dMatrix  *world_matrix,
+  gx3dVector **vertices );  // caller frees with free()
+
+// Frees a file read or built by the above
+void Lwo2_Free (Lwo2File *file);
@@ -9,7 +9,6 @@
 |							 Init_Graphics
 |								Set_Mouse_Cursor
 |             Program_Run
-|							 Init_Render_State
 |             Program_Free
 |             Program_Immediate_Key_Handler
 |
@@ -31,6 +30,27 @@
 
 #include "main.h"
 #include "position.h"
+#include "occlusion.h"
+#include "foliage.h"
+#include "render.h"
+#include "rendergx3d.h"
+#include "rendernull.h"
+#include "rendersoft.h"
+#include "renderqueue.h"
+#include "staticbatch.h"
+#include "placement.h"
+#include "eggstore.h"
+#include "egganim.h"
+#include "pick.h"
+#include "heightfield.h"
+#include "collision.h"
+#include "bake.h"
+#include "framegraph.h"
+#include "spritebatch.h"
+#include "simclock.h"
+#include "input.h"
+#include "jobs.h"
+#include "pipeline.h"
 #include <ctime>
 #include <stdlib.h>
 
@@ -45,6 +65,69 @@ typedef struct
 	unsigned bitdepth;
 } UserPreferences;
 
+// What the sections of the scene recorded in parallel need (read only while recording)
+struct SceneSections
+{
+	gx3dVector camera;
+	gx3dObject *obj_hay, *obj_trashcan, *obj_fountain, *obj_windmill, *obj_title, *obj_title2, *obj_poles, *obj_fence, *obj_hill, *obj_egg;
+	int mat_hay, mat_trashcan, mat_fountain, mat_windmill, mat_sign, mat_sign2, mat_poles, mat_fence, mat_hill, mat_egg;
+	int fence_batch;
+	EggStore *eggs;
+	int hover_egg;
+};
+
+// What the passes of the frame graph draw with (the values that change are copied in or pointed to each frame)
+struct FrameData
+{
+	gxColor clear_color;
+	gx3dColor ambient;
+	gx3dVector *position, *heading;
+	gx3dRay view_ray;
+	unsigned time, elapsed_time;
+	float glitter_start;
+	bool *glitter;
+	gx3dVector *glitter_position;
+	gx3dParticleSystem psys_glitter;
+	gx3dBox *fence_occluder, *hill_occluder;
+	gx3dObject *obj_sky, *obj_ground;
+	int mat_sky, mat_ground;
+	EggStore *eggs;
+	EggAnimParams *egg_anim;
+	int pickup_distance;
+	SceneSections *scene;
+	RenderQueueRecordFunc *scene_funcs;
+	void **scene_data;
+	int num_scene_funcs;
+	int sprite_cross, sprite_egg;
+};
+
+// What a frame is drawn from, written by Simulate() while the frame before is drawn (see pipeline.cpp)
+struct FrameSnapshot
+{
+	gx3dVector position, heading; // camera, between the last two steps
+	unsigned time; // simulated time, also between the last two steps
+};
+
+// What Simulate() steps (only it touches the state pointed to while it runs)
+struct SimState
+{
+	int steps;
+	unsigned cmd_move;
+	int turn_x, turn_y; // mouse movement, turned in the first step
+	bool force_update;
+	gx3dVector *position, *heading;
+	gx3dVector *last_position, *last_heading; // before the last step
+};
+
+// A picture covering the screen, drawn as two billboards (title, help and game over screens)
+struct Overlay
+{
+	FrameData *frame;
+	gx3dObject *obj[2];
+	gx3dTexture tex[2];
+	gx3dVector place[2];
+};
+
 /*___________________
 |
 | Function Prototypes
@@ -52,7 +135,20 @@ typedef struct
 
 static int Init_Graphics(unsigned resolution, unsigned bitdepth, unsigned stencildepth, int *generate_keypress_events);
 static void Set_Mouse_Cursor();
-static void Init_Render_State();
+static void Collide_Player(gx3dVector *from, gx3dVector *to, gx3dVector *result);
+static void Record_Foliage(int buffer, void *data);
+static void Record_Props(int buffer, void *data);
+static void Record_Fence_And_Hills(int buffer, void *data);
+static void Record_Eggs(int buffer, void *data);
+static void Pass_Clear(void *data);
+static void Pass_Occlusion(void *data);
+static void Pass_World(void *data);
+static void Pass_Scene(void *data);
+static void Pass_Particles(void *data);
+static void Pass_HUD(void *data);
+static void Pass_Overlay(void *data);
+static void Write_Debug_Line(const char *str);
+static void Simulate(void *data, void *snapshot);
 
 /*___________________
 |
@@ -83,9 +179,74 @@ static void Init_Render_State();
 #define GRAPHICS_STENCILDEPTH 0
 #define GRAPHICS_BITDEPTH (gxBITDEPTH_24 | gxBITDEPTH_32)
 
+#define WORLD_SEED 2013 // seed for procedural placement, the same seed always gives the same world
+
 #define AUTO_TRACKING 1
 #define NO_AUTO_TRACKING 0
 
+// Once an overlay screen (title, help, game over) is on every video page it's left there, shown again this often in case it was lost
+#define OVERLAY_REFRESH_MS 1000
+// Longest the game loop waits for an event each time through while an overlay is left on screen
+#define OVERLAY_SLEEP_MS   15
+
+// Fence segment placements (y rotation, x, z) - first is front left of player, the rest go clockwise from it
+static float fence_placement[][3] = {
+	{ -24, -650, -4460 }, { -24, -999, -4618 }, { -10, -1358, -4728 }, { 0, -1740, -4760 },
+	{ 15, -2115, -4710 }, { 27, -2470, -4575 }, { 27, -2813, -4402 }, { -24, -3165, -4390 },
+	{ -35, -3500, -4576 }, { -38, -3807, -4802 }, { -27, -4127, -5007 }, { -12, -4483, -5132 },
+	{ 13, -4854, -5130 }, { 19, -5220, -5026 }, { 35, -5557, -4855 }, { 40, -5859, -4623 },
+	{ 51, -6125, -4351 }, { 73, -6300, -4020 }, { 87, -6365, -3650 }, { 110, -6310, -3280 },
+	{ 130, -6122, -2956 }, { 135.5, -5863, -2674 }, { 135.5, -5588, -2407 }, { 135.5, -5313, -2140 },
+	{ 135.5, -5038, -1873 }, { 135.5, -4763, -1606 }, { 125, -4517, -1314 }, { 105, -4355, -970 },
+	{ 85, -4320, -593 }, { 85, -4351, -212 }, { 115, -4285, 150 }, { 135, -4070, 455 },
+	{ 157, -3761, 664 }, { 157, -3410, 813 }, { 157, -2357, 1260 }, { 157, -2006, 1409 },
+	{ 132, -1700, 1627 }, { 132, -1444, 1911 }, { 132, -1188, 2195 }, { 132, -932, 2479 },
+	{ 132, -676, 2763 }, { 132, -420, 3047 }, { 132, -164, 3331 }, { 132, 92, 3615 },
+	{ 132, 348, 3899 }, { 132, 604, 4183 }, { 132, 860, 4467 }, { 132, 1116, 4751 },
+	{ 132, 1372, 5035 }, { 42, 1640, 5060 }, { 42, 1925, 4805 }, { 42, 2210, 4550 },
+	{ 42, 2495, 4295 }, { 42, 2780, 4040 }, { 42, 3065, 3785 }, { 42, 3350, 3530 },
+	{ 42, 3635, 3275 }, { 42, 3920, 3020 }, { 42, 4205, 2765 }, { 42, 4490, 2510 },
+	{ 42, 4775, 2255 }, { -81, 4875, 1935 }, { -81, 4815, 1557 }, { -81, 4755, 1179 },
+	{ -81, 4695, 801 }, { -81, 4635, 423 }, { -81, 4575, 45 }, { -81, 4515, -333 },
+	{ -81, 4455, -711 }, { -81, 4395, -1089 }, { -81, 4335, -1467 }, { -81, 4275, -1845 },
+	{ -81, 4215, -2223 }, { -81, 4155, -2601 }, { -81, 4095, -2979 }, { -81, 4035, -3357 },
+	{ -81, 3975, -3735 }, { -81, 3915, -4113 }, { 12, 3705, -4257 }, { 12, 3331, -4179 },
+	{ 12, 2957, -4101 }, { 12, 2583, -4023 }, { 12, 2209, -3945 }, { -4.5, 1830, -3920 },
+	{ -4.5, 1449, -3950 }, { -4.5, 1068, -3980 }, { -4.5, 687, -4010 }, { -18, 313, -4084 },
+};
+#define NUM_FENCE ((int)(sizeof(fence_placement) / sizeof(fence_placement[0])))
+
+// Hill placements (y rotation, x, z) around the edge of the map
+static float hill_placement[][3] = {
+	{ 0, 0, -9000 }, { 0, -3800, -9000 }, { 0, 4000, -8000 }, { 90, -9000, -7000 },
+	{ 90, 8000, -7000 }, { 10, -9900, -4500 }, { -90, 8000, -5000 }, { 90, -8000, 0 },
+	{ -90, 8000, -485 }, { 90, -10000, 4500 }, { -90, 8000, 4000 }, { 90, -5500, 9000 },
+	{ -90, 5000, 9000 }, { 0, -700, 8900 }, { 0, -3000, 8950 }, { 0, 1700, 8900 },
+	{ 0, 5845, 6300 }, { 0, -9235, 8160 },
+};
+#define NUM_HILLS ((int)(sizeof(hill_placement) / sizeof(hill_placement[0])))
+
+// Haybale placements (x, z)
+static float hay_placement[][2] = {
+	{ -153, 5084 }, { 288, 5342 }, { 850, 5495 }, { 1675, 5660 }, { 2305, 5464 },
+	{ 2525, 4842 }, { 3219, 4503 }, { 3711, 4088 }, { 3956, 3469 },
+};
+#define NUM_HAY ((int)(sizeof(hay_placement) / sizeof(hay_placement[0])))
+
+// Player body for collisions, from the eye down to a little above the ground (set once the eye height is known)
+static CollisionCapsule player_capsule;
+#define PLAYER_RADIUS 15
+#define PLAYER_STEP_HEIGHT 20 // the bottom of the body clears the ground by this much
+
+// Egg placements (x, y, z)
+static float egg_placement[][3] = {
+	{ 555, 10, 1090 }, { -1010, -5, -2000 }, { -632, -5, -3278 }, { -5650, -5, -3450 },
+	{ 4019, 20, 3568 }, { 4328, 80, -1519 }, { -5889, -5, 3263 }, { -4113, -5, 4708 },
+	{ -1544, -5, 4921 }, { 2972, 40, -2794 }, { -5678, -5, -6182 }, { -3742, -5, 4280 },
+};
+#define NUM_EGGS ((int)(sizeof(egg_placement) / sizeof(egg_placement[0])))
+#define EGG_PICK_CELL_SIZE 400
+
 /*____________________________________________________________________
 |
 | Function: Program_Get_User_Preferences
@@ -216,12 +377,12 @@ static void Set_Mouse_Cursor()
 void DeployObject(gx3dObject *obj, gx3dTexture tex, int x, int y, int z, gx3dColor ambient_color)
 {
 	gx3dMatrix m;
-	gx3d_SetAmbientLight(ambient_color);
+	Render_Set_Ambient_Light(ambient_color);
 
 	gx3d_GetTranslateMatrix(&m, x, y, z);
-	gx3d_SetObjectMatrix(obj, &m);
-	gx3d_SetTexture(0, tex);
-	gx3d_DrawObject(obj, 0);
+	Render_Set_Object_Matrix(obj, &m);
+	Render_Set_Texture(0, tex);
+	Render_Draw_Object(obj);
 }
 
 void DeployObject(gx3dObject *obj, gx3dTexture tex, int x, int y, int z)
@@ -229,13 +390,420 @@ void DeployObject(gx3dObject *obj, gx3dTexture tex, int x, int y, int z)
 	gx3dMatrix m;
 
 	gx3d_GetTranslateMatrix(&m, x, y, z);
-	gx3d_SetObjectMatrix(obj, &m);
-	gx3d_SetTexture(0, tex);
-	gx3d_DrawObject(obj, 0);
+	Render_Set_Object_Matrix(obj, &m);
+	Render_Set_Texture(0, tex);
+	Render_Draw_Object(obj);
+}
+
+/*____________________________________________________________________
+|
+| Function: Get_Occluder_Box
+|
+| Input: Called from Program_Run()
+| Output: Returns a box that fits inside the solid part of an object,
+|   shrunk around the center in x,z and from the top in y.
+|___________________________________________________________________*/
+
+static void Get_Occluder_Box(gx3dObject *obj, float scale_xz, float scale_y, gx3dBox *box)
+{
+	float cx = (obj->bound_box.min.x + obj->bound_box.max.x) / 2;
+	float cz = (obj->bound_box.min.z + obj->bound_box.max.z) / 2;
+
+	box->min.x = cx - (cx - obj->bound_box.min.x) * scale_xz;
+	box->max.x = cx + (obj->bound_box.max.x - cx) * scale_xz;
+	box->min.z = cz - (cz - obj->bound_box.min.z) * scale_xz;
+	box->max.z = cz + (obj->bound_box.max.z - cz) * scale_xz;
+	box->min.y = obj->bound_box.min.y;
+	box->max.y = obj->bound_box.min.y + (obj->bound_box.max.y - obj->bound_box.min.y) * scale_y;
+}
+
+/*____________________________________________________________________
+|
+| Function: Simulate
+|
+| Input: Called from Pipeline_Begin_Frame() (or as a job)
+| Output: Steps the player, turning by the mouse movement in the first
+|   step, and writes the camera and time to draw between the last two
+|   steps into the snapshot.  Leaves the renderer alone.
+|___________________________________________________________________*/
+
+static void Simulate(void *data, void *snapshot)
+{
+	SimState *sim = (SimState *)data;
+	FrameSnapshot *frame = (FrameSnapshot *)snapshot;
+	bool position_changed, camera_changed;
+
+	for (int step = 0; step < sim->steps; step++) {
+		*sim->last_position = *sim->position;
+		*sim->last_heading = *sim->heading;
+		Position_Update(SimClock_Step_Ms(), sim->cmd_move, step ? 0 : sim->turn_y, step ? 0 : sim->turn_x, sim->force_update,
+			&position_changed, &camera_changed, sim->position, sim->heading);
+	}
+	// Used up (the pipeline simulates the first frame twice)
+	sim->steps = 0;
+	sim->turn_x = 0;
+	sim->turn_y = 0;
+
+	// Draw the camera between the last two steps
+	float alpha = SimClock_Alpha();
+	gx3dVector *p = sim->position, *lp = sim->last_position, *h = sim->heading, *lh = sim->last_heading;
+	frame->position.x = lp->x + (p->x - lp->x) * alpha;
+	frame->position.y = lp->y + (p->y - lp->y) * alpha;
+	frame->position.z = lp->z + (p->z - lp->z) * alpha;
+	frame->heading.x = lh->x + (h->x - lh->x) * alpha;
+	frame->heading.y = lh->y + (h->y - lh->y) * alpha;
+	frame->heading.z = lh->z + (h->z - lh->z) * alpha;
+	gx3d_NormalizeVector(&frame->heading, &frame->heading);
+	// The time of that camera, one step behind the simulated time (before the first step, the start)
+	double time = SimClock_Time_Ms() - SimClock_Step_Ms() + alpha * SimClock_Step_Ms();
+	frame->time = (time > 0) ? (unsigned)time : 0;
+}
+
+/*____________________________________________________________________
+|
+| Function: Write_Debug_Line
+|
+| Input: Called from Jobs_Benchmark(), Pipeline_Benchmark()
+| Output: Writes a line to the debug file.
+|___________________________________________________________________*/
+
+static void Write_Debug_Line(const char *str)
+{
+	debug_WriteFile((char *)str);
+}
+
+/*____________________________________________________________________
+|
+| Function: Collide_Player
+|
+| Input: Called from Position_Update()
+| Output: Moves the player's body from one position towards another,
+|   sliding along anything in the way.
+|___________________________________________________________________*/
+
+static void Collide_Player(gx3dVector *from, gx3dVector *to, gx3dVector *result)
+{
+	Collision_Move(from, to, &player_capsule, result);
+}
+
+/*____________________________________________________________________
+|
+| Function: Record_Foliage
+|
+| Input: Called from RenderQueue_Record_Parallel()
+| Output: Records the fields, grass and trees.
+|___________________________________________________________________*/
+
+static void Record_Foliage(int buffer, void *data)
+{
+	SceneSections *scene = (SceneSections *)data;
+
+	Foliage_Submit(buffer, &scene->camera);
+}
+
+/*____________________________________________________________________
+|
+| Function: Record_Props
+|
+| Input: Called from RenderQueue_Record_Parallel()
+| Output: Records the haybales, trashcan, fountain, windmill, signs and
+|   poles that aren't occluded.
+|___________________________________________________________________*/
+
+static void Record_Props(int buffer, void *data)
+{
+	SceneSections *scene = (SceneSections *)data;
+	gx3dMatrix m, m1, m2, m3;
+
+	// Haybales
+	for (int i = 0; i < NUM_HAY; i++) {
+		gx3d_GetScaleMatrix(&m1, 5, 5, 5);
+		gx3d_GetRotateYMatrix(&m2, 130);
+		gx3d_MultiplyMatrix(&m1, &m2, &m);
+		gx3d_GetTranslateMatrix(&m3, hay_placement[i][0], -19, hay_placement[i][1]);
+		gx3d_MultiplyMatrix(&m, &m3, &m);
+		if (Occlusion_Box_Visible(&scene->obj_hay->bound_box, &m))
+			RenderQueue_Record(buffer, RQ_PASS_OPAQUE, scene->mat_hay, scene->obj_hay, &m);
+	}
+
+	// Trashcan
+	gx3d_GetScaleMatrix(&m1, 5, 5, 5);
+	gx3d_GetTranslateMatrix(&m2, -1010, -19, -2000);
+	gx3d_MultiplyMatrix(&m1, &m2, &m);
+	if (Occlusion_Box_Visible(&scene->obj_trashcan->bound_box, &m))
+		RenderQueue_Record(buffer, RQ_PASS_OPAQUE, scene->mat_trashcan, scene->obj_trashcan, &m);
+
+	// Fountain
+	gx3d_GetScaleMatrix(&m1, 20, 20, 20);
+	gx3d_GetTranslateMatrix(&m2, 500, -19, 800);
+	gx3d_MultiplyMatrix(&m1, &m2, &m);
+	if (Occlusion_Box_Visible(&scene->obj_fountain->bound_box, &m))
+		RenderQueue_Record(buffer, RQ_PASS_OPAQUE, scene->mat_fountain, scene->obj_fountain, &m);
+
+	// Windmill
+	gx3d_GetScaleMatrix(&m1, 23, 23, 23);
+	gx3d_GetRotateYMatrix(&m2, 210);
+	gx3d_MultiplyMatrix(&m1, &m2, &m);
+	gx3d_GetTranslateMatrix(&m3, -5800, -19, 3200);
+	gx3d_MultiplyMatrix(&m, &m3, &m);
+	if (Occlusion_Box_Visible(&scene->obj_windmill->bound_box, &m))
+		RenderQueue_Record(buffer, RQ_PASS_OPAQUE, scene->mat_windmill, scene->obj_windmill, &m);
+
+	// Sign, left
+	gx3d_GetScaleMatrix(&m1, 9, 9, 9);
+	gx3d_GetRotateYMatrix(&m2, 155);
+	gx3d_MultiplyMatrix(&m1, &m2, &m);
+	gx3d_GetTranslateMatrix(&m3, -770, 270, -3280);
+	gx3d_MultiplyMatrix(&m, &m3, &m);
+	if (Occlusion_Box_Visible(&scene->obj_title->bound_box, &m))
+		RenderQueue_Record(buffer, RQ_PASS_OPAQUE, scene->mat_sign, scene->obj_title, &m);
+
+	// Sign, right
+	gx3d_GetScaleMatrix(&m1, 9, 9, 9);
+	gx3d_GetRotateYMatrix(&m2, 155);
+	gx3d_MultiplyMatrix(&m1, &m2, &m);
+	gx3d_GetTranslateMatrix(&m3, -525, 270, -3166);
+	gx3d_MultiplyMatrix(&m, &m3, &m);
+	if (Occlusion_Box_Visible(&scene->obj_title2->bound_box, &m))
+		RenderQueue_Record(buffer, RQ_PASS_OPAQUE, scene->mat_sign2, scene->obj_title2, &m);
+
+	// Poles
+	gx3d_GetScaleMatrix(&m1, 15, 15, 15);
+	gx3d_GetTranslateMatrix(&m2, -2000, -110, -2700);
+	gx3d_MultiplyMatrix(&m1, &m2, &m);
+	gx3d_GetRotateYMatrix(&m3, -25);
+	gx3d_MultiplyMatrix(&m, &m3, &m);
+	if (Occlusion_Box_Visible(&scene->obj_poles->bound_box, &m))
+		RenderQueue_Record(buffer, RQ_PASS_OPAQUE, scene->mat_poles, scene->obj_poles, &m);
+}
+
+/*____________________________________________________________________
+|
+| Function: Record_Fence_And_Hills
+|
+| Input: Called from RenderQueue_Record_Parallel()
+| Output: Records the fence (static batch chunks left by
+|   StaticBatch_Cull(), or each segment if there is no batch) and the
+|   hills.
+|___________________________________________________________________*/
+
+static void Record_Fence_And_Hills(int buffer, void *data)
+{
+	SceneSections *scene = (SceneSections *)data;
+	gx3dMatrix m, m1, m2;
+
+	StaticBatch_Submit(buffer);
+	if (scene->fence_batch == -1) {
+		for (int i = 0; i < NUM_FENCE; i++) {
+			gx3d_GetRotateYMatrix(&m1, fence_placement[i][0]);
+			gx3d_GetTranslateMatrix(&m2, fence_placement[i][1], -5, fence_placement[i][2]);
+			gx3d_MultiplyMatrix(&m1, &m2, &m);
+			RenderQueue_Record(buffer, RQ_PASS_OPAQUE, scene->mat_fence, scene->obj_fence, &m);
+		}
+	}
+
+	for (int i = 0; i < NUM_HILLS; i++) {
+		gx3d_GetRotateYMatrix(&m1, hill_placement[i][0]);
+		gx3d_GetTranslateMatrix(&m2, hill_placement[i][1], 0, hill_placement[i][2]);
+		gx3d_MultiplyMatrix(&m1, &m2, &m);
+		RenderQueue_Record(buffer, RQ_PASS_OPAQUE, scene->mat_hill, scene->obj_hill, &m);
+	}
+}
+
+/*____________________________________________________________________
+|
+| Function: Record_Eggs
+|
+| Input: Called from RenderQueue_Record_Parallel()
+| Output: Records the eggs on screen, swelling the one under the
+|   crosshair.
+|___________________________________________________________________*/
+
+static void Record_Eggs(int buffer, void *data)
+{
+	SceneSections *scene = (SceneSections *)data;
+	EggStore *eggs = scene->eggs;
+	gx3dMatrix m, m1;
+
+	for (int i = 0; i < eggs->count; i++) {
+		if (eggs->on_screen[i]) {
+			if (i == scene->hover_egg) {
+				gx3d_GetScaleMatrix(&m1, 1.25f, 1.25f, 1.25f);
+				gx3d_MultiplyMatrix(&m1, &eggs->matrix[i], &m);
+				RenderQueue_Record(buffer, RQ_PASS_OPAQUE, scene->mat_egg, scene->obj_egg, &m);
+			}
+			else
+				RenderQueue_Record(buffer, RQ_PASS_OPAQUE, scene->mat_egg, scene->obj_egg, &eggs->matrix[i]);
+		}
+	}
 }
 
-double Distance(double x1, double y1, double x2, double y2) {
-	return std::sqrt(std::pow((x2 - x1), 2) + std::pow((y2 - y1), 2));
+/*____________________________________________________________________
+|
+| Function: Pass_Clear
+|
+| Input: Called from FrameGraph_Execute()
+| Output: Clears the screen and zbuffer.
+|___________________________________________________________________*/
+
+static void Pass_Clear(void *data)
+{
+	FrameData *frame = (FrameData *)data;
+
+	Render_Clear(frame->clear_color);
+}
+
+/*____________________________________________________________________
+|
+| Function: Pass_Occlusion
+|
+| Input: Called from FrameGraph_Execute()
+| Output: Builds the occlusion buffer for this frame from the fence and
+|   hills.
+|___________________________________________________________________*/
+
+static void Pass_Occlusion(void *data)
+{
+	FrameData *frame = (FrameData *)data;
+	gx3dMatrix m, m1, m2;
+
+	Render_Get_View_Matrix(&m);
+	Occlusion_Begin_Frame(&m);
+	for (int i = 0; i < NUM_FENCE; i++) {
+		gx3d_GetRotateYMatrix(&m1, fence_placement[i][0]);
+		gx3d_GetTranslateMatrix(&m2, fence_placement[i][1], -5, fence_placement[i][2]);
+		gx3d_MultiplyMatrix(&m1, &m2, &m);
+		Occlusion_Add_Occluder(frame->fence_occluder, &m);
+	}
+	for (int i = 0; i < NUM_HILLS; i++) {
+		gx3d_GetRotateYMatrix(&m1, hill_placement[i][0]);
+		gx3d_GetTranslateMatrix(&m2, hill_placement[i][1], 0, hill_placement[i][2]);
+		gx3d_MultiplyMatrix(&m1, &m2, &m);
+		Occlusion_Add_Occluder(frame->hill_occluder, &m);
+	}
+	Occlusion_End_Occluders();
+}
+
+/*____________________________________________________________________
+|
+| Function: Pass_World
+|
+| Input: Called from FrameGraph_Execute()
+| Output: Fills the render queue with the sky, ground and the sections
+|   of the scene (recorded in parallel), and finds the egg under the
+|   crosshair.
+|___________________________________________________________________*/
+
+static void Pass_World(void *data)
+{
+	FrameData *frame = (FrameData *)data;
+	SceneSections *scene = frame->scene;
+	EggStore *eggs = frame->eggs;
+	gx3dMatrix m;
+	float hoverDistance;
+
+	RenderQueue_Begin(frame->position, frame->heading);
+
+	// Draw skydome
+	gx3d_GetTranslateMatrix(&m, 0, 0, 0);
+	RenderQueue_Submit(RQ_PASS_SKY, frame->mat_sky, frame->obj_sky, &m);
+
+	// Draw ground
+	gx3d_GetTranslateMatrix(&m, 0, 0, 0);
+	RenderQueue_Submit(RQ_PASS_OPAQUE, frame->mat_ground, frame->obj_ground, &m);
+
+	// Eggs on screen (only they can be picked)
+	EggAnim_Update(eggs, frame->egg_anim, frame->time);
+	for (int i = 0; i < eggs->count; i++) {
+		eggs->on_screen[i] = (Render_Sphere_Visible(&eggs->sphere[i]) && Occlusion_Sphere_Visible(&eggs->sphere[i]));
+	}
+	Pick_Build(eggs->sphere, eggs->on_screen, eggs->count, EGG_PICK_CELL_SIZE);
+	scene->hover_egg = Pick_Ray(&frame->view_ray, (float)frame->pickup_distance, &hoverDistance);
+
+	// Record fields, grass and trees, props, fence and hills, and eggs on worker threads
+	StaticBatch_Cull();
+	scene->camera = *frame->position;
+	RenderQueue_Record_Parallel(frame->scene_funcs, frame->scene_data, frame->num_scene_funcs);
+}
+
+/*____________________________________________________________________
+|
+| Function: Pass_Scene
+|
+| Input: Called from FrameGraph_Execute()
+| Output: Draws everything in the render queue.
+|___________________________________________________________________*/
+
+static void Pass_Scene(void *data)
+{
+	RenderQueue_Flush();
+}
+
+/*____________________________________________________________________
+|
+| Function: Pass_Particles
+|
+| Input: Called from FrameGraph_Execute()
+| Output: Draws the glitter over the egg just picked up, for a second.
+|___________________________________________________________________*/
+
+static void Pass_Particles(void *data)
+{
+	FrameData *frame = (FrameData *)data;
+	gx3dMatrix m, m1, m2;
+
+	float elapsedParticle_time = (float)frame->time / 1000 - frame->glitter_start;
+
+	gx3d_GetScaleMatrix(&m1, 5.0f, 5.0f, 5.0f);
+	gx3d_GetTranslateMatrix(&m2, frame->glitter_position->x, frame->glitter_position->y, frame->glitter_position->z);
+	gx3d_MultiplyMatrix(&m1, &m2, &m);
+	Render_Draw_Particles(frame->psys_glitter, &m, frame->elapsed_time, frame->heading);
+
+	if (elapsedParticle_time > 1.0f)
+		*frame->glitter = false;
+}
+
+/*____________________________________________________________________
+|
+| Function: Pass_HUD
+|
+| Input: Called from FrameGraph_Execute()
+| Output: Draws the crosshair and an egg for each egg picked up.
+|___________________________________________________________________*/
+
+static void Pass_HUD(void *data)
+{
+	FrameData *frame = (FrameData *)data;
+
+	Render_Set_Ambient_Light(frame->ambient);
+
+	SpriteBatch_Begin();
+	SpriteBatch_Add(frame->sprite_cross, 0, 0, 1);
+	for (int i = 1; i <= frame->eggs->num_removed; i++)
+		SpriteBatch_Add(frame->sprite_egg, (-0.8f * (float)i) + 6.8f, 2.5f, 1);
+	SpriteBatch_Flush();
+}
+
+/*____________________________________________________________________
+|
+| Function: Pass_Overlay
+|
+| Input: Called from FrameGraph_Execute()
+| Output: Clears the screen and draws a picture over all of it.
+|___________________________________________________________________*/
+
+static void Pass_Overlay(void *data)
+{
+	Overlay *overlay = (Overlay *)data;
+	gx3dMatrix m;
+
+	Render_Clear(overlay->frame->clear_color);
+	for (int i = 0; i < 2; i++) {
+		gx3d_GetTranslateMatrix(&m, overlay->place[i].x, overlay->place[i].y, overlay->place[i].z);
+		Render_Set_Object_Matrix(overlay->obj[i], &m);
+		Render_Set_Texture(0, overlay->tex[i]);
+		Render_Draw_Object(overlay->obj[i]);
+	}
 }
 
 /*____________________________________________________________________
@@ -330,10 +898,21 @@ void Program_Run()
 	gxSetClip(&Pgm_screen);
 	gxSetClipping(FALSE);
 
-	// Set the 3D viewport
-	gx3d_SetViewport(&Pgm_screen);
-	// Init other 3D stuff
-	Init_Render_State();
+	// Set the 3D viewport and other 3D stuff
+	RenderGx3d_Init(&Pgm_screen);
+
+	// Draw with gx3d, or render on the CPU instead if asked to (EGGHUNT_RENDERER=software), writing every nth frame to a file if
+	//  EGGHUNT_CAPTURE_EVERY=n
+	const char *renderer = getenv("EGGHUNT_RENDERER");
+	Render_Set_Backend(RenderGx3d_Backend());
+	if (renderer && !strcmp(renderer, "software") && RenderSoft_Init(gxGetScreenWidth(), gxGetScreenHeight())) {
+		const char *capture_every = getenv("EGGHUNT_CAPTURE_EVERY");
+		if (capture_every)
+			RenderSoft_Set_Capture(atoi(capture_every), "frame_");
+		Render_Set_Backend(RenderSoft_Backend());
+	}
+	// Backend F8 switches back to from the null backend
+	RenderBackend *main_backend = Render_Get_Backend();
 
 	/*____________________________________________________________________
 	|
@@ -361,9 +940,10 @@ void Program_Run()
 	float fov = 89; // degrees field of view
 	float near_plane = 0.1f;
 	float far_plane = 80000;
-	gx3d_SetProjectionMatrix(fov, near_plane, far_plane);
+	Render_Set_Projection(fov, near_plane, far_plane, (float)gxGetScreenWidth() / gxGetScreenHeight());
 
-	gx3d_SetFillMode(gx3d_FILL_MODE_GOURAUD_SHADED);
+	// Occlusion buffer uses the same projection
+	Occlusion_Init(fov, near_plane, far_plane, (float)gxGetScreenWidth() / gxGetScreenHeight());
 
 	// Clear the 3D viewport to all black
 	color.r = 0;
@@ -376,169 +956,195 @@ void Program_Run()
 	| Load 3D models
 	|___________________________________________________________________*/
 
-	gx3dParticleSystem psys_glitter = Script_ParticleSystem_Create("glitter.gxps");
+	gx3dParticleSystem psys_glitter = RenderGx3d_Load_Particles("glitter.gxps");
 
 	// Load a 3D model
 
 	gx3dObject *obj_ground;
-	gx3d_ReadLWO2File("Objects\\ground.lwo", &obj_ground, gx3d_VERTEXFORMAT_DEFAULT, gx3d_DONT_LOAD_TEXTURES);
-	gx3dTexture tex_ground = gx3d_InitTexture_File("Objects\\Images\\grass2.bmp", 0, 0);
+	obj_ground = Render_Load_Object("Objects\\ground.lwo");
+	gx3dTexture tex_ground = Render_Load_Texture("Objects\\Images\\grass2.bmp", 0);
 
 	gx3dObject *obj_sky;
-	gx3d_ReadLWO2File("Objects\\skydome.lwo", &obj_sky, gx3d_VERTEXFORMAT_DEFAULT, gx3d_DONT_LOAD_TEXTURES);
-	gx3dTexture tex_sky = gx3d_InitTexture_File("Objects\\Images\\sky.bmp", 0, 0);
+	obj_sky = Render_Load_Object("Objects\\skydome.lwo");
+	gx3dTexture tex_sky = Render_Load_Texture("Objects\\Images\\sky.bmp", 0);
 
 	gx3dObject *obj_title;
-	gx3d_ReadLWO2File("Objects\\billboard_title.lwo", &obj_title, gx3d_VERTEXFORMAT_DEFAULT, gx3d_DONT_LOAD_TEXTURES);
-	gx3dTexture tex_title = gx3d_InitTexture_File("Objects\\Images\\left.bmp", 0, 0);
+	obj_title = Render_Load_Object("Objects\\billboard_title.lwo");
+	gx3dTexture tex_title = Render_Load_Texture("Objects\\Images\\left.bmp", 0);
 
 	gx3dObject *obj_title2;
-	gx3d_ReadLWO2File("Objects\\billboard_title_2.lwo", &obj_title2, gx3d_VERTEXFORMAT_DEFAULT, gx3d_DONT_LOAD_TEXTURES);
-	gx3dTexture tex_title2 = gx3d_InitTexture_File("Objects\\Images\\right.bmp", 0, 0);
+	obj_title2 = Render_Load_Object("Objects\\billboard_title_2.lwo");
+	gx3dTexture tex_title2 = Render_Load_Texture("Objects\\Images\\right.bmp", 0);
 
 	gx3dObject *obj_cross;
-	gx3d_ReadLWO2File("Objects\\billboard_cross.lwo", &obj_cross, gx3d_VERTEXFORMAT_DEFAULT, gx3d_DONT_LOAD_TEXTURES);
-	gx3dTexture tex_cross = gx3d_InitTexture_File("Objects\\Images\\crosshair.bmp", "Objects\\Images\\crosshair_fa.bmp", 0);
+	obj_cross = Render_Load_Object("Objects\\billboard_cross.lwo");
+	gx3dTexture tex_cross = Render_Load_Texture("Objects\\Images\\crosshair.bmp", "Objects\\Images\\crosshair_fa.bmp");
 
 	gx3dObject *obj_egg;
-	gx3d_ReadLWO2File("Objects\\egg.lwo", &obj_egg, gx3d_VERTEXFORMAT_DEFAULT, gx3d_DONT_LOAD_TEXTURES);
-	gx3dTexture tex_egg = gx3d_InitTexture_File("Objects\\Images\\egg.bmp", 0, 0);
+	obj_egg = Render_Load_Object("Objects\\egg.lwo");
+	gx3dTexture tex_egg = Render_Load_Texture("Objects\\Images\\egg.bmp", 0);
 
 	gx3dObject *obj_fence;
-	gx3d_ReadLWO2File("Objects\\fence.lwo", &obj_fence, gx3d_VERTEXFORMAT_DEFAULT, gx3d_DONT_LOAD_TEXTURES);
-	gx3dTexture tex_fence = gx3d_InitTexture_File("Objects\\Images\\wood.bmp", 0, 0);
+	obj_fence = Render_Load_Object("Objects\\fence.lwo");
+	gx3dTexture tex_fence = Render_Load_Texture("Objects\\Images\\wood.bmp", 0);
 
 	gx3dObject *obj_hill;
-	gx3d_ReadLWO2File("Objects\\hill.lwo", &obj_hill, gx3d_VERTEXFORMAT_DEFAULT, gx3d_DONT_LOAD_TEXTURES);
-	gx3dTexture tex_hill = gx3d_InitTexture_File("Objects\\Images\\hill.bmp", 0, 0);
+	obj_hill = Render_Load_Object("Objects\\hill.lwo");
+	gx3dTexture tex_hill = Render_Load_Texture("Objects\\Images\\hill.bmp", 0);
 
 	gx3dObject *obj_hay;
-	gx3d_ReadLWO2File("Objects\\hay.lwo", &obj_hay, gx3d_VERTEXFORMAT_DEFAULT, gx3d_DONT_LOAD_TEXTURES);
-	gx3dTexture tex_hay = gx3d_InitTexture_File("Objects\\Images\\hay.bmp", 0, 0);
+	obj_hay = Render_Load_Object("Objects\\hay.lwo");
+	gx3dTexture tex_hay = Render_Load_Texture("Objects\\Images\\hay.bmp", 0);
 
 	gx3dObject *obj_trashcan;
-	gx3d_ReadLWO2File("Objects\\trashcan.lwo", &obj_trashcan, gx3d_VERTEXFORMAT_DEFAULT, gx3d_DONT_LOAD_TEXTURES);
-	gx3dTexture tex_trashcan = gx3d_InitTexture_File("Objects\\Images\\trash.bmp", 0, 0);
+	obj_trashcan = Render_Load_Object("Objects\\trashcan.lwo");
+	gx3dTexture tex_trashcan = Render_Load_Texture("Objects\\Images\\trash.bmp", 0);
 
 	gx3dObject *obj_2d_egg;
-	gx3d_ReadLWO2File("Objects\\billboard_egg.lwo", &obj_2d_egg, gx3d_VERTEXFORMAT_DEFAULT, gx3d_DONT_LOAD_TEXTURES);
-	gx3dTexture tex_2d_egg = gx3d_InitTexture_File("Objects\\Images\\2d_egg.bmp", "Objects\\Images\\2d_egg_fa.bmp", 0);
+	obj_2d_egg = Render_Load_Object("Objects\\billboard_egg.lwo");
+	gx3dTexture tex_2d_egg = Render_Load_Texture("Objects\\Images\\2d_egg.bmp", "Objects\\Images\\2d_egg_fa.bmp");
 
 	gx3dObject *obj_field;
-	gx3d_ReadLWO2File("Objects\\field.lwo", &obj_field, gx3d_VERTEXFORMAT_DEFAULT, gx3d_DONT_LOAD_TEXTURES);
-	gx3dTexture tex_field = gx3d_InitTexture_File("Objects\\Images\\field.bmp", "Objects\\Images\\field_fa.bmp", 0);
+	obj_field = Render_Load_Object("Objects\\field.lwo");
+	gx3dTexture tex_field = Render_Load_Texture("Objects\\Images\\field.bmp", "Objects\\Images\\field_fa.bmp");
 
 	gx3dObject *obj_poles;
-	gx3d_ReadLWO2File("Objects\\poles.lwo", &obj_poles, gx3d_VERTEXFORMAT_DEFAULT, gx3d_DONT_LOAD_TEXTURES);
-	gx3dTexture tex_poles = gx3d_InitTexture_File("Objects\\Images\\metal.bmp", 0, 0);
+	obj_poles = Render_Load_Object("Objects\\poles.lwo");
+	gx3dTexture tex_poles = Render_Load_Texture("Objects\\Images\\metal.bmp", 0);
 
 	gx3dObject *obj_fountain;
-	gx3d_ReadLWO2File("Objects\\fountain.lwo", &obj_fountain, gx3d_VERTEXFORMAT_DEFAULT, gx3d_DONT_LOAD_TEXTURES);
-	gx3dTexture tex_concrete = gx3d_InitTexture_File("Objects\\Images\\concrete.bmp", 0, 0);
+	obj_fountain = Render_Load_Object("Objects\\fountain.lwo");
+	gx3dTexture tex_concrete = Render_Load_Texture("Objects\\Images\\concrete.bmp", 0);
 
 	gx3dObject *obj_tree;
-	gx3d_ReadLWO2File("Objects\\tree.lwo", &obj_tree, gx3d_VERTEXFORMAT_DEFAULT, gx3d_DONT_LOAD_TEXTURES);
-	gx3dTexture tex_tree = gx3d_InitTexture_File("Objects\\Images\\tree.bmp", "Objects\\Images\\tree_fa.bmp", 0);
+	obj_tree = Render_Load_Object("Objects\\tree.lwo");
+	gx3dTexture tex_tree = Render_Load_Texture("Objects\\Images\\tree.bmp", "Objects\\Images\\tree_fa.bmp");
 
 	gx3dObject *obj_windmill;
-	gx3d_ReadLWO2File("Objects\\windmill.lwo", &obj_windmill, gx3d_VERTEXFORMAT_DEFAULT, gx3d_DONT_LOAD_TEXTURES);
-	gx3dTexture tex_windmill = gx3d_InitTexture_File("Objects\\Images\\windmill_texture.bmp", 0, 0);
+	obj_windmill = Render_Load_Object("Objects\\windmill.lwo");
+	gx3dTexture tex_windmill = Render_Load_Texture("Objects\\Images\\windmill_texture.bmp", 0);
 
-	gx3dTexture tex_sign = gx3d_InitTexture_File("Objects\\Images\\sign_1.bmp", 0, 0);
-	gx3dTexture tex_sign2 = gx3d_InitTexture_File("Objects\\Images\\sign_2.bmp", 0, 0);
+	gx3dTexture tex_sign = Render_Load_Texture("Objects\\Images\\sign_1.bmp", 0);
+	gx3dTexture tex_sign2 = Render_Load_Texture("Objects\\Images\\sign_2.bmp", 0);
 
-	gx3dTexture tex_help = gx3d_InitTexture_File("Objects\\Images\\help_1.bmp", 0, 0);
-	gx3dTexture tex_help2 = gx3d_InitTexture_File("Objects\\Images\\help_2.bmp", 0, 0);
+	gx3dTexture tex_help = Render_Load_Texture("Objects\\Images\\help_1.bmp", 0);
+	gx3dTexture tex_help2 = Render_Load_Texture("Objects\\Images\\help_2.bmp", 0);
 
-	gx3dTexture tex_end = gx3d_InitTexture_File("Objects\\Images\\end_1.bmp", 0, 0);
-	gx3dTexture tex_end2 = gx3d_InitTexture_File("Objects\\Images\\end_2.bmp", 0, 0);
+	gx3dTexture tex_end = Render_Load_Texture("Objects\\Images\\end_1.bmp", 0);
+	gx3dTexture tex_end2 = Render_Load_Texture("Objects\\Images\\end_2.bmp", 0);
 
-	gx3dTexture tex_grass_field = gx3d_InitTexture_File("Objects\\Images\\grass_field.bmp", "Objects\\Images\\grass_field_fa.bmp", 0);
+	gx3dTexture tex_grass_field = Render_Load_Texture("Objects\\Images\\grass_field.bmp", "Objects\\Images\\grass_field_fa.bmp");
 
 	gx3d_GetScaleMatrix(&m, 500, 200, 500);
-	gx3d_TransformObject(obj_sky, &m);
-
-	#define NUM_EGGS 12
-    #define NUM_FIELD 35
-    #define NUM_FIELD2 200
-	#define NUM_TREES 15
-	#define NUM_GRASS 100
-	gx3dVector eggPosition[NUM_EGGS];
-	bool eggDraw[NUM_EGGS];
-	gx3dSphere eggSphere[NUM_EGGS];
-	bool eggOnScreen[NUM_EGGS];
-	static float eggSpeed[NUM_EGGS];
-	int eggsCollected = 0;
-	bool eggParticle[NUM_EGGS];
-	bool helpScreen = false;
-	int gameOver = 0;
+	Render_Transform_Object(obj_sky, &m);
 
+	// Simplified occluders - boxes inside the solid part of the fence and hills
+	gx3dBox fence_occluder, hill_occluder;
+	Get_Occluder_Box(obj_fence, 0.9f, 0.8f, &fence_occluder);
+	Get_Occluder_Box(obj_hill, 0.6f, 0.5f, &hill_occluder);
 
+	// Ground heights from the ground and hill meshes
+	{
+		gx3dMatrix m1, m2, m;
+		gx3d_GetIdentityMatrix(&m);
+		Heightfield_Add_Object("Objects\\ground.lwo", &m);
+		for (int i = 0; i < NUM_HILLS; i++) {
+			gx3d_GetRotateYMatrix(&m1, hill_placement[i][0]);
+			gx3d_GetTranslateMatrix(&m2, hill_placement[i][1], 0, hill_placement[i][2]);
+			gx3d_MultiplyMatrix(&m1, &m2, &m);
+			Heightfield_Add_Object("Objects\\hill.lwo", &m);
+		}
+		Heightfield_Build(50);
+		HeightfieldStats hstats;
+		Heightfield_Get_Stats(&hstats);
+		sprintf(str, "Heightfield: %d x %d samples, %.0f ft apart, %d triangles, %.1f ms",
+			hstats.size_x, hstats.size_z, hstats.cell_size, hstats.triangles, hstats.build_ms);
+		debug_WriteFile(str);
+	}
+	// Camera stays as high above the ground as it starts out
+	float eye_height = position.y - Heightfield_Height(position.x, position.z);
+	Position_Set_Ground(Heightfield_Height, eye_height);
+
+	// Keep the player out of the fence, props and buildings (same placements as they're drawn with)
+	{
+		gx3dMatrix m1, m2, m3, m;
+		for (int i = 0; i < NUM_FENCE; i++) {
+			gx3d_GetRotateYMatrix(&m1, fence_placement[i][0]);
+			gx3d_GetTranslateMatrix(&m2, fence_placement[i][1], -5, fence_placement[i][2]);
+			gx3d_MultiplyMatrix(&m1, &m2, &m);
+			Collision_Add_Object("Objects\\fence.lwo", &m);
+		}
+		for (int i = 0; i < NUM_HAY; i++) {
+			gx3d_GetScaleMatrix(&m1, 5, 5, 5);
+			gx3d_GetRotateYMatrix(&m2, 130);
+			gx3d_MultiplyMatrix(&m1, &m2, &m);
+			gx3d_GetTranslateMatrix(&m3, hay_placement[i][0], -19, hay_placement[i][1]);
+			gx3d_MultiplyMatrix(&m, &m3, &m);
+			Collision_Add_Object("Objects\\hay.lwo", &m);
+		}
+		gx3d_GetScaleMatrix(&m1, 5, 5, 5);
+		gx3d_GetTranslateMatrix(&m2, -1010, -19, -2000);
+		gx3d_MultiplyMatrix(&m1, &m2, &m);
+		Collision_Add_Object("Objects\\trashcan.lwo", &m);
+		gx3d_GetScaleMatrix(&m1, 20, 20, 20);
+		gx3d_GetTranslateMatrix(&m2, 500, -19, 800);
+		gx3d_MultiplyMatrix(&m1, &m2, &m);
+		Collision_Add_Object("Objects\\fountain.lwo", &m);
+		gx3d_GetScaleMatrix(&m1, 23, 23, 23);
+		gx3d_GetRotateYMatrix(&m2, 210);
+		gx3d_MultiplyMatrix(&m1, &m2, &m);
+		gx3d_GetTranslateMatrix(&m3, -5800, -19, 3200);
+		gx3d_MultiplyMatrix(&m, &m3, &m);
+		Collision_Add_Object("Objects\\windmill.lwo", &m);
+		gx3d_GetScaleMatrix(&m1, 15, 15, 15);
+		gx3d_GetTranslateMatrix(&m2, -2000, -110, -2700);
+		gx3d_MultiplyMatrix(&m1, &m2, &m);
+		gx3d_GetRotateYMatrix(&m3, -25);
+		gx3d_MultiplyMatrix(&m, &m3, &m);
+		Collision_Add_Object("Objects\\poles.lwo", &m);
+		Collision_Build();
+		CollisionStats cstats;
+		Collision_Get_Stats(&cstats);
+		sprintf(str, "Collision: %d triangles, %d nodes, %.1f ms", cstats.triangles, cstats.nodes, cstats.build_ms);
+		debug_WriteFile(str);
+	}
+	player_capsule.radius = PLAYER_RADIUS;
+	player_capsule.top = 0;
+	player_capsule.bottom = -eye_height + PLAYER_STEP_HEIGHT + PLAYER_RADIUS;
+	Position_Set_Collision(Collide_Player);
+
+	// Eggs to hunt
+	EggStore eggs;
+	EggStore_Init(&eggs, NUM_EGGS);
+	gx3dVector egg_position[NUM_EGGS];
+	float egg_ground[NUM_EGGS];
+	for (int i = 0; i < NUM_EGGS; i++) {
+		egg_position[i].x = egg_placement[i][0];
+		egg_position[i].y = egg_placement[i][1];
+		egg_position[i].z = egg_placement[i][2];
+	}
+	Heightfield_Heights(egg_position, NUM_EGGS, egg_ground);
 	for (int i = 0; i < NUM_EGGS; i++) {
-		eggDraw[i] = true;
-		eggSpeed[i] = 0.2f;
-		eggParticle[i] = false;
+		gx3dVector v = egg_position[i];
+		// Never below the ground
+		if (v.y < egg_ground[i])
+			v.y = egg_ground[i];
+		int k = EggStore_Index(&eggs, EggStore_Add(&eggs, &v));
+		eggs.phase[k] = (float)i * 0.9f;	// so the eggs don't all bob together
+		eggs.amplitude[k] = 20;
 	}
+	EggAnimParams egg_anim;
+	egg_anim.scale = 2;
+	egg_anim.tilt = -15;
+	egg_anim.spin_rate = 100;
+	egg_anim.bob_rate = 1;
+	egg_anim.sphere_radius = obj_egg->bound_sphere.radius * 2;
+	egg_anim.sphere_height = 15;
+	bool helpScreen = false;
 
-	eggPosition[0].x = 555;
-	eggPosition[0].y = 10;
-	eggPosition[0].z = 1090;
-	eggSpeed[0] = 0.1f;
-
-	eggPosition[1].x = -1010;
-	eggPosition[1].y = -5;
-	eggPosition[1].z = -2000;
-	eggSpeed[1] = 0.1f;
-
-	eggPosition[2].x = -632;
-	eggPosition[2].y = -5;
-	eggPosition[2].z = -3278;
-	eggSpeed[2] = 0.1f;
-
-	eggPosition[3].x = -5650;
-	eggPosition[3].y = -5;
-	eggPosition[3].z = -3450;
-	eggSpeed[3] = 0.1f;
-
-	eggPosition[4].x = 4019;
-	eggPosition[4].y = 20;
-	eggPosition[4].z = 3568;
-	eggSpeed[4] = 0.1f;
-
-	eggPosition[5].x = 4328;
-	eggPosition[5].y = 80;
-	eggPosition[5].z = -1519;
-	eggSpeed[5] = 0.1f;
-
-	eggPosition[6].x = -5889;
-	eggPosition[6].y = -5;
-	eggPosition[6].z = 3263;
-	eggSpeed[6] = 0.1f;
-
-	eggPosition[7].x = -4113;
-	eggPosition[7].y = -5;
-	eggPosition[7].z = 4708;
-	eggSpeed[7] = 0.1f;
-
-	eggPosition[8].x = -1544;
-	eggPosition[8].y = -5;
-	eggPosition[8].z = 4921;
-	eggSpeed[8] = 0.1f;
-
-	eggPosition[9].x = 2972;
-	eggPosition[9].y = 40;
-	eggPosition[9].z = -2794;
-	eggSpeed[9] = 0.1f;
-
-	eggPosition[10].x = -5678;
-	eggPosition[10].y = -5;
-	eggPosition[10].z = -6182;
-	eggSpeed[10] = 0.1f;
-
-	eggPosition[11].x = -3742;
-	eggPosition[11].y = -5;
-	eggPosition[11].z = 4280;
-	eggSpeed[11] = 0.1f;
+	// Glitter shown where the last egg was collected
+	bool glitter = false;
+	gx3dVector glitterPosition;
 
 	/*____________________________________________________________________
 	|
@@ -566,7 +1172,7 @@ void Program_Run()
 	light_data.direction.dst.y = -1;
 	light_data.direction.dst.z = 0;
 
-	dir_light = gx3d_InitLight(&light_data);
+	dir_light = Render_Init_Light(&light_data);
 
 	gx3dLight main_light;
 	light_data.light_type = gx3d_LIGHT_TYPE_DIRECTION;
@@ -586,7 +1192,8 @@ void Program_Run()
 	light_data.direction.dst.y = -1;
 	light_data.direction.dst.z = 0;
 
-	main_light = gx3d_InitLight(&light_data);
+	main_light = Render_Init_Light(&light_data);
+	gx3dLightData main_light_data = light_data; // kept for baking
 
 	gx3dLight point_light1;
 	light_data.light_type = gx3d_LIGHT_TYPE_POINT;
@@ -610,7 +1217,7 @@ void Program_Run()
 	light_data.point.linear_attenuation = 0.1;
 	light_data.point.quadratic_attenuation = 0;
 
-	point_light1 = gx3d_InitLight(&light_data);
+	point_light1 = Render_Init_Light(&light_data);
 
 	gx3dVector light_position = { 10, 20, 0 }, xlight_position;
 	float angle = 0;
@@ -624,6 +1231,13 @@ void Program_Run()
 
 	// Flush input queue
 	evFlushEvents();
+	// Keys that move the player
+	Input_Init();
+	Input_Bind('w', INPUT_ACTION_FORWARD);
+	Input_Bind('s', INPUT_ACTION_BACK);
+	Input_Bind('a', INPUT_ACTION_LEFT);
+	Input_Bind('d', INPUT_ACTION_RIGHT);
+	Input_Bind(evKY_SHIFT, INPUT_ACTION_RUN);
 	// Zero mouse movement counters
 	msGetMouseMovement(&move_x, &move_y); // call this here so the next call will get movement that has occurred since it was called here
 	// Hide mouse cursor
@@ -647,112 +1261,263 @@ void Program_Run()
 	snd_PlaySound(s_crickets, 1);
 
 	// Variables
-	unsigned elapsed_time, last_time, new_time;
+	unsigned new_time, sim_time, last_sim_time;
 	bool force_update;
 	unsigned cmd_move;
+	int pending_x, pending_y; // mouse movement not simulated yet
+	double click_ms; // when the egg click not on screen yet was taken, -1 if none
+	gx3dVector last_position, last_heading; // before the last step
+	gx3dVector draw_position, draw_heading; // between the last two steps
 
 	// Init loop variables
 	cmd_move = 0;
-	last_time = 0;
+	last_sim_time = 0;
 	force_update = false;
+	pending_x = 0;
+	pending_y = 0;
+	click_ms = -1;
+	last_position = draw_position = position;
+	last_heading = draw_heading = heading;
+
+	// Simulate at a fixed rate (EGGHUNT_SIM_HZ=n steps a second) whatever the frame rate
+	const char *sim_hz = getenv("EGGHUNT_SIM_HZ");
+	SimClock_Init(sim_hz ? (float)atof(sim_hz) : 0);
+
+	// Job threads for the game systems (EGGHUNT_JOB_THREADS=n threads including this one, default one per processor)
+	const char *job_threads = getenv("EGGHUNT_JOB_THREADS");
+	Jobs_Init(job_threads ? atoi(job_threads) : 0);
+
+	// Simulate each frame while the one before is drawn (EGGHUNT_PIPELINE=0 to simulate it, then draw it)
+	const char *pipeline = getenv("EGGHUNT_PIPELINE");
+	bool pipelined = Pipeline_Init(sizeof(FrameSnapshot), !(pipeline && atoi(pipeline) == 0));
+	if (!pipelined)
+		debug_WriteFile("Pipeline_Init(): frame snapshot too big, simulating each frame before drawing it");
+	FrameSnapshot own_snapshot; // drawn from if not pipelined
+	SimState sim = { 0, 0, 0, 0, false, &position, &heading, &last_position, &last_heading };
 
 	int lightMode = 0; // 0 = ambient, 1 = directional, 2 = point
 
-	int field_x[NUM_FIELD], field_z[NUM_FIELD], field_y[NUM_FIELD];
-
-	for (int i = 0; i < NUM_FIELD; i++) {
-		field_x[i] = (rand() % 1800 - 2700);
-		field_y[i] = 30;
-		field_z[i] = (rand() % 1600 - 1900);
+	// Render queue materials
+	int mat_sky = RenderQueue_Add_Material(tex_sky, false, color3d_gray, dir_light);
+	int mat_ground = RenderQueue_Add_Material(tex_ground, false, color3d_white, main_light);
+	int mat_hay = RenderQueue_Add_Material(tex_hay, false, color3d_white, main_light);
+	int mat_trashcan = RenderQueue_Add_Material(tex_trashcan, false, color3d_white, main_light);
+	int mat_fountain = RenderQueue_Add_Material(tex_concrete, false, color3d_white, main_light);
+	int mat_windmill = RenderQueue_Add_Material(tex_windmill, false, color3d_white, main_light);
+	int mat_sign = RenderQueue_Add_Material(tex_sign, false, color3d_white, main_light);
+	int mat_sign2 = RenderQueue_Add_Material(tex_sign2, false, color3d_white, main_light);
+	int mat_poles = RenderQueue_Add_Material(tex_poles, false, color3d_white, main_light);
+	int mat_fence = RenderQueue_Add_Material(tex_fence, false, color3d_white, main_light);
+	int mat_hill = RenderQueue_Add_Material(tex_hill, false, color3d_white, main_light);
+	int mat_egg = RenderQueue_Add_Material(tex_egg, false, color3d_white, 0);
+	int mat_field = RenderQueue_Add_Material(tex_field, true, color3d_white, main_light);
+	int mat_grass_field = RenderQueue_Add_Material(tex_grass_field, true, color3d_white, main_light);
+	int mat_tree = RenderQueue_Add_Material(tex_tree, true, color3d_white, main_light);
+
+	// Keep foliage clear of the fence and the props
+	PlacementExclusion foliage_exclusion[NUM_FENCE + NUM_HAY + 4];
+	int num_foliage_exclusions = 0;
+	for (int i = 0; i < NUM_FENCE; i++) {
+		PlacementExclusion *e = &foliage_exclusion[num_foliage_exclusions++];
+		int next = (i + 1) % NUM_FENCE;
+		e->x0 = fence_placement[i][1];
+		e->z0 = fence_placement[i][2];
+		e->x1 = fence_placement[next][1];
+		e->z1 = fence_placement[next][2];
+		e->radius = 60;
 	}
-
-	int field2_x[NUM_FIELD2], field2_z[NUM_FIELD2], field2_y[NUM_FIELD2];
-
-	for (int i = 0; i < NUM_FIELD2; i++) {
-		field2_x[i] = (rand() % 4000 - 7400);
-		field2_y[i] = 30;
-		field2_z[i] = (rand() % 3000 + 6000);
-	}
-
-	int tree_x[NUM_TREES], tree_y[NUM_TREES], tree_z[NUM_TREES];
-
-	for (int i = 0; i < NUM_TREES; i++) {
-		tree_x[i] = (rand() % 2500 + 2000);
-		tree_y[i] = 5;
-		tree_z[i] = (rand() % 4000 - 1800);
+	for (int i = 0; i < NUM_HAY; i++) {
+		PlacementExclusion e = { hay_placement[i][0], hay_placement[i][1], hay_placement[i][0], hay_placement[i][1], obj_hay->bound_sphere.radius * 5 };
+		foliage_exclusion[num_foliage_exclusions++] = e;
 	}
-
-	int tree2_x[NUM_TREES], tree2_y[NUM_TREES], tree2_z[NUM_TREES];
-
-	for (int i = 0; i < NUM_TREES; i++) {
-		tree2_x[i] = (rand() % 2499 + 600);
-		tree2_y[i] = 5;
-		tree2_z[i] = (rand() % 1999 - 3700);
-	}
-
-	int grass_x[NUM_GRASS], grass_y[NUM_GRASS], grass_z[NUM_GRASS];
-
-	for (int i = 0; i < NUM_GRASS; i++) {
-		grass_x[i] = (rand() % 2499 - 4000);
-		grass_y[i] = -19;
-		grass_z[i] = (rand() % 1999 - 3000);
-	}
-
-	int grass2_x[NUM_GRASS], grass2_y[NUM_GRASS], grass2_z[NUM_GRASS];
-
-	for (int i = 0; i < NUM_GRASS; i++) {
-		grass2_x[i] = (rand() % 1500 - 2900);
-		grass2_y[i] = -19;
-		grass2_z[i] = (rand() % 1599 - 4900);
-	}
-
-	int grass3_x[50], grass3_y[50], grass3_z[50];
-
-	for (int i = 0; i < 50; i++) {
-		grass3_x[i] = (rand() % 1800 - 2000);
-		grass3_y[i] = -19;
-		grass3_z[i] = (rand() % 800 - 5000);
-	}
-
-	int grass4_x[NUM_GRASS], grass4_y[NUM_GRASS], grass4_z[NUM_GRASS];
-
-	for (int i = 0; i < NUM_GRASS; i++) {
-		grass4_x[i] = (rand() % 1750 + 75);
-		grass4_y[i] = -19;
-		grass4_z[i] = (rand() % 1999 - 4100);
+	{
+		PlacementExclusion props[] = {
+			{ 500, 800, 500, 800, obj_fountain->bound_sphere.radius * 20 },
+			{ -1010, -2000, -1010, -2000, obj_trashcan->bound_sphere.radius * 5 },
+			{ -5800, 3200, -5800, 3200, obj_windmill->bound_sphere.radius * 23 },
+			{ -2000, -2700, -2000, -2700, obj_poles->bound_sphere.radius * 15 }
+		};
+		for (int i = 0; i < 4; i++)
+			foliage_exclusion[num_foliage_exclusions++] = props[i];
 	}
 
-	int grass5_x[NUM_GRASS], grass5_y[NUM_GRASS], grass5_z[NUM_GRASS];
+	// Foliage layers, each filled with blue noise points no closer than the spacing
+	struct {
+		const char *name;
+		gx3dObject *obj;
+		int material;
+		float scale, rotate_y;
+		PlacementRegion region;
+		float spacing, y;
+		float fade_start, max_distance;
+	} foliage_layer[] = {
+		{ "field",  obj_field, mat_field,       50,  50, { -2700, -1900, -900,  -300 }, 260,  30, 5000, 10000 },
+		{ "grass1", obj_field, mat_grass_field, 10, 140, { -4000, -3000, -1501, -1001 }, 205, -19, 2500,  5000 },
+		{ "grass2", obj_field, mat_grass_field, 10, 140, { -2900, -4900, -1400, -3301 }, 140, -19, 2500,  5000 },
+		{ "grass3", obj_field, mat_grass_field, 10, 140, { -2000, -5000,  -200, -4200 }, 155, -19, 2500,  5000 },
+		{ "grass4", obj_field, mat_grass_field, 10, 140, {    75, -4100,  1825, -2101 }, 170, -19, 2500,  5000 },
+		{ "grass5", obj_field, mat_grass_field, 10, 140, {  2050, -4100,  4549, -2101 }, 205, -19, 2500,  5000 },
+		{ "grass6", obj_field, mat_grass_field, 10, 140, { -2600, -1675,  -900,   324 }, 170, -19, 2500,  5000 },
+		{ "grass7", obj_field, mat_grass_field, 10, 140, {  2900, -2800,  4450,  2700 }, 270, -19, 2500,  5000 },
+		{ "grass8", obj_field, mat_grass_field, 10, 140, {   500,  2175,  2350,  2975 }, 160, -19, 2500,  5000 },
+		{ "field2", obj_field, mat_field,       50, -40, { -7400,  6000, -3400,  9000 }, 225,  30, 5000, 10000 },
+		{ "trees",  obj_tree,  mat_tree,        20,   0, {  2000, -1800,  4500,  2200 }, 750,   5, 8000, 16000 },
+		{ "trees2", obj_tree,  mat_tree,        20,   0, {   600, -3700,  3099, -1701 }, 530,   5, 8000, 16000 }
+	};
 
-	for (int i = 0; i < NUM_GRASS; i++) {
-		grass5_x[i] = (rand() % 2499 + 2050);
-		grass5_y[i] = -19;
-		grass5_z[i] = (rand() % 1999 - 4100);
+	for (int i = 0; i < (int)(sizeof(foliage_layer) / sizeof(foliage_layer[0])); i++) {
+		gx3dVector *point;
+		PlacementStats pstats;
+		int count = Placement_Generate(&foliage_layer[i].region, foliage_layer[i].spacing, WORLD_SEED + i,
+			foliage_exclusion, num_foliage_exclusions, foliage_layer[i].y, &point);
+		Placement_Get_Stats(&pstats);
+		sprintf(str, "Placed %d %s in %.2f ms", count, foliage_layer[i].name, pstats.ms);
+		debug_WriteFile(str);
+
+		int layer = Foliage_Create_Layer(foliage_layer[i].name, foliage_layer[i].obj, foliage_layer[i].material, foliage_layer[i].scale, foliage_layer[i].rotate_y);
+		for (int j = 0; j < count; j++)
+			Foliage_Add_Instance(layer, point[j].x, point[j].y, point[j].z);
+		Foliage_Set_Layer_Distance(layer, foliage_layer[i].fade_start, foliage_layer[i].max_distance);
+		free(point);
 	}
+	int foliageLayer = 0; // layer adjusted by F4/F5/F6
 
-	int grass6_x[NUM_GRASS], grass6_y[NUM_GRASS], grass6_z[NUM_GRASS];
-
-	for (int i = 0; i < NUM_GRASS; i++) {
-		grass6_x[i] = (rand() % 1700 - 2600);
-		grass6_y[i] = -19;
-		grass6_z[i] = (rand() % 1999 - 1675);
+	// Merge the fence segments into a few static meshes
+	int fence_batch;
+	{
+		gx3dMatrix fence_matrix[NUM_FENCE];
+		for (int i = 0; i < NUM_FENCE; i++) {
+			gx3d_GetRotateYMatrix(&m1, fence_placement[i][0]);
+			gx3d_GetTranslateMatrix(&m2, fence_placement[i][1], -5, fence_placement[i][2]);
+			gx3d_MultiplyMatrix(&m1, &m2, &fence_matrix[i]);
+		}
+		fence_batch = StaticBatch_Create("Objects\\fence.lwo", mat_fence, fence_matrix, NUM_FENCE, 6000);
+		if (fence_batch == -1)
+			debug_WriteFile("Fence static batch failed, drawing segments one at a time");
 	}
 
-	int grass7_x[NUM_GRASS], grass7_y[NUM_GRASS], grass7_z[NUM_GRASS];
-
-	for (int i = 0; i < NUM_GRASS; i++) {
-		grass7_x[i] = (rand() % 1550 + 2900);
-		grass7_y[i] = -19;
-		grass7_z[i] = (rand() % 5500 - 2800);
+	// Bake the lighting of the props placed just once into their vertices, if the renderer can draw with it
+	//  (main_light and the white ambient light never change, so only the eggs and player need lighting each frame)
+	if (Render_Vertex_Colors_Supported()) {
+		struct {
+			const char *filename;
+			gx3dObject *obj;
+		} prop[4] = {
+			{ "Objects\\trashcan.lwo", obj_trashcan },
+			{ "Objects\\fountain.lwo", obj_fountain },
+			{ "Objects\\windmill.lwo", obj_windmill },
+			{ "Objects\\poles.lwo", obj_poles }
+		};
+		gx3dMatrix prop_matrix[4], m1, m2, m3, m;
+		// Same placements as Record_Props()
+		gx3d_GetScaleMatrix(&m1, 5, 5, 5);
+		gx3d_GetTranslateMatrix(&m2, -1010, -19, -2000);
+		gx3d_MultiplyMatrix(&m1, &m2, &prop_matrix[0]);
+		gx3d_GetScaleMatrix(&m1, 20, 20, 20);
+		gx3d_GetTranslateMatrix(&m2, 500, -19, 800);
+		gx3d_MultiplyMatrix(&m1, &m2, &prop_matrix[1]);
+		gx3d_GetScaleMatrix(&m1, 23, 23, 23);
+		gx3d_GetRotateYMatrix(&m2, 210);
+		gx3d_MultiplyMatrix(&m1, &m2, &m);
+		gx3d_GetTranslateMatrix(&m3, -5800, -19, 3200);
+		gx3d_MultiplyMatrix(&m, &m3, &prop_matrix[2]);
+		gx3d_GetScaleMatrix(&m1, 15, 15, 15);
+		gx3d_GetTranslateMatrix(&m2, -2000, -110, -2700);
+		gx3d_MultiplyMatrix(&m1, &m2, &m);
+		gx3d_GetRotateYMatrix(&m3, -25);
+		gx3d_MultiplyMatrix(&m, &m3, &prop_matrix[3]);
+		for (int i = 0; i < 4; i++) {
+			gx3dColor *colors;
+			int n = Bake_Object(prop[i].filename, &prop_matrix[i], color3d_white, &main_light_data, 1, Heightfield_Height, &colors);
+			if ((n == -1) || !Render_Set_Vertex_Colors(prop[i].obj, colors, n)) {
+				sprintf(str, "Baking %s failed, lighting it each frame", prop[i].filename);
+				debug_WriteFile(str);
+			}
+			free(colors);
+		}
+		BakeStats bstats;
+		Bake_Get_Stats(&bstats);
+		sprintf(str, "Baked lighting: %d objects, %d corners, %d rays, %.1f ms", bstats.objects, bstats.corners, bstats.rays, bstats.ms);
+		debug_WriteFile(str);
 	}
 
-	int grass8_x[50], grass8_y[50], grass8_z[50];
-
-	for (int i = 0; i < 50; i++) {
-		grass8_x[i] = (rand() % 1850 + 500);
-		grass8_y[i] = -19;
-		grass8_z[i] = (rand() % 800 + 2175);
-	}
+	// Sections of the scene recorded in parallel each frame
+	SceneSections scene;
+	scene.obj_hay = obj_hay;
+	scene.obj_trashcan = obj_trashcan;
+	scene.obj_fountain = obj_fountain;
+	scene.obj_windmill = obj_windmill;
+	scene.obj_title = obj_title;
+	scene.obj_title2 = obj_title2;
+	scene.obj_poles = obj_poles;
+	scene.obj_fence = obj_fence;
+	scene.obj_hill = obj_hill;
+	scene.obj_egg = obj_egg;
+	scene.mat_hay = mat_hay;
+	scene.mat_trashcan = mat_trashcan;
+	scene.mat_fountain = mat_fountain;
+	scene.mat_windmill = mat_windmill;
+	scene.mat_sign = mat_sign;
+	scene.mat_sign2 = mat_sign2;
+	scene.mat_poles = mat_poles;
+	scene.mat_fence = mat_fence;
+	scene.mat_hill = mat_hill;
+	scene.mat_egg = mat_egg;
+	scene.fence_batch = fence_batch;
+	scene.eggs = &eggs;
+	RenderQueueRecordFunc scene_funcs[] = { Record_Foliage, Record_Props, Record_Fence_And_Hills, Record_Eggs };
+	void *scene_data[] = { &scene, &scene, &scene, &scene };
+
+	// What the passes draw with
+	FrameData frame;
+	frame.clear_color = color;
+	frame.ambient = color3d_white;
+	frame.position = &draw_position;
+	frame.heading = &draw_heading;
+	frame.glitter = &glitter;
+	frame.glitter_position = &glitterPosition;
+	frame.psys_glitter = psys_glitter;
+	frame.fence_occluder = &fence_occluder;
+	frame.hill_occluder = &hill_occluder;
+	frame.obj_sky = obj_sky;
+	frame.obj_ground = obj_ground;
+	frame.mat_sky = mat_sky;
+	frame.mat_ground = mat_ground;
+	frame.eggs = &eggs;
+	frame.egg_anim = &egg_anim;
+	frame.pickup_distance = pickupDistance;
+	frame.scene = &scene;
+	frame.scene_funcs = scene_funcs;
+	frame.scene_data = scene_data;
+	frame.num_scene_funcs = sizeof(scene_funcs) / sizeof(scene_funcs[0]);
+	frame.sprite_cross = SpriteBatch_Add_Image(obj_cross, tex_cross);
+	frame.sprite_egg = SpriteBatch_Add_Image(obj_2d_egg, tex_2d_egg);
+
+	Overlay title = { &frame, { obj_title, obj_title2 }, { tex_title, tex_title2 }, { { 15.25, -14.3, -37 }, { -14.7, -14.3, -37 } } };
+	Overlay game_over = { &frame, { obj_title, obj_title2 }, { tex_end, tex_end2 }, { { 15.25, -14.3, -37 }, { -14.7, -14.3, -37 } } };
+	Overlay help = { &frame, { obj_title, obj_title2 }, { tex_help, tex_help2 }, { { 14.25, -15.6, -36 }, { -15.75, -15.6, -36 } } };
+
+	// The passes of a frame, turned on and off each frame by game state (the overlays cover everything drawn before them)
+	unsigned res_color = FrameGraph_Add_Resource("color");
+	unsigned res_depth = FrameGraph_Add_Resource("depth");
+	unsigned res_occlusion = FrameGraph_Add_Resource("occlusion");
+	unsigned res_queue = FrameGraph_Add_Resource("queue");
+	FrameGraph_Add_Pass("clear", Pass_Clear, &frame, 0, res_color | res_depth, FRAMEGRAPH_COVERS, 0);
+	int pass_occlusion = FrameGraph_Add_Pass("occlusion", Pass_Occlusion, &frame, 0, res_occlusion, 0, 0);
+	int pass_world = FrameGraph_Add_Pass("world", Pass_World, &frame, res_occlusion, res_queue, 0, 0);
+	int pass_scene = FrameGraph_Add_Pass("scene", Pass_Scene, &frame, res_queue | res_color | res_depth, res_color | res_depth, 0, 0);
+	int pass_particles = FrameGraph_Add_Pass("particles", Pass_Particles, &frame, res_color | res_depth, res_color, FRAMEGRAPH_ALPHA_BLEND, 0);
+	int pass_hud = FrameGraph_Add_Pass("hud", Pass_HUD, &frame, res_color | res_depth, res_color | res_depth, FRAMEGRAPH_ALPHA_BLEND | FRAMEGRAPH_ALPHA_TEST | FRAMEGRAPH_SCREEN_VIEW, 128);
+	int pass_title = FrameGraph_Add_Pass("title", Pass_Overlay, &title, 0, res_color | res_depth, FRAMEGRAPH_SCREEN_VIEW | FRAMEGRAPH_COVERS, 0);
+	int pass_game_over = FrameGraph_Add_Pass("game over", Pass_Overlay, &game_over, 0, res_color | res_depth, FRAMEGRAPH_SCREEN_VIEW | FRAMEGRAPH_COVERS, 0);
+	int pass_help = FrameGraph_Add_Pass("help", Pass_Overlay, &help, 0, res_color | res_depth, FRAMEGRAPH_SCREEN_VIEW | FRAMEGRAPH_COVERS, 0);
+	FrameGraph_Set_Output(res_color);
+
+	// Overlay pass on screen, the backend it was drawn with, # of times it's been flipped and when last
+	int overlay_shown = -1;
+	RenderBackend *overlay_backend = 0;
+	int overlay_flips = 0;
+	unsigned overlay_time = 0;
 
 	bool fastMovement = false;
 
@@ -766,12 +1531,8 @@ void Program_Run()
 
 		// Get the current time (# milliseconds since the program started)
 		new_time = timeGetTime();
-		// Compute the elapsed time (in milliseconds) since the last time through this loop
-		if (last_time == 0)
-			elapsed_time = 0;
-		else
-			elapsed_time = new_time - last_time;
-		last_time = new_time;
+		// Simulation steps due since the last time through this loop
+		int steps = SimClock_Advance();
 
 		static float currTime = 0.0f;
 
@@ -780,14 +1541,17 @@ void Program_Run()
 		| Process user input
 		|___________________________________________________________________*/
 
-		gxRelation relation;
+		// Clicks pick along the view last drawn, the one the player aimed with
 		gx3dRay viewVector;
-		viewVector.origin = position;
-		viewVector.direction = heading;
+		viewVector.origin = draw_position;
+		viewVector.direction = draw_heading;
 
-		// Any event ready?
-		if (evGetEvent(&event))
+		// Take every event waiting, in the order they happened
+		InputEvent *input;
+		int num_input = Input_Drain(&input);
+		for (int e = 0; e < num_input; e++)
 		{
+			event = input[e].event;
 			// key press?
 			if (event.type == evTYPE_RAW_KEY_PRESS)
 			{
@@ -800,44 +1564,179 @@ void Program_Run()
 					sprintf(str, "\n Player X: %.2f, \n Player Y: %.2f \n Player Z: %.2f \n", position.x, position.y, position.z);
 					debug_WriteFile(str);
 				}
+				if (event.keycode == evKY_F3) {
+					OcclusionStats ostats;
+					Occlusion_Get_Stats(&ostats);
+					sprintf(str, "Occlusion: %d occluders (%d tris) %.3f ms, %d tested %d culled %.3f ms",
+						ostats.occluders, ostats.triangles, ostats.raster_ms, ostats.tested, ostats.culled, ostats.test_ms);
+					debug_WriteFile(str);
+					FoliageStats fstats;
+					Foliage_Get_Stats(&fstats);
+					sprintf(str, "Foliage: %d instances, %d drawn, %d beyond max distance, %d faded, %d occluded",
+						fstats.instances, fstats.drawn, fstats.distance_culled, fstats.faded, fstats.occluded);
+					debug_WriteFile(str);
+					RenderQueueStats rstats;
+					RenderQueue_Get_Stats(&rstats);
+					sprintf(str, "Render queue: %d draws, %d batches, %d texture changes, %d blend changes, %d light changes, sort %.3f ms",
+						rstats.draws, rstats.batches, rstats.texture_changes, rstats.blend_changes, rstats.light_changes, rstats.sort_ms);
+					debug_WriteFile(str);
+					sprintf(str, "Render queue: recorded on %d threads %.3f ms, merge %.3f ms", rstats.record_threads, rstats.record_ms, rstats.merge_ms);
+					debug_WriteFile(str);
+					sprintf(str, "Eggs: %d live, %d collected", eggs.count, eggs.num_removed);
+					debug_WriteFile(str);
+					PickStats pstats;
+					Pick_Get_Stats(&pstats);
+					sprintf(str, "Picking: %d pickables, %d cells, %d entries, %d queries, %d cells visited, %d spheres tested, build %.3f ms",
+						pstats.pickables, pstats.cells, pstats.entries, pstats.queries, pstats.cells_visited, pstats.spheres_tested, pstats.build_ms);
+					debug_WriteFile(str);
+					CollisionStats cstats;
+					Collision_Get_Stats(&cstats);
+					sprintf(str, "Collision: %d triangles, %d nodes, %d moves, %d triangles tested, %.4f ms per move",
+						cstats.triangles, cstats.nodes, cstats.moves, cstats.triangles_tested, cstats.moves ? cstats.move_ms / cstats.moves : 0);
+					debug_WriteFile(str);
+					StaticBatchStats bstats;
+					StaticBatch_Get_Stats(&bstats);
+					sprintf(str, "Static batches: %d chunks, %d drawn, %d culled", bstats.chunks, bstats.drawn, bstats.culled);
+					debug_WriteFile(str);
+					SpriteBatchStats sstats;
+					SpriteBatch_Get_Stats(&sstats);
+					sprintf(str, "HUD sprites: %d in %d draws, %d dropped", sstats.sprites, sstats.draws, sstats.dropped);
+					debug_WriteFile(str);
+					InputStats istats;
+					Input_Get_Stats(&istats);
+					sprintf(str, "Input: %d events in %d drains, at most %d at once, %d full, %d taps, longest wait %.1f ms, "
+						"%d egg clicks on screen in %.1f ms (most %.1f ms)",
+						istats.events, istats.drains, istats.max_events, istats.full_drains, istats.taps, istats.max_wait_ms,
+						istats.responses, istats.response_ms, istats.max_response_ms);
+					debug_WriteFile(str);
+					RingStats qstats;
+					win_EventQueue_Get_Stats(&qstats);
+					sprintf(str, "Event queue: %u added, %u removed, %u dropped when full, at most %u waiting",
+						qstats.added, qstats.removed, qstats.dropped, qstats.max_used);
+					debug_WriteFile(str);
+					CallQueueStats callback_stats;
+					win_CallbackQueue_Get_Stats(&callback_stats);
+					sprintf(str, "Callback queue: %u added, %u removed, %u dropped when full, %u with parameters allocated",
+						callback_stats.added, callback_stats.removed, callback_stats.dropped, callback_stats.heap_params);
+					debug_WriteFile(str);
+					PipelineStats pipeline_stats;
+					Pipeline_Get_Stats(&pipeline_stats);
+					sprintf(str, "Pipeline: %s, %d frames, %.2f ms a frame, simulation %.3f ms, waited %.3f ms for it, latency %.2f ms (most %.2f ms)",
+						pipeline_stats.overlapped ? "simulation overlaps drawing" : "simulate then draw", pipeline_stats.frames, pipeline_stats.frame_ms,
+						pipeline_stats.sim_ms, pipeline_stats.wait_ms, pipeline_stats.latency_ms, pipeline_stats.max_latency_ms);
+					debug_WriteFile(str);
+					JobsStats jstats;
+					Jobs_Get_Stats(&jstats);
+					sprintf(str, "Jobs: %d threads, %u jobs run, %u stolen, %u sleeps, %u run when queue full",
+						jstats.threads, jstats.jobs, jstats.steals, jstats.sleeps, jstats.run_inline);
+					debug_WriteFile(str);
+					SimClockStats clock_stats;
+					SimClock_Get_Stats(&clock_stats);
+					sprintf(str, "Simulation: %.0f Hz, %d steps in %d frames, %d frames capped, %.0f ms dropped",
+						clock_stats.hz, clock_stats.steps, clock_stats.frames, clock_stats.capped_frames, clock_stats.dropped_ms);
+					debug_WriteFile(str);
+					RenderStats dstats;
+					Render_Get_Stats(&dstats);
+					sprintf(str, "Render: %d draw calls, %d instances in %d instanced draws (%s)",
+						dstats.draw_calls, dstats.instances, dstats.instanced_batches, Render_Instancing_Supported() ? "hardware" : "fallback");
+					debug_WriteFile(str);
+					sprintf(str, "Render: %d state changes asked for, %d sent", dstats.state_requests, dstats.state_changes);
+					debug_WriteFile(str);
+					FrameGraph_Write_Stats();
+					if (Render_Get_Backend() == RenderSoft_Backend())
+						RenderSoft_Write_Stats();
+				}
+				// Select a foliage layer and shrink/grow its draw distance
+				if (event.keycode == evKY_F4 || event.keycode == evKY_F5 || event.keycode == evKY_F6) {
+					float fade_start, max_distance;
+					if (event.keycode == evKY_F4)
+						foliageLayer = (foliageLayer + 1) % Foliage_Num_Layers();
+					Foliage_Get_Layer_Distance(foliageLayer, &fade_start, &max_distance);
+					if (event.keycode == evKY_F5)
+						Foliage_Set_Layer_Distance(foliageLayer, fade_start * 0.8f, max_distance * 0.8f);
+					else if (event.keycode == evKY_F6)
+						Foliage_Set_Layer_Distance(foliageLayer, fade_start * 1.25f, max_distance * 1.25f);
+					Foliage_Get_Layer_Distance(foliageLayer, &fade_start, &max_distance);
+					sprintf(str, "Foliage layer %s: fade start %.0f, max distance %.0f", Foliage_Layer_Name(foliageLayer), fade_start, max_distance);
+					debug_WriteFile(str);
+				}
+				// Switch between drawing and the null renderer, which only counts what would be drawn
+				if (event.keycode == evKY_F8) {
+					if (Render_Get_Backend() == RenderNull_Backend()) {
+						Render_Set_Backend(main_backend);
+						RenderNull_Write_Stats();
+					}
+					else {
+						RenderNull_Reset();
+						Render_Set_Backend(RenderNull_Backend());
+					}
+				}
+				// Run benchmarks
+				if (event.keycode == evKY_F7) {
+					Placement_Benchmark();
+					RenderQueue_Benchmark();
+					EggStore_Benchmark();
+					EggAnim_Benchmark();
+					Pick_Benchmark();
+					Heightfield_Benchmark();
+					ring_Benchmark();
+					callqueue_Benchmark();
+					Jobs_Benchmark(Write_Debug_Line);
+					Pipeline_Benchmark(Write_Debug_Line);
+					// Render the last frame again at each screen resolution
+					if (Render_Get_Backend() == RenderSoft_Backend()) {
+						int widths[] = { 640, 800, 1024, 1152, 1280, 1400, 1440, 1600, 1152, 1280, 1440, 1680, 1920, 2048, 1280, 1600, 1920, 2560 };
+						int heights[] = { 480, 600, 768, 864, 960, 1050, 1080, 1200, 720, 800, 900, 1050, 1200, 1280, 720, 900, 1080, 1440 };
+						RenderSoft_Benchmark(widths, heights, sizeof(widths) / sizeof(int), 10, "bench_");
+					}
+					// Walk into every fence segment head on from both sides and at an angle
+					{
+						CollisionWalk walks[NUM_FENCE * 3];
+						int n = 0;
+						for (int i = 0; i < NUM_FENCE; i++) {
+							// Fence runs along its x axis, across it is its z axis
+							float a = fence_placement[i][0] * 3.14159265f / 180;
+							float across_x = sinf(a), across_z = cosf(a);
+							float along_x = cosf(a), along_z = -sinf(a);
+							float x = fence_placement[i][1], z = fence_placement[i][2];
+							walks[n].start.x = x - across_x * 300;
+							walks[n].start.z = z - across_z * 300;
+							walks[n].end.x = x + across_x * 300;
+							walks[n].end.z = z + across_z * 300;
+							n++;
+							walks[n].start = walks[n - 1].end;
+							walks[n].end = walks[n - 1].start;
+							n++;
+							// Short enough that sliding along the fence never reaches its end
+							walks[n].start.x = x - (across_x + along_x) * 106;
+							walks[n].start.z = z - (across_z + along_z) * 106;
+							walks[n].end.x = x + (across_x + along_x) * 106;
+							walks[n].end.z = z + (across_z + along_z) * 106;
+							n++;
+						}
+						for (int i = 0; i < n; i++)
+							walks[i].start.y = walks[i].end.y = 0;
+						Collision_Test(&player_capsule, walks, n, 10, Heightfield_Height, eye_height);
+					}
+					// The benchmark leaves the index empty until the next frame
+				}
+				// Save the software renderer's last frame
+				if (event.keycode == evKY_F9 && Render_Get_Backend() == RenderSoft_Backend())
+					RenderSoft_Write_Image("frame.bmp");
 				if (event.keycode == evKY_F1) {
 					helpScreen = !helpScreen;
 
 				}
 				else
 				{
-					if (event.keycode == 'w')
-						cmd_move |= POSITION_MOVE_FORWARD;
-					else if (event.keycode == 's')
-						cmd_move |= POSITION_MOVE_BACK;
-					else if (event.keycode == 'a')
-						cmd_move |= POSITION_MOVE_LEFT;
-					else if (event.keycode == 'd')
-						cmd_move |= POSITION_MOVE_RIGHT;
-					else if (event.keycode == evKY_F1)
+					if (event.keycode == evKY_F1)
 					{
 						lightMode++;
 						if (lightMode == 3)
 							lightMode = 0;
 					}
-					else if (event.keycode == evKY_SHIFT)
-						fastMovement = true;
 				}
 			}
-			// key release?
-			else if (event.type == evTYPE_RAW_KEY_RELEASE)
-			{
-				if (event.keycode == 'w')
-					cmd_move &= ~(POSITION_MOVE_FORWARD);
-				else if (event.keycode == 's')
-					cmd_move &= ~(POSITION_MOVE_BACK);
-				else if (event.keycode == 'a')
-					cmd_move &= ~(POSITION_MOVE_LEFT);
-				else if (event.keycode == 'd')
-					cmd_move &= ~(POSITION_MOVE_RIGHT);
-				else if (event.keycode == evKY_SHIFT)
-					fastMovement = false;
-			}
 
 			if (gameState == 1) {
 
@@ -853,49 +1752,60 @@ void Program_Run()
 
 					
 					
-					for (int i = 0; i < NUM_EGGS /* && !egg_hit */; i++)
+					// Nearest egg on screen under the crosshair
+					float pickDistance;
+					int i = Pick_Ray(&viewVector, (float)pickupDistance, &pickDistance);
+					if (i != PICK_NONE)
 					{
-						if (eggDraw[i]) {
-							if (eggOnScreen[i])
-							{
-								if (Distance(position.x, position.z, eggPosition[i].x, eggPosition[i].z) > pickupDistance) continue;
-
-								gxRelation rel = gx3d_Relation_Ray_Sphere(&viewVector, &eggSphere[i]);
-								if (rel == gxRELATION_INTERSECT)
-								{
-									eggDraw[i] = false;
-									eggParticle[i] = true;
-									currTime = timeGetTime() / 1000;
-									gameOver++;
-
-									snd_SetSoundVolume(s_twinkle, 140);
-
-									if (snd_IsPlaying(s_twinkle))
-										snd_PlaySound(s_twinkle, 0);
-									snd_PlaySound(s_twinkle, 0);
-								}
-							}
-						}
+						glitter = true;
+						glitterPosition = eggs.sphere[i].center;
+						glitterPosition.y += 10;
+						// Start it at the time last drawn, which is what the particles are timed by
+						currTime = (float)last_sim_time / 1000;
+						EggStore_Remove(&eggs, eggs.handle[i]);
+						// Time from the first click to the frame without its egg
+						if (click_ms < 0)
+							click_ms = input[e].ms;
+						// Indices in the pick index are stale now
+						Pick_Build(eggs.sphere, eggs.on_screen, eggs.count, EGG_PICK_CELL_SIZE);
+
+						snd_SetSoundVolume(s_twinkle, 140);
+
+						if (snd_IsPlaying(s_twinkle))
+							snd_PlaySound(s_twinkle, 0);
+						snd_PlaySound(s_twinkle, 0);
 					}
 				}
 
-				if (gameOver == NUM_EGGS) {
+				if (eggs.count == 0) {
 					gameState = 3;
 			}
 
 			}
-			if (cmd_move != 0 && gameState == 1 && !helpScreen)
-			{
-				walking = true;
-				if (!snd_IsPlaying(s_footsteps))
-					snd_PlaySound(s_footsteps, 1);
-				snd_SetSoundVolume(s_footsteps, 75);
-			}
-			else
-			{
-				walking = false;
-				snd_StopSound(s_footsteps);
-			}
+		}
+		// Movement keys held (pressed and released between frames counts once)
+		unsigned actions = Input_Actions();
+		cmd_move = 0;
+		if (actions & INPUT_ACTION_FORWARD)
+			cmd_move |= POSITION_MOVE_FORWARD;
+		if (actions & INPUT_ACTION_BACK)
+			cmd_move |= POSITION_MOVE_BACK;
+		if (actions & INPUT_ACTION_LEFT)
+			cmd_move |= POSITION_MOVE_LEFT;
+		if (actions & INPUT_ACTION_RIGHT)
+			cmd_move |= POSITION_MOVE_RIGHT;
+		fastMovement = (actions & INPUT_ACTION_RUN) != 0;
+		if (cmd_move != 0 && gameState == 1 && !helpScreen)
+		{
+			walking = true;
+			if (!snd_IsPlaying(s_footsteps))
+				snd_PlaySound(s_footsteps, 1);
+			snd_SetSoundVolume(s_footsteps, 75);
+		}
+		else
+		{
+			walking = false;
+			snd_StopSound(s_footsteps);
 		}
 		// Check for camera movement (via mouse)
 		msGetMouseMovement(&move_x, &move_y);
@@ -917,1402 +1827,113 @@ void Program_Run()
 			cmd_move = 0;
 		}
 
-		bool position_changed, camera_changed;
-		Position_Update(elapsed_time, cmd_move, move_y, move_x, force_update,
-			&position_changed, &camera_changed, &position, &heading);
-		snd_SetListenerPosition(position.x, position.y, position.z, snd_3D_APPLY_NOW);
-		snd_SetListenerOrientation(heading.x, heading.y, heading.z, 0, 1, 0, snd_3D_APPLY_NOW);
+		// Mouse movement, turned in the next step
+		pending_x += move_x;
+		pending_y += move_y;
 
 		/*____________________________________________________________________
 		|
 		| Draw 3D graphics
 		|___________________________________________________________________*/
 
+		if (gameState != 3 && helpScreen == true) {
+			move_y = 0;
+			move_x = 0;
+			cmd_move = 0;
+		}
+
+		// The overlay covering the screen, if any
+		int overlay = -1;
+		if (gameState == 3)
+			overlay = pass_game_over;
+		else if (helpScreen)
+			overlay = pass_help;
+		else if (gameState == 0)
+			overlay = pass_title;
+		if ((overlay != overlay_shown) || (Render_Get_Backend() != overlay_backend)) {
+			overlay_shown = overlay;
+			overlay_backend = Render_Get_Backend();
+			overlay_flips = 0;
+		}
+		// Already on every video page?  Nothing to draw, so wait for input (or a little while, for input polled by the toolkit)
+		if ((overlay != -1) && (overlay_flips >= MAX_VRAM_PAGES) && (new_time - overlay_time < OVERLAY_REFRESH_MS)) {
+			win_EventQueue_Wait(OVERLAY_SLEEP_MS);
+			continue;
+		}
+
+		// Start simulating the next frame (on a job thread while this one is drawn), get the one to draw now
+		sim.steps = steps;
+		sim.cmd_move = cmd_move;
+		sim.turn_x = pending_x;
+		sim.turn_y = pending_y;
+		sim.force_update = force_update;
+		if (steps) {
+			pending_x = 0;
+			pending_y = 0;
+		}
+		FrameSnapshot *snapshot = &own_snapshot;
+		if (pipelined)
+			snapshot = (FrameSnapshot *)Pipeline_Begin_Frame(Simulate, &sim);
+		else
+			Simulate(&sim, snapshot);
+		draw_position = snapshot->position;
+		draw_heading = snapshot->heading;
+		{
+			gx3dVector to, world_up = { 0, 1, 0 };
+			gx3d_AddVector(&draw_position, &draw_heading, &to);
+			Render_Set_Camera(&draw_position, &to, &world_up);
+		}
+
 		// Render the screen
-		gx3d_ClearViewport(gx3d_CLEAR_SURFACE | gx3d_CLEAR_ZBUFFER, color, gx3d_MAX_ZBUFFER_VALUE, 0);
+		Render_Begin_Frame();
 		// Start rendering in 3D
-		if (gx3d_BeginRender())
+		if (Render_Begin())
 		{
 			// Set the default material
-			gx3d_SetMaterial(&material_default);
-
-			bool cross = true;
-			gx3dMatrix view_save;
-			gx3dVector tfrom, tto, twup;
-
-			gx3d_SetAmbientLight(color3d_white);
-			gx3d_DisableLight(dir_light);
-
-
-			if (gameState != 3 && helpScreen == true) {
-				// Draw Help Screen
-				if (helpScreen) {
-
-					cross = false;
-
-					move_y = 0;
-					move_x = 0;
-					cmd_move = 0;
-
-					// Save current view matrix
-					view_save;
-					gx3d_GetViewMatrix(&view_save);
-
-					// Set new view matrix
-					tfrom = { 0, 0, 1 }, tto = { 0, 0, 0 }, twup = { 0, 1, 0 };
-					gx3d_CameraSetPosition(&tfrom, &tto, &twup, gx3d_CAMERA_ORIENTATION_LOOKTO_FIXED);
-					gx3d_CameraSetViewMatrix();
-
-					gx3d_GetTranslateMatrix(&m, 14.25, -15.6, -36);
-					gx3d_SetObjectMatrix(obj_title, &m);
-					gx3d_SetTexture(0, tex_help);
-					gx3d_DrawObject(obj_title, 0);
-
-					gx3d_GetTranslateMatrix(&m, -15.75, -15.6, -36);
-					gx3d_SetObjectMatrix(obj_title2, &m);
-					gx3d_SetTexture(0, tex_help2);
-					gx3d_DrawObject(obj_title2, 0);
-
-					// Restore View Matrix
-					gx3d_SetViewMatrix(&view_save);
-
-					// Stop rendering
-					gx3d_EndRender();
-				}
-			}
-
-			if (gameState == 0)
-			{
-
-				// Draw Title Screen
-				{
-					cross = false;
-
-					// Save current view matrix
-					view_save;
-					gx3d_GetViewMatrix(&view_save);
-
-					// Set new view matrix
-					tfrom = { 0, 0, 1 }, tto = { 0, 0, 0 }, twup = { 0, 1, 0 };
-					gx3d_CameraSetPosition(&tfrom, &tto, &twup, gx3d_CAMERA_ORIENTATION_LOOKTO_FIXED);
-					gx3d_CameraSetViewMatrix();
-
-					// Draw Title Screen
-					gx3d_GetTranslateMatrix(&m, 15.25, -14.3, -37);
-					gx3d_SetObjectMatrix(obj_title, &m);
-					gx3d_SetTexture(0, tex_title);
-					gx3d_DrawObject(obj_title, 0);
-
-					gx3d_GetTranslateMatrix(&m, -14.7, -14.3, -37);
-					gx3d_SetObjectMatrix(obj_title2, &m);
-					gx3d_SetTexture(0, tex_title2);
-					gx3d_DrawObject(obj_title2, 0);
-
-					// Restore View Matrix
-					gx3d_SetViewMatrix(&view_save);
-
-					// Stop rendering
-					gx3d_EndRender();
-				}
-			}
-
-			if (gameState == 1)
-			{
-
-				// Draw skydome
-				{
-					gx3d_SetAmbientLight(color3d_gray);
-					gx3d_EnableLight(dir_light);
-					gx3d_GetTranslateMatrix(&m, 0, 0, 0);
-					gx3d_SetObjectMatrix(obj_sky, &m);
-					gx3d_SetTexture(0, tex_sky);
-					gx3d_DrawObject(obj_sky, 0);
-				}
-
-				gx3d_DisableLight(dir_light);
-				gx3d_SetAmbientLight(color3d_white);
-				gx3d_EnableLight(main_light);
-
-				// Draw ground
-				{
-					gx3d_GetTranslateMatrix(&m, 0, 0, 0);
-					gx3d_SetObjectMatrix(obj_ground, &m);
-					gx3d_SetTexture(0, tex_ground);
-					gx3d_DrawObject(obj_ground, 0);
-				}
-
-				// Draw field
-				{
-					for (int i = 0; i < NUM_FIELD; i++) {
-						gx3d_EnableAlphaBlending();
-						gx3d_EnableAlphaTesting(128);
-
-						gx3d_GetScaleMatrix(&m1, 50, 50, 50);
-						gx3d_GetRotateYMatrix(&m2, 50);
-						gx3d_MultiplyMatrix(&m1, &m2, &m);
-						gx3d_GetTranslateMatrix(&m3, field_x[i], field_y[i], field_z[i]);
-						gx3d_MultiplyMatrix(&m, &m3, &m);
-						gx3d_SetObjectMatrix(obj_field, &m);
-						gx3d_SetTexture(0, tex_field);
-						gx3d_DrawObject(obj_field, 0);
-
-
-						gx3d_DisableAlphaBlending();
-						gx3d_DisableAlphaTesting();
-					}
-				}
-
-				// Draw grass field
-				{
-					for (int i = 0; i < NUM_GRASS; i++) {
-						gx3d_EnableAlphaBlending();
-						gx3d_EnableAlphaTesting(128);
-
-						gx3d_GetScaleMatrix(&m1, 10, 10, 10);
-						gx3d_GetRotateYMatrix(&m2, 140);
-						gx3d_MultiplyMatrix(&m1, &m2, &m);
-						gx3d_GetTranslateMatrix(&m3, grass_x[i], grass_y[i], grass_z[i]);
-						gx3d_MultiplyMatrix(&m, &m3, &m);
-						gx3d_SetObjectMatrix(obj_field, &m);
-						gx3d_SetTexture(0, tex_grass_field);
-						gx3d_DrawObject(obj_field, 0);
-
-
-						gx3d_DisableAlphaBlending();
-						gx3d_DisableAlphaTesting();
-					}
-
-					for (int i = 0; i < NUM_GRASS; i++) {
-						gx3d_EnableAlphaBlending();
-						gx3d_EnableAlphaTesting(128);
-
-						gx3d_GetScaleMatrix(&m1, 10, 10, 10);
-						gx3d_GetRotateYMatrix(&m2, 140);
-						gx3d_MultiplyMatrix(&m1, &m2, &m);
-						gx3d_GetTranslateMatrix(&m3, grass2_x[i], grass2_y[i], grass2_z[i]);
-						gx3d_MultiplyMatrix(&m, &m3, &m);
-						gx3d_SetObjectMatrix(obj_field, &m);
-						gx3d_SetTexture(0, tex_grass_field);
-						gx3d_DrawObject(obj_field, 0);
-
-
-						gx3d_DisableAlphaBlending();
-						gx3d_DisableAlphaTesting();
-					}
-
-					for (int i = 0; i < 50; i++) {
-						gx3d_EnableAlphaBlending();
-						gx3d_EnableAlphaTesting(128);
-
-						gx3d_GetScaleMatrix(&m1, 10, 10, 10);
-						gx3d_GetRotateYMatrix(&m2, 140);
-						gx3d_MultiplyMatrix(&m1, &m2, &m);
-						gx3d_GetTranslateMatrix(&m3, grass3_x[i], grass3_y[i], grass3_z[i]);
-						gx3d_MultiplyMatrix(&m, &m3, &m);
-						gx3d_SetObjectMatrix(obj_field, &m);
-						gx3d_SetTexture(0, tex_grass_field);
-						gx3d_DrawObject(obj_field, 0);
-
-
-						gx3d_DisableAlphaBlending();
-						gx3d_DisableAlphaTesting();
-					}
-
-					for (int i = 0; i < NUM_GRASS; i++) {
-						gx3d_EnableAlphaBlending();
-						gx3d_EnableAlphaTesting(128);
-
-						gx3d_GetScaleMatrix(&m1, 10, 10, 10);
-						gx3d_GetRotateYMatrix(&m2, 140);
-						gx3d_MultiplyMatrix(&m1, &m2, &m);
-						gx3d_GetTranslateMatrix(&m3, grass4_x[i], grass4_y[i], grass4_z[i]);
-						gx3d_MultiplyMatrix(&m, &m3, &m);
-						gx3d_SetObjectMatrix(obj_field, &m);
-						gx3d_SetTexture(0, tex_grass_field);
-						gx3d_DrawObject(obj_field, 0);
-
-
-						gx3d_DisableAlphaBlending();
-						gx3d_DisableAlphaTesting();
-					}
-
-					for (int i = 0; i < NUM_GRASS; i++) {
-						gx3d_EnableAlphaBlending();
-						gx3d_EnableAlphaTesting(128);
-
-						gx3d_GetScaleMatrix(&m1, 10, 10, 10);
-						gx3d_GetRotateYMatrix(&m2, 140);
-						gx3d_MultiplyMatrix(&m1, &m2, &m);
-						gx3d_GetTranslateMatrix(&m3, grass5_x[i], grass5_y[i], grass5_z[i]);
-						gx3d_MultiplyMatrix(&m, &m3, &m);
-						gx3d_SetObjectMatrix(obj_field, &m);
-						gx3d_SetTexture(0, tex_grass_field);
-						gx3d_DrawObject(obj_field, 0);
-
-
-						gx3d_DisableAlphaBlending();
-						gx3d_DisableAlphaTesting();
-					}
-
-					for (int i = 0; i < NUM_GRASS; i++) {
-						gx3d_EnableAlphaBlending();
-						gx3d_EnableAlphaTesting(128);
-
-						gx3d_GetScaleMatrix(&m1, 10, 10, 10);
-						gx3d_GetRotateYMatrix(&m2, 140);
-						gx3d_MultiplyMatrix(&m1, &m2, &m);
-						gx3d_GetTranslateMatrix(&m3, grass6_x[i], grass6_y[i], grass6_z[i]);
-						gx3d_MultiplyMatrix(&m, &m3, &m);
-						gx3d_SetObjectMatrix(obj_field, &m);
-						gx3d_SetTexture(0, tex_grass_field);
-						gx3d_DrawObject(obj_field, 0);
-
-
-						gx3d_DisableAlphaBlending();
-						gx3d_DisableAlphaTesting();
-					}
-
-					for (int i = 0; i < NUM_GRASS; i++) {
-						gx3d_EnableAlphaBlending();
-						gx3d_EnableAlphaTesting(128);
-
-						gx3d_GetScaleMatrix(&m1, 10, 10, 10);
-						gx3d_GetRotateYMatrix(&m2, 140);
-						gx3d_MultiplyMatrix(&m1, &m2, &m);
-						gx3d_GetTranslateMatrix(&m3, grass7_x[i], grass7_y[i], grass7_z[i]);
-						gx3d_MultiplyMatrix(&m, &m3, &m);
-						gx3d_SetObjectMatrix(obj_field, &m);
-						gx3d_SetTexture(0, tex_grass_field);
-						gx3d_DrawObject(obj_field, 0);
-
-
-						gx3d_DisableAlphaBlending();
-						gx3d_DisableAlphaTesting();
-					}
-
-					for (int i = 0; i < 50; i++) {
-						gx3d_EnableAlphaBlending();
-						gx3d_EnableAlphaTesting(128);
-
-						gx3d_GetScaleMatrix(&m1, 10, 10, 10);
-						gx3d_GetRotateYMatrix(&m2, 140);
-						gx3d_MultiplyMatrix(&m1, &m2, &m);
-						gx3d_GetTranslateMatrix(&m3, grass8_x[i], grass8_y[i], grass8_z[i]);
-						gx3d_MultiplyMatrix(&m, &m3, &m);
-						gx3d_SetObjectMatrix(obj_field, &m);
-						gx3d_SetTexture(0, tex_grass_field);
-						gx3d_DrawObject(obj_field, 0);
-
-
-						gx3d_DisableAlphaBlending();
-						gx3d_DisableAlphaTesting();
-					}
-				}
-
-				// Draw windmill field
-				{
-					for (int i = 0; i < NUM_FIELD2; i++) {
-						gx3d_EnableAlphaBlending();
-						gx3d_EnableAlphaTesting(128);
-
-						gx3d_GetScaleMatrix(&m1, 50, 50, 50);
-						gx3d_GetRotateYMatrix(&m2, -40);
-						gx3d_MultiplyMatrix(&m1, &m2, &m);
-						gx3d_GetTranslateMatrix(&m3, field2_x[i], field2_y[i], field2_z[i]);
-						gx3d_MultiplyMatrix(&m, &m3, &m);
-						gx3d_SetObjectMatrix(obj_field, &m);
-						gx3d_SetTexture(0, tex_field);
-						gx3d_DrawObject(obj_field, 0);
-
-
-						gx3d_DisableAlphaBlending();
-						gx3d_DisableAlphaTesting();
-					}
-				}
-
-				// Draw trees
-				{
-					for (int i = 0; i < NUM_TREES; i++) {
-						gx3d_EnableAlphaBlending();
-						gx3d_EnableAlphaTesting(128);
-
-						gx3d_GetScaleMatrix(&m1, 20, 20, 20);
-						gx3d_GetTranslateMatrix(&m2, tree_x[i], tree_y[i], tree_z[i]);
-						gx3d_MultiplyMatrix(&m1, &m2, &m);
-						gx3d_SetObjectMatrix(obj_tree, &m);
-						gx3d_SetTexture(0, tex_tree);
-						gx3d_DrawObject(obj_tree, 0);
-
-						gx3d_DisableAlphaBlending();
-						gx3d_DisableAlphaTesting();
-					}
-
-					for (int i = 0; i < NUM_TREES; i++) {
-						gx3d_EnableAlphaBlending();
-						gx3d_EnableAlphaTesting(128);
-
-						gx3d_GetScaleMatrix(&m1, 20, 20, 20);
-						gx3d_GetTranslateMatrix(&m2, tree2_x[i], tree2_y[i], tree2_z[i]);
-						gx3d_MultiplyMatrix(&m1, &m2, &m);
-						gx3d_SetObjectMatrix(obj_tree, &m);
-						gx3d_SetTexture(0, tex_tree);
-						gx3d_DrawObject(obj_tree, 0);
-
-						gx3d_DisableAlphaBlending();
-						gx3d_DisableAlphaTesting();
-					}
-				}
-
-				// Draw haybales
-				{
-					gx3d_GetScaleMatrix(&m1, 5, 5, 5);
-					gx3d_GetRotateYMatrix(&m2, 130);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_GetTranslateMatrix(&m3, -153, -19, 5084);
-					gx3d_MultiplyMatrix(&m, &m3, &m);
-					gx3d_SetObjectMatrix(obj_hay, &m);
-					gx3d_SetTexture(0, tex_hay);
-					gx3d_DrawObject(obj_hay, 0);
-
-					gx3d_GetScaleMatrix(&m1, 5, 5, 5);
-					gx3d_GetRotateYMatrix(&m2, 130);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_GetTranslateMatrix(&m3, 288, -19, 5342);
-					gx3d_MultiplyMatrix(&m, &m3, &m);
-					gx3d_SetObjectMatrix(obj_hay, &m);
-					gx3d_SetTexture(0, tex_hay);
-					gx3d_DrawObject(obj_hay, 0);
-
-					gx3d_GetScaleMatrix(&m1, 5, 5, 5);
-					gx3d_GetRotateYMatrix(&m2, 130);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_GetTranslateMatrix(&m3, 850, -19, 5495);
-					gx3d_MultiplyMatrix(&m, &m3, &m);
-					gx3d_SetObjectMatrix(obj_hay, &m);
-					gx3d_SetTexture(0, tex_hay);
-					gx3d_DrawObject(obj_hay, 0);
-
-					gx3d_GetScaleMatrix(&m1, 5, 5, 5);
-					gx3d_GetRotateYMatrix(&m2, 130);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_GetTranslateMatrix(&m3, 1675, -19, 5660);
-					gx3d_MultiplyMatrix(&m, &m3, &m);
-					gx3d_SetObjectMatrix(obj_hay, &m);
-					gx3d_SetTexture(0, tex_hay);
-					gx3d_DrawObject(obj_hay, 0);
-
-					gx3d_GetScaleMatrix(&m1, 5, 5, 5);
-					gx3d_GetRotateYMatrix(&m2, 130);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_GetTranslateMatrix(&m3, 2305, -19, 5464);
-					gx3d_MultiplyMatrix(&m, &m3, &m);
-					gx3d_SetObjectMatrix(obj_hay, &m);
-					gx3d_SetTexture(0, tex_hay);
-					gx3d_DrawObject(obj_hay, 0);
-
-					gx3d_GetScaleMatrix(&m1, 5, 5, 5);
-					gx3d_GetRotateYMatrix(&m2, 130);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_GetTranslateMatrix(&m3, 2525, -19, 4842);
-					gx3d_MultiplyMatrix(&m, &m3, &m);
-					gx3d_SetObjectMatrix(obj_hay, &m);
-					gx3d_SetTexture(0, tex_hay);
-					gx3d_DrawObject(obj_hay, 0);
-
-					gx3d_GetScaleMatrix(&m1, 5, 5, 5);
-					gx3d_GetRotateYMatrix(&m2, 130);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_GetTranslateMatrix(&m3, 3219, -19, 4503);
-					gx3d_MultiplyMatrix(&m, &m3, &m);
-					gx3d_SetObjectMatrix(obj_hay, &m);
-					gx3d_SetTexture(0, tex_hay);
-					gx3d_DrawObject(obj_hay, 0);
-
-					gx3d_GetScaleMatrix(&m1, 5, 5, 5);
-					gx3d_GetRotateYMatrix(&m2, 130);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_GetTranslateMatrix(&m3, 3711, -19, 4088);
-					gx3d_MultiplyMatrix(&m, &m3, &m);
-					gx3d_SetObjectMatrix(obj_hay, &m);
-					gx3d_SetTexture(0, tex_hay);
-					gx3d_DrawObject(obj_hay, 0);
-
-					gx3d_GetScaleMatrix(&m1, 5, 5, 5);
-					gx3d_GetRotateYMatrix(&m2, 130);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_GetTranslateMatrix(&m3, 3956, -19, 3469);
-					gx3d_MultiplyMatrix(&m, &m3, &m);
-					gx3d_SetObjectMatrix(obj_hay, &m);
-					gx3d_SetTexture(0, tex_hay);
-					gx3d_DrawObject(obj_hay, 0);
-				}
-
-				// Draw trashcan
-				{
-					gx3d_GetScaleMatrix(&m1, 5, 5, 5);
-					gx3d_GetTranslateMatrix(&m2, -1010, -19, -2000);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_trashcan, &m);
-					gx3d_SetTexture(0, tex_trashcan);
-					gx3d_DrawObject(obj_trashcan, 0);
-				}
-
-				// Draw fountain
-				{
-					gx3d_GetScaleMatrix(&m1, 20, 20, 20);
-					gx3d_GetTranslateMatrix(&m2, 500, -19, 800);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fountain, &m);
-					gx3d_SetTexture(0, tex_concrete);
-					gx3d_DrawObject(obj_fountain, 0);
-				}
-
-				// Draw Windmill
-				{
-					gx3d_GetScaleMatrix(&m1, 23, 23, 23);
-					gx3d_GetRotateYMatrix(&m2, 210);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_GetTranslateMatrix(&m3, -5800, -19, 3200);
-					gx3d_MultiplyMatrix(&m, &m3, &m);
-					gx3d_SetObjectMatrix(obj_windmill, &m);
-					gx3d_SetTexture(0, tex_windmill);
-					gx3d_DrawObject(obj_windmill, 0);
-
-				}
-
-				// Draw sign
-				{
-					// Left
-					gx3d_GetScaleMatrix(&m1, 9, 9, 9);
-					gx3d_GetRotateYMatrix(&m2, 155);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_GetTranslateMatrix(&m3, -770, 270, -3280);
-					gx3d_MultiplyMatrix(&m, &m3, &m);
-					gx3d_SetObjectMatrix(obj_title, &m);
-					gx3d_SetTexture(0, tex_sign);
-					gx3d_DrawObject(obj_title, 0);
-
-					// Right
-					gx3d_GetScaleMatrix(&m1, 9, 9, 9);
-					gx3d_GetRotateYMatrix(&m2, 155);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_GetTranslateMatrix(&m3, -525, 270, -3166);
-					gx3d_MultiplyMatrix(&m, &m3, &m);
-					gx3d_SetObjectMatrix(obj_title2, &m);
-					gx3d_SetTexture(0, tex_sign2);
-					gx3d_DrawObject(obj_title2, 0);
-					
-					// Draw poles
-					gx3d_GetScaleMatrix(&m1, 15, 15, 15);
-					gx3d_GetTranslateMatrix(&m2, -2000, -110, -2700);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_GetRotateYMatrix(&m3, -25);
-					gx3d_MultiplyMatrix(&m, &m3, &m);
-					gx3d_SetObjectMatrix(obj_poles, &m);
-					gx3d_SetTexture(0, tex_poles);
-					gx3d_DrawObject(obj_poles, 0);
-				}
-
-				// Draw fence
-				{
-					// First is front left of player
-					gx3d_GetRotateYMatrix(&m1, -24);
-					gx3d_GetTranslateMatrix(&m2, -650, -5, -4460);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					// The rest are going clockwise from first
-					gx3d_GetRotateYMatrix(&m1, -24);
-					gx3d_GetTranslateMatrix(&m2, -999, -5, -4618);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -10);
-					gx3d_GetTranslateMatrix(&m2, -1358, -5, -4728);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 0);
-					gx3d_GetTranslateMatrix(&m2, -1740, -5, -4760);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 15);
-					gx3d_GetTranslateMatrix(&m2, -2115, -5, -4710);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 27);
-					gx3d_GetTranslateMatrix(&m2, -2470, -5, -4575);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 27);
-					gx3d_GetTranslateMatrix(&m2, -2813, -5, -4402);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -24);
-					gx3d_GetTranslateMatrix(&m2, -3165, -5, -4390);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -35);
-					gx3d_GetTranslateMatrix(&m2, -3500, -5, -4576);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -38);
-					gx3d_GetTranslateMatrix(&m2, -3807, -5, -4802);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -27);
-					gx3d_GetTranslateMatrix(&m2, -4127, -5, -5007);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -12);
-					gx3d_GetTranslateMatrix(&m2, -4483, -5, -5132);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 13);
-					gx3d_GetTranslateMatrix(&m2, -4854, -5, -5130);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 19);
-					gx3d_GetTranslateMatrix(&m2, -5220, -5, -5026);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 35);
-					gx3d_GetTranslateMatrix(&m2, -5557, -5, -4855);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 40);
-					gx3d_GetTranslateMatrix(&m2, -5859, -5, -4623);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 51);
-					gx3d_GetTranslateMatrix(&m2, -6125, -5, -4351);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 73);
-					gx3d_GetTranslateMatrix(&m2, -6300, -5, -4020);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 87);
-					gx3d_GetTranslateMatrix(&m2, -6365, -5, -3650);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 110);
-					gx3d_GetTranslateMatrix(&m2, -6310, -5, -3280);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 130);
-					gx3d_GetTranslateMatrix(&m2, -6122, -5, -2956);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 135.5);
-					gx3d_GetTranslateMatrix(&m2, -5863, -5, -2674);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 135.5);
-					gx3d_GetTranslateMatrix(&m2, -5588, -5, -2407);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 135.5);
-					gx3d_GetTranslateMatrix(&m2, -5313, -5, -2140);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 135.5);
-					gx3d_GetTranslateMatrix(&m2, -5038, -5, -1873);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 135.5);
-					gx3d_GetTranslateMatrix(&m2, -4763, -5, -1606);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 125);
-					gx3d_GetTranslateMatrix(&m2, -4517, -5, -1314);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 105);
-					gx3d_GetTranslateMatrix(&m2, -4355, -5, -970);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 85);
-					gx3d_GetTranslateMatrix(&m2, -4320, -5, -593);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 85);
-					gx3d_GetTranslateMatrix(&m2, -4351, -5, -212);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 115);
-					gx3d_GetTranslateMatrix(&m2, -4285, -5, 150);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 135);
-					gx3d_GetTranslateMatrix(&m2, -4070, -5, 455);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 157);
-					gx3d_GetTranslateMatrix(&m2, -3761, -5, 664);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 157);
-					gx3d_GetTranslateMatrix(&m2, -3410, -5, 813);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 157);
-					gx3d_GetTranslateMatrix(&m2, -2357, -5, 1260);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 157);
-					gx3d_GetTranslateMatrix(&m2, -2006, -5, 1409);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 132);
-					gx3d_GetTranslateMatrix(&m2, -1700, -5, 1627);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 132);
-					gx3d_GetTranslateMatrix(&m2, -1444, -5, 1911);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 132);
-					gx3d_GetTranslateMatrix(&m2, -1188, -5, 2195);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 132);
-					gx3d_GetTranslateMatrix(&m2, -932, -5, 2479);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 132);
-					gx3d_GetTranslateMatrix(&m2, -676, -5, 2763);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 132);
-					gx3d_GetTranslateMatrix(&m2, -420, -5, 3047);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 132);
-					gx3d_GetTranslateMatrix(&m2, -164, -5, 3331);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 132);
-					gx3d_GetTranslateMatrix(&m2, 92, -5, 3615);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 132);
-					gx3d_GetTranslateMatrix(&m2, 348, -5, 3899);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 132);
-					gx3d_GetTranslateMatrix(&m2, 604, -5, 4183);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 132);
-					gx3d_GetTranslateMatrix(&m2, 860, -5, 4467);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 132);
-					gx3d_GetTranslateMatrix(&m2, 1116, -5, 4751);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 132);
-					gx3d_GetTranslateMatrix(&m2, 1372, -5, 5035);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 42);
-					gx3d_GetTranslateMatrix(&m2, 1640, -5, 5060);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 42);
-					gx3d_GetTranslateMatrix(&m2, 1925, -5, 4805);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 42);
-					gx3d_GetTranslateMatrix(&m2, 2210, -5, 4550);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 42);
-					gx3d_GetTranslateMatrix(&m2, 2495, -5, 4295);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 42);
-					gx3d_GetTranslateMatrix(&m2, 2780, -5, 4040);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 42);
-					gx3d_GetTranslateMatrix(&m2, 3065, -5, 3785);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 42);
-					gx3d_GetTranslateMatrix(&m2, 3350, -5, 3530);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 42);
-					gx3d_GetTranslateMatrix(&m2, 3635, -5, 3275);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 42);
-					gx3d_GetTranslateMatrix(&m2, 3920, -5, 3020);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 42);
-					gx3d_GetTranslateMatrix(&m2, 4205, -5, 2765);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 42);
-					gx3d_GetTranslateMatrix(&m2, 4490, -5, 2510);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 42);
-					gx3d_GetTranslateMatrix(&m2, 4775, -5, 2255);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -81);
-					gx3d_GetTranslateMatrix(&m2, 4875, -5, 1935);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -81);
-					gx3d_GetTranslateMatrix(&m2, 4815, -5, 1557);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -81);
-					gx3d_GetTranslateMatrix(&m2, 4755, -5, 1179);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -81);
-					gx3d_GetTranslateMatrix(&m2, 4695, -5, 801);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -81);
-					gx3d_GetTranslateMatrix(&m2, 4635, -5, 423);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -81);
-					gx3d_GetTranslateMatrix(&m2, 4575, -5, 45);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -81);
-					gx3d_GetTranslateMatrix(&m2, 4515, -5, -333);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -81);
-					gx3d_GetTranslateMatrix(&m2, 4455, -5, -711);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -81);
-					gx3d_GetTranslateMatrix(&m2, 4395, -5, -1089);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -81);
-					gx3d_GetTranslateMatrix(&m2, 4335, -5, -1467);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -81);
-					gx3d_GetTranslateMatrix(&m2, 4275, -5, -1845);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -81);
-					gx3d_GetTranslateMatrix(&m2, 4215, -5, -2223);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -81);
-					gx3d_GetTranslateMatrix(&m2, 4155, -5, -2601);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -81);
-					gx3d_GetTranslateMatrix(&m2, 4095, -5, -2979);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -81);
-					gx3d_GetTranslateMatrix(&m2, 4035, -5, -3357);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -81);
-					gx3d_GetTranslateMatrix(&m2, 3975, -5, -3735);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -81);
-					gx3d_GetTranslateMatrix(&m2, 3915, -5, -4113);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 12);
-					gx3d_GetTranslateMatrix(&m2, 3705, -5, -4257);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 12);
-					gx3d_GetTranslateMatrix(&m2, 3331, -5, -4179);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 12);
-					gx3d_GetTranslateMatrix(&m2, 2957, -5, -4101);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 12);
-					gx3d_GetTranslateMatrix(&m2, 2583, -5, -4023);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, 12);
-					gx3d_GetTranslateMatrix(&m2, 2209, -5, -3945);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -4.5);
-					gx3d_GetTranslateMatrix(&m2, 1830, -5, -3920);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -4.5);
-					gx3d_GetTranslateMatrix(&m2, 1449, -5, -3950);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -4.5);
-					gx3d_GetTranslateMatrix(&m2, 1068, -5, -3980);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -4.5);
-					gx3d_GetTranslateMatrix(&m2, 687, -5, -4010);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-
-					gx3d_GetRotateYMatrix(&m1, -18);
-					gx3d_GetTranslateMatrix(&m2, 313, -5, -4084);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_fence, &m);
-					gx3d_SetTexture(0, tex_fence);
-					gx3d_DrawObject(obj_fence, 0);
-					// that took way too long :(
-				}
-
-				// Draw hills
-				{
-					gx3d_SetAmbientLight(color3d_white);
-
-					// Draw hill
-					gx3d_GetTranslateMatrix(&m, 0, 0, -9000);
-					gx3d_SetObjectMatrix(obj_hill, &m);
-					gx3d_SetTexture(0, tex_hill);
-					gx3d_DrawObject(obj_hill, 0);
-
-					// Draw hill2
-					gx3d_GetTranslateMatrix(&m, -3800, 0, -9000);
-					gx3d_SetObjectMatrix(obj_hill, &m);
-					gx3d_SetTexture(0, tex_hill);
-					gx3d_DrawObject(obj_hill, 0);
-
-					// Draw hill3
-					gx3d_GetTranslateMatrix(&m, 4000, 0, -8000);
-					gx3d_SetObjectMatrix(obj_hill, &m);
-					gx3d_SetTexture(0, tex_hill);
-					gx3d_DrawObject(obj_hill, 0);
-
-					// Draw hill4
-					gx3d_GetRotateYMatrix(&m1, 90);
-					gx3d_GetTranslateMatrix(&m2, -9000, 0, -7000);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_hill, &m);
-					gx3d_SetTexture(0, tex_hill);
-					gx3d_DrawObject(obj_hill, 0);
-
-					// Draw hill5
-					gx3d_GetRotateYMatrix(&m1, 90);
-					gx3d_GetTranslateMatrix(&m2, 8000, 0, -7000);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_hill, &m);
-					gx3d_SetTexture(0, tex_hill);
-					gx3d_DrawObject(obj_hill, 0);
-
-					// Draw hill6
-					gx3d_GetRotateYMatrix(&m1, 10);
-					gx3d_GetTranslateMatrix(&m2, -9900, 0, -4500);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_hill, &m);
-					gx3d_SetTexture(0, tex_hill);
-					gx3d_DrawObject(obj_hill, 0);
-
-					// Draw hill7
-					gx3d_GetRotateYMatrix(&m1, -90);
-					gx3d_GetTranslateMatrix(&m2, 8000, 0, -5000);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_hill, &m);
-					gx3d_SetTexture(0, tex_hill);
-					gx3d_DrawObject(obj_hill, 0);
-
-					// Draw hill8
-					gx3d_GetRotateYMatrix(&m1, 90);
-					gx3d_GetTranslateMatrix(&m2, -8000, 0, 0);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_hill, &m);
-					gx3d_SetTexture(0, tex_hill);
-					gx3d_DrawObject(obj_hill, 0);
-
-					// Draw hill9
-					gx3d_GetRotateYMatrix(&m1, -90);
-					gx3d_GetTranslateMatrix(&m2, 8000, 0, -485);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_hill, &m);
-					gx3d_SetTexture(0, tex_hill);
-					gx3d_DrawObject(obj_hill, 0);
-
-					// Draw hill10
-					gx3d_GetRotateYMatrix(&m1, 90);
-					gx3d_GetTranslateMatrix(&m2, -10000, 0, 4500);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_hill, &m);
-					gx3d_SetTexture(0, tex_hill);
-					gx3d_DrawObject(obj_hill, 0);
-
-					// Draw hill11
-					gx3d_GetRotateYMatrix(&m1, -90);
-					gx3d_GetTranslateMatrix(&m2, 8000, 0, 4000);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_hill, &m);
-					gx3d_SetTexture(0, tex_hill);
-					gx3d_DrawObject(obj_hill, 0);
-
-					// Draw hill12
-					gx3d_GetRotateYMatrix(&m1, 90);
-					gx3d_GetTranslateMatrix(&m2, -5500, 0, 9000);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_hill, &m);
-					gx3d_SetTexture(0, tex_hill);
-					gx3d_DrawObject(obj_hill, 0);
-
-					// Draw hill13
-					gx3d_GetRotateYMatrix(&m1, -90);
-					gx3d_GetTranslateMatrix(&m2, 5000, 0, 9000);
-					gx3d_MultiplyMatrix(&m1, &m2, &m);
-					gx3d_SetObjectMatrix(obj_hill, &m);
-					gx3d_SetTexture(0, tex_hill);
-					gx3d_DrawObject(obj_hill, 0);
-
-					// Draw hill14
-					gx3d_GetTranslateMatrix(&m, -700, 0, 8900);
-					gx3d_SetObjectMatrix(obj_hill, &m);
-					gx3d_SetTexture(0, tex_hill);
-					gx3d_DrawObject(obj_hill, 0);
-
-					// Draw hill15
-					gx3d_GetTranslateMatrix(&m, -3000, 0, 8950);
-					gx3d_SetObjectMatrix(obj_hill, &m);
-					gx3d_SetTexture(0, tex_hill);
-					gx3d_DrawObject(obj_hill, 0);
-
-					// Draw hill16
-					gx3d_GetTranslateMatrix(&m, 1700, 0, 8900);
-					gx3d_SetObjectMatrix(obj_hill, &m);
-					gx3d_SetTexture(0, tex_hill);
-					gx3d_DrawObject(obj_hill, 0);
-
-					// Draw hill17
-					gx3d_GetTranslateMatrix(&m, 5845, 0, 6300);
-					gx3d_SetObjectMatrix(obj_hill, &m);
-					gx3d_SetTexture(0, tex_hill);
-					gx3d_DrawObject(obj_hill, 0);
-
-					// Draw hill18
-					gx3d_GetTranslateMatrix(&m, -9235, 0, 8160);
-					gx3d_SetObjectMatrix(obj_hill, &m);
-					gx3d_SetTexture(0, tex_hill);
-					gx3d_DrawObject(obj_hill, 0);
-				}
-
-				gx3d_SetAmbientLight(color3d_white);
-				gx3d_DisableLight(main_light);
-
-				// Draw eggs
-				{
-					for (int i = 0; i < NUM_EGGS; i++) {
-						static gx3dVector lerpLocation = eggPosition[i];
-						if (eggDraw[i]) {
-							eggSphere[i] = obj_egg->bound_sphere;
-							eggSphere[i].center.x = eggPosition[i].x;
-							eggSphere[i].center.y = lerpLocation.y + 15;
-							eggSphere[i].center.z = eggPosition[i].z;
-							eggSphere[i].radius *= 2;
-
-							eggOnScreen[i] = false;
-							relation = gx3d_Relation_Sphere_Frustum(&eggSphere[i]);
-
-							if (relation != gxRELATION_OUTSIDE) {
-								gx3dVector newLocation = eggPosition[i];
-								newLocation.y += 20;
-								float timeScale = (float)new_time / 1000;
-								float alpha = std::sin(timeScale) * 0.5 + 0.5;
-								gx3d_LerpVector(&eggPosition[i], &newLocation, alpha, &lerpLocation);
-
-								eggOnScreen[i] = true;
-								gx3d_GetScaleMatrix(&m1, 2.0f, 2.0f, 2.0f);
-								gx3d_GetRotateYMatrix(&m2, timeScale * 100);
-								gx3d_MultiplyMatrix(&m1, &m2, &m);
-								gx3d_GetRotateXMatrix(&m3, -15);
-								gx3d_MultiplyMatrix(&m, &m3, &m);
-								gx3d_GetTranslateMatrix(&m4, eggPosition[i].x, lerpLocation.y, eggPosition[i].z);
-								gx3d_MultiplyMatrix(&m, &m4, &m);
-								gx3d_SetObjectMatrix(obj_egg, &m);
-								gx3d_SetTexture(0, tex_egg);
-								gx3d_DrawObject(obj_egg, 0);
-							}
-							
-						}
-						if (eggParticle[i]) {
-							float elapsedParticle_time = timeGetTime() / 1000;
-							elapsedParticle_time -= currTime;
-
-							gx3d_EnableAlphaBlending();
-							gx3d_GetScaleMatrix(&m1, 5.0f, 5.0f, 5.0f);
-							gx3d_GetTranslateMatrix(&m2, eggPosition[i].x, lerpLocation.y + 25,  eggPosition[i].z);
-							gx3d_MultiplyMatrix(&m1, &m2, &m);
-							gx3d_SetParticleSystemMatrix(psys_glitter, &m);
-							gx3d_UpdateParticleSystem(psys_glitter, elapsed_time);
-							
-						
-							if (elapsedParticle_time > 1.0f)
-								eggParticle[i] = false;
-							gx3d_DrawParticleSystem(psys_glitter, &heading, false);
-						}
-						gx3d_DisableAlphaBlending();
-					}
-				}
-
-				// Enable alpha blending (since the model to be drawn uses an alpha-blended texture)
-				gx3d_EnableAlphaBlending();
-				gx3d_EnableAlphaTesting(128);
-
-				// Draw HUD
-				{
-					if (!helpScreen) {
-						// Save current view matrix
-						view_save;
-						gx3d_GetViewMatrix(&view_save);
-
-						// Set new view matrix
-						tfrom = { 0, 0, 1 }, tto = { 0, 0, 0 }, twup = { 0, 1, 0 };
-						gx3d_CameraSetPosition(&tfrom, &tto, &twup, gx3d_CAMERA_ORIENTATION_LOOKTO_FIXED);
-						gx3d_CameraSetViewMatrix();
-
-						gx3d_EnableAlphaBlending();
-						gx3d_EnableAlphaTesting(128);
-
-						gx3d_GetTranslateMatrix(&m, 0, 0, -0.01);
-						gx3d_SetObjectMatrix(obj_cross, &m);
-						gx3d_SetTexture(0, tex_cross);
-
-						// Check if crosshair should be drawn
-						if (cross)
-							gx3d_DrawObject(obj_cross, 0);
-
-						for (int i = 0; i < NUM_EGGS; i++) {
-							if (!eggDraw[i]) {
-								eggsCollected++;
-								gx3d_GetTranslateMatrix(&m, (-0.8 * (float)eggsCollected) + 6.8, 2.5, -0.01);
-								gx3d_SetObjectMatrix(obj_2d_egg, &m);
-								gx3d_SetTexture(0, tex_2d_egg);
-								gx3d_DrawObject(obj_2d_egg, 0);
-							}
-						}
-						eggsCollected = 0;
-					}
-				}
-
-			}
-
-			if (gameState == 3) {
-				// Draw Game Over Screen
-				{
-					cross = false;
-
-					// Save current view matrix
-					view_save;
-					gx3d_GetViewMatrix(&view_save);
-
-					// Set new view matrix
-					tfrom = { 0, 0, 1 }, tto = { 0, 0, 0 }, twup = { 0, 1, 0 };
-					gx3d_CameraSetPosition(&tfrom, &tto, &twup, gx3d_CAMERA_ORIENTATION_LOOKTO_FIXED);
-					gx3d_CameraSetViewMatrix();
-
-					// Draw Title Screen
-					gx3d_GetTranslateMatrix(&m, 15.25, -14.3, -37);
-					gx3d_SetObjectMatrix(obj_title, &m);
-					gx3d_SetTexture(0, tex_end);
-					gx3d_DrawObject(obj_title, 0);
-
-					gx3d_GetTranslateMatrix(&m, -14.7, -14.3, -37);
-					gx3d_SetObjectMatrix(obj_title2, &m);
-					gx3d_SetTexture(0, tex_end2);
-					gx3d_DrawObject(obj_title2, 0);
-
-					// Restore View Matrix
-					gx3d_SetViewMatrix(&view_save);
-
-					// Stop rendering
-					gx3d_EndRender();
-				}
-			}
-
-			gx3d_DisableAlphaBlending();
-			gx3d_DisableAlphaTesting();
-
-			// Restore View Matrix
-			gx3d_SetViewMatrix(&view_save);
+			Render_Set_Material(&material_default);
+
+			Render_Set_Ambient_Light(color3d_white);
+			Render_Disable_Light(dir_light);
+
+			// Turn on the passes for this game state, then draw the ones the screen needs
+			FrameGraph_Enable_Pass(pass_occlusion, gameState == 1);
+			FrameGraph_Enable_Pass(pass_world, gameState == 1);
+			FrameGraph_Enable_Pass(pass_scene, gameState == 1);
+			FrameGraph_Enable_Pass(pass_particles, gameState == 1 && glitter);
+			FrameGraph_Enable_Pass(pass_hud, gameState == 1 && !helpScreen);
+			FrameGraph_Enable_Pass(pass_title, gameState == 0);
+			FrameGraph_Enable_Pass(pass_game_over, gameState == 3);
+			FrameGraph_Enable_Pass(pass_help, gameState != 3 && helpScreen);
+			frame.view_ray = viewVector;
+			// Simulated time, also drawn between steps
+			sim_time = snapshot->time;
+			frame.time = sim_time;
+			frame.elapsed_time = sim_time - last_sim_time;
+			last_sim_time = sim_time;
+			frame.glitter_start = currTime;
+			FrameGraph_Execute();
+
+			Render_Disable_Alpha_Blending();
+			Render_Disable_Alpha_Testing();
 
 			// Stop rendering
-			gx3d_EndRender();
+			Render_End();
 
 			// Page flip (so user can see it)
-			gxFlipVisualActivePages(FALSE);
+			Render_Flip();
+			if (click_ms >= 0) {
+				Input_Shown(click_ms);
+				click_ms = -1;
+			}
+			overlay_flips++;
+			overlay_time = new_time;
 		}
+
+		// Wait for the next frame's simulation, then listen from where it left the player
+		if (pipelined)
+			Pipeline_End_Frame();
+		snd_SetListenerPosition(position.x, position.y, position.z, snd_3D_APPLY_NOW);
+		snd_SetListenerOrientation(heading.x, heading.y, heading.z, 0, 1, 0, snd_3D_APPLY_NOW);
 	}
 
 	/*____________________________________________________________________
@@ -2323,45 +1944,21 @@ void Program_Run()
 	snd_StopSound(s_song);
 	snd_StopSound(s_crickets);
 	snd_Free();
-	gx3d_FreeParticleSystem(psys_glitter);
-}
-
-/*____________________________________________________________________
-|
-| Function: Init_Render_State
-|
-| Input: Called from Program_Run()
-| Output: Initializes general 3D render state.
-|___________________________________________________________________*/
-
-static void Init_Render_State()
-{
-	// Enable zbuffering
-	gx3d_EnableZBuffer();
-
-	// Enable lighting
-	gx3d_EnableLighting();
-
-	// Set the default alpha blend factor
-	gx3d_SetAlphaBlendFactor(gx3d_ALPHABLENDFACTOR_SRCALPHA, gx3d_ALPHABLENDFACTOR_INVSRCALPHA);
-
-	// Init texture addressing mode - wrap in both u and v dimensions
-	gx3d_SetTextureAddressingMode(0, gx3d_TEXTURE_DIMENSION_U | gx3d_TEXTURE_DIMENSION_V, gx3d_TEXTURE_ADDRESSMODE_WRAP);
-	gx3d_SetTextureAddressingMode(1, gx3d_TEXTURE_DIMENSION_U | gx3d_TEXTURE_DIMENSION_V, gx3d_TEXTURE_ADDRESSMODE_WRAP);
-	// Texture stage 0 default blend operator and arguments
-	gx3d_SetTextureColorOp(0, gx3d_TEXTURE_COLOROP_MODULATE, gx3d_TEXTURE_ARG_TEXTURE, gx3d_TEXTURE_ARG_CURRENT);
-	gx3d_SetTextureAlphaOp(0, gx3d_TEXTURE_ALPHAOP_SELECTARG1, gx3d_TEXTURE_ARG_TEXTURE, 0);
-	// Texture stage 1 is off by default
-	gx3d_SetTextureColorOp(1, gx3d_TEXTURE_COLOROP_DISABLE, 0, 0);
-	gx3d_SetTextureAlphaOp(1, gx3d_TEXTURE_ALPHAOP_DISABLE, 0, 0);
-
-	// Set default texture coordinates
-	gx3d_SetTextureCoordinates(0, gx3d_TEXCOORD_SET0);
-	gx3d_SetTextureCoordinates(1, gx3d_TEXCOORD_SET1);
-
-	// Enable trilinear texture filtering
-	gx3d_SetTextureFiltering(0, gx3d_TEXTURE_FILTERTYPE_TRILINEAR, 0);
-	gx3d_SetTextureFiltering(1, gx3d_TEXTURE_FILTERTYPE_TRILINEAR, 0);
+	RenderGx3d_Free_Particles(psys_glitter);
+	FrameGraph_Free();
+	SpriteBatch_Free();
+	Pick_Free();
+	Collision_Free();
+	Heightfield_Free();
+	EggStore_Free(&eggs);
+	StaticBatch_Free();
+	Jobs_Free();
+	RenderQueue_Free();
+	Foliage_Free();
+	Occlusion_Free();
+	Render_Set_Backend(RenderGx3d_Backend());
+	RenderNull_Free();
+	RenderSoft_Free();
 }
 
 /*____________________________________________________________________
@@ -0,0 +1,571 @@
+/*____________________________________________________________________
+|
+| File: occlusion.cpp
+|
+| Description: Software occlusion culling.  A small set of simplified
+|   occluders (boxes that fit inside solid geometry) is rasterized into
+|   a low resolution depth buffer using SSE2, a hierarchical-z pyramid
+|   is built from it, and occludee bounds are tested against the
+|   pyramid before they are sent to the renderer.
+|
+|   The buffer stores 1/z (view space) so depth interpolates linearly
+|   in screen space.  Larger values are closer to the camera and an
+|   empty pixel is 0 (infinitely far away).  Each level of the pyramid
+|   keeps the minimum (farthest) value of the 4 texels below it.
+|
+|   Occluders are rasterized conservatively: a pixel is written only if
+|   the whole pixel square is inside the triangle, and with the farthest
+|   depth the triangle has anywhere in that square.  So the buffer never
+|   claims an occluder covers something it only partly covers (the
+|   price is a pixel wide gap along the edges, even between triangles
+|   that share one).
+|
+|   Once the pyramid is built, occludees may be tested from several
+|   threads at once (the test counters and time are updated with
+|   interlocked adds).
+|
+| Functions: Occlusion_Init
+|            Occlusion_Free
+|            Occlusion_Begin_Frame
+|            Occlusion_Add_Occluder
+|             Clip_Near_And_Rasterize
+|             Rasterize_Triangle
+|            Occlusion_End_Occluders
+|            Occlusion_Sphere_Visible
+|            Occlusion_Box_Visible
+|             Test_View_Box
+|             Add_Test_Time
+|            Occlusion_Get_Stats
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+#include <math.h>
+#include <emmintrin.h>
+
+#include "dp.h"
+
+#include "timer.h"
+#include "occlusion.h"
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static void Clip_Near_And_Rasterize (gx3dVector *v0, gx3dVector *v1, gx3dVector *v2);
+static void Rasterize_Triangle (gx3dVector *v0, gx3dVector *v1, gx3dVector *v2);
+static bool Test_View_Box (gx3dVector *min, gx3dVector *max);
+static void Add_Test_Time (double start);
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define HIZ_LEVELS 6  // level 0 is the depth buffer, level 5 is 8x4
+
+#define HIZ_TEST_TEXELS 4 // max texels across an occludee rectangle before moving up a level
+
+#define WIDTH  OCCLUSION_BUFFER_WIDTH
+#define HEIGHT OCCLUSION_BUFFER_HEIGHT
+
+/*___________________
+|
+| Global variables
+|__________________*/
+
+alignas(16) static float depth_buffer [WIDTH * HEIGHT];
+alignas(16) static float hiz_pool [WIDTH * HEIGHT / 2];
+
+static float *hiz_level [HIZ_LEVELS];
+static int    hiz_width [HIZ_LEVELS];
+static int    hiz_height [HIZ_LEVELS];
+
+static gx3dMatrix view;         // current view matrix
+static float      proj_x;       // x scale of the projection
+static float      proj_y;       // y scale of the projection
+static float      near_z;       // near clip plane
+
+static OcclusionStats stats;
+static volatile LONGLONG test_ns;      // time testing occludees, in nanoseconds
+
+/*____________________________________________________________________
+|
+| Function: Occlusion_Init
+|
+| Input: Called from Program_Run()
+| Output: Sets up the projection and the hi-z pyramid levels.
+|___________________________________________________________________*/
+
+void Occlusion_Init (
+  float fov,
+  float near_plane,
+  float far_plane,
+  float aspect )
+{
+  int i;
+  float *p;
+
+  // Match the projection gx3d_SetProjectionMatrix() computes
+  proj_y = 1.0f / (float)tan ((fov * 3.14159265f / 180) / 2);
+  proj_x = proj_y / aspect;
+  near_z = near_plane;
+
+  // Lay out the pyramid levels
+  hiz_level[0]  = depth_buffer;
+  hiz_width[0]  = WIDTH;
+  hiz_height[0] = HEIGHT;
+  p = hiz_pool;
+  for (i=1; i<HIZ_LEVELS; i++) {
+    hiz_level[i]  = p;
+    hiz_width[i]  = hiz_width[i-1] / 2;
+    hiz_height[i] = hiz_height[i-1] / 2;
+    p += hiz_width[i] * hiz_height[i];
+  }
+
+  memset (&stats, 0, sizeof(stats));
+}
+
+/*____________________________________________________________________
+|
+| Function: Occlusion_Free
+|
+| Input: Called from Program_Run()
+| Output:
+|___________________________________________________________________*/
+
+void Occlusion_Free ()
+{
+
+}
+
+/*____________________________________________________________________
+|
+| Function: Occlusion_Begin_Frame
+|
+| Input: Called from Program_Run()
+| Output: Clears the depth buffer and saves the view matrix.
+|___________________________________________________________________*/
+
+void Occlusion_Begin_Frame (gx3dMatrix *view_matrix)
+{
+  int i;
+  __m128 zero = _mm_setzero_ps ();
+
+  view = *view_matrix;
+  memset (&stats, 0, sizeof(stats));
+  test_ns = 0;
+
+  for (i=0; i<WIDTH*HEIGHT; i+=4)
+    _mm_store_ps (&depth_buffer[i], zero);
+}
+
+/*____________________________________________________________________
+|
+| Function: Occlusion_Add_Occluder
+|
+| Input: Called from Program_Run()
+| Output: Rasterizes the 12 triangles of a box into the depth buffer.
+|___________________________________________________________________*/
+
+void Occlusion_Add_Occluder (gx3dBox *box, gx3dMatrix *world_matrix)
+{
+  int i, behind;
+  gx3dMatrix m;
+  gx3dVector corner, v[8];
+  double start;
+
+  static int face[12][3] = {
+    {0,1,3}, {0,3,2},   // -z
+    {4,6,7}, {4,7,5},   // +z
+    {0,4,5}, {0,5,1},   // -y
+    {2,3,7}, {2,7,6},   // +y
+    {0,2,6}, {0,6,4},   // -x
+    {1,5,7}, {1,7,3}    // +x
+  };
+
+  start = Timer_Now_Ms ();
+
+  // Transform corners to view space
+  gx3d_MultiplyMatrix (world_matrix, &view, &m);
+  for (i=0, behind=0; i<8; i++) {
+    corner.x = (i & 1) ? box->max.x : box->min.x;
+    corner.y = (i & 2) ? box->max.y : box->min.y;
+    corner.z = (i & 4) ? box->max.z : box->min.z;
+    gx3d_MultiplyVectorMatrix (&corner, &m, &v[i]);
+    if (v[i].z < near_z)
+      behind++;
+  }
+
+  // Entirely behind the camera?
+  if (behind < 8) {
+    for (i=0; i<12; i++)
+      Clip_Near_And_Rasterize (&v[face[i][0]], &v[face[i][1]], &v[face[i][2]]);
+    stats.occluders++;
+  }
+
+  stats.raster_ms += Timer_Elapsed_Ms (start);
+}
+
+/*____________________________________________________________________
+|
+| Function: Clip_Near_And_Rasterize
+|
+| Input: Called from Occlusion_Add_Occluder()
+| Output: Clips a view space triangle to the near plane and rasterizes
+|   the result.
+|___________________________________________________________________*/
+
+static void Clip_Near_And_Rasterize (gx3dVector *v0, gx3dVector *v1, gx3dVector *v2)
+{
+  int i, n;
+  float t;
+  gx3dVector *in[3], out[4], *a, *b;
+
+  in[0] = v0;
+  in[1] = v1;
+  in[2] = v2;
+
+  // Nothing to clip?
+  if ((v0->z >= near_z) AND (v1->z >= near_z) AND (v2->z >= near_z)) {
+    Rasterize_Triangle (v0, v1, v2);
+    return;
+  }
+
+  // Sutherland-Hodgman against z = near
+  for (i=0, n=0; i<3; i++) {
+    a = in[i];
+    b = in[(i+1)%3];
+    if (a->z >= near_z)
+      out[n++] = *a;
+    if ((a->z >= near_z) != (b->z >= near_z)) {
+      t = (near_z - a->z) / (b->z - a->z);
+      out[n].x = a->x + (b->x - a->x) * t;
+      out[n].y = a->y + (b->y - a->y) * t;
+      out[n].z = near_z;
+      n++;
+    }
+  }
+
+  for (i=1; i+1<n; i++)
+    Rasterize_Triangle (&out[0], &out[i], &out[i+1]);
+}
+
+/*____________________________________________________________________
+|
+| Function: Rasterize_Triangle
+|
+| Input: Called from Clip_Near_And_Rasterize()
+| Output: Rasterizes a view space triangle (in front of the near plane)
+|   into the depth buffer, 4 pixels at a time.  Only pixels entirely
+|   inside the triangle are written, with the farthest depth in the
+|   pixel.
+|___________________________________________________________________*/
+
+static void Rasterize_Triangle (gx3dVector *v0, gx3dVector *v1, gx3dVector *v2)
+{
+  int i, x, y, xmin, xmax, ymin, ymax;
+  float sx[3], sy[3], iz[3], area, fx, fy;
+  float a[3], b[3], c[3], az, bz, cz;
+  gx3dVector *v[3];
+  float *row;
+  __m128 e0, e1, e2, ez, step0, step1, step2, stepz, mask, d, offsets;
+
+  v[0] = v0;
+  v[1] = v1;
+  v[2] = v2;
+
+  // Project to buffer coordinates
+  for (i=0; i<3; i++) {
+    iz[i] = 1.0f / v[i]->z;
+    sx[i] = ( v[i]->x * proj_x * iz[i] * 0.5f + 0.5f) * WIDTH;
+    sy[i] = (-v[i]->y * proj_y * iz[i] * 0.5f + 0.5f) * HEIGHT;
+  }
+
+  area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sy[1] - sy[0]) * (sx[2] - sx[0]);
+  if (fabs (area) < 0.0001f)
+    return;
+  // Occluders are solid from both sides so just flip the winding
+  if (area < 0) {
+    fx = sx[1]; sx[1] = sx[2]; sx[2] = fx;
+    fy = sy[1]; sy[1] = sy[2]; sy[2] = fy;
+    fx = iz[1]; iz[1] = iz[2]; iz[2] = fx;
+    area = -area;
+  }
+
+  // Bounding rectangle, clipped to the buffer
+  fx = sx[0]; if (sx[1] < fx) fx = sx[1]; if (sx[2] < fx) fx = sx[2];
+  xmin = (int)floor (fx);
+  fx = sx[0]; if (sx[1] > fx) fx = sx[1]; if (sx[2] > fx) fx = sx[2];
+  xmax = (int)ceil (fx);
+  fy = sy[0]; if (sy[1] < fy) fy = sy[1]; if (sy[2] < fy) fy = sy[2];
+  ymin = (int)floor (fy);
+  fy = sy[0]; if (sy[1] > fy) fy = sy[1]; if (sy[2] > fy) fy = sy[2];
+  ymax = (int)ceil (fy);
+  if (xmin < 0) xmin = 0;
+  if (ymin < 0) ymin = 0;
+  if (xmax > WIDTH-1)  xmax = WIDTH-1;
+  if (ymax > HEIGHT-1) ymax = HEIGHT-1;
+  if ((xmin > xmax) OR (ymin > ymax))
+    return;
+  xmin &= ~3;
+
+  // Edge functions: e[i] is positive inside edge (v[i], v[i+1])
+  for (i=0; i<3; i++) {
+    a[i] = sy[i] - sy[(i+1)%3];
+    b[i] = sx[(i+1)%3] - sx[i];
+    c[i] = -(a[i] * sx[i] + b[i] * sy[i]);
+  }
+
+  // Depth plane (1/z is linear in screen space)
+  az = ((iz[1] - iz[0]) * a[2] + (iz[2] - iz[0]) * a[0]) / area;
+  bz = ((iz[1] - iz[0]) * b[2] + (iz[2] - iz[0]) * b[0]) / area;
+  cz = iz[0] + ((iz[1] - iz[0]) * c[2] + (iz[2] - iz[0]) * c[0]) / area;
+
+  /* Move each edge in and the depth plane back by the most they change
+     from a pixel center to a corner of the pixel (half a pixel in x and
+     in y), so the tests at the center hold for the whole pixel */
+  for (i=0; i<3; i++)
+    c[i] -= (fabs (a[i]) + fabs (b[i])) * 0.5f;
+  cz -= (fabs (az) + fabs (bz)) * 0.5f;
+
+  offsets = _mm_set_ps (3.5f, 2.5f, 1.5f, 0.5f);
+  step0 = _mm_set1_ps (a[0] * 4);
+  step1 = _mm_set1_ps (a[1] * 4);
+  step2 = _mm_set1_ps (a[2] * 4);
+  stepz = _mm_set1_ps (az * 4);
+
+  for (y=ymin; y<=ymax; y++) {
+    fy  = (float)y + 0.5f;
+    fx  = (float)xmin;
+    row = &depth_buffer[y * WIDTH];
+    // Values at the 4 pixel centers starting at xmin
+    e0 = _mm_add_ps (_mm_set1_ps (a[0] * fx + b[0] * fy + c[0]), _mm_mul_ps (_mm_set1_ps (a[0]), offsets));
+    e1 = _mm_add_ps (_mm_set1_ps (a[1] * fx + b[1] * fy + c[1]), _mm_mul_ps (_mm_set1_ps (a[1]), offsets));
+    e2 = _mm_add_ps (_mm_set1_ps (a[2] * fx + b[2] * fy + c[2]), _mm_mul_ps (_mm_set1_ps (a[2]), offsets));
+    ez = _mm_add_ps (_mm_set1_ps (az   * fx + bz   * fy + cz),   _mm_mul_ps (_mm_set1_ps (az),   offsets));
+    for (x=xmin; x<=xmax; x+=4) {
+      mask = _mm_and_ps (_mm_and_ps (_mm_cmpge_ps (e0, _mm_setzero_ps ()),
+                                     _mm_cmpge_ps (e1, _mm_setzero_ps ())),
+                                     _mm_cmpge_ps (e2, _mm_setzero_ps ()));
+      if (_mm_movemask_ps (mask)) {
+        // Keep the closest (largest 1/z) value
+        d = _mm_load_ps (&row[x]);
+        d = _mm_or_ps (_mm_and_ps (mask, _mm_max_ps (d, ez)), _mm_andnot_ps (mask, d));
+        _mm_store_ps (&row[x], d);
+      }
+      e0 = _mm_add_ps (e0, step0);
+      e1 = _mm_add_ps (e1, step1);
+      e2 = _mm_add_ps (e2, step2);
+      ez = _mm_add_ps (ez, stepz);
+    }
+  }
+
+  stats.triangles++;
+}
+
+/*____________________________________________________________________
+|
+| Function: Occlusion_End_Occluders
+|
+| Input: Called from Program_Run()
+| Output: Builds the hi-z pyramid.  Each texel is the minimum 1/z
+|   (farthest occluder) of the 2x2 texels below it.
+|___________________________________________________________________*/
+
+void Occlusion_End_Occluders ()
+{
+  int level, x, y, src_width;
+  float *src0, *src1, *dst;
+  __m128 a, b;
+  double start;
+
+  start = Timer_Now_Ms ();
+
+  for (level=1; level<HIZ_LEVELS; level++) {
+    src_width = hiz_width[level-1];
+    for (y=0; y<hiz_height[level]; y++) {
+      src0 = &hiz_level[level-1][(y*2) * src_width];
+      src1 = src0 + src_width;
+      dst  = &hiz_level[level][y * hiz_width[level]];
+      for (x=0; x<src_width; x+=8) {
+        // Vertical min of 8 texels from 2 rows
+        a = _mm_min_ps (_mm_load_ps (&src0[x]),   _mm_load_ps (&src1[x]));
+        b = _mm_min_ps (_mm_load_ps (&src0[x+4]), _mm_load_ps (&src1[x+4]));
+        // Horizontal min of adjacent pairs
+        _mm_store_ps (&dst[x/2], _mm_min_ps (_mm_shuffle_ps (a, b, _MM_SHUFFLE(2,0,2,0)),
+                                             _mm_shuffle_ps (a, b, _MM_SHUFFLE(3,1,3,1))));
+      }
+    }
+  }
+
+  stats.raster_ms += Timer_Elapsed_Ms (start);
+}
+
+/*____________________________________________________________________
+|
+| Function: Occlusion_Sphere_Visible
+|
+| Input: Called from Program_Run(), Foliage_Submit() (any thread)
+| Output: Returns true if any part of the sphere may be visible.
+|___________________________________________________________________*/
+
+bool Occlusion_Sphere_Visible (gx3dSphere *sphere)
+{
+  bool visible;
+  gx3dVector center, min, max;
+  double start;
+
+  start = Timer_Now_Ms ();
+
+  gx3d_MultiplyVectorMatrix (&sphere->center, &view, &center);
+  min.x = center.x - sphere->radius;
+  min.y = center.y - sphere->radius;
+  min.z = center.z - sphere->radius;
+  max.x = center.x + sphere->radius;
+  max.y = center.y + sphere->radius;
+  max.z = center.z + sphere->radius;
+  visible = Test_View_Box (&min, &max);
+
+  Add_Test_Time (start);
+
+  return (visible);
+}
+
+/*____________________________________________________________________
+|
+| Function: Occlusion_Box_Visible
+|
+| Input: Called from Record_Props(), StaticBatch_Submit() (any thread)
+| Output: Returns true if any part of the box may be visible.
+|___________________________________________________________________*/
+
+bool Occlusion_Box_Visible (gx3dBox *box, gx3dMatrix *world_matrix)
+{
+  int i;
+  bool visible;
+  gx3dMatrix m;
+  gx3dVector corner, v, min, max;
+  double start;
+
+  start = Timer_Now_Ms ();
+
+  // Get a view space box around the transformed box
+  gx3d_MultiplyMatrix (world_matrix, &view, &m);
+  for (i=0; i<8; i++) {
+    corner.x = (i & 1) ? box->max.x : box->min.x;
+    corner.y = (i & 2) ? box->max.y : box->min.y;
+    corner.z = (i & 4) ? box->max.z : box->min.z;
+    gx3d_MultiplyVectorMatrix (&corner, &m, &v);
+    if (i == 0) {
+      min = v;
+      max = v;
+    }
+    else {
+      if (v.x < min.x) min.x = v.x; else if (v.x > max.x) max.x = v.x;
+      if (v.y < min.y) min.y = v.y; else if (v.y > max.y) max.y = v.y;
+      if (v.z < min.z) min.z = v.z; else if (v.z > max.z) max.z = v.z;
+    }
+  }
+  visible = Test_View_Box (&min, &max);
+
+  Add_Test_Time (start);
+
+  return (visible);
+}
+
+/*____________________________________________________________________
+|
+| Function: Test_View_Box
+|
+| Input: Called from Occlusion_Sphere_Visible(), Occlusion_Box_Visible()
+| Output: Tests a view space box against the hi-z pyramid.  Returns
+|   true if visible.  Anything crossing the near plane or outside the
+|   screen is reported visible (frustum culling is done elsewhere).
+|___________________________________________________________________*/
+
+static bool Test_View_Box (gx3dVector *min, gx3dVector *max)
+{
+  int x, y, xmin, xmax, ymin, ymax, level;
+  float fxmin, fxmax, fymin, fymax, closest;
+  float *texel;
+
+  InterlockedIncrement ((volatile LONG *)&stats.tested);
+
+  if (min->z <= near_z)
+    return (true);
+
+  // Screen rectangle - x/z is monotonic over the box so the extremes are at the corners
+  fxmin = min->x / min->z; if (min->x / max->z < fxmin) fxmin = min->x / max->z;
+  fxmax = max->x / min->z; if (max->x / max->z > fxmax) fxmax = max->x / max->z;
+  fymin = min->y / min->z; if (min->y / max->z < fymin) fymin = min->y / max->z;
+  fymax = max->y / min->z; if (max->y / max->z > fymax) fymax = max->y / max->z;
+  xmin = (int)floor (( fxmin * proj_x * 0.5f + 0.5f) * WIDTH);
+  xmax = (int)floor (( fxmax * proj_x * 0.5f + 0.5f) * WIDTH);
+  ymin = (int)floor ((-fymax * proj_y * 0.5f + 0.5f) * HEIGHT);
+  ymax = (int)floor ((-fymin * proj_y * 0.5f + 0.5f) * HEIGHT);
+
+  if ((xmax < 0) OR (ymax < 0) OR (xmin >= WIDTH) OR (ymin >= HEIGHT))
+    return (true);
+  if (xmin < 0) xmin = 0;
+  if (ymin < 0) ymin = 0;
+  if (xmax > WIDTH-1)  xmax = WIDTH-1;
+  if (ymax > HEIGHT-1) ymax = HEIGHT-1;
+
+  // Move up the pyramid until the rectangle covers only a few texels
+  for (level=0; level<HIZ_LEVELS-1; level++) {
+    if (((xmax - xmin) >> level) < HIZ_TEST_TEXELS AND ((ymax - ymin) >> level) < HIZ_TEST_TEXELS)
+      break;
+  }
+  xmin >>= level;
+  xmax >>= level;
+  ymin >>= level;
+  ymax >>= level;
+
+  // Hidden only if every texel has an occluder closer than the closest point of the box
+  closest = 1.0f / min->z;
+  for (y=ymin; y<=ymax; y++) {
+    texel = &hiz_level[level][y * hiz_width[level]];
+    for (x=xmin; x<=xmax; x++)
+      if (texel[x] <= closest)
+        return (true);
+  }
+
+  InterlockedIncrement ((volatile LONG *)&stats.culled);
+  return (false);
+}
+
+/*____________________________________________________________________
+|
+| Function: Add_Test_Time
+|
+| Input: Called from Occlusion_Sphere_Visible(), Occlusion_Box_Visible()
+| Output: Adds the time since start to the time spent testing.
+|___________________________________________________________________*/
+
+static void Add_Test_Time (double start)
+{
+  InterlockedExchangeAdd64 (&test_ns, (LONGLONG)((Timer_Now_Ms () - start) * 1000000));
+}
+
+/*____________________________________________________________________
+|
+| Function: Occlusion_Get_Stats
+|
+| Input: Called from Program_Run()
+| Output: Returns statistics for the current frame.
+|___________________________________________________________________*/
+
+void Occlusion_Get_Stats (OcclusionStats *occlusion_stats)
+{
+  *occlusion_stats = stats;
+  occlusion_stats->test_ms = (float)((double)test_ns / 1000000);
+}
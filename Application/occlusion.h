@@ -0,0 +1,53 @@
+/*____________________________________________________________________
+|
+| File: occlusion.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+// Size of the low resolution occlusion depth buffer (width must be a multiple of 128)
+#define OCCLUSION_BUFFER_WIDTH  256
+#define OCCLUSION_BUFFER_HEIGHT 128
+
+// Per-frame statistics
+struct OcclusionStats {
+  int   occluders;          // # of occluders submitted
+  int   triangles;          // # of occluder triangles rasterized
+  int   tested;             // # of occludees tested
+  int   culled;             // # of occludees found to be hidden
+  float raster_ms;          // time spent rasterizing occluders and building the hi-z pyramid
+  float test_ms;            // time spent testing occludees
+};
+
+// Init occlusion buffer, using the same parameters given to gx3d_SetProjectionMatrix()
+void Occlusion_Init (
+  float fov,                // degrees field of view
+  float near_plane,
+  float far_plane,
+  float aspect );           // screen width / screen height
+
+// Free any resources
+void Occlusion_Free ();
+
+// Clears the depth buffer and sets the camera for this frame
+void Occlusion_Begin_Frame (gx3dMatrix *view_matrix);
+
+// Rasterizes a box occluder (in object space) into the depth buffer
+void Occlusion_Add_Occluder (
+  gx3dBox    *box,          // object space box - should be fully inside the occluding geometry
+  gx3dMatrix *world_matrix );
+
+// Builds the hierarchical-z pyramid - call after all occluders have been added
+void Occlusion_End_Occluders ();
+
+// The two tests below may be called from several threads at once
+
+// Returns true if any part of the sphere (in world space) may be visible
+bool Occlusion_Sphere_Visible (gx3dSphere *sphere);
+
+// Returns true if any part of the box (in object space) may be visible
+bool Occlusion_Box_Visible (gx3dBox *box, gx3dMatrix *world_matrix);
+
+// Returns statistics for the current frame
+void Occlusion_Get_Stats (OcclusionStats *stats);
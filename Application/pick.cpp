@@ -0,0 +1,515 @@
+/*____________________________________________________________________
+|
+| File: pick.cpp
+|
+| Description: Ray picking against a set of bounding spheres.  The
+|   spheres are binned into a uniform grid on the x,z plane (a sphere
+|   goes into every cell its bounds overlap) and a ray walks the grid
+|   one cell at a time from its origin.  The spheres in a cell are
+|   stored as separate x, y, z and radius squared arrays, padded to a
+|   multiple of 4 with spheres that can't be hit, and are tested 4 at
+|   a time with SSE using squared distances.
+|
+|   The walk stops as soon as the nearest hit so far is closer than
+|   the far side of the current cell.  Any closer hit would be in a
+|   cell already visited, and every sphere crossing that cell has been
+|   tested.
+|
+| Functions: Pick_Build
+|            Pick_Ray
+|             Test_Cell
+|            Pick_Get_Stats
+|            Pick_Free
+|            Pick_Benchmark
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+#include <math.h>
+#include <float.h>
+#include <emmintrin.h>
+
+#include "dp.h"
+
+#include "timer.h"
+#include "pick.h"
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static void Test_Cell (int cell, gx3dVector *origin, gx3dVector *direction, float *best, int *best_index);
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define MAX_CELLS (256*256)
+
+/*___________________
+|
+| Macros
+|__________________*/
+
+#define CLAMP(_v_,_lo_,_hi_) ((_v_) < (_lo_) ? (_lo_) : ((_v_) > (_hi_) ? (_hi_) : (_v_)))
+#define CELL_X(_x_)          CLAMP ((int)(((_x_) - grid_x) * inv_cell_size), 0, cells_x - 1)
+#define CELL_Z(_z_)          CLAMP ((int)(((_z_) - grid_z) * inv_cell_size), 0, cells_z - 1)
+
+/*___________________
+|
+| Global variables
+|__________________*/
+
+// Grid
+static float grid_x, grid_z;          // min corner
+static float cell_size, inv_cell_size;
+static int   cells_x = 0, cells_z = 0;
+static int  *cell_start = 0;          // entries of cell i are cell_start[i] to cell_start[i+1]-1
+static int  *cell_fill  = 0;
+static int   max_cells  = 0;
+
+// Entries
+static float *entry_x = 0, *entry_y = 0, *entry_z = 0;
+static float *entry_r2 = 0;           // radius squared (-FLT_MAX for padding)
+static int   *entry_index = 0;        // index of the sphere in the array given to Pick_Build()
+static int    max_entries = 0;
+
+static PickStats stats;
+
+/*____________________________________________________________________
+|
+| Function: Pick_Build
+|
+| Input: Called from Program_Run(), Pick_Benchmark()
+| Output: Builds the index from an array of spheres.
+|___________________________________________________________________*/
+
+void Pick_Build (
+  gx3dSphere    *spheres,
+  unsigned char *enabled,
+  int            count,
+  float          size )
+{
+  int i, x, z, x0, x1, z0, z1, cell, num_cells, total;
+  float min_x, min_z, max_x, max_z, r;
+  gx3dSphere *s;
+  double start;
+
+  start = Timer_Now_Ms ();
+  memset (&stats, 0, sizeof(stats));
+  cells_x = cells_z = 0;
+
+  // Bounds of the enabled spheres
+  min_x = min_z =  FLT_MAX;
+  max_x = max_z = -FLT_MAX;
+  for (i=0; i<count; i++) {
+    if (enabled AND (NOT enabled[i]))
+      continue;
+    s = &spheres[i];
+    if (s->center.x - s->radius < min_x) min_x = s->center.x - s->radius;
+    if (s->center.z - s->radius < min_z) min_z = s->center.z - s->radius;
+    if (s->center.x + s->radius > max_x) max_x = s->center.x + s->radius;
+    if (s->center.z + s->radius > max_z) max_z = s->center.z + s->radius;
+    stats.pickables++;
+  }
+  if (stats.pickables == 0) {
+    stats.build_ms = Timer_Elapsed_Ms (start);
+    return;
+  }
+
+  // Size the grid, using bigger cells if there would be too many
+  cell_size = size;
+  for (;;) {
+    cells_x = (int)((max_x - min_x) / cell_size) + 1;
+    cells_z = (int)((max_z - min_z) / cell_size) + 1;
+    if (cells_x * cells_z <= MAX_CELLS)
+      break;
+    cell_size *= 2;
+  }
+  inv_cell_size = 1 / cell_size;
+  grid_x = min_x;
+  grid_z = min_z;
+  num_cells = cells_x * cells_z;
+  if (num_cells > max_cells) {
+    cell_start = (int *) realloc (cell_start, (num_cells + 1) * sizeof(int));
+    cell_fill  = (int *) realloc (cell_fill,   num_cells      * sizeof(int));
+    max_cells  = num_cells;
+  }
+
+  // Count the entries in each cell
+  memset (cell_fill, 0, num_cells * sizeof(int));
+  for (i=0; i<count; i++) {
+    if (enabled AND (NOT enabled[i]))
+      continue;
+    s = &spheres[i];
+    x0 = CELL_X (s->center.x - s->radius);
+    x1 = CELL_X (s->center.x + s->radius);
+    z0 = CELL_Z (s->center.z - s->radius);
+    z1 = CELL_Z (s->center.z + s->radius);
+    for (z=z0; z<=z1; z++)
+      for (x=x0; x<=x1; x++)
+        cell_fill[z * cells_x + x]++;
+  }
+
+  // Counts to offsets, padding each cell to a multiple of 4
+  for (i=0, total=0; i<num_cells; i++) {
+    cell_start[i] = total;
+    total += (cell_fill[i] + 3) & ~3;
+    cell_fill[i] = cell_start[i];
+  }
+  cell_start[num_cells] = total;
+  if (total > max_entries) {
+    entry_x     = (float *) realloc (entry_x,     total * sizeof(float));
+    entry_y     = (float *) realloc (entry_y,     total * sizeof(float));
+    entry_z     = (float *) realloc (entry_z,     total * sizeof(float));
+    entry_r2    = (float *) realloc (entry_r2,    total * sizeof(float));
+    entry_index = (int *)   realloc (entry_index, total * sizeof(int));
+    max_entries = total;
+  }
+  // Padding can never be hit
+  for (i=0; i<total; i++) {
+    entry_x[i] = entry_y[i] = entry_z[i] = 0;
+    entry_r2[i]    = -FLT_MAX;
+    entry_index[i] = PICK_NONE;
+  }
+
+  // Fill the cells
+  for (i=0; i<count; i++) {
+    if (enabled AND (NOT enabled[i]))
+      continue;
+    s = &spheres[i];
+    r = s->radius * s->radius;
+    x0 = CELL_X (s->center.x - s->radius);
+    x1 = CELL_X (s->center.x + s->radius);
+    z0 = CELL_Z (s->center.z - s->radius);
+    z1 = CELL_Z (s->center.z + s->radius);
+    for (z=z0; z<=z1; z++)
+      for (x=x0; x<=x1; x++) {
+        cell = cell_fill[z * cells_x + x]++;
+        entry_x[cell]     = s->center.x;
+        entry_y[cell]     = s->center.y;
+        entry_z[cell]     = s->center.z;
+        entry_r2[cell]    = r;
+        entry_index[cell] = i;
+        stats.entries++;
+      }
+  }
+
+  stats.cells    = num_cells;
+  stats.build_ms = Timer_Elapsed_Ms (start);
+}
+
+/*____________________________________________________________________
+|
+| Function: Pick_Ray
+|
+| Input: Called from Program_Run(), Pick_Benchmark()
+| Output: Returns index of the nearest sphere hit by a ray within
+|   max_distance and the distance to the hit, or PICK_NONE.  A ray
+|   starting inside a sphere hits it at distance 0.
+|___________________________________________________________________*/
+
+int Pick_Ray (gx3dRay *ray, float max_distance, float *distance)
+{
+  int x, z, step_x, step_z, best_index;
+  float len, t0, t1, ta, tb, t_max_x, t_max_z, t_delta_x, t_delta_z, t_exit, best;
+  gx3dVector o, d;
+
+  stats.queries++;
+  if (cells_x == 0)
+    return (PICK_NONE);
+
+  o = ray->origin;
+  d = ray->direction;
+  len = sqrtf (d.x * d.x + d.y * d.y + d.z * d.z);
+  if (len == 0)
+    return (PICK_NONE);
+  d.x /= len;
+  d.y /= len;
+  d.z /= len;
+
+  // Clip the ray to the grid
+  t0 = 0;
+  t1 = max_distance;
+  if (d.x == 0) {
+    if ((o.x < grid_x) OR (o.x > grid_x + cells_x * cell_size))
+      return (PICK_NONE);
+  }
+  else {
+    ta = (grid_x - o.x) / d.x;
+    tb = (grid_x + cells_x * cell_size - o.x) / d.x;
+    if (ta > tb) { t_exit = ta; ta = tb; tb = t_exit; }
+    if (ta > t0) t0 = ta;
+    if (tb < t1) t1 = tb;
+  }
+  if (d.z == 0) {
+    if ((o.z < grid_z) OR (o.z > grid_z + cells_z * cell_size))
+      return (PICK_NONE);
+  }
+  else {
+    ta = (grid_z - o.z) / d.z;
+    tb = (grid_z + cells_z * cell_size - o.z) / d.z;
+    if (ta > tb) { t_exit = ta; ta = tb; tb = t_exit; }
+    if (ta > t0) t0 = ta;
+    if (tb < t1) t1 = tb;
+  }
+  if (t0 > t1)
+    return (PICK_NONE);
+
+  // Set up the walk from the cell the ray enters at t0
+  x = CELL_X (o.x + d.x * t0);
+  z = CELL_Z (o.z + d.z * t0);
+  if (d.x > 0) {
+    step_x    = 1;
+    t_max_x   = (grid_x + (x + 1) * cell_size - o.x) / d.x;
+    t_delta_x = cell_size / d.x;
+  }
+  else if (d.x < 0) {
+    step_x    = -1;
+    t_max_x   = (grid_x + x * cell_size - o.x) / d.x;
+    t_delta_x = -cell_size / d.x;
+  }
+  else {
+    step_x    = 0;
+    t_max_x   = t_delta_x = FLT_MAX;
+  }
+  if (d.z > 0) {
+    step_z    = 1;
+    t_max_z   = (grid_z + (z + 1) * cell_size - o.z) / d.z;
+    t_delta_z = cell_size / d.z;
+  }
+  else if (d.z < 0) {
+    step_z    = -1;
+    t_max_z   = (grid_z + z * cell_size - o.z) / d.z;
+    t_delta_z = -cell_size / d.z;
+  }
+  else {
+    step_z    = 0;
+    t_max_z   = t_delta_z = FLT_MAX;
+  }
+
+  best       = max_distance;
+  best_index = PICK_NONE;
+  for (;;) {
+    Test_Cell (z * cells_x + x, &o, &d, &best, &best_index);
+    stats.cells_visited++;
+    t_exit = (t_max_x < t_max_z) ? t_max_x : t_max_z;
+    if ((best <= t_exit) OR (t_exit >= t1))
+      break;
+    if (t_max_x < t_max_z) {
+      x += step_x;
+      t_max_x += t_delta_x;
+    }
+    else {
+      z += step_z;
+      t_max_z += t_delta_z;
+    }
+    if ((x < 0) OR (x >= cells_x) OR (z < 0) OR (z >= cells_z))
+      break;
+  }
+
+  if (best_index != PICK_NONE)
+    *distance = best;
+  return (best_index);
+}
+
+/*____________________________________________________________________
+|
+| Function: Test_Cell
+|
+| Input: Called from Pick_Ray()
+| Output: Tests the spheres in a cell 4 at a time, updating the nearest
+|   hit.  direction must be unit length.
+|___________________________________________________________________*/
+
+static void Test_Cell (int cell, gx3dVector *origin, gx3dVector *direction, float *best, int *best_index)
+{
+  int i, k, mask;
+  float t [4];
+  __m128 ox, oy, oz, dx, dy, dz, vbest, zero;
+  __m128 cx, cy, cz, b, c, disc, sq, t_near, hit;
+
+  ox    = _mm_set1_ps (origin->x);
+  oy    = _mm_set1_ps (origin->y);
+  oz    = _mm_set1_ps (origin->z);
+  dx    = _mm_set1_ps (direction->x);
+  dy    = _mm_set1_ps (direction->y);
+  dz    = _mm_set1_ps (direction->z);
+  vbest = _mm_set1_ps (*best);
+  zero  = _mm_setzero_ps ();
+
+  for (i=cell_start[cell]; i<cell_start[cell+1]; i+=4) {
+    // Origin to center, projected on the ray (b) and squared distance less radius squared (c)
+    cx = _mm_sub_ps (_mm_loadu_ps (&entry_x[i]), ox);
+    cy = _mm_sub_ps (_mm_loadu_ps (&entry_y[i]), oy);
+    cz = _mm_sub_ps (_mm_loadu_ps (&entry_z[i]), oz);
+    b  = _mm_add_ps (_mm_add_ps (_mm_mul_ps (cx, dx), _mm_mul_ps (cy, dy)), _mm_mul_ps (cz, dz));
+    c  = _mm_add_ps (_mm_add_ps (_mm_mul_ps (cx, cx), _mm_mul_ps (cy, cy)), _mm_mul_ps (cz, cz));
+    c  = _mm_sub_ps (c, _mm_loadu_ps (&entry_r2[i]));
+    disc = _mm_sub_ps (_mm_mul_ps (b, b), c);
+    hit  = _mm_cmpge_ps (disc, zero);
+    if (_mm_movemask_ps (hit) == 0)
+      continue;
+    // Hit if the far intersection is ahead of the origin and the near one is closer than the best so far
+    sq     = _mm_sqrt_ps (_mm_max_ps (disc, zero));
+    t_near = _mm_max_ps (_mm_sub_ps (b, sq), zero);
+    hit    = _mm_and_ps (hit, _mm_cmpge_ps (_mm_add_ps (b, sq), zero));
+    hit    = _mm_and_ps (hit, _mm_cmplt_ps (t_near, vbest));
+    mask   = _mm_movemask_ps (hit);
+    if (mask) {
+      _mm_storeu_ps (t, t_near);
+      for (k=0; k<4; k++)
+        if ((mask & (1 << k)) AND (t[k] < *best)) {
+          *best       = t[k];
+          *best_index = entry_index[i+k];
+        }
+      vbest = _mm_set1_ps (*best);
+    }
+  }
+  stats.spheres_tested += cell_start[cell+1] - cell_start[cell];
+}
+
+/*____________________________________________________________________
+|
+| Function: Pick_Get_Stats
+|
+| Input: Called from Program_Run()
+| Output: Returns statistics since the last call to Pick_Build().
+|___________________________________________________________________*/
+
+void Pick_Get_Stats (PickStats *pick_stats)
+{
+  *pick_stats = stats;
+}
+
+/*____________________________________________________________________
+|
+| Function: Pick_Free
+|
+| Input: Called from Program_Run(), Pick_Benchmark()
+| Output: Frees the index.
+|___________________________________________________________________*/
+
+void Pick_Free ()
+{
+  free (cell_start);
+  free (cell_fill);
+  free (entry_x);
+  free (entry_y);
+  free (entry_z);
+  free (entry_r2);
+  free (entry_index);
+  cell_start = cell_fill = 0;
+  entry_x = entry_y = entry_z = entry_r2 = 0;
+  entry_index = 0;
+  max_cells = max_entries = 0;
+  cells_x = cells_z = 0;
+}
+
+/*____________________________________________________________________
+|
+| Function: Pick_Benchmark
+|
+| Input: Called from Program_Run()
+| Output: Builds an index of 10,000 spheres spread over a 20,000 foot
+|   square and casts 1,000 rays through it, then casts the same rays
+|   against every sphere one at a time.  Writes both times and the #
+|   of rays where the results differ to the debug file.  Leaves the
+|   index empty.
+|___________________________________________________________________*/
+
+void Pick_Benchmark ()
+{
+  int i, j, n, num_rays, brute_hit, hits, mismatches;
+  int *grid_hits;
+  float grid_ms, brute_ms, dist, brute_dist, angle, len, b, c, disc, t;
+  char str [200];
+  gx3dSphere *spheres;
+  gx3dRay *rays;
+  gx3dVector d, oc;
+  double start;
+  PickStats build_stats;
+
+  n        = 10000;
+  num_rays = 1000;
+  spheres  = (gx3dSphere *) malloc (n * sizeof(gx3dSphere));
+  rays     = (gx3dRay *)    malloc (num_rays * sizeof(gx3dRay));
+  grid_hits = (int *)       malloc (num_rays * sizeof(int));
+  srand (1);
+  for (i=0; i<n; i++) {
+    spheres[i].center.x = (float)(rand () % 20000) - 10000;
+    spheres[i].center.y = (float)(rand () % 100);
+    spheres[i].center.z = (float)(rand () % 20000) - 10000;
+    spheres[i].radius   = (float)(10 + rand () % 30);
+  }
+  for (i=0; i<num_rays; i++) {
+    angle = (float)(rand () % 3600) * (3.14159265f / 1800);
+    rays[i].origin.x    = (float)(rand () % 20000) - 10000;
+    rays[i].origin.y    = 50;
+    rays[i].origin.z    = (float)(rand () % 20000) - 10000;
+    rays[i].direction.x = (float)cos (angle);
+    rays[i].direction.y = (float)(rand () % 100 - 50) / 1000;
+    rays[i].direction.z = (float)sin (angle);
+  }
+
+  // Grid
+  Pick_Build (spheres, 0, n, 200);
+  Pick_Get_Stats (&build_stats);
+  start = Timer_Now_Ms ();
+  for (i=0; i<num_rays; i++)
+    grid_hits[i] = Pick_Ray (&rays[i], 2000, &dist);
+  grid_ms = Timer_Elapsed_Ms (start);
+
+  // Every sphere
+  start = Timer_Now_Ms ();
+  hits = mismatches = 0;
+  for (i=0; i<num_rays; i++) {
+    d = rays[i].direction;
+    len = sqrtf (d.x * d.x + d.y * d.y + d.z * d.z);
+    d.x /= len;
+    d.y /= len;
+    d.z /= len;
+    brute_hit  = PICK_NONE;
+    brute_dist = 2000;
+    for (j=0; j<n; j++) {
+      oc.x = spheres[j].center.x - rays[i].origin.x;
+      oc.y = spheres[j].center.y - rays[i].origin.y;
+      oc.z = spheres[j].center.z - rays[i].origin.z;
+      b = oc.x * d.x + oc.y * d.y + oc.z * d.z;
+      c = oc.x * oc.x + oc.y * oc.y + oc.z * oc.z - spheres[j].radius * spheres[j].radius;
+      disc = b * b - c;
+      if ((disc < 0) OR (b + sqrtf (disc) < 0))
+        continue;
+      t = b - sqrtf (disc);
+      if (t < 0)
+        t = 0;
+      if (t < brute_dist) {
+        brute_dist = t;
+        brute_hit  = j;
+      }
+    }
+    if (brute_hit != PICK_NONE)
+      hits++;
+    if (brute_hit != grid_hits[i])
+      mismatches++;
+  }
+  brute_ms = Timer_Elapsed_Ms (start);
+
+  sprintf (str, "Picking: %d spheres, build %.3f ms (%d cells, %d entries), %d rays grid %.3f ms, every sphere %.3f ms, %d hits, %d mismatches",
+    n, build_stats.build_ms, build_stats.cells, build_stats.entries, num_rays, grid_ms, brute_ms, hits, mismatches);
+  debug_WriteFile (str);
+
+  free (spheres);
+  free (rays);
+  free (grid_hits);
+  Pick_Free ();
+}
@@ -0,0 +1,39 @@
+/*____________________________________________________________________
+|
+| File: pick.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+#define PICK_NONE -1
+
+// Statistics since the last call to Pick_Build()
+struct PickStats {
+  int   pickables;      // # of spheres in the index
+  int   cells;          // # of grid cells
+  int   entries;        // # of sphere entries in the cells (a sphere can be in more than one cell)
+  int   queries;        // # of calls to Pick_Ray()
+  int   cells_visited;
+  int   spheres_tested;
+  float build_ms;
+};
+
+// Builds the index from an array of spheres (spheres with enabled[i] == 0 are left out, enabled can be 0)
+void Pick_Build (
+  gx3dSphere    *spheres,
+  unsigned char *enabled,
+  int            count,
+  float          cell_size );   // size of a grid cell on the x,z plane
+
+// Returns index of the nearest sphere hit by a ray within max_distance and the distance to it, or PICK_NONE
+int Pick_Ray (gx3dRay *ray, float max_distance, float *distance);
+
+// Returns statistics since the last call to Pick_Build()
+void Pick_Get_Stats (PickStats *stats);
+
+// Frees the index
+void Pick_Free ();
+
+// Times building and querying an index of 10,000 spheres against a loop over every sphere and writes the results to the debug file
+void Pick_Benchmark ();
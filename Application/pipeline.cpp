@@ -0,0 +1,446 @@
+/*____________________________________________________________________
+|
+| File: pipeline.cpp
+|
+| Description: Two stage frame pipeline.  The simulation of frame N+1
+|   runs as a job while frame N is culled, recorded and drawn, so the
+|   two take as long as the longer of them rather than both.  Each
+|   frame is drawn from a snapshot of what the simulation produced for
+|   it, written only by the simulation and only read after it's done,
+|   so the stages share nothing else.  Two snapshots are used in turn:
+|   the one drawn and the one being simulated.  Pipeline_End_Frame()
+|   waits for the simulation before the next frame starts, so a third
+|   would never be used.
+|
+|   The first frame is simulated before it's drawn, and then again as a
+|   job, with its input used up, to be drawn by the second frame, so
+|   each snapshot is drawn once.
+|
+|   The cost is a frame of latency: input is simulated in one frame
+|   and drawn in the next.  The statistics measure it, as the time from
+|   the start of a frame's simulation to the end of the frame that
+|   draws it, along with the frame time.  Without overlap (or without
+|   job threads) each frame is simulated and then drawn, as before.
+|
+|   Pipeline_Benchmark() runs made up simulation and drawing loads
+|   through the pipeline both ways.  It uses only standard C++ threads
+|   and timing, so it can be run on its own (on Linux, say):
+|     g++ -O2 -std=c++14 -pthread -DPIPELINE_BENCHMARK_MAIN pipeline.cpp
+|       jobs.cpp timer.cpp
+|
+| Functions: Pipeline_Init
+|            Pipeline_Begin_Frame
+|             Sim_Job
+|             Simulate
+|            Pipeline_End_Frame
+|            Pipeline_Get_Stats
+|            Pipeline_Benchmark
+|             Bench_Run
+|             Bench_Sim
+|             Bench_Busy
+|             Bench_Work
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#ifdef _WIN32
+#include <first_header.h>
+#endif
+
+#include <chrono>
+#include <thread>
+
+#include "portable.h"
+
+#include "timer.h"
+#include "jobs.h"
+#include "pipeline.h"
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define BENCH_FRAMES        200
+#define BENCH_SIM_MS        4.0f    // simulating a frame
+#define BENCH_DRAW_MS       6.0f    // drawing one
+#define BENCH_DRAW_CPU_MS   2.0f    // of which the CPU is busy, when drawing waits on the GPU the rest of the time
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+struct Snapshot {
+  double             sim_start;   // when its simulation started
+  alignas(16) char   data [PIPELINE_MAX_SNAPSHOT];
+};
+
+// What the simulation job is given
+struct SimCall {
+  PipelineSimFunc  sim;
+  void            *data;
+  Snapshot        *snapshot;
+};
+
+// Everything about the pipeline between frames
+struct Pipeline {
+  Snapshot       snapshots [PIPELINE_SNAPSHOTS];
+  bool           overlap;
+  int            drawn;           // snapshot drawn this frame, -1 before the first frame
+  int            sim_snapshot;    // snapshot being simulated
+  bool           simulating;      // is the next frame being simulated now?
+  Job           *sim_job;
+  double         frame_start;
+  int            intervals, sims;
+  double         total_frame_ms, total_sim_ms, total_wait_ms, total_latency_ms;
+  PipelineStats  stats;
+};
+
+// What a benchmark frame does
+struct BenchLoad {
+  float  sim_ms, draw_cpu_ms, draw_wait_ms;
+};
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static void  Sim_Job (Job *job, void *data);
+static void  Simulate (SimCall *call);
+static void  Bench_Run (BenchLoad *load, bool overlap_sim, PipelineStats *bench_stats, float *ms);
+static void  Bench_Sim (void *data, void *snapshot);
+static void  Bench_Busy (float ms);
+static float Bench_Work (double n);
+
+/*___________________
+|
+| Global variables
+|__________________*/
+
+static Pipeline pl = { {}, false, -1, 0, false, 0, 0, 0, 0, 0, 0, 0, 0, {} };
+static double   bench_work_per_ms;   // Bench_Busy() work done in a ms
+
+/*____________________________________________________________________
+|
+| Function: Pipeline_Init
+|
+| Input: Called from Program_Run(), Bench_Run()
+| Output: Starts the pipeline.  Returns false if a snapshot won't fit.
+|___________________________________________________________________*/
+
+bool Pipeline_Init (unsigned snapshot_size, bool overlap_sim)
+{
+  if (snapshot_size > PIPELINE_MAX_SNAPSHOT)
+    return (false);
+
+  pl.overlap    = overlap_sim;
+  pl.drawn      = -1;
+  pl.simulating = false;
+  pl.intervals  = 0;
+  pl.sims       = 0;
+  pl.total_frame_ms = pl.total_sim_ms = pl.total_wait_ms = pl.total_latency_ms = 0;
+  memset (&pl.stats, 0, sizeof(pl.stats));
+
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: Pipeline_Begin_Frame
+|
+| Input: Called from Program_Run()
+| Output: Starts a job simulating the next frame into the snapshot not
+|   being drawn, and returns the one to draw.  If not overlapping,
+|   simulates the frame and returns that.  The first frame is simulated
+|   first as well, then the job is started for the second.
+|___________________________________________________________________*/
+
+void *Pipeline_Begin_Frame (PipelineSimFunc sim, void *data)
+{
+  SimCall call;
+  double now;
+
+  now = Timer_Now_Ms ();
+  if (pl.drawn != -1) {
+    pl.total_frame_ms += Timer_Elapsed_Ms (pl.frame_start);
+    pl.intervals++;
+  }
+  pl.frame_start = now;
+
+  call.sim  = sim;
+  call.data = data;
+
+  if (NOT pl.overlap OR (Jobs_Num_Threads () == 0)) {
+    pl.drawn = 0;
+    call.snapshot = &pl.snapshots[pl.drawn];
+    Simulate (&call);
+    return (pl.snapshots[pl.drawn].data);
+  }
+
+  // Nothing to draw yet
+  if (pl.drawn == -1) {
+    pl.drawn = 0;
+    call.snapshot = &pl.snapshots[pl.drawn];
+    Simulate (&call);
+  }
+
+  pl.sim_snapshot = (pl.drawn + 1) % PIPELINE_SNAPSHOTS;
+  call.snapshot = &pl.snapshots[pl.sim_snapshot];
+  pl.sim_job = Jobs_Create (Sim_Job, &call, sizeof(call), 0);
+  if (pl.sim_job)
+    Jobs_Submit (pl.sim_job);
+  else
+    Simulate (&call);
+  pl.simulating = true;
+
+  return (pl.snapshots[pl.drawn].data);
+}
+
+/*____________________________________________________________________
+|
+| Function: Sim_Job
+|
+| Input: Called from Jobs_Wait() and the job threads
+| Output: Simulates the next frame.
+|___________________________________________________________________*/
+
+static void Sim_Job (Job *, void *data)
+{
+  Simulate ((SimCall *)data);
+}
+
+/*____________________________________________________________________
+|
+| Function: Simulate
+|
+| Input: Called from Pipeline_Begin_Frame(), Sim_Job()
+| Output: Simulates a frame into a snapshot.
+|___________________________________________________________________*/
+
+static void Simulate (SimCall *call)
+{
+  call->snapshot->sim_start = Timer_Now_Ms ();
+  (*call->sim) (call->data, call->snapshot->data);
+  pl.total_sim_ms += Timer_Elapsed_Ms (call->snapshot->sim_start);
+  pl.sims++;
+}
+
+/*____________________________________________________________________
+|
+| Function: Pipeline_End_Frame
+|
+| Input: Called from Program_Run()
+| Output: Waits for the simulation of the next frame, if it's running,
+|   and makes it the one drawn next.
+|___________________________________________________________________*/
+
+void Pipeline_End_Frame ()
+{
+  float latency;
+  double start;
+
+  if (pl.drawn == -1)
+    return;
+
+  if (pl.sim_job) {
+    start = Timer_Now_Ms ();
+    Jobs_Wait (pl.sim_job);
+    pl.total_wait_ms += Timer_Elapsed_Ms (start);
+    pl.sim_job = 0;
+  }
+
+  // The frame just drawn
+  latency = Timer_Elapsed_Ms (pl.snapshots[pl.drawn].sim_start);
+  pl.total_latency_ms += latency;
+  if (latency > pl.stats.max_latency_ms)
+    pl.stats.max_latency_ms = latency;
+  pl.stats.frames++;
+
+  if (pl.simulating) {
+    pl.drawn = pl.sim_snapshot;
+    pl.simulating = false;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Pipeline_Get_Stats
+|
+| Input: Called from Program_Run()
+| Output: Returns statistics since Pipeline_Init().
+|___________________________________________________________________*/
+
+void Pipeline_Get_Stats (PipelineStats *pipeline_stats)
+{
+  pl.stats.overlapped = pl.overlap AND (Jobs_Num_Threads () > 0);
+  pl.stats.frame_ms   = pl.intervals ? (float)(pl.total_frame_ms / pl.intervals) : 0;
+  pl.stats.sim_ms     = pl.sims ? (float)(pl.total_sim_ms / pl.sims) : 0;
+  pl.stats.wait_ms    = pl.stats.frames ? (float)(pl.total_wait_ms / pl.stats.frames) : 0;
+  pl.stats.latency_ms = pl.stats.frames ? (float)(pl.total_latency_ms / pl.stats.frames) : 0;
+  *pipeline_stats = pl.stats;
+}
+
+/*____________________________________________________________________
+|
+| Function: Pipeline_Benchmark
+|
+| Input: Called from Program_Run(), main() (PIPELINE_BENCHMARK_MAIN)
+| Output: Runs BENCH_FRAMES frames of a made up simulation and drawing
+|   load through the pipeline, simulating then drawing each frame and
+|   then overlapping the two, and writes the frame time and latency of
+|   each.  Drawing keeps the CPU busy the whole time in one load and
+|   waits on the GPU most of the time in the other.  Needs a job thread
+|   to overlap, so starts one if there isn't.  Leaves the pipeline and
+|   the job threads as they were.
+|___________________________________________________________________*/
+
+void Pipeline_Benchmark (PipelineWriteFunc write)
+{
+  int i, old_threads;
+  float ms [2];
+  double start;
+  char str [300];
+  BenchLoad load [2];
+  PipelineStats bench_stats [2];
+  static Pipeline saved;
+
+  saved = pl;
+  // How much work takes a ms, so the loads are a fixed amount of work (and not a fixed time, which a thread
+  //  sharing a processor would still take up, doing less)
+  start = Timer_Now_Ms ();
+  Bench_Work (1e7);
+  bench_work_per_ms = 1e7 / Timer_Elapsed_Ms (start);
+  old_threads = Jobs_Num_Threads ();
+  if (old_threads < 2)
+    Jobs_Init (2);
+
+  load[0].sim_ms       = BENCH_SIM_MS;
+  load[0].draw_cpu_ms  = BENCH_DRAW_MS;
+  load[0].draw_wait_ms = 0;
+  load[1].sim_ms       = BENCH_SIM_MS;
+  load[1].draw_cpu_ms  = BENCH_DRAW_CPU_MS;
+  load[1].draw_wait_ms = BENCH_DRAW_MS - BENCH_DRAW_CPU_MS;
+
+  sprintf (str, "Pipeline benchmark: %d frames, %d processors, %d job threads", BENCH_FRAMES,
+    (int)std::thread::hardware_concurrency (), Jobs_Num_Threads ());
+  (*write) (str);
+  for (i=0; i<2; i++) {
+    Bench_Run (&load[i], false, &bench_stats[0], &ms[0]);
+    Bench_Run (&load[i], true, &bench_stats[1], &ms[1]);
+    sprintf (str, "Pipeline benchmark, %.0f ms simulation, %.0f ms drawing (CPU busy %.0f ms%s): "
+      "simulate then draw %.2f ms a frame (%.0f fps), latency %.2f ms (most %.2f); "
+      "overlapped %.2f ms a frame (%.0f fps), latency %.2f ms (most %.2f), waited %.2f ms",
+      load[i].sim_ms, load[i].draw_cpu_ms + load[i].draw_wait_ms,
+      load[i].draw_cpu_ms, load[i].draw_wait_ms > 0 ? ", then waiting on the GPU" : "",
+      ms[0], 1000 / ms[0], bench_stats[0].latency_ms, bench_stats[0].max_latency_ms,
+      ms[1], 1000 / ms[1], bench_stats[1].latency_ms, bench_stats[1].max_latency_ms, bench_stats[1].wait_ms);
+    (*write) (str);
+  }
+
+  if (old_threads == 0)
+    Jobs_Free ();
+  else if (old_threads < 2)
+    Jobs_Init (old_threads);
+  pl = saved;
+}
+
+/*____________________________________________________________________
+|
+| Function: Bench_Run
+|
+| Input: Called from Pipeline_Benchmark()
+| Output: Runs BENCH_FRAMES frames of load through the pipeline and
+|   returns its statistics and the mean frame time in *ms.
+|___________________________________________________________________*/
+
+static void Bench_Run (BenchLoad *load, bool overlap_sim, PipelineStats *bench_stats, float *ms)
+{
+  int frame;
+  double start;
+
+  Pipeline_Init (sizeof(int), overlap_sim);
+  start = Timer_Now_Ms ();
+  for (frame=0; frame<BENCH_FRAMES; frame++) {
+    Pipeline_Begin_Frame (Bench_Sim, load);
+    Bench_Busy (load->draw_cpu_ms);
+    if (load->draw_wait_ms > 0)
+      std::this_thread::sleep_for (std::chrono::microseconds ((int)(load->draw_wait_ms * 1000)));
+    Pipeline_End_Frame ();
+  }
+  *ms = Timer_Elapsed_Ms (start) / BENCH_FRAMES;
+  Pipeline_Get_Stats (bench_stats);
+}
+
+/*____________________________________________________________________
+|
+| Function: Bench_Sim
+|
+| Input: Called from Simulate()
+| Output: Keeps the CPU busy for as long as the load's simulation
+|   takes.
+|___________________________________________________________________*/
+
+static void Bench_Sim (void *data, void *snapshot)
+{
+  BenchLoad *load = (BenchLoad *)data;
+
+  Bench_Busy (load->sim_ms);
+  *(int *)snapshot = 1;
+}
+
+/*____________________________________________________________________
+|
+| Function: Bench_Busy
+|
+| Input: Called from Bench_Run(), Bench_Sim()
+| Output: Does ms worth of work.
+|___________________________________________________________________*/
+
+static void Bench_Busy (float ms)
+{
+  Bench_Work (ms * bench_work_per_ms);
+}
+
+/*____________________________________________________________________
+|
+| Function: Bench_Work
+|
+| Input: Called from Pipeline_Benchmark(), Bench_Busy()
+| Output: Does n steps of work the compiler can't remove.
+|___________________________________________________________________*/
+
+static float Bench_Work (double n)
+{
+  int i;
+  volatile float x = 1;
+
+  for (i=0; i<(int)n; i++)
+    x = x * 0.999f + 0.001f;
+
+  return (x);
+}
+
+#ifdef PIPELINE_BENCHMARK_MAIN
+
+static void Write_Line (const char *str)
+{
+  puts (str);
+}
+
+int main ()
+{
+  Jobs_Init (0);
+  Pipeline_Benchmark (Write_Line);
+  Jobs_Free ();
+  return (0);
+}
+
+#endif
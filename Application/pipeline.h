@@ -0,0 +1,45 @@
+/*____________________________________________________________________
+|
+| File: pipeline.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+#define PIPELINE_SNAPSHOTS     2      // the one drawn and the one being simulated
+#define PIPELINE_MAX_SNAPSHOT  1024   // bytes
+
+// Simulates a frame, writing what it's drawn from into snapshot (and nothing the renderer uses).  It should
+//  use up the input in data: on the first frame it's called twice with the same data.
+typedef void (*PipelineSimFunc) (void *data, void *snapshot);
+
+// Writes a line of benchmark results
+typedef void (*PipelineWriteFunc) (const char *str);
+
+// Statistics since Pipeline_Init()
+struct PipelineStats {
+  bool  overlapped;         // simulation runs while the frame before is drawn?
+  int   frames;
+  float frame_ms;           // mean time from one Pipeline_Begin_Frame() to the next
+  float sim_ms;             // mean time simulating a frame
+  float wait_ms;            // mean time Pipeline_End_Frame() waited for the simulation
+  float latency_ms;         // mean time from the start of a frame's simulation to the end of the frame drawing it
+  float max_latency_ms;
+};
+
+// Sets the size of a snapshot and whether the simulation of one frame overlaps the drawing of the frame before
+//  (on the job threads), returns false if the snapshot is too big
+bool Pipeline_Init (unsigned snapshot_size, bool overlap);
+
+// Starts simulating the next frame and returns the snapshot to draw now (the first frame is simulated first)
+void *Pipeline_Begin_Frame (PipelineSimFunc sim, void *data);
+
+// Call once the frame is drawn: waits for the simulation of the next one
+void Pipeline_End_Frame ();
+
+// Returns statistics since Pipeline_Init()
+void Pipeline_Get_Stats (PipelineStats *stats);
+
+// Times made up frames simulated then drawn against the two overlapped, writing the frame time and latency of
+//  each with write.  Leaves the pipeline and the job threads as they were.
+void Pipeline_Benchmark (PipelineWriteFunc write);
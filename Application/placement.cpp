@@ -0,0 +1,595 @@
+/*____________________________________________________________________
+|
+| File: placement.cpp
+|
+| Description: Procedural placement of objects with a blue noise
+|   (Poisson disk) distribution: points are spread randomly but no two
+|   are closer than a minimum distance, so there are no clumps or
+|   gaps.  Points can be kept inside a polygon and out of exclusion
+|   zones.
+|
+|   Uses a background grid with cells small enough to hold at most one
+|   point (Bridson's algorithm, with the candidates around an active
+|   point spaced evenly just beyond the min distance, which packs the
+|   points more densely with fewer tries).  The grid is split into square tiles
+|   that are filled in 4 phases in a 2x2 checkerboard order.  Tiles in
+|   the same phase never touch each other, so they can be filled by
+|   different threads at the same time without locking.  Each tile has
+|   its own random number generator seeded from the seed and the tile
+|   position and the points are read out of the grid in cell order, so
+|   the result doesn't depend on the # of threads or their timing.
+|
+| Functions: Placement_Generate
+|             Tile_Thread
+|             Fill_Tile
+|             Try_Point
+|             Inside_Polygon
+|             Segment_Distance2
+|            Placement_Get_Stats
+|            Placement_Benchmark
+|             Random
+|             Random_Float
+|             Hash_Seed
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+#include <math.h>
+
+#include "dp.h"
+
+#include "timer.h"
+#include "placement.h"
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+// Grid cell, holds at most one point
+struct Cell {
+  float x, z;
+  int   used;
+};
+
+// State shared by all threads during a call to Placement_Generate()
+struct Context {
+  PlacementRegion    *region;
+  PlacementExclusion *exclusions;
+  int                 num_exclusions;
+  unsigned            seed;
+  float               r, r2;              // min distance and min distance squared
+  float               cell_size;
+  float               inv_cell_size;
+  int                 grid_w, grid_h;     // in cells
+  int                 stride;             // cells per row, including a border of 2 empty cells all around
+  Cell               *cell;
+  int                 tiles_w, tiles_h;
+  int                *phase_tile;         // tiles of the current phase
+  int                 num_phase_tiles;
+  volatile long       next_tile;          // next entry in phase_tile[] to fill
+};
+
+// Bounds of the tile being filled
+struct Tile {
+  int   cx0, cz0, cx1, cz1;               // cells
+  float x0, z0, x1, z1;                   // world
+  int   num_exclusions;
+  int   exclusion [64];                   // exclusions that touch the tile
+  bool  all_exclusions;                   // too many to list, test them all
+};
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static DWORD WINAPI Tile_Thread (LPVOID param);
+static void  Fill_Tile (Context *ctx, int tile);
+static bool  Try_Point (Context *ctx, Tile *t, float x, float z);
+static bool  Inside_Polygon (PlacementRegion *region, float x, float z);
+static float Segment_Distance2 (PlacementExclusion *e, float x, float z);
+static unsigned Random (unsigned *state);
+static float Random_Float (unsigned *state);
+static unsigned Hash_Seed (unsigned seed, int x, int z);
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define TILE_CELLS      16  // tile width in cells - must be at least 3 so a tile only reads its direct neighbors
+#define CANDIDATES      12  // tries around an active point before it is retired
+#define DART_TRIES      8   // failed random tries before a tile is considered full
+
+#define PI 3.14159265f
+
+#define BORDER 2    // empty cells around the grid so neighbor searches need no bounds checks
+
+/*___________________
+|
+| Macros
+|__________________*/
+
+#define CELL_INDEX(_ctx_,_cx_,_cz_) (((_cz_) + BORDER) * (_ctx_)->stride + (_cx_) + BORDER)
+
+/*___________________
+|
+| Global variables
+|__________________*/
+
+static PlacementStats stats;
+static int            max_threads = PLACEMENT_MAX_THREADS;
+
+/*____________________________________________________________________
+|
+| Function: Placement_Generate
+|
+| Input: Called from Program_Run(), Placement_Benchmark()
+| Output: Fills a region with blue noise points.  Returns # of points
+|   and a malloc'd array of them in *points (NULL if none).
+|___________________________________________________________________*/
+
+int Placement_Generate (
+  PlacementRegion    *region,
+  float               min_distance,
+  unsigned            seed,
+  PlacementExclusion *exclusions,
+  int                 num_exclusions,
+  float               y,
+  gx3dVector        **points )
+{
+  int i, n, phase, tx, tz, num_threads;
+  HANDLE thread [PLACEMENT_MAX_THREADS];
+  SYSTEM_INFO info;
+  double start;
+  Cell *c;
+  Context ctx;
+
+  memset (&stats, 0, sizeof(stats));
+  *points = NULL;
+  if ((min_distance <= 0) OR (region->max_x <= region->min_x) OR (region->max_z <= region->min_z))
+    return (0);
+
+  start = Timer_Now_Ms ();
+
+  memset (&ctx, 0, sizeof(ctx));
+  ctx.region         = region;
+  ctx.exclusions     = exclusions;
+  ctx.num_exclusions = num_exclusions;
+  ctx.seed           = seed;
+  ctx.r              = min_distance;
+  ctx.r2             = min_distance * min_distance;
+  ctx.cell_size      = min_distance / (float)sqrt (2.0);
+  ctx.inv_cell_size  = 1 / ctx.cell_size;
+  ctx.grid_w         = (int)ceil ((region->max_x - region->min_x) / ctx.cell_size);
+  ctx.grid_h         = (int)ceil ((region->max_z - region->min_z) / ctx.cell_size);
+  ctx.stride         = ctx.grid_w + 2 * BORDER;
+  ctx.cell           = (Cell *) calloc (ctx.stride * (ctx.grid_h + 2 * BORDER), sizeof(Cell));
+  ctx.tiles_w        = (ctx.grid_w + TILE_CELLS - 1) / TILE_CELLS;
+  ctx.tiles_h        = (ctx.grid_h + TILE_CELLS - 1) / TILE_CELLS;
+  ctx.phase_tile     = (int *) malloc (ctx.tiles_w * ctx.tiles_h * sizeof(int));
+
+  GetSystemInfo (&info);
+
+  // Fill tiles with even x and even z, then odd x even z, ...
+  for (phase=0; phase<4; phase++) {
+    ctx.num_phase_tiles = 0;
+    for (tz=phase/2; tz<ctx.tiles_h; tz+=2)
+      for (tx=phase%2; tx<ctx.tiles_w; tx+=2)
+        ctx.phase_tile[ctx.num_phase_tiles++] = tz * ctx.tiles_w + tx;
+    ctx.next_tile = 0;
+
+    num_threads = (int)info.dwNumberOfProcessors;
+    if (num_threads > max_threads)
+      num_threads = max_threads;
+    if (num_threads > ctx.num_phase_tiles)
+      num_threads = ctx.num_phase_tiles;
+    if (num_threads < 1)
+      num_threads = 1;
+
+    // This thread is one of the workers
+    n = 0;
+    for (i=1; i<num_threads; i++) {
+      thread[n] = CreateThread (NULL, 0, Tile_Thread, &ctx, 0, NULL);
+      if (thread[n])
+        n++;
+    }
+    Tile_Thread (&ctx);
+    if (n) {
+      WaitForMultipleObjects (n, thread, TRUE, INFINITE);
+      for (i=0; i<n; i++)
+        CloseHandle (thread[i]);
+    }
+    if (stats.threads < n + 1)
+      stats.threads = n + 1;
+  }
+
+  // Read the points out in cell order
+  n = 0;
+  for (tz=0; tz<ctx.grid_h; tz++)
+    for (tx=0, c=&ctx.cell[CELL_INDEX(&ctx,0,tz)]; tx<ctx.grid_w; tx++, c++)
+      n += c->used;
+  if (n) {
+    *points = (gx3dVector *) malloc (n * sizeof(gx3dVector));
+    n = 0;
+    for (tz=0; tz<ctx.grid_h; tz++)
+      for (tx=0, c=&ctx.cell[CELL_INDEX(&ctx,0,tz)]; tx<ctx.grid_w; tx++, c++)
+        if (c->used) {
+          (*points)[n].x = c->x;
+          (*points)[n].y = y;
+          (*points)[n].z = c->z;
+          n++;
+        }
+  }
+
+  free (ctx.cell);
+  free (ctx.phase_tile);
+
+  stats.points = n;
+  stats.tiles  = ctx.tiles_w * ctx.tiles_h;
+  stats.ms     = Timer_Elapsed_Ms (start);
+
+  return (n);
+}
+
+/*____________________________________________________________________
+|
+| Function: Tile_Thread
+|
+| Input: Called from Placement_Generate() (directly and as a thread)
+| Output: Fills tiles of the current phase until there are none left.
+|___________________________________________________________________*/
+
+static DWORD WINAPI Tile_Thread (LPVOID param)
+{
+  int i;
+  Context *ctx = (Context *)param;
+
+  for (;;) {
+    i = (int)InterlockedIncrement (&ctx->next_tile) - 1;
+    if (i >= ctx->num_phase_tiles)
+      break;
+    Fill_Tile (ctx, ctx->phase_tile[i]);
+  }
+
+  return (0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Fill_Tile
+|
+| Input: Called from Tile_Thread()
+| Output: Fills one tile with points, growing outward from random
+|   starting points until no more fit.
+|___________________________________________________________________*/
+
+static void Fill_Tile (Context *ctx, int tile)
+{
+  int i, j, k, misses, num_active;
+  int active [TILE_CELLS * TILE_CELLS];
+  unsigned rnd;
+  float x, z, dx, dz, t, d, step_cos, step_sin;
+  PlacementExclusion *e;
+  Tile bounds;
+
+  // Tile bounds
+  bounds.cx0 = (tile % ctx->tiles_w) * TILE_CELLS;
+  bounds.cz0 = (tile / ctx->tiles_w) * TILE_CELLS;
+  bounds.cx1 = bounds.cx0 + TILE_CELLS;
+  bounds.cz1 = bounds.cz0 + TILE_CELLS;
+  if (bounds.cx1 > ctx->grid_w)
+    bounds.cx1 = ctx->grid_w;
+  if (bounds.cz1 > ctx->grid_h)
+    bounds.cz1 = ctx->grid_h;
+  bounds.x0 = ctx->region->min_x + bounds.cx0 * ctx->cell_size;
+  bounds.z0 = ctx->region->min_z + bounds.cz0 * ctx->cell_size;
+  bounds.x1 = ctx->region->min_x + bounds.cx1 * ctx->cell_size;
+  bounds.z1 = ctx->region->min_z + bounds.cz1 * ctx->cell_size;
+  if (bounds.x1 > ctx->region->max_x)
+    bounds.x1 = ctx->region->max_x;
+  if (bounds.z1 > ctx->region->max_z)
+    bounds.z1 = ctx->region->max_z;
+
+  // List the exclusions that reach into this tile
+  bounds.num_exclusions = 0;
+  bounds.all_exclusions = false;
+  for (i=0; (i<ctx->num_exclusions) AND (NOT bounds.all_exclusions); i++) {
+    e = &ctx->exclusions[i];
+    if ((((e->x0 < e->x1) ? e->x0 : e->x1) - e->radius > bounds.x1) OR
+        (((e->x0 > e->x1) ? e->x0 : e->x1) + e->radius < bounds.x0) OR
+        (((e->z0 < e->z1) ? e->z0 : e->z1) - e->radius > bounds.z1) OR
+        (((e->z0 > e->z1) ? e->z0 : e->z1) + e->radius < bounds.z0))
+      continue;
+    if (bounds.num_exclusions == (int)(sizeof(bounds.exclusion) / sizeof(bounds.exclusion[0])))
+      bounds.all_exclusions = true;
+    else
+      bounds.exclusion[bounds.num_exclusions++] = i;
+  }
+
+  // Rotation between candidates
+  step_cos = (float)cos (2 * PI / CANDIDATES);
+  step_sin = (float)sin (2 * PI / CANDIDATES);
+  d = ctx->r * 1.0001f;
+
+  rnd = Hash_Seed (ctx->seed, tile % ctx->tiles_w, tile / ctx->tiles_w);
+
+  num_active = 0;
+  for (misses=0; misses<DART_TRIES; ) {
+    // Throw a dart anywhere in the tile
+    x = bounds.x0 + Random_Float (&rnd) * (bounds.x1 - bounds.x0);
+    z = bounds.z0 + Random_Float (&rnd) * (bounds.z1 - bounds.z0);
+    if (NOT Try_Point (ctx, &bounds, x, z)) {
+      misses++;
+      continue;
+    }
+    misses = 0;
+    active[num_active++] = CELL_INDEX (ctx, (int)((x - ctx->region->min_x) * ctx->inv_cell_size),
+                                            (int)((z - ctx->region->min_z) * ctx->inv_cell_size));
+
+    // Grow from the active points
+    while (num_active) {
+      j = (int)(Random (&rnd) % (unsigned)num_active);
+      // Random direction to start from
+      do {
+        dx = Random_Float (&rnd) * 2 - 1;
+        dz = Random_Float (&rnd) * 2 - 1;
+        t = dx*dx + dz*dz;
+      } while ((t > 1) OR (t < 0.01f));
+      t = d / (float)sqrt (t);
+      dx *= t;
+      dz *= t;
+      for (k=0; k<CANDIDATES; k++) {
+        x = ctx->cell[active[j]].x + dx;
+        z = ctx->cell[active[j]].z + dz;
+        t  = dx * step_cos - dz * step_sin;
+        dz = dx * step_sin + dz * step_cos;
+        dx = t;
+        if (Try_Point (ctx, &bounds, x, z)) {
+          active[num_active++] = CELL_INDEX (ctx, (int)((x - ctx->region->min_x) * ctx->inv_cell_size),
+                                                  (int)((z - ctx->region->min_z) * ctx->inv_cell_size));
+          break;
+        }
+      }
+      // Nothing fits around this point any more?
+      if (k == CANDIDATES)
+        active[j] = active[--num_active];
+    }
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Try_Point
+|
+| Input: Called from Fill_Tile()
+| Output: Adds a point to the grid and returns true if it is in the
+|   tile, in the region, clear of exclusions and not too close to any
+|   other point.
+|___________________________________________________________________*/
+
+static bool Try_Point (Context *ctx, Tile *t, float x, float z)
+{
+  int i, n, cx, cz, gx, gz;
+  float dx, dz;
+  Cell *c, *p;
+  PlacementExclusion *e;
+
+  if ((x < t->x0) OR (x >= t->x1) OR (z < t->z0) OR (z >= t->z1))
+    return (false);
+  cx = (int)((x - ctx->region->min_x) * ctx->inv_cell_size);
+  cz = (int)((z - ctx->region->min_z) * ctx->inv_cell_size);
+  // Rounding can put a point on the tile edge in the next cell over
+  if ((cx < t->cx0) OR (cx >= t->cx1) OR (cz < t->cz0) OR (cz >= t->cz1))
+    return (false);
+
+  c = &ctx->cell[CELL_INDEX (ctx, cx, cz)];
+  if (c->used)
+    return (false);
+
+  // Any point within min distance is at most 2 cells away, but not in the corner cells
+  for (gz=-2; gz<=2; gz++) {
+    n = ((gz == -2) OR (gz == 2)) ? 1 : 2;
+    p = c + gz * ctx->stride - n;
+    for (gx=-n; gx<=n; gx++, p++) {
+      if (p->used) {
+        dx = p->x - x;
+        dz = p->z - z;
+        if (dx*dx + dz*dz < ctx->r2)
+          return (false);
+      }
+    }
+  }
+
+  if (t->all_exclusions) {
+    for (i=0; i<ctx->num_exclusions; i++) {
+      e = &ctx->exclusions[i];
+      if (Segment_Distance2 (e, x, z) < e->radius * e->radius)
+        return (false);
+    }
+  }
+  else {
+    for (i=0; i<t->num_exclusions; i++) {
+      e = &ctx->exclusions[t->exclusion[i]];
+      if (Segment_Distance2 (e, x, z) < e->radius * e->radius)
+        return (false);
+    }
+  }
+
+  if (ctx->region->num_vertices AND (NOT Inside_Polygon (ctx->region, x, z)))
+    return (false);
+
+  c->x    = x;
+  c->z    = z;
+  c->used = 1;
+
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: Inside_Polygon
+|
+| Input: Called from Try_Point()
+| Output: Returns true if x,z is inside the region polygon (even-odd
+|   rule).
+|___________________________________________________________________*/
+
+static bool Inside_Polygon (PlacementRegion *region, float x, float z)
+{
+  int i, j;
+  bool inside;
+  gx3dVector *a, *b;
+
+  inside = false;
+  for (i=0, j=region->num_vertices-1; i<region->num_vertices; j=i++) {
+    a = &region->polygon[i];
+    b = &region->polygon[j];
+    if (((a->z > z) != (b->z > z)) AND
+        (x < (b->x - a->x) * (z - a->z) / (b->z - a->z) + a->x))
+      inside = NOT inside;
+  }
+
+  return (inside);
+}
+
+/*____________________________________________________________________
+|
+| Function: Segment_Distance2
+|
+| Input: Called from Try_Point()
+| Output: Returns squared distance from x,z to an exclusion segment.
+|___________________________________________________________________*/
+
+static float Segment_Distance2 (PlacementExclusion *e, float x, float z)
+{
+  float dx, dz, len2, t;
+
+  dx = e->x1 - e->x0;
+  dz = e->z1 - e->z0;
+  len2 = dx*dx + dz*dz;
+  t = 0;
+  if (len2 > 0) {
+    t = ((x - e->x0) * dx + (z - e->z0) * dz) / len2;
+    if (t < 0)
+      t = 0;
+    else if (t > 1)
+      t = 1;
+  }
+  dx = e->x0 + t * dx - x;
+  dz = e->z0 + t * dz - z;
+
+  return (dx*dx + dz*dz);
+}
+
+/*____________________________________________________________________
+|
+| Function: Placement_Get_Stats
+|
+| Input: Called from ____
+| Output: Returns statistics for the last call to Placement_Generate().
+|___________________________________________________________________*/
+
+void Placement_Get_Stats (PlacementStats *placement_stats)
+{
+  *placement_stats = stats;
+}
+
+/*____________________________________________________________________
+|
+| Function: Placement_Benchmark
+|
+| Input: Called from Program_Run()
+| Output: Generates 100,000+ points single threaded and multithreaded,
+|   checks both give the same points and writes the times to the debug
+|   file.
+|___________________________________________________________________*/
+
+void Placement_Benchmark ()
+{
+  int n1, n2;
+  bool same;
+  char str [200];
+  gx3dVector *p1, *p2;
+  PlacementStats s1, s2;
+  PlacementRegion region = { -10000, -10000, 10000, 10000, 0, NULL };
+  PlacementExclusion exclusion = { -5000, 0, 5000, 0, 500 };
+
+  max_threads = 1;
+  n1 = Placement_Generate (&region, 50, 2013, &exclusion, 1, 0, &p1);
+  s1 = stats;
+  max_threads = PLACEMENT_MAX_THREADS;
+  n2 = Placement_Generate (&region, 50, 2013, &exclusion, 1, 0, &p2);
+  s2 = stats;
+
+  same = (n1 == n2) AND ((n1 == 0) OR (memcmp (p1, p2, n1 * sizeof(gx3dVector)) == 0));
+  sprintf (str, "Placement: %d points, %d tiles, 1 thread %.2f ms, %d threads %.2f ms, results %s",
+    n2, s2.tiles, s1.ms, s2.threads, s2.ms, same ? "match" : "DIFFER");
+  debug_WriteFile (str);
+
+  free (p1);
+  free (p2);
+}
+
+/*____________________________________________________________________
+|
+| Function: Random
+|
+| Input: Called from Fill_Tile()
+| Output: Returns next value of a xorshift generator.
+|___________________________________________________________________*/
+
+static unsigned Random (unsigned *state)
+{
+  unsigned x = *state;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+
+  return (x);
+}
+
+/*____________________________________________________________________
+|
+| Function: Random_Float
+|
+| Input: Called from Fill_Tile()
+| Output: Returns a random value in [0,1).
+|___________________________________________________________________*/
+
+static float Random_Float (unsigned *state)
+{
+  return ((float)(Random (state) >> 8) * (1.0f / 16777216));
+}
+
+/*____________________________________________________________________
+|
+| Function: Hash_Seed
+|
+| Input: Called from Fill_Tile()
+| Output: Returns a (non-zero) generator seed for a tile.
+|___________________________________________________________________*/
+
+static unsigned Hash_Seed (unsigned seed, int x, int z)
+{
+  unsigned h;
+
+  h = seed ^ ((unsigned)x * 0x9E3779B1u) ^ ((unsigned)z * 0x85EBCA77u);
+  h ^= h >> 16;
+  h *= 0x7FEB352Du;
+  h ^= h >> 15;
+  h *= 0x846CA68Bu;
+  h ^= h >> 16;
+
+  return (h ? h : 1);
+}
@@ -0,0 +1,49 @@
+/*____________________________________________________________________
+|
+| File: placement.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+#define PLACEMENT_MAX_THREADS 16
+
+// Area to fill: a rectangle on the x,z plane, optionally trimmed to a polygon inside it
+struct PlacementRegion {
+  float       min_x, min_z;
+  float       max_x, max_z;
+  int         num_vertices; // 0 to fill the whole rectangle
+  gx3dVector *polygon;      // x,z of each polygon vertex (y is ignored)
+};
+
+// Area to keep clear: a line segment on the x,z plane with a radius (a circle if both ends are the same)
+struct PlacementExclusion {
+  float x0, z0;
+  float x1, z1;
+  float radius;
+};
+
+// Statistics for the last call to Placement_Generate()
+struct PlacementStats {
+  int   points;
+  int   tiles;
+  int   threads;
+  float ms;
+};
+
+// Fills a region with points no closer than min_distance to each other (blue noise).  The same
+//  inputs always give the same points.  Returns # of points and a malloc'd array in *points.
+int Placement_Generate (
+  PlacementRegion    *region,
+  float               min_distance,
+  unsigned            seed,
+  PlacementExclusion *exclusions,
+  int                 num_exclusions,
+  float               y,            // y of every point
+  gx3dVector        **points );     // caller frees with free()
+
+// Returns statistics for the last call to Placement_Generate()
+void Placement_Get_Stats (PlacementStats *stats);
+
+// Times generating 100,000+ points and writes the results to the debug file
+void Placement_Benchmark ();
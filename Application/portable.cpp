@@ -0,0 +1,214 @@
+/*____________________________________________________________________
+|
+| File: portable.cpp
+|
+| Description: The gx3d functions declared in portable.h, for builds
+|   without Windows and the gx toolkit (see headless.cpp).  They work
+|   the way gx3d's do: matrices are row major and transform row vectors
+|   (Direct3D style), and view space is left handed with +z forward.
+|   On Windows the real ones are used and this file is empty.
+|
+| Functions: gx3d_GetIdentityMatrix
+|            gx3d_GetScaleMatrix
+|            gx3d_GetTranslateMatrix
+|            gx3d_MultiplyMatrix
+|            gx3d_MultiplyVectorMatrix
+|            gx3d_ComputeViewMatrix
+|             Normalize
+|             Cross
+|            debug_WriteFile
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+#ifndef _WIN32
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include "portable.h"
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static void Normalize (gx3dVector *v);
+static void Cross (gx3dVector *a, gx3dVector *b, gx3dVector *result);
+
+/*____________________________________________________________________
+|
+| Function: gx3d_GetIdentityMatrix
+|
+| Input: Called from anywhere
+| Output: Sets m to the identity matrix.
+|___________________________________________________________________*/
+
+void gx3d_GetIdentityMatrix (gx3dMatrix *m)
+{
+  memset (m, 0, sizeof(gx3dMatrix));
+  m->_00 = m->_11 = m->_22 = m->_33 = 1;
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_GetScaleMatrix
+|
+| Input: Called from anywhere
+| Output: Sets m to a scale matrix.
+|___________________________________________________________________*/
+
+void gx3d_GetScaleMatrix (gx3dMatrix *m, float x, float y, float z)
+{
+  gx3d_GetIdentityMatrix (m);
+  m->_00 = x;
+  m->_11 = y;
+  m->_22 = z;
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_GetTranslateMatrix
+|
+| Input: Called from anywhere
+| Output: Sets m to a translation matrix.
+|___________________________________________________________________*/
+
+void gx3d_GetTranslateMatrix (gx3dMatrix *m, float x, float y, float z)
+{
+  gx3d_GetIdentityMatrix (m);
+  m->_30 = x;
+  m->_31 = y;
+  m->_32 = z;
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_MultiplyMatrix
+|
+| Input: Called from anywhere
+| Output: result = a * b (a's transform, then b's).  result may be a
+|   or b.
+|___________________________________________________________________*/
+
+void gx3d_MultiplyMatrix (gx3dMatrix *a, gx3dMatrix *b, gx3dMatrix *result)
+{
+  int i, j, k;
+  float *pa, *pb, *pr;
+  gx3dMatrix r;
+
+  pa = &a->_00;
+  pb = &b->_00;
+  pr = &r._00;
+  for (i=0; i<4; i++)
+    for (j=0; j<4; j++) {
+      pr[i*4+j] = 0;
+      for (k=0; k<4; k++)
+        pr[i*4+j] += pa[i*4+k] * pb[k*4+j];
+    }
+  *result = r;
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_MultiplyVectorMatrix
+|
+| Input: Called from anywhere
+| Output: result = v * m, with v a point (w = 1).  result may be v.
+|___________________________________________________________________*/
+
+void gx3d_MultiplyVectorMatrix (gx3dVector *v, gx3dMatrix *m, gx3dVector *result)
+{
+  gx3dVector r;
+
+  r.x = v->x * m->_00 + v->y * m->_10 + v->z * m->_20 + m->_30;
+  r.y = v->x * m->_01 + v->y * m->_11 + v->z * m->_21 + m->_31;
+  r.z = v->x * m->_02 + v->y * m->_12 + v->z * m->_22 + m->_32;
+  *result = r;
+}
+
+/*____________________________________________________________________
+|
+| Function: gx3d_ComputeViewMatrix
+|
+| Input: Called from anywhere
+| Output: Sets m to the view matrix of a camera at from looking at to,
+|   with world_up as close to up as it can be.
+|___________________________________________________________________*/
+
+void gx3d_ComputeViewMatrix (gx3dMatrix *m, gx3dVector *from, gx3dVector *to, gx3dVector *world_up)
+{
+  gx3dVector x, y, z;
+
+  z.x = to->x - from->x;
+  z.y = to->y - from->y;
+  z.z = to->z - from->z;
+  Normalize (&z);
+  Cross (world_up, &z, &x);
+  Normalize (&x);
+  Cross (&z, &x, &y);
+
+  m->_00 = x.x;  m->_01 = y.x;  m->_02 = z.x;  m->_03 = 0;
+  m->_10 = x.y;  m->_11 = y.y;  m->_12 = z.y;  m->_13 = 0;
+  m->_20 = x.z;  m->_21 = y.z;  m->_22 = z.z;  m->_23 = 0;
+  m->_30 = -(x.x * from->x + x.y * from->y + x.z * from->z);
+  m->_31 = -(y.x * from->x + y.y * from->y + y.z * from->z);
+  m->_32 = -(z.x * from->x + z.y * from->y + z.z * from->z);
+  m->_33 = 1;
+}
+
+/*____________________________________________________________________
+|
+| Function: Normalize
+|
+| Input: Called from gx3d_ComputeViewMatrix()
+| Output: Makes v unit length (if it has any length).
+|___________________________________________________________________*/
+
+static void Normalize (gx3dVector *v)
+{
+  float length;
+
+  length = sqrtf (v->x * v->x + v->y * v->y + v->z * v->z);
+  if (length > 0) {
+    v->x /= length;
+    v->y /= length;
+    v->z /= length;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Cross
+|
+| Input: Called from gx3d_ComputeViewMatrix()
+| Output: result = a x b.
+|___________________________________________________________________*/
+
+static void Cross (gx3dVector *a, gx3dVector *b, gx3dVector *result)
+{
+  gx3dVector r;
+
+  r.x = a->y * b->z - a->z * b->y;
+  r.y = a->z * b->x - a->x * b->z;
+  r.z = a->x * b->y - a->y * b->x;
+  *result = r;
+}
+
+/*____________________________________________________________________
+|
+| Function: debug_WriteFile
+|
+| Input: Called from anywhere
+| Output: Writes a line to stdout (gx's writes to the debug file).
+|___________________________________________________________________*/
+
+void debug_WriteFile (const char *str)
+{
+  printf ("%s\n", str);
+}
+
+#endif
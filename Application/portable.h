@@ -0,0 +1,121 @@
+/*____________________________________________________________________
+|
+| File: portable.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+// Modules that don't need Windows or a gx3d device (the render front end, the null and software backends,
+//  the LWO2 reader) include this in place of dp.h.  On Windows it is dp.h.  Anywhere else it declares the
+//  gx3d types those modules use and the few gx3d math functions they call, done in portable.cpp.
+
+#ifdef _WIN32
+
+#include "dp.h"
+
+#else
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/*___________________
+|
+| Defines
+|__________________*/
+
+#define OR  ||
+#define AND &&
+#define NOT !
+
+#define gx3d_LIGHT_TYPE_DIRECTION 0
+#define gx3d_LIGHT_TYPE_POINT     1
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+struct gxColor {
+  unsigned char r, g, b, a;
+};
+
+struct gxRectangle {
+  int xleft, ytop, xright, ybottom;
+};
+
+struct gx3dVector {
+  float x, y, z;
+};
+
+// Row vectors, so a point is transformed by v * m
+struct gx3dMatrix {
+  float _00, _01, _02, _03;
+  float _10, _11, _12, _13;
+  float _20, _21, _22, _23;
+  float _30, _31, _32, _33;
+};
+
+struct gx3dSphere {
+  gx3dVector center;
+  float      radius;
+};
+
+struct gx3dBox {
+  gx3dVector min, max;
+};
+
+struct gx3dColor {
+  float r, g, b, a;
+};
+
+struct gx3dMaterialData {
+  gx3dColor ambient, diffuse, specular, emissive;
+  float     specular_sharpness;
+};
+
+struct gx3dLightData {
+  int light_type;
+  struct {
+    gx3dColor  diffuse_color, specular_color, ambient_color;
+    gx3dVector dst;
+  } direction;
+  struct {
+    gx3dColor  diffuse_color, specular_color, ambient_color;
+    gx3dVector src;
+    float      range, constant_attenuation, linear_attenuation, quadratic_attenuation;
+  } point;
+};
+
+// Only the bounding volumes, which is all a backend other than gx3d's fills in
+struct gx3dObject {
+  char      *name;
+  gx3dBox    bound_box;
+  gx3dSphere bound_sphere;
+};
+
+typedef void *gx3dTexture;
+typedef void *gx3dLight;
+typedef void *gx3dParticleSystem;
+
+/*___________________
+|
+| Functions
+|__________________*/
+
+void gx3d_GetIdentityMatrix (gx3dMatrix *m);
+void gx3d_GetScaleMatrix (gx3dMatrix *m, float x, float y, float z);
+void gx3d_GetTranslateMatrix (gx3dMatrix *m, float x, float y, float z);
+// result may be a or b
+void gx3d_MultiplyMatrix (gx3dMatrix *a, gx3dMatrix *b, gx3dMatrix *result);
+// result may be v
+void gx3d_MultiplyVectorMatrix (gx3dVector *v, gx3dMatrix *m, gx3dVector *result);
+// Left handed view matrix looking from from to to
+void gx3d_ComputeViewMatrix (gx3dMatrix *m, gx3dVector *from, gx3dVector *to, gx3dVector *world_up);
+
+// Writes a line to stdout
+void debug_WriteFile (const char *str);
+
+#endif
@@ -7,6 +7,8 @@
 | Functions: Position_Init
 |            Position_Free
 |            Position_Set_Speed
+|            Position_Set_Ground
+|            Position_Set_Collision
 |            Position_Update
 |
 | (C) Copyright 2013 Abonvita Software LLC.
@@ -23,6 +25,7 @@
 
 #include "dp.h"
 
+#include "render.h"
 #include "position.h"
 
 /*___________________
@@ -46,6 +49,9 @@ static gx3dVector current_heading;			// current heading (normalized)
 static float      current_speed;				// current move speed
 static float      current_xrotate;			// current rotation of camera	
 static float	    current_yrotate;
+static PositionGroundFunc ground_height = 0;	// ground under the camera, if any
+static float      eye_height;
+static PositionCollideFunc collide = 0;		// moves the camera around obstacles, if any
 
 /*____________________________________________________________________
 |
@@ -61,7 +67,8 @@ void Position_Init (
   float       move_speed )  // move speed in feet per second
 {
   bool b;
-  gx3dVector v;
+  gx3dVector v, v1, to, world_up = { 0, 1, 0 };
+  gx3dMatrix m;
 
   // Init global variables
   current_position = *position;
@@ -73,6 +80,12 @@ void Position_Init (
   current_yrotate  = 0;
 
   Position_Update (0, 0, 0, 0, true, &b, &b, &v, &v);	// force an update to start the camera off in the correct position
+
+  // Set the camera
+  gx3d_MultiplyScalarVector (CAMERA_DISTANCE, &current_heading, &v1);
+  gx3d_AddVector (&current_position, &v1, &to);
+  gx3d_ComputeViewMatrix (&m, &current_position, &to, &world_up);
+  Render_Set_View_Matrix (&m);
 }
 
 /*____________________________________________________________________
@@ -101,6 +114,35 @@ void Position_Set_Speed (float move_speed)
   current_speed = move_speed;
 }
 
+/*____________________________________________________________________
+|
+| Function: Position_Set_Ground
+|
+| Input: Called from Program_Run()
+| Output: Sets the function giving ground height and how high above the
+|   ground to keep the camera.
+|___________________________________________________________________*/
+
+void Position_Set_Ground (PositionGroundFunc ground, float height)
+{
+  ground_height = ground;
+  eye_height    = height;
+}
+
+/*____________________________________________________________________
+|
+| Function: Position_Set_Collision
+|
+| Input: Called from Program_Run()
+| Output: Sets the function that stops the camera moving through
+|   obstacles (0 for none).
+|___________________________________________________________________*/
+
+void Position_Set_Collision (PositionCollideFunc collide_func)
+{
+  collide = collide_func;
+}
+
 /*____________________________________________________________________
 |
 | Function: Position_Update
@@ -110,7 +152,7 @@ void Position_Set_Speed (float move_speed)
 |___________________________________________________________________*/
 
 void Position_Update (
-  unsigned    elapsed_time,
+  float       elapsed_time,
   unsigned    move,
   int         xrotate,
   int         yrotate,
@@ -122,9 +164,9 @@ void Position_Update (
 {
 	int n;
 	float move_amount;
-  gx3dMatrix m, mx, my, mxy;
+  gx3dMatrix mx, my, mxy;
   gx3dVector to, world_up = { 0, 1, 0 };
-	gx3dVector v1, v_right;
+	gx3dVector v1, v_right, from;
 
 /*____________________________________________________________________
 |
@@ -135,7 +177,7 @@ void Position_Update (
   *camera_changed   = false;
 
 	// Compute amount of movement to make, if any
-	move_amount = ((float)elapsed_time / 1000) * current_speed;
+	move_amount = (elapsed_time / 1000) * current_speed;
 
 /*____________________________________________________________________
 |
@@ -182,6 +224,7 @@ void Position_Update (
 |___________________________________________________________________*/
   
   if (move OR update_all) {
+    from = current_position;
 		if (move & POSITION_MOVE_FORWARD) {
 			// Move 0.5 feet along the view vector
 			gx3d_MultiplyScalarVector (move_amount, &current_heading, &v1);
@@ -208,6 +251,11 @@ void Position_Update (
 			gx3d_MultiplyScalarVector (-move_amount, &v_right, &v1);
 		  gx3d_AddVector (&current_position, &v1, &current_position);
 		}
+    // Walk around obstacles (across, the ground sets the height below)
+    if (collide) {
+      current_position.y = from.y;
+      (*collide) (&from, &current_position, &current_position);
+    }
 		*position_changed = true;
 	}
 
@@ -217,19 +265,17 @@ void Position_Update (
 |___________________________________________________________________*/
   
   if ((xrotate != 0) OR (yrotate != 0) OR *position_changed) {
-    // Compute a point the camera is looking at
-		gx3d_MultiplyScalarVector (CAMERA_DISTANCE, &current_heading, &v1);
-	  gx3d_AddVector (&current_position, &v1, &to);
-//		to.x = current_position.x + (current_heading.x * CAMERA_DISTANCE);
-//    to.y = current_position.y + (current_heading.y * CAMERA_DISTANCE);
-//    to.z = current_position.z + (current_heading.z * CAMERA_DISTANCE);
-    // Set new camera	position
-	  gx3d_ComputeViewMatrix (&m, &current_position, &to, &world_up);
-
-	  current_position.y = 100;
-	 
-
-  	gx3d_SetViewMatrix (&m);
+    // Stand on the ground
+    to = current_position;
+    if (ground_height)
+      to.y = (*ground_height) (current_position.x, current_position.z) + eye_height;
+    else
+      to.y = 100;
+    if (collide)
+      (*collide) (&current_position, &to, &current_position);
+    else
+      current_position = to;
+    // The caller sets the camera (this may run on a job thread, so it leaves the renderer alone)
     *camera_changed = true;
   }
   
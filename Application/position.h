@@ -31,9 +31,21 @@ void Position_Free ();
 // Sets new move speed (in fps)
 void Position_Set_Speed (float move_speed);
 
-// Update position
+// Returns ground height at x,z
+typedef float (*PositionGroundFunc) (float x, float z);
+
+// Keeps the camera eye_height above the ground (0 for a fixed height of 100)
+void Position_Set_Ground (PositionGroundFunc ground, float eye_height);
+
+// Moves the camera from a position towards another, stopping at obstacles
+typedef void (*PositionCollideFunc) (gx3dVector *from, gx3dVector *to, gx3dVector *result);
+
+// Stops the camera moving through obstacles (0 for none)
+void Position_Set_Collision (PositionCollideFunc collide);
+
+// Update position (doesn't set the camera, so it can run on a job thread while the renderer is in use)
 void Position_Update (
-  unsigned    elapsed_time,
+  float       elapsed_time,     // milliseconds
   unsigned    move,
   int         xrotate,
   int         yrotate,
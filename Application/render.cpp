@@ -0,0 +1,731 @@
+/*____________________________________________________________________
+|
+| File: render.cpp
+|
+| Description: Thin layer the game draws through, so it can be pointed
+|   at something other than gx3d (like the null backend in
+|   rendernull.cpp, to run frames without a GPU).  Each call goes to
+|   the current backend through its table of functions.  No gx3d
+|   function is called here (the gx3d backend is in rendergx3d.cpp),
+|   only its types are used.
+|
+|   Also counts the draw calls made each frame and provides an
+|   instanced draw.  If the backend has a hardware instanced draw, a
+|   batch of instances is one draw call, otherwise the batch falls back
+|   to setting the world matrix and drawing each instance, with the
+|   texture set only once.
+|
+|   State changes (material, textures, ambient light, lights, alpha
+|   blending and testing) are checked against the state last sent to
+|   the backend, and ones that wouldn't change anything are dropped.
+|   The state is forgotten when the backend changes, a particle system
+|   is drawn (gx3d sets its own texture and blending for those) or a
+|   texture that's set is freed (its handle could come back).
+|
+| Functions: Render_Set_Backend
+|            Render_Get_Backend
+|            Render_Instancing_Supported
+|            Render_Vertex_Colors_Supported
+|            Render_Load_Object
+|            Render_Free_Object
+|            Render_Transform_Object
+|            Render_Set_Vertex_Colors
+|            Render_Load_Texture
+|            Render_Free_Texture
+|            Render_Init_Light
+|            Render_Begin_Frame
+|            Render_Clear
+|            Render_Begin
+|            Render_End
+|            Render_Flip
+|            Render_Set_Projection
+|            Render_Set_View_Matrix
+|            Render_Get_View_Matrix
+|            Render_Set_Camera
+|            Render_Set_Object_Matrix
+|            Render_Set_Material
+|            Render_Set_Texture
+|            Render_Set_Ambient_Light
+|            Render_Enable_Light
+|            Render_Disable_Light
+|            Render_Enable_Alpha_Blending
+|            Render_Disable_Alpha_Blending
+|            Render_Enable_Alpha_Testing
+|            Render_Disable_Alpha_Testing
+|            Render_Sphere_Visible
+|            Render_Draw_Object
+|            Render_Draw_Instanced
+|            Render_Draw_Particles
+|            Render_Get_Stats
+|             Forget_State
+|             Change_Light
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#ifdef _WIN32
+#include <first_header.h>
+#endif
+
+#include "portable.h"
+
+#include "render.h"
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define MAX_TEXTURE_STAGES 8
+#define MAX_LIGHTS         16   // lights whose on/off state is remembered
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+// State last sent to the backend
+struct RenderState {
+  bool              material_known;
+  gx3dMaterialData  material;
+  bool              texture_known [MAX_TEXTURE_STAGES];
+  gx3dTexture       texture [MAX_TEXTURE_STAGES];
+  bool              ambient_known;
+  gx3dColor         ambient;
+  int               alpha_blending;     // 0 unknown, 1 off, 2 on
+  int               alpha_testing;      // 0 unknown, 1 off, otherwise 2 + reference
+  int               num_lights;
+  gx3dLight         light [MAX_LIGHTS];
+  bool              light_on [MAX_LIGHTS];
+};
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static void         Forget_State ();
+static bool         Change_Light (gx3dLight light, bool on);
+
+/*___________________
+|
+| Global variables
+|__________________*/
+
+static RenderBackend *backend = 0;   // set by Program_Run() before anything is drawn
+
+// Projection, kept to pass on to a new backend
+static bool  projection_set = false;
+static float projection_fov, projection_near, projection_far, projection_aspect;
+
+static RenderStats stats;       // current frame
+static RenderStats last_stats;  // last complete frame
+
+static RenderState state;       // all zero is all unknown
+
+/*____________________________________________________________________
+|
+| Function: Render_Set_Backend
+|
+| Input: Called from Program_Run()
+| Output: Sends everything to a new backend, starting with the current
+|   projection and view matrix (if there was a backend before).
+|___________________________________________________________________*/
+
+void Render_Set_Backend (RenderBackend *new_backend)
+{
+  gx3dMatrix m;
+  RenderBackend *old_backend = backend;
+
+  if (old_backend)
+    (*old_backend->get_view_matrix) (&m);
+  backend = new_backend;
+  Forget_State ();
+  if (projection_set)
+    (*backend->set_projection) (projection_fov, projection_near, projection_far, projection_aspect);
+  if (old_backend)
+    (*backend->set_view_matrix) (&m);
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Get_Backend
+|
+| Input: Called from Program_Run()
+| Output: Returns the current backend.
+|___________________________________________________________________*/
+
+RenderBackend *Render_Get_Backend ()
+{
+  return (backend);
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Instancing_Supported
+|
+| Input: Called from Program_Run()
+| Output: Returns true if instanced draws go to the hardware.
+|___________________________________________________________________*/
+
+bool Render_Instancing_Supported ()
+{
+  return (backend->draw_instanced != 0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Vertex_Colors_Supported
+|
+| Input: Called from Program_Run()
+| Output: Returns true if objects can be drawn with baked vertex
+|   colors.
+|___________________________________________________________________*/
+
+bool Render_Vertex_Colors_Supported ()
+{
+  return (backend->set_vertex_colors != 0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Load_Object
+|
+| Input: Called from Program_Run(), StaticBatch_Create()
+| Output: Returns an object read from an LWO2 file.
+|___________________________________________________________________*/
+
+gx3dObject *Render_Load_Object (const char *lwo_filename)
+{
+  return ((*backend->load_object) (lwo_filename));
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Free_Object
+|
+| Input: Called from StaticBatch_Create(), StaticBatch_Free()
+| Output: Frees an object.
+|___________________________________________________________________*/
+
+void Render_Free_Object (gx3dObject *obj)
+{
+  (*backend->free_object) (obj);
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Transform_Object
+|
+| Input: Called from Program_Run()
+| Output: Transforms the vertices (and bounds) of an object for good.
+|___________________________________________________________________*/
+
+void Render_Transform_Object (gx3dObject *obj, gx3dMatrix *m)
+{
+  (*backend->transform_object) (obj, m);
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Set_Vertex_Colors
+|
+| Input: Called from Program_Run()
+| Output: Gives an object colors to draw with in place of lighting.
+|   Returns false if the backend can't.
+|___________________________________________________________________*/
+
+bool Render_Set_Vertex_Colors (gx3dObject *obj, gx3dColor *colors, int count)
+{
+  if (backend->set_vertex_colors == 0)
+    return (false);
+  return ((*backend->set_vertex_colors) (obj, colors, count));
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Load_Texture
+|
+| Input: Called from Program_Run()
+| Output: Returns a texture read from a bmp file and optional alpha bmp
+|   file.
+|___________________________________________________________________*/
+
+gx3dTexture Render_Load_Texture (const char *filename, const char *alpha_filename)
+{
+  return ((*backend->load_texture) (filename, alpha_filename));
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Free_Texture
+|
+| Input: Called from ____
+| Output: Frees a texture.
+|___________________________________________________________________*/
+
+void Render_Free_Texture (gx3dTexture tex)
+{
+  int i;
+
+  for (i=0; i<MAX_TEXTURE_STAGES; i++)
+    if (state.texture[i] == tex)
+      state.texture_known[i] = false;
+  (*backend->free_texture) (tex);
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Init_Light
+|
+| Input: Called from Program_Run()
+| Output: Returns a new light.
+|___________________________________________________________________*/
+
+gx3dLight Render_Init_Light (gx3dLightData *data)
+{
+  return ((*backend->init_light) (data));
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Begin_Frame
+|
+| Input: Called from Program_Run()
+| Output: Saves the counts of the last frame and starts over.
+|___________________________________________________________________*/
+
+void Render_Begin_Frame ()
+{
+  last_stats = stats;
+  memset (&stats, 0, sizeof(stats));
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Clear
+|
+| Input: Called from Program_Run()
+| Output: Clears the surface and the zbuffer.
+|___________________________________________________________________*/
+
+void Render_Clear (gxColor color)
+{
+  (*backend->clear) (color);
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Begin
+|
+| Input: Called from Program_Run()
+| Output: Returns true if ready to draw.
+|___________________________________________________________________*/
+
+bool Render_Begin ()
+{
+  return ((*backend->begin_render) ());
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_End
+|
+| Input: Called from Program_Run()
+| Output: Stops drawing.
+|___________________________________________________________________*/
+
+void Render_End ()
+{
+  (*backend->end_render) ();
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Flip
+|
+| Input: Called from Program_Run()
+| Output: Shows the frame just drawn.
+|___________________________________________________________________*/
+
+void Render_Flip ()
+{
+  (*backend->flip) ();
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Set_Projection
+|
+| Input: Called from Program_Run()
+| Output: Sets the projection (fov is vertical, in degrees).
+|___________________________________________________________________*/
+
+void Render_Set_Projection (float fov, float near_plane, float far_plane, float aspect)
+{
+  projection_set    = true;
+  projection_fov    = fov;
+  projection_near   = near_plane;
+  projection_far    = far_plane;
+  projection_aspect = aspect;
+  (*backend->set_projection) (fov, near_plane, far_plane, aspect);
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Set_View_Matrix
+|
+| Input: Called from Program_Run(), Position_Update()
+| Output: Sets the view matrix.
+|___________________________________________________________________*/
+
+void Render_Set_View_Matrix (gx3dMatrix *m)
+{
+  (*backend->set_view_matrix) (m);
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Get_View_Matrix
+|
+| Input: Called from Program_Run()
+| Output: Returns the view matrix.
+|___________________________________________________________________*/
+
+void Render_Get_View_Matrix (gx3dMatrix *m)
+{
+  (*backend->get_view_matrix) (m);
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Set_Camera
+|
+| Input: Called from Program_Run()
+| Output: Sets the view matrix to look from one point at another.
+|___________________________________________________________________*/
+
+void Render_Set_Camera (gx3dVector *from, gx3dVector *to, gx3dVector *world_up)
+{
+  (*backend->set_camera) (from, to, world_up);
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Set_Object_Matrix
+|
+| Input: Called from Program_Run(), RenderQueue_Flush()
+| Output: Sets the world matrix of an object.
+|___________________________________________________________________*/
+
+void Render_Set_Object_Matrix (gx3dObject *obj, gx3dMatrix *m)
+{
+  (*backend->set_object_matrix) (obj, m);
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Set_Material
+|
+| Input: Called from Program_Run()
+| Output: Sets the material.
+|___________________________________________________________________*/
+
+void Render_Set_Material (gx3dMaterialData *material)
+{
+  stats.state_requests++;
+  if (state.material_known AND (memcmp (&state.material, material, sizeof(gx3dMaterialData)) == 0))
+    return;
+  state.material_known = true;
+  state.material = *material;
+  (*backend->set_material) (material);
+  stats.state_changes++;
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Set_Texture
+|
+| Input: Called from Program_Run(), RenderQueue_Flush(),
+|   Render_Draw_Instanced()
+| Output: Sets the texture of a texture stage.
+|___________________________________________________________________*/
+
+void Render_Set_Texture (int stage, gx3dTexture tex)
+{
+  stats.state_requests++;
+  if ((stage >= 0) AND (stage < MAX_TEXTURE_STAGES)) {
+    if (state.texture_known[stage] AND (state.texture[stage] == tex))
+      return;
+    state.texture_known[stage] = true;
+    state.texture[stage] = tex;
+  }
+  (*backend->set_texture) (stage, tex);
+  stats.state_changes++;
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Set_Ambient_Light
+|
+| Input: Called from Program_Run(), RenderQueue_Flush()
+| Output: Sets the ambient light.
+|___________________________________________________________________*/
+
+void Render_Set_Ambient_Light (gx3dColor color)
+{
+  stats.state_requests++;
+  if (state.ambient_known AND (memcmp (&state.ambient, &color, sizeof(gx3dColor)) == 0))
+    return;
+  state.ambient_known = true;
+  state.ambient = color;
+  (*backend->set_ambient_light) (color);
+  stats.state_changes++;
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Enable_Light
+|
+| Input: Called from RenderQueue_Flush()
+| Output: Turns a light on.
+|___________________________________________________________________*/
+
+void Render_Enable_Light (gx3dLight light)
+{
+  stats.state_requests++;
+  if (Change_Light (light, true)) {
+    (*backend->enable_light) (light);
+    stats.state_changes++;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Disable_Light
+|
+| Input: Called from Program_Run(), RenderQueue_Flush()
+| Output: Turns a light off.
+|___________________________________________________________________*/
+
+void Render_Disable_Light (gx3dLight light)
+{
+  stats.state_requests++;
+  if (Change_Light (light, false)) {
+    (*backend->disable_light) (light);
+    stats.state_changes++;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Enable_Alpha_Blending
+|
+| Input: Called from Program_Run(), RenderQueue_Flush()
+| Output: Turns alpha blending on.
+|___________________________________________________________________*/
+
+void Render_Enable_Alpha_Blending ()
+{
+  stats.state_requests++;
+  if (state.alpha_blending == 2)
+    return;
+  state.alpha_blending = 2;
+  (*backend->enable_alpha_blending) ();
+  stats.state_changes++;
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Disable_Alpha_Blending
+|
+| Input: Called from Program_Run(), RenderQueue_Flush()
+| Output: Turns alpha blending off.
+|___________________________________________________________________*/
+
+void Render_Disable_Alpha_Blending ()
+{
+  stats.state_requests++;
+  if (state.alpha_blending == 1)
+    return;
+  state.alpha_blending = 1;
+  (*backend->disable_alpha_blending) ();
+  stats.state_changes++;
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Enable_Alpha_Testing
+|
+| Input: Called from Program_Run(), RenderQueue_Flush()
+| Output: Turns alpha testing on, passing alpha >= reference.
+|___________________________________________________________________*/
+
+void Render_Enable_Alpha_Testing (int reference)
+{
+  stats.state_requests++;
+  if (state.alpha_testing == 2 + reference)
+    return;
+  state.alpha_testing = 2 + reference;
+  (*backend->enable_alpha_testing) (reference);
+  stats.state_changes++;
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Disable_Alpha_Testing
+|
+| Input: Called from Program_Run(), RenderQueue_Flush()
+| Output: Turns alpha testing off.
+|___________________________________________________________________*/
+
+void Render_Disable_Alpha_Testing ()
+{
+  stats.state_requests++;
+  if (state.alpha_testing == 1)
+    return;
+  state.alpha_testing = 1;
+  (*backend->disable_alpha_testing) ();
+  stats.state_changes++;
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Sphere_Visible
+|
+| Input: Called from Program_Run(), StaticBatch_Submit()
+| Output: Returns false if a sphere is completely outside the view
+|   frustum.
+|___________________________________________________________________*/
+
+bool Render_Sphere_Visible (gx3dSphere *sphere)
+{
+  return ((*backend->sphere_visible) (sphere));
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Draw_Object
+|
+| Input: Called from Program_Run(), RenderQueue_Flush()
+| Output: Draws an object.
+|___________________________________________________________________*/
+
+void Render_Draw_Object (gx3dObject *obj)
+{
+  (*backend->draw_object) (obj);
+  stats.draw_calls++;
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Draw_Instanced
+|
+| Input: Called from RenderQueue_Flush()
+| Output: Draws an object once for each world matrix.
+|___________________________________________________________________*/
+
+void Render_Draw_Instanced (
+  gx3dObject  *obj,
+  gx3dTexture  tex,
+  gx3dMatrix  *matrices,
+  int          count )
+{
+  int i;
+
+  if (count <= 0)
+    return;
+
+  if (tex)
+    Render_Set_Texture (0, tex);
+
+  if (backend->draw_instanced) {
+    (*backend->draw_instanced) (obj, matrices, count);
+    stats.draw_calls++;
+  }
+  else {
+    for (i=0; i<count; i++) {
+      (*backend->set_object_matrix) (obj, &matrices[i]);
+      (*backend->draw_object) (obj);
+    }
+    stats.draw_calls += count;
+  }
+  stats.instanced_batches++;
+  stats.instances += count;
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Draw_Particles
+|
+| Input: Called from Program_Run()
+| Output: Moves a particle system, updates it and draws it.
+|___________________________________________________________________*/
+
+void Render_Draw_Particles (gx3dParticleSystem psys, gx3dMatrix *m, unsigned elapsed_ms, gx3dVector *heading)
+{
+  (*backend->draw_particles) (psys, m, elapsed_ms, heading);
+  stats.draw_calls++;
+  Forget_State ();
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Get_Stats
+|
+| Input: Called from ____
+| Output: Returns statistics for the last complete frame.
+|___________________________________________________________________*/
+
+void Render_Get_Stats (RenderStats *render_stats)
+{
+  *render_stats = last_stats;
+}
+
+/*____________________________________________________________________
+|
+| Function: Forget_State
+|
+| Input: Called from Render_Set_Backend(), Render_Draw_Particles()
+| Output: Marks all state unknown, so the next change of each kind goes
+|   to the backend.
+|___________________________________________________________________*/
+
+static void Forget_State ()
+{
+  memset (&state, 0, sizeof(state));
+}
+
+/*____________________________________________________________________
+|
+| Function: Change_Light
+|
+| Input: Called from Render_Enable_Light(), Render_Disable_Light()
+| Output: Returns true if turning a light on or off would change it (or
+|   its state isn't known), remembering its new state.
+|___________________________________________________________________*/
+
+static bool Change_Light (gx3dLight light, bool on)
+{
+  int i;
+
+  for (i=0; i<state.num_lights; i++)
+    if (state.light[i] == light) {
+      if (state.light_on[i] == on)
+        return (false);
+      state.light_on[i] = on;
+      return (true);
+    }
+  if (state.num_lights < MAX_LIGHTS) {
+    state.light[state.num_lights] = light;
+    state.light_on[state.num_lights] = on;
+    state.num_lights++;
+  }
+  return (true);
+}
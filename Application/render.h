@@ -0,0 +1,125 @@
+/*____________________________________________________________________
+|
+| File: render.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+// Per-frame statistics
+struct RenderStats {
+  int draw_calls;           // # of draw calls sent to the driver
+  int instanced_batches;    // # of calls to Render_Draw_Instanced()
+  int instances;            // # of instances drawn by those calls
+  int state_requests;       // # of state changes asked for
+  int state_changes;        // # of those sent to the backend (the rest changed nothing)
+};
+
+// Everything the game asks of the renderer.  A backend fills in every entry except set_vertex_colors,
+//  which is 0 if the backend can't draw with baked vertex colors, and draw_instanced, which is 0 if the
+//  backend can't draw instances in one call.
+struct RenderBackend {
+  const char *name;
+  // Objects (vertex buffers) and textures
+  gx3dObject  *(*load_object)  (const char *lwo_filename);
+  void         (*free_object)  (gx3dObject *obj);
+  void         (*transform_object) (gx3dObject *obj, gx3dMatrix *m);  // moves the vertices for good
+  bool         (*set_vertex_colors) (gx3dObject *obj, gx3dColor *colors, int count);
+  gx3dTexture  (*load_texture) (const char *filename, const char *alpha_filename);
+  void         (*free_texture) (gx3dTexture tex);
+  // Lights
+  gx3dLight    (*init_light)   (gx3dLightData *data);
+  // Frame
+  void (*clear)        (gxColor color);    // clears the surface and the zbuffer
+  bool (*begin_render) ();
+  void (*end_render)   ();
+  void (*flip)         ();
+  // Matrices
+  void (*set_projection)    (float fov, float near_plane, float far_plane, float aspect);
+  void (*set_view_matrix)   (gx3dMatrix *m);
+  void (*get_view_matrix)   (gx3dMatrix *m);
+  void (*set_camera)        (gx3dVector *from, gx3dVector *to, gx3dVector *world_up);
+  void (*set_object_matrix) (gx3dObject *obj, gx3dMatrix *m);
+  // State
+  void (*set_material)           (gx3dMaterialData *material);
+  void (*set_texture)            (int stage, gx3dTexture tex);
+  void (*set_ambient_light)      (gx3dColor color);
+  void (*enable_light)           (gx3dLight light);
+  void (*disable_light)          (gx3dLight light);
+  void (*enable_alpha_blending)  ();
+  void (*disable_alpha_blending) ();
+  void (*enable_alpha_testing)   (int reference);
+  void (*disable_alpha_testing)  ();
+  // Visibility
+  bool (*sphere_visible) (gx3dSphere *sphere);   // returns false if completely outside the view frustum
+  // Draws
+  void (*draw_object)    (gx3dObject *obj);
+  void (*draw_instanced) (gx3dObject *obj, gx3dMatrix *matrices, int count);
+  void (*draw_particles) (gx3dParticleSystem psys, gx3dMatrix *m, unsigned elapsed_ms, gx3dVector *heading);
+};
+
+// Sets the backend everything below goes to (call before anything else), carrying the projection and
+//  view matrix over to it
+void Render_Set_Backend (RenderBackend *backend);
+RenderBackend *Render_Get_Backend ();
+bool Render_Instancing_Supported ();
+bool Render_Vertex_Colors_Supported ();
+
+// Objects and textures
+gx3dObject *Render_Load_Object (const char *lwo_filename);
+void        Render_Free_Object (gx3dObject *obj);
+void        Render_Transform_Object (gx3dObject *obj, gx3dMatrix *m);
+// Gives an object a color for each corner of its triangles (in the order of Lwo2_Get_Mesh()) that it's drawn
+//  with in place of lighting, returns false if the backend can't or count doesn't match
+bool        Render_Set_Vertex_Colors (gx3dObject *obj, gx3dColor *colors, int count);
+gx3dTexture Render_Load_Texture (const char *filename, const char *alpha_filename);
+void        Render_Free_Texture (gx3dTexture tex);
+
+// Lights
+gx3dLight Render_Init_Light (gx3dLightData *data);
+
+// Starts counting draw calls for a new frame
+void Render_Begin_Frame ();
+
+// Frame
+void Render_Clear (gxColor color);
+bool Render_Begin ();
+void Render_End ();
+void Render_Flip ();
+
+// Matrices
+void Render_Set_Projection (float fov, float near_plane, float far_plane, float aspect);
+void Render_Set_View_Matrix (gx3dMatrix *m);
+void Render_Get_View_Matrix (gx3dMatrix *m);
+void Render_Set_Camera (gx3dVector *from, gx3dVector *to, gx3dVector *world_up);
+void Render_Set_Object_Matrix (gx3dObject *obj, gx3dMatrix *m);
+
+// State
+void Render_Set_Material (gx3dMaterialData *material);
+void Render_Set_Texture (int stage, gx3dTexture tex);
+void Render_Set_Ambient_Light (gx3dColor color);
+void Render_Enable_Light (gx3dLight light);
+void Render_Disable_Light (gx3dLight light);
+void Render_Enable_Alpha_Blending ();
+void Render_Disable_Alpha_Blending ();
+void Render_Enable_Alpha_Testing (int reference);
+void Render_Disable_Alpha_Testing ();
+
+// Returns false if a sphere is completely outside the view frustum
+bool Render_Sphere_Visible (gx3dSphere *sphere);
+
+// Draws an object using its current world matrix
+void Render_Draw_Object (gx3dObject *obj);
+
+// Draws an object once for each world matrix
+void Render_Draw_Instanced (
+  gx3dObject  *obj,
+  gx3dTexture  tex,         // texture to use or 0 to keep the current texture
+  gx3dMatrix  *matrices,
+  int          count );
+
+// Moves a particle system, updates it and draws it
+void Render_Draw_Particles (gx3dParticleSystem psys, gx3dMatrix *m, unsigned elapsed_ms, gx3dVector *heading);
+
+// Returns statistics for the last complete frame
+void Render_Get_Stats (RenderStats *stats);
@@ -0,0 +1,569 @@
+/*____________________________________________________________________
+|
+| File: rendergx3d.cpp
+|
+| Description: The gx3d (Direct3D) rendering backend.  Each entry just
+|   calls the matching gx3d function.  It's kept apart from the front
+|   end in render.cpp so a build without gx3d's renderer can leave it
+|   out and use the null or software backend.  The device state the
+|   game sets once (viewport, fill mode, texture stages, ...) and the
+|   particle systems, which only gx3d can draw, are here too, so the
+|   game itself makes no gx3d device calls.
+|
+| Functions: RenderGx3d_Backend
+|            RenderGx3d_Init
+|            RenderGx3d_Load_Particles
+|            RenderGx3d_Free_Particles
+|             Gx3d_Load_Object
+|             Gx3d_Free_Object
+|             Gx3d_Transform_Object
+|             Gx3d_Load_Texture
+|             Gx3d_Free_Texture
+|             Gx3d_Init_Light
+|             Gx3d_Clear
+|             Gx3d_Begin_Render
+|             Gx3d_End_Render
+|             Gx3d_Flip
+|             Gx3d_Set_Projection
+|             Gx3d_Set_Camera
+|             Gx3d_Set_View_Matrix
+|             Gx3d_Get_View_Matrix
+|             Gx3d_Set_Object_Matrix
+|             Gx3d_Set_Material
+|             Gx3d_Set_Texture
+|             Gx3d_Set_Ambient_Light
+|             Gx3d_Enable_Light
+|             Gx3d_Disable_Light
+|             Gx3d_Enable_Alpha_Blending
+|             Gx3d_Disable_Alpha_Blending
+|             Gx3d_Enable_Alpha_Testing
+|             Gx3d_Disable_Alpha_Testing
+|             Gx3d_Sphere_Visible
+|             Gx3d_Draw_Object
+|             Gx3d_Draw_Particles
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+
+#include "dp.h"
+
+#include "render.h"
+#include "rendergx3d.h"
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static gx3dObject  *Gx3d_Load_Object (const char *lwo_filename);
+static void         Gx3d_Free_Object (gx3dObject *obj);
+static void         Gx3d_Transform_Object (gx3dObject *obj, gx3dMatrix *m);
+static gx3dTexture  Gx3d_Load_Texture (const char *filename, const char *alpha_filename);
+static void         Gx3d_Free_Texture (gx3dTexture tex);
+static gx3dLight    Gx3d_Init_Light (gx3dLightData *data);
+static void         Gx3d_Clear (gxColor color);
+static bool         Gx3d_Begin_Render ();
+static void         Gx3d_End_Render ();
+static void         Gx3d_Flip ();
+static void         Gx3d_Set_Projection (float fov, float near_plane, float far_plane, float aspect);
+static void         Gx3d_Set_Camera (gx3dVector *from, gx3dVector *to, gx3dVector *world_up);
+static void         Gx3d_Set_View_Matrix (gx3dMatrix *m);
+static void         Gx3d_Get_View_Matrix (gx3dMatrix *m);
+static void         Gx3d_Set_Object_Matrix (gx3dObject *obj, gx3dMatrix *m);
+static void         Gx3d_Set_Material (gx3dMaterialData *material);
+static void         Gx3d_Set_Texture (int stage, gx3dTexture tex);
+static void         Gx3d_Set_Ambient_Light (gx3dColor color);
+static void         Gx3d_Enable_Light (gx3dLight light);
+static void         Gx3d_Disable_Light (gx3dLight light);
+static void         Gx3d_Enable_Alpha_Blending ();
+static void         Gx3d_Disable_Alpha_Blending ();
+static void         Gx3d_Enable_Alpha_Testing (int reference);
+static void         Gx3d_Disable_Alpha_Testing ();
+static bool         Gx3d_Sphere_Visible (gx3dSphere *sphere);
+static void         Gx3d_Draw_Object (gx3dObject *obj);
+static void         Gx3d_Draw_Particles (gx3dParticleSystem psys, gx3dMatrix *m, unsigned elapsed_ms, gx3dVector *heading);
+
+/*___________________
+|
+| Global variables
+|__________________*/
+
+static RenderBackend gx3d_backend = {
+  "gx3d",
+  Gx3d_Load_Object,
+  Gx3d_Free_Object,
+  Gx3d_Transform_Object,
+  0,                        // gx3d objects can't be given vertex colors after they're read
+  Gx3d_Load_Texture,
+  Gx3d_Free_Texture,
+  Gx3d_Init_Light,
+  Gx3d_Clear,
+  Gx3d_Begin_Render,
+  Gx3d_End_Render,
+  Gx3d_Flip,
+  Gx3d_Set_Projection,
+  Gx3d_Set_View_Matrix,
+  Gx3d_Get_View_Matrix,
+  Gx3d_Set_Camera,
+  Gx3d_Set_Object_Matrix,
+  Gx3d_Set_Material,
+  Gx3d_Set_Texture,
+  Gx3d_Set_Ambient_Light,
+  Gx3d_Enable_Light,
+  Gx3d_Disable_Light,
+  Gx3d_Enable_Alpha_Blending,
+  Gx3d_Disable_Alpha_Blending,
+  Gx3d_Enable_Alpha_Testing,
+  Gx3d_Disable_Alpha_Testing,
+  Gx3d_Sphere_Visible,
+  Gx3d_Draw_Object,
+  0,                        // no hardware instancing in gx3d
+  Gx3d_Draw_Particles
+};
+
+/*____________________________________________________________________
+|
+| Function: RenderGx3d_Backend
+|
+| Input: Called from Program_Run()
+| Output: Returns the gx3d backend.
+|___________________________________________________________________*/
+
+RenderBackend *RenderGx3d_Backend ()
+{
+  return (&gx3d_backend);
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderGx3d_Init
+|
+| Input: Called from Program_Run()
+| Output: Sets the viewport and the general 3D render state.
+|___________________________________________________________________*/
+
+void RenderGx3d_Init (gxRectangle *viewport)
+{
+  gx3d_SetViewport (viewport);
+  gx3d_SetFillMode (gx3d_FILL_MODE_GOURAUD_SHADED);
+
+  // Enable zbuffering
+  gx3d_EnableZBuffer ();
+
+  // Enable lighting
+  gx3d_EnableLighting ();
+
+  // Set the default alpha blend factor
+  gx3d_SetAlphaBlendFactor (gx3d_ALPHABLENDFACTOR_SRCALPHA, gx3d_ALPHABLENDFACTOR_INVSRCALPHA);
+
+  // Init texture addressing mode - wrap in both u and v dimensions
+  gx3d_SetTextureAddressingMode (0, gx3d_TEXTURE_DIMENSION_U | gx3d_TEXTURE_DIMENSION_V, gx3d_TEXTURE_ADDRESSMODE_WRAP);
+  gx3d_SetTextureAddressingMode (1, gx3d_TEXTURE_DIMENSION_U | gx3d_TEXTURE_DIMENSION_V, gx3d_TEXTURE_ADDRESSMODE_WRAP);
+  // Texture stage 0 default blend operator and arguments
+  gx3d_SetTextureColorOp (0, gx3d_TEXTURE_COLOROP_MODULATE, gx3d_TEXTURE_ARG_TEXTURE, gx3d_TEXTURE_ARG_CURRENT);
+  gx3d_SetTextureAlphaOp (0, gx3d_TEXTURE_ALPHAOP_SELECTARG1, gx3d_TEXTURE_ARG_TEXTURE, 0);
+  // Texture stage 1 is off by default
+  gx3d_SetTextureColorOp (1, gx3d_TEXTURE_COLOROP_DISABLE, 0, 0);
+  gx3d_SetTextureAlphaOp (1, gx3d_TEXTURE_ALPHAOP_DISABLE, 0, 0);
+
+  // Set default texture coordinates
+  gx3d_SetTextureCoordinates (0, gx3d_TEXCOORD_SET0);
+  gx3d_SetTextureCoordinates (1, gx3d_TEXCOORD_SET1);
+
+  // Enable trilinear texture filtering
+  gx3d_SetTextureFiltering (0, gx3d_TEXTURE_FILTERTYPE_TRILINEAR, 0);
+  gx3d_SetTextureFiltering (1, gx3d_TEXTURE_FILTERTYPE_TRILINEAR, 0);
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderGx3d_Load_Particles
+|
+| Input: Called from Program_Run()
+| Output: Returns a particle system read from a gxps script file.
+|___________________________________________________________________*/
+
+gx3dParticleSystem RenderGx3d_Load_Particles (const char *filename)
+{
+  return (Script_ParticleSystem_Create ((char *)filename));
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderGx3d_Free_Particles
+|
+| Input: Called from Program_Run()
+| Output: Frees a particle system.
+|___________________________________________________________________*/
+
+void RenderGx3d_Free_Particles (gx3dParticleSystem psys)
+{
+  gx3d_FreeParticleSystem (psys);
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Load_Object
+|
+| Input: Called from Render_Load_Object() (through gx3d_backend)
+| Output: Reads an object from an LWO2 file.
+|___________________________________________________________________*/
+
+static gx3dObject *Gx3d_Load_Object (const char *lwo_filename)
+{
+  gx3dObject *obj;
+
+  gx3d_ReadLWO2File ((char *)lwo_filename, &obj, gx3d_VERTEXFORMAT_DEFAULT, gx3d_DONT_LOAD_TEXTURES);
+  return (obj);
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Free_Object
+|
+| Input: Called from Render_Free_Object() (through gx3d_backend)
+| Output: Frees an object.
+|___________________________________________________________________*/
+
+static void Gx3d_Free_Object (gx3dObject *obj)
+{
+  gx3d_FreeObject (obj);
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Transform_Object
+|
+| Input: Called from Render_Transform_Object() (through gx3d_backend)
+| Output: Transforms the vertices (and bounds) of an object.
+|___________________________________________________________________*/
+
+static void Gx3d_Transform_Object (gx3dObject *obj, gx3dMatrix *m)
+{
+  gx3d_TransformObject (obj, m);
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Load_Texture
+|
+| Input: Called from Render_Load_Texture() (through gx3d_backend)
+| Output: Reads a texture (and optional alpha) from bmp files.
+|___________________________________________________________________*/
+
+static gx3dTexture Gx3d_Load_Texture (const char *filename, const char *alpha_filename)
+{
+  return (gx3d_InitTexture_File ((char *)filename, (char *)alpha_filename, 0));
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Free_Texture
+|
+| Input: Called from Render_Free_Texture() (through gx3d_backend)
+| Output: Frees a texture.
+|___________________________________________________________________*/
+
+static void Gx3d_Free_Texture (gx3dTexture tex)
+{
+  gx3d_FreeTexture (tex);
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Init_Light
+|
+| Input: Called from Render_Init_Light() (through gx3d_backend)
+| Output: Returns a new light.
+|___________________________________________________________________*/
+
+static gx3dLight Gx3d_Init_Light (gx3dLightData *data)
+{
+  return (gx3d_InitLight (data));
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Clear
+|
+| Input: Called from Render_Clear() (through gx3d_backend)
+| Output: Clears the viewport and zbuffer.
+|___________________________________________________________________*/
+
+static void Gx3d_Clear (gxColor color)
+{
+  gx3d_ClearViewport (gx3d_CLEAR_SURFACE | gx3d_CLEAR_ZBUFFER, color, gx3d_MAX_ZBUFFER_VALUE, 0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Begin_Render
+|
+| Input: Called from Render_Begin() (through gx3d_backend)
+| Output: Returns true if ready to draw.
+|___________________________________________________________________*/
+
+static bool Gx3d_Begin_Render ()
+{
+  return (gx3d_BeginRender () != 0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_End_Render
+|
+| Input: Called from Render_End() (through gx3d_backend)
+| Output: Stops drawing.
+|___________________________________________________________________*/
+
+static void Gx3d_End_Render ()
+{
+  gx3d_EndRender ();
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Flip
+|
+| Input: Called from Render_Flip() (through gx3d_backend)
+| Output: Shows the page just drawn.
+|___________________________________________________________________*/
+
+static void Gx3d_Flip ()
+{
+  gxFlipVisualActivePages (FALSE);
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Set_Projection
+|
+| Input: Called from Render_Set_Projection() (through gx3d_backend)
+| Output: Sets the projection matrix (gx3d takes the aspect ratio from
+|   the viewport).
+|___________________________________________________________________*/
+
+static void Gx3d_Set_Projection (float fov, float near_plane, float far_plane, float)
+{
+  gx3d_SetProjectionMatrix (fov, near_plane, far_plane);
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Set_Camera
+|
+| Input: Called from Render_Set_Camera() (through gx3d_backend)
+| Output: Sets the view matrix to look from one point at another.
+|___________________________________________________________________*/
+
+static void Gx3d_Set_Camera (gx3dVector *from, gx3dVector *to, gx3dVector *world_up)
+{
+  gx3d_CameraSetPosition (from, to, world_up, gx3d_CAMERA_ORIENTATION_LOOKTO_FIXED);
+  gx3d_CameraSetViewMatrix ();
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Set_View_Matrix
+|
+| Input: Called from Render_Set_View_Matrix() (through gx3d_backend)
+| Output: Sets the view matrix.
+|___________________________________________________________________*/
+
+static void Gx3d_Set_View_Matrix (gx3dMatrix *m)
+{
+  gx3d_SetViewMatrix (m);
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Get_View_Matrix
+|
+| Input: Called from Render_Get_View_Matrix() (through gx3d_backend)
+| Output: Returns the view matrix.
+|___________________________________________________________________*/
+
+static void Gx3d_Get_View_Matrix (gx3dMatrix *m)
+{
+  gx3d_GetViewMatrix (m);
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Set_Object_Matrix
+|
+| Input: Called from Render_Set_Object_Matrix() (through gx3d_backend)
+| Output: Sets the world matrix of an object.
+|___________________________________________________________________*/
+
+static void Gx3d_Set_Object_Matrix (gx3dObject *obj, gx3dMatrix *m)
+{
+  gx3d_SetObjectMatrix (obj, m);
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Set_Material
+|
+| Input: Called from Render_Set_Material() (through gx3d_backend)
+| Output: Sets the material.
+|___________________________________________________________________*/
+
+static void Gx3d_Set_Material (gx3dMaterialData *material)
+{
+  gx3d_SetMaterial (material);
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Set_Texture
+|
+| Input: Called from Render_Set_Texture() (through gx3d_backend)
+| Output: Sets the texture of a texture stage.
+|___________________________________________________________________*/
+
+static void Gx3d_Set_Texture (int stage, gx3dTexture tex)
+{
+  gx3d_SetTexture (stage, tex);
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Set_Ambient_Light
+|
+| Input: Called from Render_Set_Ambient_Light() (through gx3d_backend)
+| Output: Sets the ambient light.
+|___________________________________________________________________*/
+
+static void Gx3d_Set_Ambient_Light (gx3dColor color)
+{
+  gx3d_SetAmbientLight (color);
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Enable_Light
+|
+| Input: Called from Render_Enable_Light() (through gx3d_backend)
+| Output: Turns a light on.
+|___________________________________________________________________*/
+
+static void Gx3d_Enable_Light (gx3dLight light)
+{
+  gx3d_EnableLight (light);
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Disable_Light
+|
+| Input: Called from Render_Disable_Light() (through gx3d_backend)
+| Output: Turns a light off.
+|___________________________________________________________________*/
+
+static void Gx3d_Disable_Light (gx3dLight light)
+{
+  gx3d_DisableLight (light);
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Enable_Alpha_Blending
+|
+| Input: Called from Render_Enable_Alpha_Blending() (through gx3d_backend)
+| Output: Turns alpha blending on.
+|___________________________________________________________________*/
+
+static void Gx3d_Enable_Alpha_Blending ()
+{
+  gx3d_EnableAlphaBlending ();
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Disable_Alpha_Blending
+|
+| Input: Called from Render_Disable_Alpha_Blending() (through gx3d_backend)
+| Output: Turns alpha blending off.
+|___________________________________________________________________*/
+
+static void Gx3d_Disable_Alpha_Blending ()
+{
+  gx3d_DisableAlphaBlending ();
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Enable_Alpha_Testing
+|
+| Input: Called from Render_Enable_Alpha_Testing() (through gx3d_backend)
+| Output: Turns alpha testing on.
+|___________________________________________________________________*/
+
+static void Gx3d_Enable_Alpha_Testing (int reference)
+{
+  gx3d_EnableAlphaTesting (reference);
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Disable_Alpha_Testing
+|
+| Input: Called from Render_Disable_Alpha_Testing() (through gx3d_backend)
+| Output: Turns alpha testing off.
+|___________________________________________________________________*/
+
+static void Gx3d_Disable_Alpha_Testing ()
+{
+  gx3d_DisableAlphaTesting ();
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Sphere_Visible
+|
+| Input: Called from Render_Sphere_Visible() (through gx3d_backend)
+| Output: Returns false if a sphere is outside the view frustum.
+|___________________________________________________________________*/
+
+static bool Gx3d_Sphere_Visible (gx3dSphere *sphere)
+{
+  return (gx3d_Relation_Sphere_Frustum (sphere) != gxRELATION_OUTSIDE);
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Draw_Object
+|
+| Input: Called from Render_Draw_Object(), Render_Draw_Instanced()
+|   (through gx3d_backend)
+| Output: Draws an object.
+|___________________________________________________________________*/
+
+static void Gx3d_Draw_Object (gx3dObject *obj)
+{
+  gx3d_DrawObject (obj, 0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Gx3d_Draw_Particles
+|
+| Input: Called from Render_Draw_Particles() (through gx3d_backend)
+| Output: Moves, updates and draws a particle system.
+|___________________________________________________________________*/
+
+static void Gx3d_Draw_Particles (gx3dParticleSystem psys, gx3dMatrix *m, unsigned elapsed_ms, gx3dVector *heading)
+{
+  gx3d_SetParticleSystemMatrix (psys, m);
+  gx3d_UpdateParticleSystem (psys, elapsed_ms);
+  gx3d_DrawParticleSystem (psys, heading, false);
+}
@@ -0,0 +1,17 @@
+/*____________________________________________________________________
+|
+| File: rendergx3d.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+// Returns the gx3d (Direct3D) backend
+RenderBackend *RenderGx3d_Backend ();
+
+// Sets the viewport and the general 3D render state (call once, after graphics mode starts)
+void RenderGx3d_Init (gxRectangle *viewport);
+
+// Particle systems, which only the gx3d backend draws
+gx3dParticleSystem RenderGx3d_Load_Particles (const char *filename);
+void               RenderGx3d_Free_Particles (gx3dParticleSystem psys);
@@ -0,0 +1,872 @@
+/*____________________________________________________________________
+|
+| File: rendernull.cpp
+|
+| Description: Rendering backend that draws nothing.  Every command is
+|   recorded (kind, handle and one value) and counted per frame, so a
+|   whole frame of the game can run and be profiled without a GPU.  A
+|   frame ends at each flip; the commands of the last complete frame
+|   can be read back.
+|
+|   Objects are read from their LWO2 files only to compute bounding
+|   volumes, so culling works the same as with a real backend, and the
+|   backend keeps its own view and projection to test spheres against
+|   the view frustum.  Textures and lights are just handles.  Objects
+|   and textures it didn't load (from the backend in use before) are
+|   left alone.
+|
+| Functions: RenderNull_Backend
+|             Record
+|             Null_Load_Object
+|             Null_Free_Object
+|             Null_Transform_Object
+|             Null_Load_Texture
+|             Null_Free_Texture
+|             Null_Init_Light
+|             Null_Clear
+|             Null_Begin_Render
+|             Null_End_Render
+|             Null_Flip
+|             Null_Set_Projection
+|             Null_Set_View_Matrix
+|             Null_Get_View_Matrix
+|             Null_Set_Camera
+|             Null_Set_Object_Matrix
+|             Null_Set_Material
+|             Null_Set_Texture
+|             Null_Set_Ambient_Light
+|             Null_Enable_Light
+|             Null_Disable_Light
+|             Null_Enable_Alpha_Blending
+|             Null_Disable_Alpha_Blending
+|             Null_Enable_Alpha_Testing
+|             Null_Disable_Alpha_Testing
+|             Null_Sphere_Visible
+|             Null_Draw_Object
+|             Null_Draw_Particles
+|            RenderNull_Reset
+|            RenderNull_Get_Commands
+|            RenderNull_Command_Name
+|            RenderNull_Get_Stats
+|            RenderNull_Write_Stats
+|            RenderNull_Free
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#ifdef _WIN32
+#include <first_header.h>
+#endif
+#include <math.h>
+#include <float.h>
+
+#include "portable.h"
+
+#include "lwo2.h"
+#include "render.h"
+#include "timer.h"
+#include "rendernull.h"
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static void         Record (int type, void *handle, int value);
+static gx3dObject  *Null_Load_Object (const char *lwo_filename);
+static void         Null_Free_Object (gx3dObject *obj);
+static void         Null_Transform_Object (gx3dObject *obj, gx3dMatrix *m);
+static gx3dTexture  Null_Load_Texture (const char *filename, const char *alpha_filename);
+static void         Null_Free_Texture (gx3dTexture tex);
+static gx3dLight    Null_Init_Light (gx3dLightData *data);
+static void         Null_Clear (gxColor color);
+static bool         Null_Begin_Render ();
+static void         Null_End_Render ();
+static void         Null_Flip ();
+static void         Null_Set_Projection (float fov, float near_plane, float far_plane, float aspect);
+static void         Null_Set_View_Matrix (gx3dMatrix *m);
+static void         Null_Get_View_Matrix (gx3dMatrix *m);
+static void         Null_Set_Camera (gx3dVector *from, gx3dVector *to, gx3dVector *world_up);
+static void         Null_Set_Object_Matrix (gx3dObject *obj, gx3dMatrix *m);
+static void         Null_Set_Material (gx3dMaterialData *material);
+static void         Null_Set_Texture (int stage, gx3dTexture tex);
+static void         Null_Set_Ambient_Light (gx3dColor color);
+static void         Null_Enable_Light (gx3dLight light);
+static void         Null_Disable_Light (gx3dLight light);
+static void         Null_Enable_Alpha_Blending ();
+static void         Null_Disable_Alpha_Blending ();
+static void         Null_Enable_Alpha_Testing (int reference);
+static void         Null_Disable_Alpha_Testing ();
+static bool         Null_Sphere_Visible (gx3dSphere *sphere);
+static void         Null_Draw_Object (gx3dObject *obj);
+static void         Null_Draw_Particles (gx3dParticleSystem psys, gx3dMatrix *m, unsigned elapsed_ms, gx3dVector *heading);
+
+/*___________________
+|
+| Global variables
+|__________________*/
+
+static RenderBackend null_backend = {
+  "null",
+  Null_Load_Object,
+  Null_Free_Object,
+  Null_Transform_Object,
+  0,                        // lit like gx3d
+  Null_Load_Texture,
+  Null_Free_Texture,
+  Null_Init_Light,
+  Null_Clear,
+  Null_Begin_Render,
+  Null_End_Render,
+  Null_Flip,
+  Null_Set_Projection,
+  Null_Set_View_Matrix,
+  Null_Get_View_Matrix,
+  Null_Set_Camera,
+  Null_Set_Object_Matrix,
+  Null_Set_Material,
+  Null_Set_Texture,
+  Null_Set_Ambient_Light,
+  Null_Enable_Light,
+  Null_Disable_Light,
+  Null_Enable_Alpha_Blending,
+  Null_Disable_Alpha_Blending,
+  Null_Enable_Alpha_Testing,
+  Null_Disable_Alpha_Testing,
+  Null_Sphere_Visible,
+  Null_Draw_Object,
+  0,                        // instances are drawn one at a time, like gx3d
+  Null_Draw_Particles
+};
+
+static const char *command_name [RENDERNULL_NUM_COMMANDS] = {
+  "load object", "free object", "load texture", "free texture",
+  "clear", "begin render", "end render", "flip",
+  "set projection", "set view matrix", "get view matrix", "set camera", "set object matrix",
+  "set material", "set texture", "set ambient light", "enable light", "disable light",
+  "enable alpha blending", "disable alpha blending", "enable alpha testing", "disable alpha testing",
+  "sphere visible", "draw object", "draw particles", "init light",
+  "transform object"
+};
+
+// Commands of the frame being recorded and of the last complete frame
+static RenderNullCommand *commands      = 0;
+static int                num_commands  = 0;
+static int                max_commands  = 0;
+static RenderNullCommand *last_commands = 0;
+static int                num_last      = 0;
+static int                max_last      = 0;
+
+static RenderNullStats stats;
+static double          last_flip;
+static float           total_frame_ms;
+
+// View and projection
+static gx3dMatrix view_matrix = { 1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1 };
+static float      proj_x = 1, proj_y = 1, near_z = 0.1f, far_z = FLT_MAX;
+
+// Objects and textures loaded by this backend
+static gx3dObject **objects      = 0;
+static int          max_objects  = 0;
+static void       **textures     = 0;
+static int          max_textures = 0;
+static void       **lights       = 0;
+static int          num_lights   = 0;
+
+/*____________________________________________________________________
+|
+| Function: RenderNull_Backend
+|
+| Input: Called from Program_Run()
+| Output: Returns the null backend.
+|___________________________________________________________________*/
+
+RenderBackend *RenderNull_Backend ()
+{
+  return (&null_backend);
+}
+
+/*____________________________________________________________________
+|
+| Function: Record
+|
+| Input: Called from the Null_ functions
+| Output: Adds a command to the frame being recorded.
+|___________________________________________________________________*/
+
+static void Record (int type, void *handle, int value)
+{
+  if (num_commands == max_commands) {
+    max_commands = max_commands ? max_commands * 2 : 1024;
+    commands = (RenderNullCommand *) realloc (commands, max_commands * sizeof(RenderNullCommand));
+  }
+  commands[num_commands].type   = type;
+  commands[num_commands].handle = handle;
+  commands[num_commands].value  = value;
+  num_commands++;
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Load_Object
+|
+| Input: Called from Render_Load_Object() (through null_backend)
+| Output: Returns an object holding just the bounding box and sphere of
+|   the object in an LWO2 file (empty if the file can't be read).
+|___________________________________________________________________*/
+
+static gx3dObject *Null_Load_Object (const char *lwo_filename)
+{
+  int i, n;
+  float d;
+  gx3dVector *v, *c, *min, *max;
+  gx3dMatrix m;
+  gx3dObject *obj;
+
+  obj = (gx3dObject *) calloc (1, sizeof(gx3dObject));
+  gx3d_GetIdentityMatrix (&m);
+  n = Lwo2_Read_Triangles (lwo_filename, &m, &v);
+  if (n > 0) {
+    min = &obj->bound_box.min;
+    max = &obj->bound_box.max;
+    *min = *max = v[0];
+    for (i=1; i<n*3; i++) {
+      if (v[i].x < min->x) min->x = v[i].x;
+      if (v[i].y < min->y) min->y = v[i].y;
+      if (v[i].z < min->z) min->z = v[i].z;
+      if (v[i].x > max->x) max->x = v[i].x;
+      if (v[i].y > max->y) max->y = v[i].y;
+      if (v[i].z > max->z) max->z = v[i].z;
+    }
+    c = &obj->bound_sphere.center;
+    c->x = (min->x + max->x) / 2;
+    c->y = (min->y + max->y) / 2;
+    c->z = (min->z + max->z) / 2;
+    for (i=0; i<n*3; i++) {
+      d = (v[i].x - c->x) * (v[i].x - c->x) + (v[i].y - c->y) * (v[i].y - c->y) + (v[i].z - c->z) * (v[i].z - c->z);
+      if (d > obj->bound_sphere.radius)
+        obj->bound_sphere.radius = d;
+    }
+    obj->bound_sphere.radius = sqrtf (obj->bound_sphere.radius);
+  }
+  if (n != -1)
+    free (v);
+
+  // Remember it
+  for (i=0; (i<max_objects) AND objects[i]; i++);
+  if (i == max_objects) {
+    max_objects = max_objects ? max_objects * 2 : 64;
+    objects = (gx3dObject **) realloc (objects, max_objects * sizeof(gx3dObject *));
+    memset (&objects[i], 0, (max_objects - i) * sizeof(gx3dObject *));
+  }
+  objects[i] = obj;
+  stats.objects++;
+
+  Record (RENDERNULL_LOAD_OBJECT, obj, 0);
+  return (obj);
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Free_Object
+|
+| Input: Called from Render_Free_Object() (through null_backend)
+| Output: Frees an object, if this backend loaded it.
+|___________________________________________________________________*/
+
+static void Null_Free_Object (gx3dObject *obj)
+{
+  int i;
+
+  Record (RENDERNULL_FREE_OBJECT, obj, 0);
+  for (i=0; i<max_objects; i++)
+    if (objects[i] == obj) {
+      free (obj);
+      objects[i] = 0;
+      stats.objects--;
+      break;
+    }
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Transform_Object
+|
+| Input: Called from Render_Transform_Object() (through null_backend)
+| Output: Moves the bounds of an object, if this backend loaded it: the
+|   box becomes the box around its transformed corners and the sphere
+|   grows by the largest scale of the matrix.
+|___________________________________________________________________*/
+
+static void Null_Transform_Object (gx3dObject *obj, gx3dMatrix *m)
+{
+  int i;
+  float s, scale;
+  gx3dVector v, min, max;
+  gx3dBox *box = &obj->bound_box;
+
+  Record (RENDERNULL_TRANSFORM_OBJECT, obj, 0);
+  for (i=0; (i<max_objects) AND (objects[i] != obj); i++);
+  if (i == max_objects)
+    return;
+
+  for (i=0; i<8; i++) {
+    v.x = (i & 1) ? box->max.x : box->min.x;
+    v.y = (i & 2) ? box->max.y : box->min.y;
+    v.z = (i & 4) ? box->max.z : box->min.z;
+    gx3d_MultiplyVectorMatrix (&v, m, &v);
+    if ((i == 0) OR (v.x < min.x)) min.x = v.x;
+    if ((i == 0) OR (v.y < min.y)) min.y = v.y;
+    if ((i == 0) OR (v.z < min.z)) min.z = v.z;
+    if ((i == 0) OR (v.x > max.x)) max.x = v.x;
+    if ((i == 0) OR (v.y > max.y)) max.y = v.y;
+    if ((i == 0) OR (v.z > max.z)) max.z = v.z;
+  }
+  box->min = min;
+  box->max = max;
+
+  scale = sqrtf (m->_00 * m->_00 + m->_01 * m->_01 + m->_02 * m->_02);
+  s = sqrtf (m->_10 * m->_10 + m->_11 * m->_11 + m->_12 * m->_12);
+  if (s > scale)
+    scale = s;
+  s = sqrtf (m->_20 * m->_20 + m->_21 * m->_21 + m->_22 * m->_22);
+  if (s > scale)
+    scale = s;
+  gx3d_MultiplyVectorMatrix (&obj->bound_sphere.center, m, &obj->bound_sphere.center);
+  obj->bound_sphere.radius *= scale;
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Load_Texture
+|
+| Input: Called from Render_Load_Texture() (through null_backend)
+| Output: Returns a new texture handle.
+|___________________________________________________________________*/
+
+static gx3dTexture Null_Load_Texture (const char *, const char *)
+{
+  int i;
+  void *tex;
+
+  tex = malloc (sizeof(int));
+  for (i=0; (i<max_textures) AND textures[i]; i++);
+  if (i == max_textures) {
+    max_textures = max_textures ? max_textures * 2 : 64;
+    textures = (void **) realloc (textures, max_textures * sizeof(void *));
+    memset (&textures[i], 0, (max_textures - i) * sizeof(void *));
+  }
+  textures[i] = tex;
+  stats.textures++;
+
+  Record (RENDERNULL_LOAD_TEXTURE, tex, 0);
+  return ((gx3dTexture) tex);
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Free_Texture
+|
+| Input: Called from Render_Free_Texture() (through null_backend)
+| Output: Frees a texture handle, if this backend made it.
+|___________________________________________________________________*/
+
+static void Null_Free_Texture (gx3dTexture tex)
+{
+  int i;
+
+  Record (RENDERNULL_FREE_TEXTURE, (void *)tex, 0);
+  for (i=0; i<max_textures; i++)
+    if (textures[i] == (void *)tex) {
+      free (textures[i]);
+      textures[i] = 0;
+      stats.textures--;
+      break;
+    }
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Init_Light
+|
+| Input: Called from Render_Init_Light() (through null_backend)
+| Output: Returns a new light handle.
+|___________________________________________________________________*/
+
+static gx3dLight Null_Init_Light (gx3dLightData *)
+{
+  void *light;
+
+  light = malloc (sizeof(int));
+  lights = (void **) realloc (lights, (num_lights + 1) * sizeof(void *));
+  lights[num_lights++] = light;
+
+  Record (RENDERNULL_INIT_LIGHT, light, 0);
+  return ((gx3dLight) light);
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Clear
+|
+| Input: Called from Render_Clear() (through null_backend)
+| Output: Records a clear.
+|___________________________________________________________________*/
+
+static void Null_Clear (gxColor)
+{
+  Record (RENDERNULL_CLEAR, 0, 0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Begin_Render
+|
+| Input: Called from Render_Begin() (through null_backend)
+| Output: Records the start of drawing.  Always ready.
+|___________________________________________________________________*/
+
+static bool Null_Begin_Render ()
+{
+  Record (RENDERNULL_BEGIN_RENDER, 0, 0);
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_End_Render
+|
+| Input: Called from Render_End() (through null_backend)
+| Output: Records the end of drawing.
+|___________________________________________________________________*/
+
+static void Null_End_Render ()
+{
+  Record (RENDERNULL_END_RENDER, 0, 0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Flip
+|
+| Input: Called from Render_Flip() (through null_backend)
+| Output: Ends the frame: its commands become the last frame's and are
+|   counted.
+|___________________________________________________________________*/
+
+static void Null_Flip ()
+{
+  int i;
+  RenderNullCommand *t;
+
+  Record (RENDERNULL_FLIP, 0, 0);
+
+  // Time since the last flip
+  if (stats.frames) {
+    total_frame_ms += Timer_Elapsed_Ms (last_flip);
+    stats.frame_ms = total_frame_ms / stats.frames;
+  }
+  last_flip = Timer_Now_Ms ();
+  stats.frames++;
+
+  // Count the frame
+  stats.commands = num_commands;
+  memset (stats.count, 0, sizeof(stats.count));
+  for (i=0; i<num_commands; i++)
+    stats.count[commands[i].type]++;
+
+  // Swap the recorded and last frames
+  t = last_commands;
+  last_commands = commands;
+  commands = t;
+  num_last = num_commands;
+  i = max_last;
+  max_last = max_commands;
+  max_commands = i;
+  num_commands = 0;
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Set_Projection
+|
+| Input: Called from Render_Set_Projection(), Render_Set_Backend()
+|   (through null_backend)
+| Output: Keeps the projection for Null_Sphere_Visible().
+|___________________________________________________________________*/
+
+static void Null_Set_Projection (float fov, float near_plane, float far_plane, float aspect)
+{
+  Record (RENDERNULL_SET_PROJECTION, 0, 0);
+  proj_y = 1.0f / (float)tan ((fov * 3.14159265f / 180) / 2);
+  proj_x = proj_y / aspect;
+  near_z = near_plane;
+  far_z  = far_plane;
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Set_View_Matrix
+|
+| Input: Called from Render_Set_View_Matrix(), Render_Set_Backend()
+|   (through null_backend)
+| Output: Keeps the view matrix.
+|___________________________________________________________________*/
+
+static void Null_Set_View_Matrix (gx3dMatrix *m)
+{
+  Record (RENDERNULL_SET_VIEW_MATRIX, 0, 0);
+  view_matrix = *m;
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Get_View_Matrix
+|
+| Input: Called from Render_Get_View_Matrix(), Render_Set_Backend()
+|   (through null_backend)
+| Output: Returns the view matrix.
+|___________________________________________________________________*/
+
+static void Null_Get_View_Matrix (gx3dMatrix *m)
+{
+  Record (RENDERNULL_GET_VIEW_MATRIX, 0, 0);
+  *m = view_matrix;
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Set_Camera
+|
+| Input: Called from Render_Set_Camera() (through null_backend)
+| Output: Sets the view matrix to look from one point at another.
+|___________________________________________________________________*/
+
+static void Null_Set_Camera (gx3dVector *from, gx3dVector *to, gx3dVector *world_up)
+{
+  Record (RENDERNULL_SET_CAMERA, 0, 0);
+  gx3d_ComputeViewMatrix (&view_matrix, from, to, world_up);
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Set_Object_Matrix
+|
+| Input: Called from Render_Set_Object_Matrix(), Render_Draw_Instanced()
+|   (through null_backend)
+| Output: Records the command.
+|___________________________________________________________________*/
+
+static void Null_Set_Object_Matrix (gx3dObject *obj, gx3dMatrix *)
+{
+  Record (RENDERNULL_SET_OBJECT_MATRIX, obj, 0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Set_Material
+|
+| Input: Called from Render_Set_Material() (through null_backend)
+| Output: Records the command.
+|___________________________________________________________________*/
+
+static void Null_Set_Material (gx3dMaterialData *material)
+{
+  Record (RENDERNULL_SET_MATERIAL, material, 0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Set_Texture
+|
+| Input: Called from Render_Set_Texture(), Render_Draw_Instanced()
+|   (through null_backend)
+| Output: Records the command.
+|___________________________________________________________________*/
+
+static void Null_Set_Texture (int stage, gx3dTexture tex)
+{
+  Record (RENDERNULL_SET_TEXTURE, (void *)tex, stage);
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Set_Ambient_Light
+|
+| Input: Called from Render_Set_Ambient_Light() (through null_backend)
+| Output: Records the command.
+|___________________________________________________________________*/
+
+static void Null_Set_Ambient_Light (gx3dColor)
+{
+  Record (RENDERNULL_SET_AMBIENT_LIGHT, 0, 0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Enable_Light
+|
+| Input: Called from Render_Enable_Light() (through null_backend)
+| Output: Records the command.
+|___________________________________________________________________*/
+
+static void Null_Enable_Light (gx3dLight light)
+{
+  Record (RENDERNULL_ENABLE_LIGHT, (void *)light, 0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Disable_Light
+|
+| Input: Called from Render_Disable_Light() (through null_backend)
+| Output: Records the command.
+|___________________________________________________________________*/
+
+static void Null_Disable_Light (gx3dLight light)
+{
+  Record (RENDERNULL_DISABLE_LIGHT, (void *)light, 0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Enable_Alpha_Blending
+|
+| Input: Called from Render_Enable_Alpha_Blending() (through
+|   null_backend)
+| Output: Records the command.
+|___________________________________________________________________*/
+
+static void Null_Enable_Alpha_Blending ()
+{
+  Record (RENDERNULL_ENABLE_ALPHA_BLENDING, 0, 0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Disable_Alpha_Blending
+|
+| Input: Called from Render_Disable_Alpha_Blending() (through
+|   null_backend)
+| Output: Records the command.
+|___________________________________________________________________*/
+
+static void Null_Disable_Alpha_Blending ()
+{
+  Record (RENDERNULL_DISABLE_ALPHA_BLENDING, 0, 0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Enable_Alpha_Testing
+|
+| Input: Called from Render_Enable_Alpha_Testing() (through
+|   null_backend)
+| Output: Records the command.
+|___________________________________________________________________*/
+
+static void Null_Enable_Alpha_Testing (int reference)
+{
+  Record (RENDERNULL_ENABLE_ALPHA_TESTING, 0, reference);
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Disable_Alpha_Testing
+|
+| Input: Called from Render_Disable_Alpha_Testing() (through
+|   null_backend)
+| Output: Records the command.
+|___________________________________________________________________*/
+
+static void Null_Disable_Alpha_Testing ()
+{
+  Record (RENDERNULL_DISABLE_ALPHA_TESTING, 0, 0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Sphere_Visible
+|
+| Input: Called from Render_Sphere_Visible() (through null_backend)
+| Output: Returns false if a sphere is completely outside the view
+|   frustum.
+|___________________________________________________________________*/
+
+static bool Null_Sphere_Visible (gx3dSphere *sphere)
+{
+  float x, y, z, r;
+  bool visible;
+  gx3dVector *c = &sphere->center;
+  gx3dMatrix *m = &view_matrix;
+
+  // Center in view space
+  x = c->x * m->_00 + c->y * m->_10 + c->z * m->_20 + m->_30;
+  y = c->x * m->_01 + c->y * m->_11 + c->z * m->_21 + m->_31;
+  z = c->x * m->_02 + c->y * m->_12 + c->z * m->_22 + m->_32;
+  r = sphere->radius;
+
+  // Outside a plane: near, far, then the sides (each through the eye, normal proportional to (+-proj, -1))
+  visible = NOT ((z + r < near_z) OR (z - r > far_z) OR
+                 ( x * proj_x - z > r * sqrtf (proj_x * proj_x + 1)) OR
+                 (-x * proj_x - z > r * sqrtf (proj_x * proj_x + 1)) OR
+                 ( y * proj_y - z > r * sqrtf (proj_y * proj_y + 1)) OR
+                 (-y * proj_y - z > r * sqrtf (proj_y * proj_y + 1)));
+
+  Record (RENDERNULL_SPHERE_VISIBLE, 0, visible);
+  return (visible);
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Draw_Object
+|
+| Input: Called from Render_Draw_Object(), Render_Draw_Instanced()
+|   (through null_backend)
+| Output: Records the command.
+|___________________________________________________________________*/
+
+static void Null_Draw_Object (gx3dObject *obj)
+{
+  Record (RENDERNULL_DRAW_OBJECT, obj, 0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Null_Draw_Particles
+|
+| Input: Called from Render_Draw_Particles() (through null_backend)
+| Output: Records the command.
+|___________________________________________________________________*/
+
+static void Null_Draw_Particles (gx3dParticleSystem psys, gx3dMatrix *, unsigned, gx3dVector *)
+{
+  Record (RENDERNULL_DRAW_PARTICLES, (void *)psys, 0);
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderNull_Reset
+|
+| Input: Called from Program_Run()
+| Output: Starts counting frames over.
+|___________________________________________________________________*/
+
+void RenderNull_Reset ()
+{
+  int objects_loaded, textures_loaded;
+
+  objects_loaded  = stats.objects;
+  textures_loaded = stats.textures;
+  memset (&stats, 0, sizeof(stats));
+  stats.objects  = objects_loaded;
+  stats.textures = textures_loaded;
+  total_frame_ms = 0;
+  num_commands   = 0;
+  num_last       = 0;
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderNull_Get_Commands
+|
+| Input: Called from ____
+| Output: Returns the commands recorded for the last complete frame.
+|___________________________________________________________________*/
+
+RenderNullCommand *RenderNull_Get_Commands (int *count)
+{
+  *count = num_last;
+  return (last_commands);
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderNull_Command_Name
+|
+| Input: Called from RenderNull_Write_Stats()
+| Output: Returns the name of a kind of command.
+|___________________________________________________________________*/
+
+const char *RenderNull_Command_Name (int type)
+{
+  if ((type < 0) OR (type >= RENDERNULL_NUM_COMMANDS))
+    return ("?");
+  return (command_name[type]);
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderNull_Get_Stats
+|
+| Input: Called from RenderNull_Write_Stats()
+| Output: Returns statistics since RenderNull_Reset().
+|___________________________________________________________________*/
+
+void RenderNull_Get_Stats (RenderNullStats *null_stats)
+{
+  *null_stats = stats;
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderNull_Write_Stats
+|
+| Input: Called from Program_Run()
+| Output: Writes the statistics and the count of each kind of command
+|   in the last frame to the debug file.
+|___________________________________________________________________*/
+
+void RenderNull_Write_Stats ()
+{
+  int i;
+  char str [200];
+
+  sprintf (str, "Null render: %d frames, %.3f ms per frame, %d commands in the last frame, %d objects, %d textures",
+    stats.frames, stats.frame_ms, stats.commands, stats.objects, stats.textures);
+  debug_WriteFile (str);
+  for (i=0; i<RENDERNULL_NUM_COMMANDS; i++)
+    if (stats.count[i]) {
+      sprintf (str, "  %-24s %d", command_name[i], stats.count[i]);
+      debug_WriteFile (str);
+    }
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderNull_Free
+|
+| Input: Called from Program_Run()
+| Output: Frees the recorded commands and anything the backend loaded.
+|___________________________________________________________________*/
+
+void RenderNull_Free ()
+{
+  int i;
+
+  for (i=0; i<max_objects; i++)
+    free (objects[i]);
+  for (i=0; i<max_textures; i++)
+    free (textures[i]);
+  for (i=0; i<num_lights; i++)
+    free (lights[i]);
+  free (objects);
+  free (textures);
+  free (lights);
+  free (commands);
+  free (last_commands);
+  objects       = 0;
+  textures      = 0;
+  lights        = 0;
+  commands      = 0;
+  last_commands = 0;
+  max_objects = max_textures = num_lights = 0;
+  num_commands = max_commands = num_last = max_last = 0;
+  memset (&stats, 0, sizeof(stats));
+}
@@ -0,0 +1,73 @@
+/*____________________________________________________________________
+|
+| File: rendernull.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+// Kinds of commands recorded
+#define RENDERNULL_LOAD_OBJECT             0
+#define RENDERNULL_FREE_OBJECT             1
+#define RENDERNULL_LOAD_TEXTURE            2
+#define RENDERNULL_FREE_TEXTURE            3
+#define RENDERNULL_CLEAR                   4
+#define RENDERNULL_BEGIN_RENDER            5
+#define RENDERNULL_END_RENDER              6
+#define RENDERNULL_FLIP                    7
+#define RENDERNULL_SET_PROJECTION          8
+#define RENDERNULL_SET_VIEW_MATRIX         9
+#define RENDERNULL_GET_VIEW_MATRIX         10
+#define RENDERNULL_SET_CAMERA              11
+#define RENDERNULL_SET_OBJECT_MATRIX       12
+#define RENDERNULL_SET_MATERIAL            13
+#define RENDERNULL_SET_TEXTURE             14
+#define RENDERNULL_SET_AMBIENT_LIGHT       15
+#define RENDERNULL_ENABLE_LIGHT            16
+#define RENDERNULL_DISABLE_LIGHT           17
+#define RENDERNULL_ENABLE_ALPHA_BLENDING   18
+#define RENDERNULL_DISABLE_ALPHA_BLENDING  19
+#define RENDERNULL_ENABLE_ALPHA_TESTING    20
+#define RENDERNULL_DISABLE_ALPHA_TESTING   21
+#define RENDERNULL_SPHERE_VISIBLE          22
+#define RENDERNULL_DRAW_OBJECT             23
+#define RENDERNULL_DRAW_PARTICLES          24
+#define RENDERNULL_INIT_LIGHT              25
+#define RENDERNULL_TRANSFORM_OBJECT        26
+#define RENDERNULL_NUM_COMMANDS            27
+
+struct RenderNullCommand {
+  int   type;
+  void *handle;   // object, texture, light or particle system, if any
+  int   value;    // texture stage, alpha reference or (for RENDERNULL_SPHERE_VISIBLE) the result
+};
+
+struct RenderNullStats {
+  int   frames;                             // # of frames flipped since RenderNull_Reset()
+  float frame_ms;                           // average time from one flip to the next
+  int   commands;                           // # recorded in the last frame
+  int   count [RENDERNULL_NUM_COMMANDS];    // # of each kind in the last frame
+  int   objects;                            // # loaded and not yet freed
+  int   textures;
+};
+
+// Returns the null backend, which draws nothing but records and counts every command
+RenderBackend *RenderNull_Backend ();
+
+// Starts counting frames over
+void RenderNull_Reset ();
+
+// Returns the commands recorded for the last complete frame
+RenderNullCommand *RenderNull_Get_Commands (int *count);
+
+// Returns the name of a kind of command
+const char *RenderNull_Command_Name (int type);
+
+// Returns statistics since RenderNull_Reset()
+void RenderNull_Get_Stats (RenderNullStats *stats);
+
+// Writes the statistics and the count of each kind of command in the last frame to the debug file
+void RenderNull_Write_Stats ();
+
+// Frees the recorded commands and any objects, textures and lights made by the backend
+void RenderNull_Free ();
@@ -0,0 +1,758 @@
+/*____________________________________________________________________
+|
+| File: renderqueue.cpp
+|
+| Description: Sorted render queue.  Draws are submitted during the
+|   frame as a 64-bit sort key plus the object and its world matrix.
+|   At flush time the keys are radix sorted and the draws are issued
+|   in key order, changing render state only when the next draw needs
+|   something different from the last one.  Runs of draws of the same
+|   object with the same material go out as one instanced draw.
+|
+|   Key layout (most significant bits first):
+|     pass (3) | blend (1) | opaque: material (16) | depth (32)
+|                          | blended: far-to-near depth (32) | material (16)
+|   Opaque draws are grouped by material and drawn front to back
+|   within a material.  Blended draws are drawn back to front.
+|
+|   Sections of the scene can also be recorded in parallel, each into
+|   its own command buffer (arrays kept from frame to frame, so they
+|   stop growing after the first few frames), on the job threads if
+|   they're running.  The buffers are then appended to the queue in
+|   buffer order by the calling thread.  The
+|   sort is stable, so the draws come out in the same order whichever
+|   thread recorded what.
+|
+| Functions: RenderQueue_Add_Material
+|            RenderQueue_Begin
+|            RenderQueue_Submit
+|            RenderQueue_Record
+|            RenderQueue_Record_Parallel
+|             Record_Sections
+|             Record_Thread
+|             Record_Range
+|             Grow_Queue
+|             Make_Key
+|            RenderQueue_Flush
+|             Radix_Sort
+|             Set_Material
+|            RenderQueue_Get_Stats
+|            RenderQueue_Benchmark
+|             Benchmark_Section
+|            RenderQueue_Free
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+#include <math.h>
+
+#include "dp.h"
+
+#include "timer.h"
+#include "render.h"
+#include "renderqueue.h"
+#include "jobs.h"
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+typedef unsigned long long SortKey;
+
+struct Material {
+  gx3dTexture tex;
+  bool        blend;
+  gx3dColor   ambient;
+  gx3dLight   light;
+};
+
+struct DrawItem {
+  gx3dObject *obj;
+  int         material;
+  gx3dMatrix  matrix;
+};
+
+// Command buffer, recorded by one thread at a time
+struct Buffer {
+  DrawItem *items;
+  SortKey  *keys;
+  int       num_items;
+  int       max_items;
+  char      pad [64 - 2 * sizeof(void *) - 2 * sizeof(int)];  // keep threads from sharing a cache line
+};
+
+// State shared by all threads during a call to Record_Sections()
+struct RecordContext {
+  RenderQueueRecordFunc *funcs;
+  void                 **data;
+  int                    count;
+  volatile long          next;      // next section to record
+};
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static void Record_Sections (RenderQueueRecordFunc *funcs, void **data, int count, int num_threads);
+static DWORD WINAPI Record_Thread (LPVOID param);
+static void Record_Range (int first, int last, void *data);
+static void Grow_Queue (int n);
+static SortKey Make_Key (int pass, int material, gx3dMatrix *world_matrix);
+static void Radix_Sort (int n);
+static void Benchmark_Section (int buffer, void *data);
+static void Set_Material (int material);
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define PASS_SHIFT  61
+#define BLEND_SHIFT 60
+
+/*___________________
+|
+| Global variables
+|__________________*/
+
+static Material materials [RQ_MAX_MATERIALS];
+static int      num_materials = 0;
+
+static DrawItem *items     = 0;
+static SortKey  *keys      = 0;   // keys[i] and order[i] are sorted together
+static int      *order     = 0;
+static SortKey  *temp_keys = 0;
+static int      *temp_order = 0;
+static gx3dMatrix *batch    = 0;   // world matrices of an instanced draw
+static int       num_items = 0;
+static int       max_items = 0;
+
+static Buffer buffers [RQ_MAX_BUFFERS];
+
+static gx3dVector camera, heading;
+
+// Render state set by the last draw
+static bool        state_valid;
+static Material    state;
+
+static RenderQueueStats stats;
+static RenderQueueStats record_stats;   // recording part, kept until the next recording
+
+/*____________________________________________________________________
+|
+| Function: RenderQueue_Add_Material
+|
+| Input: Called from Program_Run()
+| Output: Creates a material.  Returns material id or -1 on error.
+|___________________________________________________________________*/
+
+int RenderQueue_Add_Material (
+  gx3dTexture tex,
+  bool        blend,
+  gx3dColor   ambient,
+  gx3dLight   light )
+{
+  if (num_materials == RQ_MAX_MATERIALS)
+    return (-1);
+
+  materials[num_materials].tex     = tex;
+  materials[num_materials].blend   = blend;
+  materials[num_materials].ambient = ambient;
+  materials[num_materials].light   = light;
+
+  return (num_materials++);
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderQueue_Begin
+|
+| Input: Called from Program_Run()
+| Output: Empties the queue and sets the camera for this frame.
+|___________________________________________________________________*/
+
+void RenderQueue_Begin (gx3dVector *camera_position, gx3dVector *camera_heading)
+{
+  camera    = *camera_position;
+  heading   = *camera_heading;
+  num_items = 0;
+  memset (&record_stats, 0, sizeof(record_stats));
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderQueue_Submit
+|
+| Input: Called from Program_Run()
+| Output: Adds a draw to the queue.
+|___________________________________________________________________*/
+
+void RenderQueue_Submit (int pass, int material, gx3dObject *obj, gx3dMatrix *world_matrix)
+{
+  int n;
+
+  if ((material < 0) OR (material >= num_materials))
+    return;
+
+  if (num_items == max_items)
+    Grow_Queue (num_items + 1);
+
+  n = num_items++;
+  items[n].obj      = obj;
+  items[n].material = material;
+  items[n].matrix   = *world_matrix;
+  keys[n]  = Make_Key (pass, material, world_matrix);
+  order[n] = n;
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderQueue_Record
+|
+| Input: Called from Foliage_Submit(), StaticBatch_Submit(), functions
+|   called by RenderQueue_Record_Parallel()
+| Output: Adds a draw to a command buffer.
+|___________________________________________________________________*/
+
+void RenderQueue_Record (int buffer, int pass, int material, gx3dObject *obj, gx3dMatrix *world_matrix)
+{
+  int n;
+  Buffer *b;
+
+  if ((buffer < 0) OR (buffer >= RQ_MAX_BUFFERS) OR (material < 0) OR (material >= num_materials))
+    return;
+
+  b = &buffers[buffer];
+  if (b->num_items == b->max_items) {
+    n = b->max_items ? b->max_items * 2 : 256;
+    b->items = (DrawItem *) realloc (b->items, n * sizeof(DrawItem));
+    b->keys  = (SortKey *)  realloc (b->keys,  n * sizeof(SortKey));
+    b->max_items = n;
+  }
+
+  n = b->num_items++;
+  b->items[n].obj      = obj;
+  b->items[n].material = material;
+  b->items[n].matrix   = *world_matrix;
+  b->keys[n] = Make_Key (pass, material, world_matrix);
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderQueue_Record_Parallel
+|
+| Input: Called from Program_Run()
+| Output: Records sections of the scene into buffers on the job
+|   threads (or else up to one thread per processor) and adds the
+|   buffers to the queue in order.
+|___________________________________________________________________*/
+
+void RenderQueue_Record_Parallel (RenderQueueRecordFunc *funcs, void **data, int count)
+{
+  int num_threads;
+  SYSTEM_INFO info;
+
+  if (Jobs_Num_Threads ()) {
+    Record_Sections (funcs, data, count, 0);
+    return;
+  }
+
+  GetSystemInfo (&info);
+  num_threads = (int)info.dwNumberOfProcessors;
+  if (num_threads > RQ_MAX_THREADS)
+    num_threads = RQ_MAX_THREADS;
+
+  Record_Sections (funcs, data, count, num_threads);
+}
+
+/*____________________________________________________________________
+|
+| Function: Record_Sections
+|
+| Input: Called from RenderQueue_Record_Parallel(),
+|   RenderQueue_Benchmark()
+| Output: Records sections into buffers on up to num_threads threads
+|   (including this one), or on the job threads if num_threads is 0,
+|   then appends the buffers to the queue.
+|___________________________________________________________________*/
+
+static void Record_Sections (RenderQueueRecordFunc *funcs, void **data, int count, int num_threads)
+{
+  int i, n, total;
+  HANDLE thread [RQ_MAX_THREADS];
+  double start;
+  RecordContext ctx;
+
+  memset (&record_stats, 0, sizeof(record_stats));
+  if (count > RQ_MAX_BUFFERS)
+    count = RQ_MAX_BUFFERS;
+  if (count <= 0)
+    return;
+
+  start = Timer_Now_Ms ();
+
+  for (i=0; i<count; i++)
+    buffers[i].num_items = 0;
+  ctx.funcs = funcs;
+  ctx.data  = data;
+  ctx.count = count;
+  ctx.next  = 0;
+
+  if (num_threads == 0) {
+    // One section per job, no threads to start
+    Jobs_Parallel_For (count, 1, Record_Range, &ctx);
+    record_stats.record_threads = Jobs_Num_Threads ();
+  }
+  else {
+    if (num_threads > count)
+      num_threads = count;
+    if (num_threads > RQ_MAX_THREADS)
+      num_threads = RQ_MAX_THREADS;
+
+    // This thread is one of the workers
+    n = 0;
+    for (i=1; i<num_threads; i++) {
+      thread[n] = CreateThread (NULL, 0, Record_Thread, &ctx, 0, NULL);
+      if (thread[n])
+        n++;
+    }
+    Record_Thread (&ctx);
+    if (n) {
+      WaitForMultipleObjects (n, thread, TRUE, INFINITE);
+      for (i=0; i<n; i++)
+        CloseHandle (thread[i]);
+    }
+    record_stats.record_threads = n + 1;
+  }
+  record_stats.record_ms = Timer_Elapsed_Ms (start);
+
+  // Append the buffers in order
+  start = Timer_Now_Ms ();
+  for (i=0, total=num_items; i<count; i++)
+    total += buffers[i].num_items;
+  if (total > max_items)
+    Grow_Queue (total);
+  for (i=0; i<count; i++) {
+    memcpy (&items[num_items], buffers[i].items, buffers[i].num_items * sizeof(DrawItem));
+    memcpy (&keys[num_items],  buffers[i].keys,  buffers[i].num_items * sizeof(SortKey));
+    num_items += buffers[i].num_items;
+  }
+  for (i=0; i<num_items; i++)
+    order[i] = i;
+  record_stats.merge_ms = Timer_Elapsed_Ms (start);
+}
+
+/*____________________________________________________________________
+|
+| Function: Record_Thread
+|
+| Input: Called from Record_Sections() (directly and as a thread)
+| Output: Records sections until there are none left.
+|___________________________________________________________________*/
+
+static DWORD WINAPI Record_Thread (LPVOID param)
+{
+  int i;
+  RecordContext *ctx = (RecordContext *)param;
+
+  for (;;) {
+    i = (int)InterlockedIncrement (&ctx->next) - 1;
+    if (i >= ctx->count)
+      break;
+    (*ctx->funcs[i]) (i, ctx->data[i]);
+  }
+
+  return (0);
+}
+
+/*____________________________________________________________________
+|
+| Function: Record_Range
+|
+| Input: Called from Record_Sections() (as a job)
+| Output: Records sections first to last-1.
+|___________________________________________________________________*/
+
+static void Record_Range (int first, int last, void *data)
+{
+  int i;
+  RecordContext *ctx = (RecordContext *)data;
+
+  for (i=first; i<last; i++)
+    (*ctx->funcs[i]) (i, ctx->data[i]);
+}
+
+/*____________________________________________________________________
+|
+| Function: Grow_Queue
+|
+| Input: Called from RenderQueue_Submit(), Record_Sections()
+| Output: Makes room in the queue for at least n draws.
+|___________________________________________________________________*/
+
+static void Grow_Queue (int n)
+{
+  int size;
+
+  size = max_items ? max_items : 256;
+  while (size < n)
+    size *= 2;
+  items      = (DrawItem *) realloc (items,      size * sizeof(DrawItem));
+  keys       = (SortKey *)  realloc (keys,       size * sizeof(SortKey));
+  order      = (int *)      realloc (order,      size * sizeof(int));
+  temp_keys  = (SortKey *)  realloc (temp_keys,  size * sizeof(SortKey));
+  temp_order = (int *)      realloc (temp_order, size * sizeof(int));
+  batch      = (gx3dMatrix *) realloc (batch,    size * sizeof(gx3dMatrix));
+  max_items = size;
+}
+
+/*____________________________________________________________________
+|
+| Function: Make_Key
+|
+| Input: Called from RenderQueue_Submit(), RenderQueue_Record()
+| Output: Returns the sort key of a draw.
+|___________________________________________________________________*/
+
+static SortKey Make_Key (int pass, int material, gx3dMatrix *world_matrix)
+{
+  float depth;
+  unsigned depth_bits;
+  SortKey key;
+
+  // Distance along the view direction (anything behind the camera counts as 0)
+  depth = (world_matrix->_30 - camera.x) * heading.x +
+          (world_matrix->_31 - camera.y) * heading.y +
+          (world_matrix->_32 - camera.z) * heading.z;
+  if (depth < 0)
+    depth = 0;
+  // Bits of a positive float sort in the same order as the float
+  memcpy (&depth_bits, &depth, sizeof(depth_bits));
+
+  key = (SortKey)pass << PASS_SHIFT;
+  if (materials[material].blend)
+    key |= ((SortKey)1 << BLEND_SHIFT) | ((SortKey)(~depth_bits) << 16) | (SortKey)material;
+  else
+    key |= ((SortKey)material << 32) | (SortKey)depth_bits;
+
+  return (key);
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderQueue_Flush
+|
+| Input: Called from Program_Run()
+| Output: Sorts the queue and draws it.
+|___________________________________________________________________*/
+
+void RenderQueue_Flush ()
+{
+  int i, n;
+  DrawItem *item, *next;
+  double start;
+
+  memset (&stats, 0, sizeof(stats));
+  stats.record_threads = record_stats.record_threads;
+  stats.record_ms      = record_stats.record_ms;
+  stats.merge_ms       = record_stats.merge_ms;
+
+  start = Timer_Now_Ms ();
+  Radix_Sort (num_items);
+  stats.sort_ms = Timer_Elapsed_Ms (start);
+
+  state_valid = false;
+  for (i=0; i<num_items; i+=n) {
+    item = &items[order[i]];
+    Set_Material (item->material);
+    // Gather the run of draws of this object with this material
+    batch[0] = item->matrix;
+    for (n=1; i+n<num_items; n++) {
+      next = &items[order[i+n]];
+      if ((next->obj != item->obj) OR (next->material != item->material))
+        break;
+      batch[n] = next->matrix;
+    }
+    if (n == 1) {
+      Render_Set_Object_Matrix (item->obj, &item->matrix);
+      Render_Draw_Object (item->obj);
+    }
+    else {
+      Render_Draw_Instanced (item->obj, 0, batch, n);
+      stats.batches++;
+    }
+  }
+  stats.draws = num_items;
+
+  // Leave state the way the caller expects it
+  if (state_valid) {
+    if (state.blend) {
+      Render_Disable_Alpha_Blending ();
+      Render_Disable_Alpha_Testing ();
+    }
+    if (state.light)
+      Render_Disable_Light (state.light);
+  }
+  num_items = 0;
+}
+
+/*____________________________________________________________________
+|
+| Function: Radix_Sort
+|
+| Input: Called from RenderQueue_Flush()
+| Output: Sorts keys[] and order[] by key, 8 bits at a time starting
+|   with the least significant byte.  Bytes that are the same in every
+|   key (most of the high bytes, usually) are skipped.
+|___________________________________________________________________*/
+
+static void Radix_Sort (int n)
+{
+  int i, byte, shift, sum, t;
+  SortKey *sk;
+  int *so;
+  static int count [8][256];
+
+  if (n < 2)
+    return;
+
+  // Histogram all 8 bytes in one pass over the keys
+  memset (count, 0, sizeof(count));
+  for (i=0; i<n; i++)
+    for (byte=0; byte<8; byte++)
+      count[byte][(keys[i] >> (byte * 8)) & 0xFF]++;
+
+  for (byte=0; byte<8; byte++) {
+    shift = byte * 8;
+    if (count[byte][(keys[0] >> shift) & 0xFF] == n)
+      continue;
+    // Counts to starting offsets
+    for (i=0, sum=0; i<256; i++) {
+      t = count[byte][i];
+      count[byte][i] = sum;
+      sum += t;
+    }
+    for (i=0; i<n; i++) {
+      t = count[byte][(keys[i] >> shift) & 0xFF]++;
+      temp_keys[t]  = keys[i];
+      temp_order[t] = order[i];
+    }
+    sk = keys;  keys  = temp_keys;  temp_keys  = sk;
+    so = order; order = temp_order; temp_order = so;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Set_Material
+|
+| Input: Called from RenderQueue_Flush()
+| Output: Changes only the render state that differs from the last draw.
+|___________________________________________________________________*/
+
+static void Set_Material (int material)
+{
+  Material *m = &materials[material];
+
+  if ((NOT state_valid) OR (m->blend != state.blend)) {
+    if (m->blend) {
+      Render_Enable_Alpha_Blending ();
+      Render_Enable_Alpha_Testing (128);
+    }
+    else {
+      Render_Disable_Alpha_Blending ();
+      Render_Disable_Alpha_Testing ();
+    }
+    stats.blend_changes++;
+  }
+  if ((NOT state_valid) OR (m->tex != state.tex)) {
+    Render_Set_Texture (0, m->tex);
+    stats.texture_changes++;
+  }
+  if ((NOT state_valid) OR memcmp (&m->ambient, &state.ambient, sizeof(gx3dColor))) {
+    Render_Set_Ambient_Light (m->ambient);
+    stats.light_changes++;
+  }
+  if ((NOT state_valid) OR (m->light != state.light)) {
+    if (state_valid AND state.light)
+      Render_Disable_Light (state.light);
+    if (m->light)
+      Render_Enable_Light (m->light);
+    stats.light_changes++;
+  }
+
+  state       = *m;
+  state_valid = true;
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderQueue_Get_Stats
+|
+| Input: Called from ____
+| Output: Returns statistics for the last call to RenderQueue_Flush().
+|___________________________________________________________________*/
+
+void RenderQueue_Get_Stats (RenderQueueStats *render_stats)
+{
+  *render_stats = stats;
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderQueue_Benchmark
+|
+| Input: Called from Program_Run()
+| Output: Records the same synthetic scene on 1, 2, 4, 8 and 16
+|   threads, checks each gives the same queue as 1 thread and writes
+|   the best of several times for each to the debug file.
+|___________________________________________________________________*/
+
+void RenderQueue_Benchmark ()
+{
+  int i, j, t, num_threads, n1;
+  bool same;
+  float best, best1, merge;
+  char str [200];
+  RenderQueueRecordFunc funcs [RQ_MAX_BUFFERS];
+  void *data [RQ_MAX_BUFFERS];
+  int section [RQ_MAX_BUFFERS];
+  SortKey *keys1;
+  DrawItem *items1;
+  SYSTEM_INFO info;
+  gx3dVector position = { 0, 0, 0 }, direction = { 0, 0, 1 };
+
+  if (num_materials == 0)
+    return;
+
+  for (i=0; i<RQ_MAX_BUFFERS; i++) {
+    section[i] = i;
+    funcs[i]   = Benchmark_Section;
+    data[i]    = &section[i];
+  }
+  GetSystemInfo (&info);
+
+  keys1  = 0;
+  items1 = 0;
+  n1     = 0;
+  best1  = 0;
+  same   = true;
+  for (num_threads=1; num_threads<=RQ_MAX_THREADS; num_threads*=2) {
+    best  = 0;
+    merge = 0;
+    for (t=0; t<10; t++) {
+      RenderQueue_Begin (&position, &direction);
+      Record_Sections (funcs, data, RQ_MAX_BUFFERS, num_threads);
+      if ((t == 0) OR (record_stats.record_ms < best))
+        best = record_stats.record_ms;
+      merge += record_stats.merge_ms / 10;
+    }
+    if (num_threads == 1) {
+      n1     = num_items;
+      best1  = best;
+      keys1  = (SortKey *)  malloc (n1 * sizeof(SortKey));
+      items1 = (DrawItem *) malloc (n1 * sizeof(DrawItem));
+      memcpy (keys1,  keys,  n1 * sizeof(SortKey));
+      memcpy (items1, items, n1 * sizeof(DrawItem));
+    }
+    else if (num_items != n1)
+      same = false;
+    else
+      for (j=0; j<n1; j++)
+        if ((keys[j] != keys1[j]) OR (items[j].material != items1[j].material) OR
+            memcmp (&items[j].matrix, &items1[j].matrix, sizeof(gx3dMatrix))) {
+          same = false;
+          break;
+        }
+    sprintf (str, "Render queue record: %d sections, %d draws, %d thread%s %.3f ms (%.2fx), merge %.3f ms",
+      RQ_MAX_BUFFERS, num_items, record_stats.record_threads, record_stats.record_threads == 1 ? "" : "s", best, best > 0 ? best1 / best : 0, merge);
+    debug_WriteFile (str);
+  }
+  sprintf (str, "Render queue record: %d processors, results %s", (int)info.dwNumberOfProcessors, same ? "match" : "DIFFER");
+  debug_WriteFile (str);
+
+  free (keys1);
+  free (items1);
+  num_items = 0;
+  memset (&record_stats, 0, sizeof(record_stats));
+}
+
+/*____________________________________________________________________
+|
+| Function: Benchmark_Section
+|
+| Input: Called from Record_Thread() (through RenderQueue_Benchmark())
+| Output: Records one section of a synthetic scene: a square of
+|   instances, each placed, turned and tested against a view cone,
+|   about the work a real section does per draw.
+|___________________________________________________________________*/
+
+static void Benchmark_Section (int buffer, void *data)
+{
+  int i, j, k, section;
+  float x, z, d;
+  gx3dMatrix m, m1, m2;
+  gx3dVector corner, v;
+
+  section = *(int *)data;
+  for (i=0; i<64; i++)
+    for (j=0; j<64; j++) {
+      x = (float)((section % 4) * 64 + j - 128) * 40;
+      z = (float)((section / 4) * 64 + i) * 40;
+      gx3d_GetRotateYMatrix (&m1, (float)((i * 64 + j) % 360));
+      gx3d_GetTranslateMatrix (&m2, x, 0, z);
+      gx3d_MultiplyMatrix (&m1, &m2, &m);
+      // In front of the camera and within 45 degrees of the view direction?
+      for (k=0; k<8; k++) {
+        corner.x = (k & 1) ? 10.0f : -10.0f;
+        corner.y = (k & 2) ? 10.0f : -10.0f;
+        corner.z = (k & 4) ? 10.0f : -10.0f;
+        gx3d_MultiplyVectorMatrix (&corner, &m, &v);
+        d = v.z - (float)fabs (v.x);
+        if (d >= 0)
+          break;
+      }
+      if (k < 8)
+        RenderQueue_Record (buffer, RQ_PASS_OPAQUE, (i + j + section) % num_materials, 0, &m);
+    }
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderQueue_Free
+|
+| Input: Called from Program_Run()
+| Output: Frees the queue.
+|___________________________________________________________________*/
+
+void RenderQueue_Free ()
+{
+  int i;
+
+  for (i=0; i<RQ_MAX_BUFFERS; i++) {
+    free (buffers[i].items);
+    free (buffers[i].keys);
+  }
+  memset (buffers, 0, sizeof(buffers));
+  free (items);
+  free (keys);
+  free (order);
+  free (temp_keys);
+  free (temp_order);
+  free (batch);
+  items      = 0;
+  batch      = 0;
+  keys       = temp_keys  = 0;
+  order      = temp_order = 0;
+  num_items  = max_items  = 0;
+  num_materials = 0;
+}
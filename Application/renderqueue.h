@@ -0,0 +1,69 @@
+/*____________________________________________________________________
+|
+| File: renderqueue.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+// Passes, drawn in this order
+#define RQ_PASS_SKY     0
+#define RQ_PASS_OPAQUE  1
+#define RQ_PASS_ALPHA   2       // alpha blended, drawn back to front
+
+#define RQ_MAX_MATERIALS 64
+
+// Command buffers that can be recorded at the same time by different threads
+#define RQ_MAX_BUFFERS   16
+#define RQ_MAX_THREADS   16
+
+// Records draws into one command buffer (see RenderQueue_Record_Parallel())
+typedef void (*RenderQueueRecordFunc) (int buffer, void *data);
+
+// Per-frame statistics
+struct RenderQueueStats {
+  int   draws;              // # of objects drawn
+  int   batches;            // # of instanced draws of runs with the same object and material
+  int   texture_changes;
+  int   blend_changes;
+  int   light_changes;      // includes ambient light changes
+  float sort_ms;            // time spent sorting
+  int   record_threads;     // # of threads used by the last call to RenderQueue_Record_Parallel()
+  float record_ms;          // time it spent recording
+  float merge_ms;           // time it spent merging the buffers into the queue
+};
+
+// Creates a material (render state shared by many draws), returns material id or -1 on error
+int RenderQueue_Add_Material (
+  gx3dTexture tex,
+  bool        blend,        // alpha blending and alpha testing on?
+  gx3dColor   ambient,
+  gx3dLight   light );      // light to enable or 0 for none
+
+// Empties the queue and sets the camera used to compute depth
+void RenderQueue_Begin (gx3dVector *camera_position, gx3dVector *camera_heading);
+
+// Adds a draw to the queue (the matrix is copied)
+void RenderQueue_Submit (int pass, int material, gx3dObject *obj, gx3dMatrix *world_matrix);
+
+// Adds a draw to a command buffer.  Different threads may record into different buffers at the same time.
+void RenderQueue_Record (int buffer, int pass, int material, gx3dObject *obj, gx3dMatrix *world_matrix);
+
+// Empties buffers 0 to count-1, calls each function with its own buffer (funcs[i] records into buffer i)
+//  on as many threads as there are processors, then adds the buffers to the queue in buffer order.  The
+//  queue ends up the same however many threads are used.  Functions may only read state that doesn't
+//  change until this returns, and must not call the renderer.
+void RenderQueue_Record_Parallel (RenderQueueRecordFunc *funcs, void **data, int count);
+
+// Sorts and draws everything in the queue, leaves alpha blending and all material lights off
+void RenderQueue_Flush ();
+
+// Returns statistics for the last call to RenderQueue_Flush()
+void RenderQueue_Get_Stats (RenderQueueStats *stats);
+
+// Times recording a synthetic scene into 16 buffers on 1 to 16 threads, checks every thread count
+//  gives the same queue and writes the results to the debug file.  Empties the queue.
+void RenderQueue_Benchmark ();
+
+// Free any resources
+void RenderQueue_Free ();
@@ -0,0 +1,2385 @@
+/*____________________________________________________________________
+|
+| File: rendersoft.cpp
+|
+| Description: Rendering backend that rasterizes on the CPU into its
+|   own frame buffer, so frames can be rendered (and written to image
+|   files) without a GPU.  Draws are recorded with the state they were
+|   made with and the whole frame is rendered at each flip:
+|
+|   1. Vertex stage (one thread per processor, a draw at a time):
+|      vertices are lit per vertex (Gouraud) the way fixed function
+|      Direct3D lights them, projected, clipped to the near plane and a
+|      guard band, back faces are culled, and each triangle is set up as
+|      3 edge functions and 7 attribute planes (z, 1/w, u/w, v/w, r/w,
+|      g/w, b/w) in screen space.
+|   2. Binning: triangles are added, in draw order, to each 64x64 pixel
+|      tile their bounding rectangle touches.
+|   3. Raster stage (one thread per processor, a tile at a time, so no
+|      pixel is touched by 2 threads): SSE2 evaluates the edge functions
+|      and planes 4 pixels at a time, with the top-left fill rule, a
+|      less-or-equal depth test and perspective correct attributes.
+|      Textures are sampled bilinear with wrap addressing from the
+|      mipmap level that fits the first covered pixel of each 4, and
+|      modulate the vertex color.  Alpha testing and (src alpha, inv src
+|      alpha) blending follow the state set in RenderGx3d_Init().
+|
+|   Objects are read from their LWO2 files, textures from 24 or 32-bit
+|   bmp files (with sizes a power of 2, the intensity of the alpha file
+|   becomes the alpha channel).  Particle systems aren't drawn.  Objects,
+|   textures and lights made by another backend are skipped.  The last
+|   frame's commands are kept so it can be rendered again, to benchmark
+|   other frame buffer sizes.
+|
+|   It needs no Windows or gx3d device (see portable.h), so headless.cpp
+|   can run it on any platform.
+|
+| Functions: RenderSoft_Backend
+|             Soft_Load_Object
+|             Soft_Free_Object
+|             Soft_Transform_Object
+|             Soft_Set_Vertex_Colors
+|             Soft_Load_Texture
+|             Soft_Free_Texture
+|             Soft_Init_Light
+|             Soft_Clear
+|             Soft_Begin_Render
+|             Soft_End_Render
+|             Soft_Flip
+|             Soft_Set_Projection
+|             Soft_Set_View_Matrix
+|             Soft_Get_View_Matrix
+|             Soft_Set_Camera
+|             Soft_Set_Object_Matrix
+|             Soft_Set_Material
+|             Soft_Set_Texture
+|             Soft_Set_Ambient_Light
+|             Soft_Enable_Light
+|             Soft_Disable_Light
+|             Soft_Enable_Alpha_Blending
+|             Soft_Disable_Alpha_Blending
+|             Soft_Enable_Alpha_Testing
+|             Soft_Disable_Alpha_Testing
+|             Soft_Sphere_Visible
+|             Soft_Draw_Object
+|             Soft_Draw_Particles
+|              Add_Command
+|            RenderSoft_Init
+|             Resize_Buffers
+|            RenderSoft_Write_Image
+|            RenderSoft_Set_Capture
+|            RenderSoft_Get_Stats
+|            RenderSoft_Write_Stats
+|            RenderSoft_Benchmark
+|            RenderSoft_Free
+|             Render_Frame
+|             Clear_Buffers
+|             Draw_Batch
+|             Run_Threads
+|             Vertex_Thread
+|             Transform_Draw
+|             Prepare_Lights
+|             Light_Vertex
+|             Clip_Triangle
+|             Setup_Triangle
+|             Raster_Thread
+|             Raster_Triangle
+|             Mip_Level
+|             Sample_Texture
+|             Channel
+|             Floor
+|             Pack_Color
+|             Normal_Matrix
+|             Compute_Bounds
+|             Read_Bmp
+|             Add_Handle
+|             Remove_Handle
+|             Has_Handle
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#ifdef _WIN32
+#include <first_header.h>
+#endif
+#include <stdio.h>
+#include <math.h>
+#include <emmintrin.h>
+
+#include <atomic>
+#include <thread>
+
+#include "portable.h"
+
+#include "lwo2.h"
+#include "render.h"
+#include "timer.h"
+#include "rendersoft.h"
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define COMMAND_CLEAR 0
+#define COMMAND_DRAW  1
+
+// Attribute planes of a triangle
+#define PLANE_Z    0
+#define PLANE_W    1    // 1/w
+#define PLANE_U    2    // u/w
+#define PLANE_V    3
+#define PLANE_R    4    // r/w
+#define PLANE_G    5
+#define PLANE_B    6
+#define NUM_PLANES 7
+
+// Triangles are clipped so their screen coordinates stay within this many viewports of the center
+#define GUARD_BAND 4
+#define NUM_CLIP_PLANES 5   // near, then the guard band sides
+
+#define TILE RENDERSOFT_TILE_SIZE
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+// Object loaded by this backend
+struct SoftObject {
+  gx3dObject  obj;              // bounds the game sees (first, so a SoftObject * is its gx3dObject *)
+  Lwo2Vertex *vertex;           // 3 per triangle, in feet
+  int         num_triangles;
+  gx3dMatrix  matrix;           // world matrix
+  gx3dColor  *color;            // baked color of each triangle corner, drawn in place of lighting (0 for none)
+};
+
+// Texture and its mipmaps, texels are 0xAARRGGBB with the top row first
+struct SoftTexture {
+  int       num_levels;
+  int       width [RENDERSOFT_MAX_LEVELS];
+  int       height [RENDERSOFT_MAX_LEVELS];
+  unsigned *texel [RENDERSOFT_MAX_LEVELS];
+};
+
+// Render state a draw is made with
+struct SoftState {
+  SoftTexture      *texture;            // 0 for none
+  bool              blend;
+  int               alpha_reference;    // -1 if alpha testing is off
+  gx3dColor         ambient;
+  gx3dMaterialData  material;
+  int               num_lights;
+  gx3dLightData    *light [RENDERSOFT_MAX_LIGHTS];
+};
+
+// Camera a draw is seen from
+struct SoftView {
+  gx3dMatrix matrix;
+  float      proj_y;                    // the x scale follows from the size of the frame buffer
+  float      near_z, far_z;
+};
+
+struct SoftCommand {
+  int         type;
+  gxColor     color;                    // COMMAND_CLEAR
+  SoftObject *obj;                      // COMMAND_DRAW
+  gx3dMatrix  matrix;
+  int         state, view;              // indices into the frame's states and views
+};
+
+// Commands of one frame and the states and views they use
+struct SoftFrame {
+  SoftCommand *command;
+  int          num_commands, max_commands;
+  SoftState   *state;
+  int          num_states, max_states;
+  SoftView    *view;
+  int          num_views, max_views;
+};
+
+// Light in world space, with its colors times the material's
+struct PreparedLight {
+  bool       point;
+  gx3dVector vector;                    // direction to a directional light, or position of a point light
+  gx3dColor  ambient;
+  gx3dColor  diffuse;
+  float      range, attenuation0, attenuation1, attenuation2;
+};
+
+// Vertex in clip space
+struct ClipVertex {
+  float x, y, z, w;
+  float u, v;
+  float r, g, b;
+};
+
+// Triangle set up for rasterizing.  Each edge and attribute is a*x + b*y + c in screen space.
+struct SoftTriangle {
+  float      edge [3][3];               // >= 0 inside
+  float      plane [NUM_PLANES][3];
+  int        xmin, ymin, xmax, ymax;    // bounding rectangle of pixels
+  unsigned   top_left;                  // bit i set if edge i is a top or left edge
+  float      alpha;                     // 0-255, used if there's no texture
+  SoftState *state;
+};
+
+// Triangles set up by one thread
+struct TriangleList {
+  SoftTriangle *triangle;
+  int           count, max;
+};
+
+// Triangles touching one tile, in draw order
+struct TileBin {
+  SoftTriangle **triangle;
+  int            count, max;
+};
+
+// Draws being set up by the vertex threads
+struct BatchContext {
+  SoftFrame     *frame;
+  SoftCommand   *command;
+  int              count;
+  std::atomic<int> next;
+};
+
+struct VertexWork {
+  BatchContext *ctx;
+  int           list;                   // index of this thread's triangle list
+};
+
+struct RasterContext {
+  std::atomic<int> next;
+};
+
+// Things made by this backend
+struct HandleList {
+  void **item;
+  int    count, max;
+};
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static gx3dObject  *Soft_Load_Object (const char *lwo_filename);
+static void         Soft_Free_Object (gx3dObject *obj);
+static void         Soft_Transform_Object (gx3dObject *obj, gx3dMatrix *m);
+static bool         Soft_Set_Vertex_Colors (gx3dObject *obj, gx3dColor *colors, int count);
+static gx3dTexture  Soft_Load_Texture (const char *filename, const char *alpha_filename);
+static void         Soft_Free_Texture (gx3dTexture tex);
+static gx3dLight    Soft_Init_Light (gx3dLightData *data);
+static void         Soft_Clear (gxColor color);
+static bool         Soft_Begin_Render ();
+static void         Soft_End_Render ();
+static void         Soft_Flip ();
+static void         Soft_Set_Projection (float fov, float near_plane, float far_plane, float aspect);
+static void         Soft_Set_View_Matrix (gx3dMatrix *m);
+static void         Soft_Get_View_Matrix (gx3dMatrix *m);
+static void         Soft_Set_Camera (gx3dVector *from, gx3dVector *to, gx3dVector *world_up);
+static void         Soft_Set_Object_Matrix (gx3dObject *obj, gx3dMatrix *m);
+static void         Soft_Set_Material (gx3dMaterialData *material);
+static void         Soft_Set_Texture (int stage, gx3dTexture tex);
+static void         Soft_Set_Ambient_Light (gx3dColor color);
+static void         Soft_Enable_Light (gx3dLight light);
+static void         Soft_Disable_Light (gx3dLight light);
+static void         Soft_Enable_Alpha_Blending ();
+static void         Soft_Disable_Alpha_Blending ();
+static void         Soft_Enable_Alpha_Testing (int reference);
+static void         Soft_Disable_Alpha_Testing ();
+static bool         Soft_Sphere_Visible (gx3dSphere *sphere);
+static void         Soft_Draw_Object (gx3dObject *obj);
+static void         Soft_Draw_Particles (gx3dParticleSystem psys, gx3dMatrix *m, unsigned elapsed_ms, gx3dVector *heading);
+static SoftCommand *Add_Command (int type);
+static bool         Resize_Buffers (int new_width, int new_height);
+static float        Render_Frame (SoftFrame *f);
+static void         Clear_Buffers (gxColor color);
+static void         Draw_Batch (SoftFrame *f, SoftCommand *command, int count);
+static void         Run_Threads (void (*func) (void *param), void **params, int n);
+static void         Vertex_Thread (void *param);
+static void         Transform_Draw (SoftFrame *f, SoftCommand *command, TriangleList *list);
+static int          Prepare_Lights (SoftState *s, PreparedLight *light);
+static void         Light_Vertex (PreparedLight *light, int num_lights, gx3dColor *base, gx3dVector *p, gx3dVector *n, ClipVertex *v);
+static void         Clip_Triangle (ClipVertex *v, SoftState *s, float alpha, TriangleList *list);
+static void         Setup_Triangle (ClipVertex *v0, ClipVertex *v1, ClipVertex *v2, SoftState *s, float alpha, TriangleList *list);
+static void         Raster_Thread (void *param);
+static void         Raster_Triangle (SoftTriangle *tri, int tx0, int ty0, int tx1, int ty1);
+static int          Mip_Level (SoftTriangle *tri, SoftTexture *tex, __m128 *p, int bits);
+static void         Sample_Texture (SoftTexture *tex, int level, __m128 u, __m128 v, __m128 *r, __m128 *g, __m128 *b, __m128 *a);
+static __m128       Channel (__m128i p, int shift);
+static __m128       Floor (__m128 x);
+static __m128i      Pack_Color (__m128 r, __m128 g, __m128 b);
+static void         Normal_Matrix (gx3dMatrix *m, float n[3][3]);
+static void         Compute_Bounds (SoftObject *obj);
+static unsigned    *Read_Bmp (const char *filename, int *width, int *height);
+static void         Add_Handle (HandleList *list, void *item);
+static bool         Remove_Handle (HandleList *list, void *item);
+static bool         Has_Handle (HandleList *list, void *item);
+
+/*___________________
+|
+| Global variables
+|__________________*/
+
+static RenderBackend soft_backend = {
+  "software",
+  Soft_Load_Object,
+  Soft_Free_Object,
+  Soft_Transform_Object,
+  Soft_Set_Vertex_Colors,
+  Soft_Load_Texture,
+  Soft_Free_Texture,
+  Soft_Init_Light,
+  Soft_Clear,
+  Soft_Begin_Render,
+  Soft_End_Render,
+  Soft_Flip,
+  Soft_Set_Projection,
+  Soft_Set_View_Matrix,
+  Soft_Get_View_Matrix,
+  Soft_Set_Camera,
+  Soft_Set_Object_Matrix,
+  Soft_Set_Material,
+  Soft_Set_Texture,
+  Soft_Set_Ambient_Light,
+  Soft_Enable_Light,
+  Soft_Disable_Light,
+  Soft_Enable_Alpha_Blending,
+  Soft_Disable_Alpha_Blending,
+  Soft_Enable_Alpha_Testing,
+  Soft_Disable_Alpha_Testing,
+  Soft_Sphere_Visible,
+  Soft_Draw_Object,
+  0,                        // instances are drawn one at a time
+  Soft_Draw_Particles
+};
+
+// Frame buffer (stride is a multiple of 4 pixels)
+static unsigned *color_buffer = 0;      // 0xAARRGGBB
+static float    *depth_buffer = 0;      // z/w, 0 at the near plane to 1 at the far plane
+static int       width, height, stride;
+static TileBin  *bins = 0;
+static int       tiles_x, tiles_y, num_tiles;
+
+// Frame being recorded and the last complete frame
+static SoftFrame frame [2];
+static int       recording = 0;
+
+// Current state
+static SoftState  state;
+static bool       state_changed = true;
+static SoftView   view;
+static bool       view_changed = true;
+static float      proj_x = 1;           // for Soft_Sphere_Visible()
+
+// Things made by this backend
+static HandleList objects, textures, lights;
+
+// Work areas of the vertex stage
+static TriangleList  lists [RENDERSOFT_MAX_THREADS];
+static int          *draw_list  = 0;    // list each draw of a batch went to
+static int          *draw_first = 0;    // its first triangle in that list
+static int          *draw_count = 0;
+static int           max_draws  = 0;
+
+static int num_threads = 1;
+
+static RenderSoftStats stats;
+static float           total_frame_ms;
+
+// Writing frames to files
+static int  capture_every = 0;
+static char capture_prefix [200];
+
+/*____________________________________________________________________
+|
+| Function: RenderSoft_Backend
+|
+| Input: Called from Program_Run()
+| Output: Returns the software backend.
+|___________________________________________________________________*/
+
+RenderBackend *RenderSoft_Backend ()
+{
+  return (&soft_backend);
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Load_Object
+|
+| Input: Called from Render_Load_Object() (through soft_backend)
+| Output: Returns an object holding the triangles of an LWO2 file
+|   (empty if the file can't be read).
+|___________________________________________________________________*/
+
+static gx3dObject *Soft_Load_Object (const char *lwo_filename)
+{
+  gx3dMatrix m;
+  Lwo2File file;
+  SoftObject *obj;
+
+  obj = (SoftObject *) calloc (1, sizeof(SoftObject));
+  gx3d_GetIdentityMatrix (&obj->matrix);
+  if (Lwo2_Read (lwo_filename, &file)) {
+    gx3d_GetScaleMatrix (&m, LWO2_FEET_PER_UNIT, LWO2_FEET_PER_UNIT, LWO2_FEET_PER_UNIT);
+    obj->num_triangles = Lwo2_Get_Mesh (&file, &m, &obj->vertex);
+    Lwo2_Free (&file);
+  }
+  Compute_Bounds (obj);
+  Add_Handle (&objects, obj);
+
+  return (&obj->obj);
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Free_Object
+|
+| Input: Called from Render_Free_Object() (through soft_backend)
+| Output: Frees an object, if this backend loaded it.
+|___________________________________________________________________*/
+
+static void Soft_Free_Object (gx3dObject *obj)
+{
+  if (Remove_Handle (&objects, obj)) {
+    free (((SoftObject *)obj)->vertex);
+    free (((SoftObject *)obj)->color);
+    free (obj);
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Transform_Object
+|
+| Input: Called from Render_Transform_Object() (through soft_backend)
+| Output: Transforms the vertices and normals of an object, if this
+|   backend loaded it, and recomputes its bounds.
+|___________________________________________________________________*/
+
+static void Soft_Transform_Object (gx3dObject *obj, gx3dMatrix *m)
+{
+  int i;
+  float length, n[3][3];
+  gx3dVector v;
+  Lwo2Vertex *vertex;
+  SoftObject *soft = (SoftObject *)obj;
+
+  if (NOT Has_Handle (&objects, obj))
+    return;
+
+  Normal_Matrix (m, n);
+  for (i=0; i<soft->num_triangles*3; i++) {
+    vertex = &soft->vertex[i];
+    gx3d_MultiplyVectorMatrix (&vertex->position, m, &vertex->position);
+    v = vertex->normal;
+    vertex->normal.x = v.x * n[0][0] + v.y * n[1][0] + v.z * n[2][0];
+    vertex->normal.y = v.x * n[0][1] + v.y * n[1][1] + v.z * n[2][1];
+    vertex->normal.z = v.x * n[0][2] + v.y * n[1][2] + v.z * n[2][2];
+    length = sqrtf (vertex->normal.x * vertex->normal.x + vertex->normal.y * vertex->normal.y + vertex->normal.z * vertex->normal.z);
+    if (length > 0) {
+      vertex->normal.x /= length;
+      vertex->normal.y /= length;
+      vertex->normal.z /= length;
+    }
+  }
+  Compute_Bounds (soft);
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Set_Vertex_Colors
+|
+| Input: Called from Render_Set_Vertex_Colors() (through soft_backend)
+| Output: Copies a color for each triangle corner of an object, if this
+|   backend loaded it and the count matches.  Returns true if set.
+|___________________________________________________________________*/
+
+static bool Soft_Set_Vertex_Colors (gx3dObject *obj, gx3dColor *colors, int count)
+{
+  SoftObject *soft = (SoftObject *)obj;
+
+  if ((NOT Has_Handle (&objects, obj)) OR (count != soft->num_triangles * 3) OR (count == 0))
+    return (false);
+
+  soft->color = (gx3dColor *) realloc (soft->color, count * sizeof(gx3dColor));
+  memcpy (soft->color, colors, count * sizeof(gx3dColor));
+
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Load_Texture
+|
+| Input: Called from Render_Load_Texture() (through soft_backend)
+| Output: Returns a texture with its mipmaps, read from a bmp file
+|   (and an optional alpha bmp file), or 0 if the file can't be read or
+|   isn't a power of 2 in each direction.
+|___________________________________________________________________*/
+
+static gx3dTexture Soft_Load_Texture (const char *filename, const char *alpha_filename)
+{
+  int i, x, y, w, h, aw, ah, x1, y1, level;
+  unsigned c [4], *texel, *alpha, *src, *dst;
+  char str [300];
+  SoftTexture *tex;
+
+  texel = Read_Bmp (filename, &w, &h);
+  if (texel == 0) {
+    sprintf (str, "Software render: can't read texture %s", filename);
+    debug_WriteFile (str);
+    return (0);
+  }
+  if ((w & (w - 1)) OR (h & (h - 1))) {
+    sprintf (str, "Software render: texture %s is %dx%d, not a power of 2", filename, w, h);
+    debug_WriteFile (str);
+    free (texel);
+    return (0);
+  }
+
+  // Intensity of the alpha file is the alpha channel
+  if (alpha_filename) {
+    alpha = Read_Bmp (alpha_filename, &aw, &ah);
+    if (alpha AND (aw == w) AND (ah == h))
+      for (i=0; i<w*h; i++)
+        texel[i] = (texel[i] & 0xFFFFFF) | ((((alpha[i] >> 16) & 0xFF) + ((alpha[i] >> 8) & 0xFF) + (alpha[i] & 0xFF)) / 3) << 24;
+    free (alpha);
+  }
+
+  tex = (SoftTexture *) calloc (1, sizeof(SoftTexture));
+  tex->num_levels = 1;
+  tex->width[0]   = w;
+  tex->height[0]  = h;
+  tex->texel[0]   = texel;
+
+  // Each mipmap averages 2x2 texels of the one before it
+  for (level=1; ((w > 1) OR (h > 1)) AND (level < RENDERSOFT_MAX_LEVELS); level++) {
+    src = tex->texel[level-1];
+    aw = w;
+    w = (w > 1) ? w / 2 : 1;
+    h = (h > 1) ? h / 2 : 1;
+    dst = (unsigned *) malloc (w * h * sizeof(unsigned));
+    for (y=0; y<h; y++)
+      for (x=0; x<w; x++) {
+        x1 = (aw > 1) ? 1 : 0;
+        y1 = (tex->height[level-1] > 1) ? aw : 0;
+        c[0] = src[(y * 2) * aw + x * 2];
+        c[1] = src[(y * 2) * aw + x * 2 + x1];
+        c[2] = src[(y * 2) * aw + x * 2 + y1];
+        c[3] = src[(y * 2) * aw + x * 2 + x1 + y1];
+        dst[y * w + x] = 0;
+        for (i=0; i<32; i+=8)
+          dst[y * w + x] |= ((((c[0] >> i) & 0xFF) + ((c[1] >> i) & 0xFF) + ((c[2] >> i) & 0xFF) + ((c[3] >> i) & 0xFF) + 2) / 4) << i;
+      }
+    tex->width[level]  = w;
+    tex->height[level] = h;
+    tex->texel[level]  = dst;
+    tex->num_levels++;
+  }
+
+  Add_Handle (&textures, tex);
+  return ((gx3dTexture) tex);
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Free_Texture
+|
+| Input: Called from Render_Free_Texture() (through soft_backend)
+| Output: Frees a texture, if this backend made it.
+|___________________________________________________________________*/
+
+static void Soft_Free_Texture (gx3dTexture tex)
+{
+  int i;
+  SoftTexture *t = (SoftTexture *)tex;
+
+  if (Remove_Handle (&textures, t)) {
+    if (state.texture == t) {
+      state.texture = 0;
+      state_changed = true;
+    }
+    for (i=0; i<t->num_levels; i++)
+      free (t->texel[i]);
+    free (t);
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Init_Light
+|
+| Input: Called from Render_Init_Light() (through soft_backend)
+| Output: Returns a light, which is a copy of its data.
+|___________________________________________________________________*/
+
+static gx3dLight Soft_Init_Light (gx3dLightData *data)
+{
+  gx3dLightData *light;
+
+  light = (gx3dLightData *) malloc (sizeof(gx3dLightData));
+  *light = *data;
+  Add_Handle (&lights, light);
+
+  return ((gx3dLight) light);
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Clear
+|
+| Input: Called from Render_Clear() (through soft_backend)
+| Output: Records a clear of the frame buffer and depth buffer.
+|___________________________________________________________________*/
+
+static void Soft_Clear (gxColor color)
+{
+  Add_Command (COMMAND_CLEAR)->color = color;
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Begin_Render
+|
+| Input: Called from Render_Begin() (through soft_backend)
+| Output: Returns true.
+|___________________________________________________________________*/
+
+static bool Soft_Begin_Render ()
+{
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_End_Render
+|
+| Input: Called from Render_End() (through soft_backend)
+| Output: Nothing, the frame is rendered at the flip.
+|___________________________________________________________________*/
+
+static void Soft_End_Render ()
+{
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Flip
+|
+| Input: Called from Render_Flip() (through soft_backend)
+| Output: Renders the recorded frame, writes it to a file if capturing,
+|   and keeps it as the last frame.
+|___________________________________________________________________*/
+
+static void Soft_Flip ()
+{
+  char filename [300];
+
+  if (color_buffer) {
+    total_frame_ms += Render_Frame (&frame[recording]);
+    stats.frames++;
+    stats.frame_ms = total_frame_ms / stats.frames;
+    stats.fps      = (stats.frame_ms > 0) ? 1000 / stats.frame_ms : 0;
+    if (capture_every AND ((stats.frames % capture_every) == 0)) {
+      sprintf (filename, "%s%05d.bmp", capture_prefix, stats.frames);
+      RenderSoft_Write_Image (filename);
+    }
+  }
+
+  // Start a new frame
+  recording = 1 - recording;
+  frame[recording].num_commands = 0;
+  frame[recording].num_states   = 0;
+  frame[recording].num_views    = 0;
+  state_changed = true;
+  view_changed  = true;
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Set_Projection
+|
+| Input: Called from Render_Set_Projection(), Render_Set_Backend()
+|   (through soft_backend)
+| Output: Sets the projection.  Pixels are square, so the x scale
+|   used to render is the y scale over the frame buffer aspect.
+|___________________________________________________________________*/
+
+static void Soft_Set_Projection (float fov, float near_plane, float far_plane, float aspect)
+{
+  view.proj_y = 1.0f / (float)tan ((fov * 3.14159265f / 180) / 2);
+  view.near_z = near_plane;
+  view.far_z  = far_plane;
+  proj_x = view.proj_y / aspect;
+  view_changed = true;
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Set_View_Matrix
+|
+| Input: Called from Render_Set_View_Matrix(), Render_Set_Backend()
+|   (through soft_backend)
+| Output: Sets the view matrix.
+|___________________________________________________________________*/
+
+static void Soft_Set_View_Matrix (gx3dMatrix *m)
+{
+  view.matrix = *m;
+  view_changed = true;
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Get_View_Matrix
+|
+| Input: Called from Render_Get_View_Matrix(), Render_Set_Backend()
+|   (through soft_backend)
+| Output: Returns the view matrix.
+|___________________________________________________________________*/
+
+static void Soft_Get_View_Matrix (gx3dMatrix *m)
+{
+  *m = view.matrix;
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Set_Camera
+|
+| Input: Called from Render_Set_Camera() (through soft_backend)
+| Output: Sets the view matrix to look from one point at another.
+|___________________________________________________________________*/
+
+static void Soft_Set_Camera (gx3dVector *from, gx3dVector *to, gx3dVector *world_up)
+{
+  gx3d_ComputeViewMatrix (&view.matrix, from, to, world_up);
+  view_changed = true;
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Set_Object_Matrix
+|
+| Input: Called from Render_Set_Object_Matrix(), Render_Draw_Instanced()
+|   (through soft_backend)
+| Output: Sets the world matrix of an object, if this backend loaded it.
+|___________________________________________________________________*/
+
+static void Soft_Set_Object_Matrix (gx3dObject *obj, gx3dMatrix *m)
+{
+  if (Has_Handle (&objects, obj))
+    ((SoftObject *)obj)->matrix = *m;
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Set_Material
+|
+| Input: Called from Render_Set_Material() (through soft_backend)
+| Output: Sets the material.
+|___________________________________________________________________*/
+
+static void Soft_Set_Material (gx3dMaterialData *material)
+{
+  state.material = *material;
+  state_changed = true;
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Set_Texture
+|
+| Input: Called from Render_Set_Texture(), Render_Draw_Instanced()
+|   (through soft_backend)
+| Output: Sets the texture of stage 0 (the only stage used).  Textures
+|   not made by this backend draw untextured.
+|___________________________________________________________________*/
+
+static void Soft_Set_Texture (int stage, gx3dTexture tex)
+{
+  if (stage == 0) {
+    state.texture = Has_Handle (&textures, (void *)tex) ? (SoftTexture *)tex : 0;
+    state_changed = true;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Set_Ambient_Light
+|
+| Input: Called from Render_Set_Ambient_Light() (through soft_backend)
+| Output: Sets the ambient light.
+|___________________________________________________________________*/
+
+static void Soft_Set_Ambient_Light (gx3dColor color)
+{
+  state.ambient = color;
+  state_changed = true;
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Enable_Light
+|
+| Input: Called from Render_Enable_Light() (through soft_backend)
+| Output: Turns on a light, if this backend made it.
+|___________________________________________________________________*/
+
+static void Soft_Enable_Light (gx3dLight light)
+{
+  int i;
+
+  if (NOT Has_Handle (&lights, (void *)light))
+    return;
+  for (i=0; i<state.num_lights; i++)
+    if (state.light[i] == (gx3dLightData *)light)
+      return;
+  if (state.num_lights < RENDERSOFT_MAX_LIGHTS) {
+    state.light[state.num_lights++] = (gx3dLightData *)light;
+    state_changed = true;
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Disable_Light
+|
+| Input: Called from Render_Disable_Light() (through soft_backend)
+| Output: Turns off a light.
+|___________________________________________________________________*/
+
+static void Soft_Disable_Light (gx3dLight light)
+{
+  int i;
+
+  for (i=0; i<state.num_lights; i++)
+    if (state.light[i] == (gx3dLightData *)light) {
+      state.light[i] = state.light[--state.num_lights];
+      state_changed = true;
+      break;
+    }
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Enable_Alpha_Blending
+|
+| Input: Called from Render_Enable_Alpha_Blending() (through
+|   soft_backend)
+| Output: Turns on blending by source alpha.
+|___________________________________________________________________*/
+
+static void Soft_Enable_Alpha_Blending ()
+{
+  state.blend = true;
+  state_changed = true;
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Disable_Alpha_Blending
+|
+| Input: Called from Render_Disable_Alpha_Blending() (through
+|   soft_backend)
+| Output: Turns off blending.
+|___________________________________________________________________*/
+
+static void Soft_Disable_Alpha_Blending ()
+{
+  state.blend = false;
+  state_changed = true;
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Enable_Alpha_Testing
+|
+| Input: Called from Render_Enable_Alpha_Testing() (through
+|   soft_backend)
+| Output: Keeps only pixels with alpha >= reference (0-255).
+|___________________________________________________________________*/
+
+static void Soft_Enable_Alpha_Testing (int reference)
+{
+  state.alpha_reference = reference;
+  state_changed = true;
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Disable_Alpha_Testing
+|
+| Input: Called from Render_Disable_Alpha_Testing() (through
+|   soft_backend)
+| Output: Turns off alpha testing.
+|___________________________________________________________________*/
+
+static void Soft_Disable_Alpha_Testing ()
+{
+  state.alpha_reference = -1;
+  state_changed = true;
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Sphere_Visible
+|
+| Input: Called from Render_Sphere_Visible() (through soft_backend)
+| Output: Returns false if a sphere is completely outside the view
+|   frustum.
+|___________________________________________________________________*/
+
+static bool Soft_Sphere_Visible (gx3dSphere *sphere)
+{
+  float x, y, z, r;
+  gx3dVector *c = &sphere->center;
+  gx3dMatrix *m = &view.matrix;
+
+  // Center in view space
+  x = c->x * m->_00 + c->y * m->_10 + c->z * m->_20 + m->_30;
+  y = c->x * m->_01 + c->y * m->_11 + c->z * m->_21 + m->_31;
+  z = c->x * m->_02 + c->y * m->_12 + c->z * m->_22 + m->_32;
+  r = sphere->radius;
+
+  // Outside a plane: near, far, then the sides (each through the eye, normal proportional to (+-proj, -1))
+  return (NOT ((z + r < view.near_z) OR (z - r > view.far_z) OR
+               ( x * proj_x - z > r * sqrtf (proj_x * proj_x + 1)) OR
+               (-x * proj_x - z > r * sqrtf (proj_x * proj_x + 1)) OR
+               ( y * view.proj_y - z > r * sqrtf (view.proj_y * view.proj_y + 1)) OR
+               (-y * view.proj_y - z > r * sqrtf (view.proj_y * view.proj_y + 1))));
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Draw_Object
+|
+| Input: Called from Render_Draw_Object(), Render_Draw_Instanced()
+|   (through soft_backend)
+| Output: Records a draw of an object with its world matrix and the
+|   current state and view, if this backend loaded it.
+|___________________________________________________________________*/
+
+static void Soft_Draw_Object (gx3dObject *obj)
+{
+  SoftCommand *command;
+  SoftFrame *f = &frame[recording];
+
+  if (NOT Has_Handle (&objects, obj))
+    return;
+
+  // States and views are only added when they change
+  if (state_changed) {
+    if (f->num_states == f->max_states) {
+      f->max_states = f->max_states ? f->max_states * 2 : 64;
+      f->state = (SoftState *) realloc (f->state, f->max_states * sizeof(SoftState));
+    }
+    f->state[f->num_states++] = state;
+    state_changed = false;
+  }
+  if (view_changed) {
+    if (f->num_views == f->max_views) {
+      f->max_views = f->max_views ? f->max_views * 2 : 8;
+      f->view = (SoftView *) realloc (f->view, f->max_views * sizeof(SoftView));
+    }
+    f->view[f->num_views++] = view;
+    view_changed = false;
+  }
+
+  command = Add_Command (COMMAND_DRAW);
+  command->obj    = (SoftObject *)obj;
+  command->matrix = ((SoftObject *)obj)->matrix;
+  command->state  = f->num_states - 1;
+  command->view   = f->num_views - 1;
+}
+
+/*____________________________________________________________________
+|
+| Function: Soft_Draw_Particles
+|
+| Input: Called from Render_Draw_Particles() (through soft_backend)
+| Output: Nothing, particle systems live on the gx3d device.
+|___________________________________________________________________*/
+
+static void Soft_Draw_Particles (gx3dParticleSystem, gx3dMatrix *, unsigned, gx3dVector *)
+{
+}
+
+/*____________________________________________________________________
+|
+| Function: Add_Command
+|
+| Input: Called from Soft_Clear(), Soft_Draw_Object()
+| Output: Returns a new command at the end of the frame being recorded.
+|___________________________________________________________________*/
+
+static SoftCommand *Add_Command (int type)
+{
+  SoftFrame *f = &frame[recording];
+
+  if (f->num_commands == f->max_commands) {
+    f->max_commands = f->max_commands ? f->max_commands * 2 : 1024;
+    f->command = (SoftCommand *) realloc (f->command, f->max_commands * sizeof(SoftCommand));
+  }
+  f->command[f->num_commands].type = type;
+  return (&f->command[f->num_commands++]);
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderSoft_Init
+|
+| Input: Called from Program_Run()
+| Output: Sets the size of the frame buffer and starts counting frames
+|   over.  Returns false if the buffers can't be allocated.
+|___________________________________________________________________*/
+
+bool RenderSoft_Init (int new_width, int new_height)
+{
+  num_threads = (int)std::thread::hardware_concurrency ();
+  if (num_threads < 1)
+    num_threads = 1;
+  if (num_threads > RENDERSOFT_MAX_THREADS)
+    num_threads = RENDERSOFT_MAX_THREADS;
+
+  state.alpha_reference = -1;
+  state.material.ambient.r = state.material.ambient.g = state.material.ambient.b = state.material.ambient.a = 1;
+  state.material.diffuse = state.material.ambient;
+  state_changed = true;
+
+  memset (&stats, 0, sizeof(stats));
+  total_frame_ms = 0;
+  stats.threads  = num_threads;
+
+  return (Resize_Buffers (new_width, new_height));
+}
+
+/*____________________________________________________________________
+|
+| Function: Resize_Buffers
+|
+| Input: Called from RenderSoft_Init(), RenderSoft_Benchmark()
+| Output: Allocates the frame buffer, depth buffer and tile bins for a
+|   size.  Returns false if they can't be allocated.
+|___________________________________________________________________*/
+
+static bool Resize_Buffers (int new_width, int new_height)
+{
+  int i;
+
+  if (color_buffer)
+    _mm_free (color_buffer);
+  if (depth_buffer)
+    _mm_free (depth_buffer);
+  for (i=0; i<num_tiles; i++)
+    free (bins[i].triangle);
+  free (bins);
+  color_buffer = 0;
+  depth_buffer = 0;
+  bins = 0;
+  width = height = stride = 0;
+  tiles_x = tiles_y = num_tiles = 0;
+
+  if ((new_width <= 0) OR (new_height <= 0))
+    return (false);
+
+  stride = (new_width + 3) & ~3;
+  color_buffer = (unsigned *) _mm_malloc (stride * new_height * sizeof(unsigned), 16);
+  depth_buffer = (float *) _mm_malloc (stride * new_height * sizeof(float), 16);
+  if ((color_buffer == 0) OR (depth_buffer == 0)) {
+    if (color_buffer)
+      _mm_free (color_buffer);
+    if (depth_buffer)
+      _mm_free (depth_buffer);
+    color_buffer = 0;
+    depth_buffer = 0;
+    stride = 0;
+    return (false);
+  }
+  width   = new_width;
+  height  = new_height;
+  tiles_x = (width  + TILE - 1) / TILE;
+  tiles_y = (height + TILE - 1) / TILE;
+  num_tiles = tiles_x * tiles_y;
+  bins = (TileBin *) calloc (num_tiles, sizeof(TileBin));
+
+  memset (color_buffer, 0, stride * height * sizeof(unsigned));
+  for (i=0; i<stride*height; i++)
+    depth_buffer[i] = 1;
+
+  return (true);
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderSoft_Write_Image
+|
+| Input: Called from Soft_Flip(), RenderSoft_Benchmark(), Program_Run()
+| Output: Writes the frame buffer as a 24-bit bmp file.  Returns true on
+|   success.
+|___________________________________________________________________*/
+
+bool RenderSoft_Write_Image (const char *filename)
+{
+  int i, x, y, row_size;
+  unsigned value, *p;
+  unsigned char header [54], *row;
+  bool ok;
+  FILE *fp;
+
+  if (color_buffer == 0)
+    return (false);
+  fp = fopen (filename, "wb");
+  if (fp == NULL)
+    return (false);
+
+  // File header and BITMAPINFOHEADER, little endian
+  row_size = (width * 3 + 3) & ~3;
+  memset (header, 0, sizeof(header));
+  header[0] = 'B';
+  header[1] = 'M';
+  for (i=0; i<4; i++) {
+    value = 54 + row_size * height;
+    header[2+i]  = (unsigned char)(value >> (i * 8));
+    header[10+i] = (unsigned char)(54 >> (i * 8));
+    header[14+i] = (unsigned char)(40 >> (i * 8));
+    header[18+i] = (unsigned char)(width >> (i * 8));
+    header[22+i] = (unsigned char)(height >> (i * 8));
+    value = row_size * height;
+    header[34+i] = (unsigned char)(value >> (i * 8));
+  }
+  header[26] = 1;     // planes
+  header[28] = 24;    // bits per pixel
+  ok = (fwrite (header, sizeof(header), 1, fp) == 1);
+
+  // Rows bottom up
+  row = (unsigned char *) calloc (row_size, 1);
+  for (y=height-1; (y>=0) AND ok; y--) {
+    p = &color_buffer[y * stride];
+    for (x=0; x<width; x++) {
+      row[x*3+0] = (unsigned char)(p[x]);
+      row[x*3+1] = (unsigned char)(p[x] >> 8);
+      row[x*3+2] = (unsigned char)(p[x] >> 16);
+    }
+    ok = (fwrite (row, row_size, 1, fp) == 1);
+  }
+  free (row);
+  fclose (fp);
+
+  return (ok);
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderSoft_Set_Capture
+|
+| Input: Called from Program_Run()
+| Output: Writes every nth frame to <prefix><frame #>.bmp (0 to stop).
+|___________________________________________________________________*/
+
+void RenderSoft_Set_Capture (int every, const char *prefix)
+{
+  capture_every = (every > 0) ? every : 0;
+  strncpy (capture_prefix, prefix ? prefix : "", sizeof(capture_prefix) - 1);
+  capture_prefix[sizeof(capture_prefix) - 1] = 0;
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderSoft_Get_Stats
+|
+| Input: Called from RenderSoft_Write_Stats()
+| Output: Returns statistics since RenderSoft_Init().
+|___________________________________________________________________*/
+
+void RenderSoft_Get_Stats (RenderSoftStats *soft_stats)
+{
+  *soft_stats = stats;
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderSoft_Write_Stats
+|
+| Input: Called from Program_Run()
+| Output: Writes the statistics to the debug file.
+|___________________________________________________________________*/
+
+void RenderSoft_Write_Stats ()
+{
+  char str [300];
+
+  sprintf (str, "Software render %dx%d: %d frames, %.3f ms per frame (%.1f fps) on %d %s",
+    width, height, stats.frames, stats.frame_ms, stats.fps, stats.threads, (stats.threads == 1) ? "thread" : "threads");
+  debug_WriteFile (str);
+  sprintf (str, "  last frame: %d draws, %d triangles, %d rasterized, %d tile entries, vertex %.3f ms, bin %.3f ms, raster %.3f ms",
+    stats.draws, stats.triangles, stats.rasterized, stats.bin_entries, stats.vertex_ms, stats.bin_ms, stats.raster_ms);
+  debug_WriteFile (str);
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderSoft_Benchmark
+|
+| Input: Called from Program_Run()
+| Output: Renders the last frame again a number of times at each size,
+|   writes the frame rates to the debug file and the image at each size
+|   to <image_prefix><width>x<height>.bmp.  The frame buffer goes back
+|   to its size before.
+|___________________________________________________________________*/
+
+void RenderSoft_Benchmark (
+  int        *widths,
+  int        *heights,
+  int         count,
+  int         frames,
+  const char *image_prefix )
+{
+  int i, j, old_width, old_height;
+  float ms, vertex_ms, bin_ms, raster_ms;
+  char str [300];
+  SoftFrame *f = &frame[1 - recording];
+  RenderSoftStats old_stats;
+
+  if (f->num_commands == 0) {
+    debug_WriteFile ("Software render benchmark: no frame to render");
+    return;
+  }
+  if (frames < 1)
+    frames = 1;
+
+  old_stats  = stats;
+  old_width  = width;
+  old_height = height;
+
+  for (i=0; i<count; i++) {
+    if (NOT Resize_Buffers (widths[i], heights[i])) {
+      sprintf (str, "Software render %dx%d: can't allocate the frame buffer", widths[i], heights[i]);
+      debug_WriteFile (str);
+      continue;
+    }
+    // Once to warm up the caches, then timed
+    Render_Frame (f);
+    ms = vertex_ms = bin_ms = raster_ms = 0;
+    for (j=0; j<frames; j++) {
+      ms        += Render_Frame (f);
+      vertex_ms += stats.vertex_ms;
+      bin_ms    += stats.bin_ms;
+      raster_ms += stats.raster_ms;
+    }
+    sprintf (str, "Software render %dx%d: %.1f fps, %.3f ms per frame (vertex %.3f, bin %.3f, raster %.3f) on %d %s",
+      width, height, ms > 0 ? frames * 1000 / ms : 0, ms / frames, vertex_ms / frames, bin_ms / frames, raster_ms / frames,
+      num_threads, (num_threads == 1) ? "thread" : "threads");
+    debug_WriteFile (str);
+    if (image_prefix) {
+      sprintf (str, "%s%dx%d.bmp", image_prefix, width, height);
+      RenderSoft_Write_Image (str);
+    }
+  }
+
+  Resize_Buffers (old_width, old_height);
+  stats = old_stats;
+}
+
+/*____________________________________________________________________
+|
+| Function: RenderSoft_Free
+|
+| Input: Called from Program_Run()
+| Output: Frees the buffers and anything the backend made.
+|___________________________________________________________________*/
+
+void RenderSoft_Free ()
+{
+  int i, j;
+  SoftTexture *tex;
+
+  Resize_Buffers (0, 0);
+
+  for (i=0; i<objects.count; i++) {
+    free (((SoftObject *)objects.item[i])->vertex);
+    free (objects.item[i]);
+  }
+  for (i=0; i<textures.count; i++) {
+    tex = (SoftTexture *)textures.item[i];
+    for (j=0; j<tex->num_levels; j++)
+      free (tex->texel[j]);
+    free (tex);
+  }
+  for (i=0; i<lights.count; i++)
+    free (lights.item[i]);
+  free (objects.item);
+  free (textures.item);
+  free (lights.item);
+  memset (&objects,  0, sizeof(objects));
+  memset (&textures, 0, sizeof(textures));
+  memset (&lights,   0, sizeof(lights));
+
+  for (i=0; i<2; i++) {
+    free (frame[i].command);
+    free (frame[i].state);
+    free (frame[i].view);
+  }
+  memset (frame, 0, sizeof(frame));
+  for (i=0; i<RENDERSOFT_MAX_THREADS; i++)
+    free (lists[i].triangle);
+  memset (lists, 0, sizeof(lists));
+  free (draw_list);
+  free (draw_first);
+  free (draw_count);
+  draw_list = draw_first = draw_count = 0;
+  max_draws = 0;
+
+  memset (&state, 0, sizeof(state));
+  state.alpha_reference = -1;
+  state_changed = view_changed = true;
+  capture_every = 0;
+  memset (&stats, 0, sizeof(stats));
+}
+
+/*____________________________________________________________________
+|
+| Function: Render_Frame
+|
+| Input: Called from Soft_Flip(), RenderSoft_Benchmark()
+| Output: Renders the commands of a frame into the frame buffer, the
+|   draws between clears as one batch.  Returns the time it took in
+|   milliseconds.
+|___________________________________________________________________*/
+
+static float Render_Frame (SoftFrame *f)
+{
+  int i, first;
+  double start;
+
+  start = Timer_Now_Ms ();
+  stats.draws = stats.triangles = stats.rasterized = stats.bin_entries = 0;
+  stats.vertex_ms = stats.bin_ms = stats.raster_ms = 0;
+
+  first = 0;
+  for (i=0; i<f->num_commands; i++)
+    if (f->command[i].type == COMMAND_CLEAR) {
+      Draw_Batch (f, &f->command[first], i - first);
+      Clear_Buffers (f->command[i].color);
+      first = i + 1;
+    }
+  Draw_Batch (f, &f->command[first], f->num_commands - first);
+
+  return (Timer_Elapsed_Ms (start));
+}
+
+/*____________________________________________________________________
+|
+| Function: Clear_Buffers
+|
+| Input: Called from Render_Frame()
+| Output: Clears the frame buffer to a color and the depth buffer to
+|   the far plane.
+|___________________________________________________________________*/
+
+static void Clear_Buffers (gxColor color)
+{
+  int i;
+  __m128i c;
+  __m128 one;
+
+  c   = _mm_set1_epi32 (0xFF000000 | (color.r << 16) | (color.g << 8) | color.b);
+  one = _mm_set1_ps (1);
+  for (i=0; i<stride*height; i+=4) {
+    _mm_store_si128 ((__m128i *)&color_buffer[i], c);
+    _mm_store_ps (&depth_buffer[i], one);
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Draw_Batch
+|
+| Input: Called from Render_Frame()
+| Output: Draws a run of draw commands: sets up their triangles on the
+|   vertex threads, bins the triangles in draw order, then rasterizes
+|   the tiles on the raster threads.
+|___________________________________________________________________*/
+
+static void Draw_Batch (SoftFrame *f, SoftCommand *command, int count)
+{
+  int i, j, n, x, y, tx0, ty0, tx1, ty1;
+  void *params [RENDERSOFT_MAX_THREADS];
+  double start;
+  SoftTriangle *tri;
+  TileBin *bin;
+  BatchContext ctx;
+  VertexWork work [RENDERSOFT_MAX_THREADS];
+  RasterContext raster;
+
+  if (count <= 0)
+    return;
+
+  // Vertex stage
+  start = Timer_Now_Ms ();
+  if (count > max_draws) {
+    max_draws  = count * 2;
+    draw_list  = (int *) realloc (draw_list,  max_draws * sizeof(int));
+    draw_first = (int *) realloc (draw_first, max_draws * sizeof(int));
+    draw_count = (int *) realloc (draw_count, max_draws * sizeof(int));
+  }
+  ctx.frame   = f;
+  ctx.command = command;
+  ctx.count   = count;
+  ctx.next    = 0;
+  n = (num_threads < count) ? num_threads : count;
+  for (i=0; i<n; i++) {
+    lists[i].count = 0;
+    work[i].ctx  = &ctx;
+    work[i].list = i;
+    params[i] = &work[i];
+  }
+  Run_Threads (Vertex_Thread, params, n);
+  stats.draws += count;
+  for (i=0; i<count; i++)
+    stats.triangles += command[i].obj->num_triangles;
+  for (i=0; i<n; i++)
+    stats.rasterized += lists[i].count;
+  stats.vertex_ms += Timer_Elapsed_Ms (start);
+
+  // Bin the triangles in draw order
+  start = Timer_Now_Ms ();
+  for (i=0; i<num_tiles; i++)
+    bins[i].count = 0;
+  for (i=0; i<count; i++)
+    for (j=0; j<draw_count[i]; j++) {
+      tri = &lists[draw_list[i]].triangle[draw_first[i] + j];
+      tx0 = tri->xmin / TILE;
+      ty0 = tri->ymin / TILE;
+      tx1 = tri->xmax / TILE;
+      ty1 = tri->ymax / TILE;
+      for (y=ty0; y<=ty1; y++)
+        for (x=tx0; x<=tx1; x++) {
+          bin = &bins[y * tiles_x + x];
+          if (bin->count == bin->max) {
+            bin->max = bin->max ? bin->max * 2 : 256;
+            bin->triangle = (SoftTriangle **) realloc (bin->triangle, bin->max * sizeof(SoftTriangle *));
+          }
+          bin->triangle[bin->count++] = tri;
+        }
+      stats.bin_entries += (tx1 - tx0 + 1) * (ty1 - ty0 + 1);
+    }
+  stats.bin_ms += Timer_Elapsed_Ms (start);
+
+  // Raster stage
+  start = Timer_Now_Ms ();
+  raster.next = 0;
+  n = (num_threads < num_tiles) ? num_threads : num_tiles;
+  for (i=0; i<n; i++)
+    params[i] = &raster;
+  Run_Threads (Raster_Thread, params, n);
+  stats.raster_ms += Timer_Elapsed_Ms (start);
+}
+
+/*____________________________________________________________________
+|
+| Function: Run_Threads
+|
+| Input: Called from Draw_Batch()
+| Output: Runs a thread function n times at once, the first on this
+|   thread, and waits for them all.
+|___________________________________________________________________*/
+
+static void Run_Threads (void (*func) (void *param), void **params, int n)
+{
+  int i;
+  std::thread thread [RENDERSOFT_MAX_THREADS];
+
+  if (n <= 0)
+    return;
+
+  for (i=1; i<n; i++)
+    thread[i] = std::thread (func, params[i]);
+  (*func) (params[0]);
+  for (i=1; i<n; i++)
+    thread[i].join ();
+}
+
+/*____________________________________________________________________
+|
+| Function: Vertex_Thread
+|
+| Input: Called from Run_Threads()
+| Output: Sets up the triangles of draws until there are none left,
+|   noting where each draw's triangles went.
+|___________________________________________________________________*/
+
+static void Vertex_Thread (void *param)
+{
+  int i;
+  VertexWork *work = (VertexWork *)param;
+  BatchContext *ctx = work->ctx;
+  TriangleList *list = &lists[work->list];
+
+  for (;;) {
+    i = ctx->next++;
+    if (i >= ctx->count)
+      break;
+    draw_list[i]  = work->list;
+    draw_first[i] = list->count;
+    Transform_Draw (ctx->frame, &ctx->command[i], list);
+    draw_count[i] = list->count - draw_first[i];
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Transform_Draw
+|
+| Input: Called from Vertex_Thread()
+| Output: Lights (or takes the baked colors of), projects and clips the
+|   triangles of a draw and adds the ones that can be seen to a list.
+|___________________________________________________________________*/
+
+static void Transform_Draw (SoftFrame *f, SoftCommand *command, TriangleList *list)
+{
+  int i, k, num_lights;
+  float px, py, q, nq, x, y, z, alpha, length, n[3][3];
+  gx3dVector *in, *normal, p, pn;
+  gx3dMatrix mv;
+  gx3dColor base;
+  ClipVertex cv [3];
+  PreparedLight light [RENDERSOFT_MAX_LIGHTS];
+  SoftObject *obj = command->obj;
+  SoftState  *s   = &f->state[command->state];
+  SoftView   *v   = &f->view[command->view];
+  gx3dMatrix *m   = &command->matrix;
+  gx3dMaterialData *mat = &s->material;
+
+  // Object to view space, then the projection gx3d_SetProjectionMatrix() computes
+  gx3d_MultiplyMatrix (m, &v->matrix, &mv);
+  Normal_Matrix (m, n);
+  py = v->proj_y;
+  px = py * height / width;
+  q  = v->far_z / (v->far_z - v->near_z);
+  nq = v->near_z * q;
+
+  // Lighting that's the same for every vertex
+  base.r = mat->emissive.r + mat->ambient.r * s->ambient.r;
+  base.g = mat->emissive.g + mat->ambient.g * s->ambient.g;
+  base.b = mat->emissive.b + mat->ambient.b * s->ambient.b;
+  alpha = mat->diffuse.a * 255;
+  if (alpha < 0)   alpha = 0;
+  if (alpha > 255) alpha = 255;
+  num_lights = Prepare_Lights (s, light);
+
+  for (i=0; i<obj->num_triangles; i++) {
+    for (k=0; k<3; k++) {
+      in = &obj->vertex[i*3+k].position;
+      x = in->x * mv._00 + in->y * mv._10 + in->z * mv._20 + mv._30;
+      y = in->x * mv._01 + in->y * mv._11 + in->z * mv._21 + mv._31;
+      z = in->x * mv._02 + in->y * mv._12 + in->z * mv._22 + mv._32;
+      cv[k].x = x * px;
+      cv[k].y = y * py;
+      cv[k].z = z * q - nq;
+      cv[k].w = z;
+      cv[k].u = obj->vertex[i*3+k].u;
+      cv[k].v = obj->vertex[i*3+k].v;
+      // Baked lighting
+      if (obj->color) {
+        cv[k].r = obj->color[i*3+k].r;
+        cv[k].g = obj->color[i*3+k].g;
+        cv[k].b = obj->color[i*3+k].b;
+        continue;
+      }
+      // Light in world space
+      if (num_lights) {
+        p.x = in->x * m->_00 + in->y * m->_10 + in->z * m->_20 + m->_30;
+        p.y = in->x * m->_01 + in->y * m->_11 + in->z * m->_21 + m->_31;
+        p.z = in->x * m->_02 + in->y * m->_12 + in->z * m->_22 + m->_32;
+        normal = &obj->vertex[i*3+k].normal;
+        pn.x = normal->x * n[0][0] + normal->y * n[1][0] + normal->z * n[2][0];
+        pn.y = normal->x * n[0][1] + normal->y * n[1][1] + normal->z * n[2][1];
+        pn.z = normal->x * n[0][2] + normal->y * n[1][2] + normal->z * n[2][2];
+        length = sqrtf (pn.x * pn.x + pn.y * pn.y + pn.z * pn.z);
+        if (length > 0) {
+          pn.x /= length;
+          pn.y /= length;
+          pn.z /= length;
+        }
+      }
+      Light_Vertex (light, num_lights, &base, &p, &pn, &cv[k]);
+    }
+    Clip_Triangle (cv, s, alpha, list);
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Prepare_Lights
+|
+| Input: Called from Transform_Draw()
+| Output: Returns # of lights on in a state, with their directions
+|   normalized and their colors multiplied by the material's.
+|___________________________________________________________________*/
+
+static int Prepare_Lights (SoftState *s, PreparedLight *light)
+{
+  int i;
+  float length;
+  gx3dLightData *data;
+  gx3dMaterialData *mat = &s->material;
+
+  for (i=0; i<s->num_lights; i++) {
+    data = s->light[i];
+    light[i].point = (data->light_type == gx3d_LIGHT_TYPE_POINT);
+    if (light[i].point) {
+      light[i].vector       = data->point.src;
+      light[i].ambient      = data->point.ambient_color;
+      light[i].diffuse      = data->point.diffuse_color;
+      light[i].range        = data->point.range;
+      light[i].attenuation0 = data->point.constant_attenuation;
+      light[i].attenuation1 = data->point.linear_attenuation;
+      light[i].attenuation2 = data->point.quadratic_attenuation;
+    }
+    else {
+      // Toward the light
+      length = sqrtf (data->direction.dst.x * data->direction.dst.x + data->direction.dst.y * data->direction.dst.y + data->direction.dst.z * data->direction.dst.z);
+      if (length == 0)
+        length = 1;
+      light[i].vector.x = -data->direction.dst.x / length;
+      light[i].vector.y = -data->direction.dst.y / length;
+      light[i].vector.z = -data->direction.dst.z / length;
+      light[i].ambient  = data->direction.ambient_color;
+      light[i].diffuse  = data->direction.diffuse_color;
+    }
+    light[i].ambient.r *= mat->ambient.r;
+    light[i].ambient.g *= mat->ambient.g;
+    light[i].ambient.b *= mat->ambient.b;
+    light[i].diffuse.r *= mat->diffuse.r;
+    light[i].diffuse.g *= mat->diffuse.g;
+    light[i].diffuse.b *= mat->diffuse.b;
+  }
+
+  return (s->num_lights);
+}
+
+/*____________________________________________________________________
+|
+| Function: Light_Vertex
+|
+| Input: Called from Transform_Draw()
+| Output: Sets the color of a vertex (0-1) from its world position and
+|   normal: emissive + ambient, plus for each light (attenuated by
+|   distance for a point light) its ambient and its diffuse times N.L.
+|___________________________________________________________________*/
+
+static void Light_Vertex (PreparedLight *light, int num_lights, gx3dColor *base, gx3dVector *p, gx3dVector *n, ClipVertex *v)
+{
+  int i;
+  float d, dot, attenuation;
+  gx3dVector l;
+
+  v->r = base->r;
+  v->g = base->g;
+  v->b = base->b;
+  for (i=0; i<num_lights; i++) {
+    if (light[i].point) {
+      l.x = light[i].vector.x - p->x;
+      l.y = light[i].vector.y - p->y;
+      l.z = light[i].vector.z - p->z;
+      d = sqrtf (l.x * l.x + l.y * l.y + l.z * l.z);
+      if (d > light[i].range)
+        continue;
+      if (d > 0) {
+        l.x /= d;
+        l.y /= d;
+        l.z /= d;
+      }
+      attenuation = light[i].attenuation0 + light[i].attenuation1 * d + light[i].attenuation2 * d * d;
+      attenuation = (attenuation > 0.0001f) ? 1 / attenuation : 10000;
+    }
+    else {
+      l = light[i].vector;
+      attenuation = 1;
+    }
+    dot = n->x * l.x + n->y * l.y + n->z * l.z;
+    if (dot < 0)
+      dot = 0;
+    v->r += attenuation * (light[i].ambient.r + light[i].diffuse.r * dot);
+    v->g += attenuation * (light[i].ambient.g + light[i].diffuse.g * dot);
+    v->b += attenuation * (light[i].ambient.b + light[i].diffuse.b * dot);
+  }
+  if (v->r > 1) v->r = 1;
+  if (v->g > 1) v->g = 1;
+  if (v->b > 1) v->b = 1;
+  if (v->r < 0) v->r = 0;
+  if (v->g < 0) v->g = 0;
+  if (v->b < 0) v->b = 0;
+}
+
+/*____________________________________________________________________
+|
+| Function: Clip_Triangle
+|
+| Input: Called from Transform_Draw()
+| Output: Drops a triangle outside the view frustum, clips one that
+|   crosses the near plane or the guard band and sets up the triangles
+|   left.
+|___________________________________________________________________*/
+
+static void Clip_Triangle (ClipVertex *v, SoftState *s, float alpha, TriangleList *list)
+{
+  int i, j, k, n, src, plane;
+  unsigned code [3], clip;
+  float d [NUM_CLIP_PLANES + 3], t, *a, *b, *c;
+  ClipVertex poly [2][NUM_CLIP_PLANES + 3];
+
+  // Outside one side of the view frustum
+  for (i=0; i<3; i++)
+    code[i] = ( v[i].x >  v[i].w)       | ((v[i].x < -v[i].w) << 1) |
+              ((v[i].y >  v[i].w) << 2) | ((v[i].y < -v[i].w) << 3) |
+              ((v[i].z <  0)      << 4) | ((v[i].z >  v[i].w) << 5);
+  if (code[0] & code[1] & code[2])
+    return;
+
+  // Planes crossed: near, then the sides of the guard band
+  clip = 0;
+  for (i=0; i<3; i++)
+    clip |= (v[i].z < 0) | ((GUARD_BAND * v[i].w - v[i].x < 0) << 1) | ((GUARD_BAND * v[i].w + v[i].x < 0) << 2) |
+                           ((GUARD_BAND * v[i].w - v[i].y < 0) << 3) | ((GUARD_BAND * v[i].w + v[i].y < 0) << 4);
+  if (clip == 0) {
+    Setup_Triangle (&v[0], &v[1], &v[2], s, alpha, list);
+    return;
+  }
+
+  // Clip the polygon against each plane crossed (each adds at most one vertex)
+  poly[0][0] = v[0];
+  poly[0][1] = v[1];
+  poly[0][2] = v[2];
+  n = 3;
+  src = 0;
+  for (plane=0; plane<NUM_CLIP_PLANES; plane++) {
+    if (NOT (clip & (1 << plane)))
+      continue;
+    for (i=0; i<n; i++)
+      switch (plane) {
+        case 0: d[i] = poly[src][i].z;                                 break;
+        case 1: d[i] = GUARD_BAND * poly[src][i].w - poly[src][i].x;   break;
+        case 2: d[i] = GUARD_BAND * poly[src][i].w + poly[src][i].x;   break;
+        case 3: d[i] = GUARD_BAND * poly[src][i].w - poly[src][i].y;   break;
+        case 4: d[i] = GUARD_BAND * poly[src][i].w + poly[src][i].y;   break;
+      }
+    k = 0;
+    for (i=0; i<n; i++) {
+      j = (i + 1) % n;
+      if (d[i] >= 0)
+        poly[1-src][k++] = poly[src][i];
+      if ((d[i] >= 0) != (d[j] >= 0)) {
+        t = d[i] / (d[i] - d[j]);
+        a = (float *)&poly[src][i];
+        b = (float *)&poly[src][j];
+        c = (float *)&poly[1-src][k++];
+        for (j=0; j<(int)(sizeof(ClipVertex) / sizeof(float)); j++)
+          c[j] = a[j] + (b[j] - a[j]) * t;
+      }
+    }
+    n = k;
+    src = 1 - src;
+    if (n < 3)
+      return;
+  }
+
+  // Fan of triangles
+  for (i=1; i<n-1; i++)
+    Setup_Triangle (&poly[src][0], &poly[src][i], &poly[src][i+1], s, alpha, list);
+}
+
+/*____________________________________________________________________
+|
+| Function: Setup_Triangle
+|
+| Input: Called from Clip_Triangle()
+| Output: Projects a triangle to the screen and adds its edge functions
+|   and attribute planes to a list, unless it faces away (is counter
+|   clockwise on the screen) or covers no pixel centers.
+|___________________________________________________________________*/
+
+static void Setup_Triangle (ClipVertex *v0, ClipVertex *v1, ClipVertex *v2, SoftState *s, float alpha, TriangleList *list)
+{
+  int i, j, k;
+  float iw, area, minx, maxx, miny, maxy, sx [3], sy [3], attr [3][NUM_PLANES];
+  ClipVertex *v [3];
+  SoftTriangle *tri;
+
+  v[0] = v0;
+  v[1] = v1;
+  v[2] = v2;
+  for (i=0; i<3; i++) {
+    iw = 1 / v[i]->w;
+    sx[i] = (v[i]->x * iw * 0.5f + 0.5f) * width;
+    sy[i] = (0.5f - v[i]->y * iw * 0.5f) * height;
+    attr[i][PLANE_Z] = v[i]->z * iw;
+    attr[i][PLANE_W] = iw;
+    attr[i][PLANE_U] = v[i]->u * iw;
+    attr[i][PLANE_V] = v[i]->v * iw;
+    attr[i][PLANE_R] = v[i]->r * iw;
+    attr[i][PLANE_G] = v[i]->g * iw;
+    attr[i][PLANE_B] = v[i]->b * iw;
+  }
+
+  // Front faces are clockwise on the screen (y down)
+  area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sy[1] - sy[0]) * (sx[2] - sx[0]);
+  if (NOT (area > 0))
+    return;
+
+  // Pixels with centers inside the bounding rectangle
+  minx = maxx = sx[0];
+  miny = maxy = sy[0];
+  for (i=1; i<3; i++) {
+    if (sx[i] < minx) minx = sx[i];
+    if (sx[i] > maxx) maxx = sx[i];
+    if (sy[i] < miny) miny = sy[i];
+    if (sy[i] > maxy) maxy = sy[i];
+  }
+  if (list->count == list->max) {
+    list->max = list->max ? list->max * 2 : 4096;
+    list->triangle = (SoftTriangle *) realloc (list->triangle, list->max * sizeof(SoftTriangle));
+  }
+  tri = &list->triangle[list->count];
+  tri->xmin = (int)ceilf (minx - 0.5f);
+  tri->xmax = (int)floorf (maxx - 0.5f);
+  tri->ymin = (int)ceilf (miny - 0.5f);
+  tri->ymax = (int)floorf (maxy - 0.5f);
+  if (tri->xmin < 0)        tri->xmin = 0;
+  if (tri->ymin < 0)        tri->ymin = 0;
+  if (tri->xmax > width-1)  tri->xmax = width-1;
+  if (tri->ymax > height-1) tri->ymax = height-1;
+  if ((tri->xmin > tri->xmax) OR (tri->ymin > tri->ymax))
+    return;
+
+  // Edge i from vertex i to vertex i+1, positive on the inside
+  tri->top_left = 0;
+  for (i=0; i<3; i++) {
+    j = (i + 1) % 3;
+    tri->edge[i][0] = sy[i] - sy[j];
+    tri->edge[i][1] = sx[j] - sx[i];
+    tri->edge[i][2] = -(tri->edge[i][0] * sx[i] + tri->edge[i][1] * sy[i]);
+    if ((tri->edge[i][0] > 0) OR ((tri->edge[i][0] == 0) AND (tri->edge[i][1] > 0)))
+      tri->top_left |= 1 << i;
+  }
+
+  // The weight of each vertex is the edge across from it over the area
+  for (k=0; k<NUM_PLANES; k++)
+    for (j=0; j<3; j++)
+      tri->plane[k][j] = (attr[0][k] * tri->edge[1][j] + attr[1][k] * tri->edge[2][j] + attr[2][k] * tri->edge[0][j]) / area;
+
+  tri->alpha = alpha;
+  tri->state = s;
+  list->count++;
+}
+
+/*____________________________________________________________________
+|
+| Function: Raster_Thread
+|
+| Input: Called from Run_Threads()
+| Output: Rasterizes the triangles binned to each tile, in order, until
+|   there are no tiles left.
+|___________________________________________________________________*/
+
+static void Raster_Thread (void *param)
+{
+  int i, t, tx0, ty0, tx1, ty1;
+  RasterContext *ctx = (RasterContext *)param;
+
+  for (;;) {
+    t = ctx->next++;
+    if (t >= num_tiles)
+      break;
+    tx0 = (t % tiles_x) * TILE;
+    ty0 = (t / tiles_x) * TILE;
+    tx1 = (tx0 + TILE < width)  ? tx0 + TILE - 1 : width - 1;
+    ty1 = (ty0 + TILE < height) ? ty0 + TILE - 1 : height - 1;
+    for (i=0; i<bins[t].count; i++)
+      Raster_Triangle (bins[t].triangle[i], tx0, ty0, tx1, ty1);
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Raster_Triangle
+|
+| Input: Called from Raster_Thread()
+| Output: Draws the part of a triangle inside a tile, 4 pixels at a
+|   time.
+|___________________________________________________________________*/
+
+static void Raster_Triangle (SoftTriangle *tri, int tx0, int ty0, int tx1, int ty1)
+{
+  int i, x, y, xmin, xmax, ymin, ymax, bits;
+  float fx, fy;
+  unsigned *color_row;
+  float *depth_row;
+  __m128 offsets, zero, one, scale, inside, mask, depth, w, u, v, r, g, b, a, k;
+  __m128 tr, tg, tb, ta, alpha, alpha_reference;
+  __m128 e [3], e_step [3], top_left [3], p [NUM_PLANES], p_step [NUM_PLANES];
+  __m128i out, old;
+  SoftState   *s   = tri->state;
+  SoftTexture *tex = s->texture;
+
+  xmin = (tri->xmin > tx0) ? tri->xmin : tx0;
+  ymin = (tri->ymin > ty0) ? tri->ymin : ty0;
+  xmax = (tri->xmax < tx1) ? tri->xmax : tx1;
+  ymax = (tri->ymax < ty1) ? tri->ymax : ty1;
+  if ((xmin > xmax) OR (ymin > ymax))
+    return;
+  xmin &= ~3;
+
+  offsets = _mm_set_ps (3.5f, 2.5f, 1.5f, 0.5f);
+  zero    = _mm_setzero_ps ();
+  one     = _mm_set1_ps (1);
+  scale   = _mm_set1_ps (255);
+  for (i=0; i<3; i++) {
+    e_step[i]   = _mm_set1_ps (tri->edge[i][0] * 4);
+    top_left[i] = (tri->top_left & (1 << i)) ? _mm_castsi128_ps (_mm_set1_epi32 (-1)) : zero;
+  }
+  for (i=0; i<NUM_PLANES; i++)
+    p_step[i] = _mm_set1_ps (tri->plane[i][0] * 4);
+  alpha           = _mm_set1_ps (tri->alpha);
+  alpha_reference = _mm_set1_ps ((float)s->alpha_reference);
+
+  for (y=ymin; y<=ymax; y++) {
+    fx = (float)xmin;
+    fy = (float)y + 0.5f;
+    color_row = &color_buffer[y * stride];
+    depth_row = &depth_buffer[y * stride];
+    // Values at the 4 pixel centers starting at xmin
+    for (i=0; i<3; i++)
+      e[i] = _mm_add_ps (_mm_set1_ps (tri->edge[i][0] * fx + tri->edge[i][1] * fy + tri->edge[i][2]), _mm_mul_ps (_mm_set1_ps (tri->edge[i][0]), offsets));
+    for (i=0; i<NUM_PLANES; i++)
+      p[i] = _mm_add_ps (_mm_set1_ps (tri->plane[i][0] * fx + tri->plane[i][1] * fy + tri->plane[i][2]), _mm_mul_ps (_mm_set1_ps (tri->plane[i][0]), offsets));
+
+    for (x=xmin; x<=xmax; x+=4) {
+      // Inside all 3 edges, pixels exactly on an edge only if it's a top or left edge
+      inside = _mm_or_ps (_mm_cmpgt_ps (e[0], zero), _mm_and_ps (_mm_cmpeq_ps (e[0], zero), top_left[0]));
+      inside = _mm_and_ps (inside, _mm_or_ps (_mm_cmpgt_ps (e[1], zero), _mm_and_ps (_mm_cmpeq_ps (e[1], zero), top_left[1])));
+      inside = _mm_and_ps (inside, _mm_or_ps (_mm_cmpgt_ps (e[2], zero), _mm_and_ps (_mm_cmpeq_ps (e[2], zero), top_left[2])));
+      if (_mm_movemask_ps (inside)) {
+        depth = _mm_load_ps (&depth_row[x]);
+        mask  = _mm_and_ps (inside, _mm_cmple_ps (p[PLANE_Z], depth));
+        bits  = _mm_movemask_ps (mask);
+        if (bits) {
+          // Perspective correct attributes
+          w = _mm_div_ps (one, p[PLANE_W]);
+          r = _mm_mul_ps (p[PLANE_R], w);
+          g = _mm_mul_ps (p[PLANE_G], w);
+          b = _mm_mul_ps (p[PLANE_B], w);
+          if (tex) {
+            u = _mm_mul_ps (p[PLANE_U], w);
+            v = _mm_mul_ps (p[PLANE_V], w);
+            Sample_Texture (tex, Mip_Level (tri, tex, p, bits), u, v, &tr, &tg, &tb, &ta);
+            r = _mm_mul_ps (r, tr);
+            g = _mm_mul_ps (g, tg);
+            b = _mm_mul_ps (b, tb);
+            a = ta;
+          }
+          else {
+            r = _mm_mul_ps (r, scale);
+            g = _mm_mul_ps (g, scale);
+            b = _mm_mul_ps (b, scale);
+            a = alpha;
+          }
+          if (s->alpha_reference >= 0)
+            mask = _mm_and_ps (mask, _mm_cmpge_ps (a, alpha_reference));
+          if (_mm_movemask_ps (mask)) {
+            old = _mm_load_si128 ((__m128i *)&color_row[x]);
+            if (s->blend) {
+              k = _mm_div_ps (a, scale);
+              r = _mm_add_ps (Channel (old, 16), _mm_mul_ps (_mm_sub_ps (r, Channel (old, 16)), k));
+              g = _mm_add_ps (Channel (old, 8),  _mm_mul_ps (_mm_sub_ps (g, Channel (old, 8)),  k));
+              b = _mm_add_ps (Channel (old, 0),  _mm_mul_ps (_mm_sub_ps (b, Channel (old, 0)),  k));
+            }
+            out = Pack_Color (r, g, b);
+            out = _mm_or_si128 (_mm_and_si128 (_mm_castps_si128 (mask), out), _mm_andnot_si128 (_mm_castps_si128 (mask), old));
+            _mm_store_si128 ((__m128i *)&color_row[x], out);
+            _mm_store_ps (&depth_row[x], _mm_or_ps (_mm_and_ps (mask, p[PLANE_Z]), _mm_andnot_ps (mask, depth)));
+          }
+        }
+      }
+      for (i=0; i<3; i++)
+        e[i] = _mm_add_ps (e[i], e_step[i]);
+      for (i=0; i<NUM_PLANES; i++)
+        p[i] = _mm_add_ps (p[i], p_step[i]);
+    }
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Mip_Level
+|
+| Input: Called from Raster_Triangle()
+| Output: Returns the mipmap level for 4 pixels, from the texels per
+|   pixel at the first one covered.
+|___________________________________________________________________*/
+
+static int Mip_Level (SoftTriangle *tri, SoftTexture *tex, __m128 *p, int bits)
+{
+  int i, level;
+  float iw, u, v, dudx, dvdx, dudy, dvdy, rho;
+  alignas(16) float lane_w [4], lane_u [4], lane_v [4];
+
+  if (tex->num_levels == 1)
+    return (0);
+
+  for (i=0; NOT (bits & (1 << i)); i++);
+  _mm_store_ps (lane_w, p[PLANE_W]);
+  _mm_store_ps (lane_u, p[PLANE_U]);
+  _mm_store_ps (lane_v, p[PLANE_V]);
+  iw = lane_w[i];
+  u  = lane_u[i] / iw;
+  v  = lane_v[i] / iw;
+
+  // u = (u/w) / (1/w), so du/dx = (d(u/w)/dx - u * d(1/w)/dx) / (1/w)
+  dudx = (tri->plane[PLANE_U][0] - u * tri->plane[PLANE_W][0]) / iw * tex->width[0];
+  dvdx = (tri->plane[PLANE_V][0] - v * tri->plane[PLANE_W][0]) / iw * tex->height[0];
+  dudy = (tri->plane[PLANE_U][1] - u * tri->plane[PLANE_W][1]) / iw * tex->width[0];
+  dvdy = (tri->plane[PLANE_V][1] - v * tri->plane[PLANE_W][1]) / iw * tex->height[0];
+  rho = dudx * dudx + dvdx * dvdx;
+  if (dudy * dudy + dvdy * dvdy > rho)
+    rho = dudy * dudy + dvdy * dvdy;
+  if (NOT (rho > 1))
+    return (0);
+
+  // log2 of texels per pixel, rounded
+  level = (int)(logf (rho) * 0.7213475f + 0.5f);
+  if (level > tex->num_levels - 1)
+    level = tex->num_levels - 1;
+
+  return (level);
+}
+
+/*____________________________________________________________________
+|
+| Function: Sample_Texture
+|
+| Input: Called from Raster_Triangle()
+| Output: Returns the colors (0-255) of a mipmap level at 4 texture
+|   coordinates, filtered bilinear with wrap addressing.
+|___________________________________________________________________*/
+
+static void Sample_Texture (SoftTexture *tex, int level, __m128 u, __m128 v, __m128 *r, __m128 *g, __m128 *b, __m128 *a)
+{
+  int i, w, h, x0, x1, y0, y1;
+  unsigned *texel;
+  __m128 x, y, fx, fy, fl, c00, c10, c01, c11, top, bottom, *out [4];
+  __m128i t00, t10, t01, t11;
+  alignas(16) int lane_x [4], lane_y [4];
+  alignas(16) unsigned s00 [4], s10 [4], s01 [4], s11 [4];
+
+  w = tex->width[level];
+  h = tex->height[level];
+  texel = tex->texel[level];
+
+  // Texel centers are at whole numbers
+  x = _mm_sub_ps (_mm_mul_ps (u, _mm_set1_ps ((float)w)), _mm_set1_ps (0.5f));
+  y = _mm_sub_ps (_mm_mul_ps (v, _mm_set1_ps ((float)h)), _mm_set1_ps (0.5f));
+  fl = Floor (x);
+  fx = _mm_sub_ps (x, fl);
+  _mm_store_si128 ((__m128i *)lane_x, _mm_cvttps_epi32 (fl));
+  fl = Floor (y);
+  fy = _mm_sub_ps (y, fl);
+  _mm_store_si128 ((__m128i *)lane_y, _mm_cvttps_epi32 (fl));
+
+  // Sizes are powers of 2, so wrapping is a mask
+  for (i=0; i<4; i++) {
+    x0 = lane_x[i] & (w - 1);
+    x1 = (x0 + 1) & (w - 1);
+    y0 = (lane_y[i] & (h - 1)) * w;
+    y1 = (((lane_y[i] & (h - 1)) + 1) & (h - 1)) * w;
+    s00[i] = texel[y0 + x0];
+    s10[i] = texel[y0 + x1];
+    s01[i] = texel[y1 + x0];
+    s11[i] = texel[y1 + x1];
+  }
+  t00 = _mm_load_si128 ((__m128i *)s00);
+  t10 = _mm_load_si128 ((__m128i *)s10);
+  t01 = _mm_load_si128 ((__m128i *)s01);
+  t11 = _mm_load_si128 ((__m128i *)s11);
+
+  // Blue, green, red, alpha
+  out[0] = b;
+  out[1] = g;
+  out[2] = r;
+  out[3] = a;
+  for (i=0; i<4; i++) {
+    c00 = Channel (t00, i * 8);
+    c10 = Channel (t10, i * 8);
+    c01 = Channel (t01, i * 8);
+    c11 = Channel (t11, i * 8);
+    top    = _mm_add_ps (c00, _mm_mul_ps (_mm_sub_ps (c10, c00), fx));
+    bottom = _mm_add_ps (c01, _mm_mul_ps (_mm_sub_ps (c11, c01), fx));
+    *out[i] = _mm_add_ps (top, _mm_mul_ps (_mm_sub_ps (bottom, top), fy));
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: Channel
+|
+| Input: Called from Raster_Triangle(), Sample_Texture()
+| Output: Returns one 8-bit channel of 4 packed colors as floats.
+|___________________________________________________________________*/
+
+static __m128 Channel (__m128i p, int shift)
+{
+  return (_mm_cvtepi32_ps (_mm_and_si128 (_mm_srl_epi32 (p, _mm_cvtsi32_si128 (shift)), _mm_set1_epi32 (0xFF))));
+}
+
+/*____________________________________________________________________
+|
+| Function: Floor
+|
+| Input: Called from Sample_Texture()
+| Output: Returns the floor of 4 floats (in int range).
+|___________________________________________________________________*/
+
+static __m128 Floor (__m128 x)
+{
+  __m128 t;
+
+  t = _mm_cvtepi32_ps (_mm_cvttps_epi32 (x));
+  // Truncation rounded negative values up
+  return (_mm_sub_ps (t, _mm_and_ps (_mm_cmpgt_ps (t, x), _mm_set1_ps (1))));
+}
+
+/*____________________________________________________________________
+|
+| Function: Pack_Color
+|
+| Input: Called from Raster_Triangle()
+| Output: Returns 4 colors (0-255) packed as 0xFFRRGGBB.
+|___________________________________________________________________*/
+
+static __m128i Pack_Color (__m128 r, __m128 g, __m128 b)
+{
+  __m128 zero, max;
+  __m128i ir, ig, ib;
+
+  zero = _mm_setzero_ps ();
+  max  = _mm_set1_ps (255);
+  ir = _mm_cvtps_epi32 (_mm_min_ps (_mm_max_ps (r, zero), max));
+  ig = _mm_cvtps_epi32 (_mm_min_ps (_mm_max_ps (g, zero), max));
+  ib = _mm_cvtps_epi32 (_mm_min_ps (_mm_max_ps (b, zero), max));
+
+  return (_mm_or_si128 (_mm_or_si128 (_mm_slli_epi32 (ir, 16), _mm_slli_epi32 (ig, 8)),
+                        _mm_or_si128 (ib, _mm_set1_epi32 (0xFF000000))));
+}
+
+/*____________________________________________________________________
+|
+| Function: Normal_Matrix
+|
+| Input: Called from Soft_Transform_Object(), Transform_Draw()
+| Output: Returns the matrix that transforms normals for a matrix (the
+|   inverse transpose of its upper 3x3, up to scale), so normals stay
+|   perpendicular under non-uniform scaling.
+|___________________________________________________________________*/
+
+static void Normal_Matrix (gx3dMatrix *m, float n[3][3])
+{
+  int i, j;
+  float a [3][3], det;
+
+  a[0][0] = m->_00; a[0][1] = m->_01; a[0][2] = m->_02;
+  a[1][0] = m->_10; a[1][1] = m->_11; a[1][2] = m->_12;
+  a[2][0] = m->_20; a[2][1] = m->_21; a[2][2] = m->_22;
+
+  // Rows of the cofactor matrix are cross products of the other 2 rows
+  for (i=0; i<3; i++) {
+    j = (i + 1) % 3;
+    n[i][0] = a[j][1] * a[(j+1)%3][2] - a[j][2] * a[(j+1)%3][1];
+    n[i][1] = a[j][2] * a[(j+1)%3][0] - a[j][0] * a[(j+1)%3][2];
+    n[i][2] = a[j][0] * a[(j+1)%3][1] - a[j][1] * a[(j+1)%3][0];
+  }
+
+  // A mirroring matrix would turn the normals inside out
+  det = a[0][0] * n[0][0] + a[0][1] * n[0][1] + a[0][2] * n[0][2];
+  if (det < 0)
+    for (i=0; i<3; i++)
+      for (j=0; j<3; j++)
+        n[i][j] = -n[i][j];
+}
+
+/*____________________________________________________________________
+|
+| Function: Compute_Bounds
+|
+| Input: Called from Soft_Load_Object(), Soft_Transform_Object()
+| Output: Sets the bounding box of an object and a sphere around the
+|   center of the box.
+|___________________________________________________________________*/
+
+static void Compute_Bounds (SoftObject *obj)
+{
+  int i;
+  float d;
+  gx3dVector *v, *c, *min, *max;
+
+  memset (&obj->obj.bound_box, 0, sizeof(obj->obj.bound_box));
+  memset (&obj->obj.bound_sphere, 0, sizeof(obj->obj.bound_sphere));
+  if (obj->num_triangles == 0)
+    return;
+
+  min = &obj->obj.bound_box.min;
+  max = &obj->obj.bound_box.max;
+  *min = *max = obj->vertex[0].position;
+  for (i=1; i<obj->num_triangles*3; i++) {
+    v = &obj->vertex[i].position;
+    if (v->x < min->x) min->x = v->x;
+    if (v->y < min->y) min->y = v->y;
+    if (v->z < min->z) min->z = v->z;
+    if (v->x > max->x) max->x = v->x;
+    if (v->y > max->y) max->y = v->y;
+    if (v->z > max->z) max->z = v->z;
+  }
+  c = &obj->obj.bound_sphere.center;
+  c->x = (min->x + max->x) / 2;
+  c->y = (min->y + max->y) / 2;
+  c->z = (min->z + max->z) / 2;
+  for (i=0; i<obj->num_triangles*3; i++) {
+    v = &obj->vertex[i].position;
+    d = (v->x - c->x) * (v->x - c->x) + (v->y - c->y) * (v->y - c->y) + (v->z - c->z) * (v->z - c->z);
+    if (d > obj->obj.bound_sphere.radius)
+      obj->obj.bound_sphere.radius = d;
+  }
+  obj->obj.bound_sphere.radius = sqrtf (obj->obj.bound_sphere.radius);
+}
+
+/*____________________________________________________________________
+|
+| Function: Read_Bmp
+|
+| Input: Called from Soft_Load_Texture()
+| Output: Returns the pixels of an uncompressed 24 or 32-bit bmp file
+|   as a malloc'd array of 0xFFRRGGBB, top row first, or 0 if it can't
+|   be read.
+|___________________________________________________________________*/
+
+static unsigned *Read_Bmp (const char *filename, int *width, int *height)
+{
+  int x, y, w, h, size, offset, bytes, row_size;
+  unsigned compression, *pixels;
+  unsigned char *data, *src;
+  bool top_down;
+  FILE *fp;
+
+  fp = fopen (filename, "rb");
+  if (fp == NULL)
+    return (0);
+  fseek (fp, 0, SEEK_END);
+  size = (int)ftell (fp);
+  fseek (fp, 0, SEEK_SET);
+  if (size < 54) {
+    fclose (fp);
+    return (0);
+  }
+  data = (unsigned char *) malloc (size);
+  if (fread (data, size, 1, fp) != 1) {
+    free (data);
+    fclose (fp);
+    return (0);
+  }
+  fclose (fp);
+
+  // File header and BITMAPINFOHEADER, little endian
+  offset      = data[10] | (data[11] << 8) | (data[12] << 16) | (data[13] << 24);
+  w           = data[18] | (data[19] << 8) | (data[20] << 16) | (data[21] << 24);
+  h           = data[22] | (data[23] << 8) | (data[24] << 16) | (data[25] << 24);
+  bytes       = (data[28] | (data[29] << 8)) / 8;
+  compression = data[30] | (data[31] << 8) | (data[32] << 16) | (data[33] << 24);
+  top_down = (h < 0);
+  if (top_down)
+    h = -h;
+  row_size = (w * bytes + 3) & ~3;
+  if ((data[0] != 'B') OR (data[1] != 'M') OR (w <= 0) OR (h <= 0) OR
+      ((bytes != 3) AND (bytes != 4)) OR (compression != 0) OR
+      (offset < 0) OR (offset + row_size * h > size)) {
+    free (data);
+    return (0);
+  }
+
+  pixels = (unsigned *) malloc (w * h * sizeof(unsigned));
+  for (y=0; y<h; y++) {
+    src = data + offset + (top_down ? y : h - 1 - y) * row_size;
+    for (x=0; x<w; x++, src+=bytes)
+      pixels[y * w + x] = 0xFF000000 | (src[2] << 16) | (src[1] << 8) | src[0];
+  }
+  free (data);
+
+  *width  = w;
+  *height = h;
+  return (pixels);
+}
+
+/*____________________________________________________________________
+|
+| Function: Add_Handle
+|
+| Input: Called from Soft_Load_Object(), Soft_Load_Texture(),
+|   Soft_Init_Light()
+| Output: Adds something made by this backend to a list.
+|___________________________________________________________________*/
+
+static void Add_Handle (HandleList *list, void *item)
+{
+  if (list->count == list->max) {
+    list->max = list->max ? list->max * 2 : 64;
+    list->item = (void **) realloc (list->item, list->max * sizeof(void *));
+  }
+  list->item[list->count++] = item;
+}
+
+/*____________________________________________________________________
+|
+| Function: Remove_Handle
+|
+| Input: Called from Soft_Free_Object(), Soft_Free_Texture()
+| Output: Removes something from a list.  Returns true if it was there.
+|___________________________________________________________________*/
+
+static bool Remove_Handle (HandleList *list, void *item)
+{
+  int i;
+
+  for (i=0; i<list->count; i++)
+    if (list->item[i] == item) {
+      list->item[i] = list->item[--list->count];
+      return (true);
+    }
+  return (false);
+}
+
+/*____________________________________________________________________
+|
+| Function: Has_Handle
+|
+| Input: Called from the Soft_ functions
+| Output: Returns true if something was made by this backend.
+|___________________________________________________________________*/
+
+static bool Has_Handle (HandleList *list, void *item)
+{
+  int i;
+
+  for (i=0; i<list->count; i++)
+    if (list->item[i] == item)
+      return (true);
+  return (false);
+}
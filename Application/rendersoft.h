@@ -0,0 +1,57 @@
+/*____________________________________________________________________
+|
+| File: rendersoft.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+#define RENDERSOFT_TILE_SIZE   64   // screen tiles are this many pixels square
+#define RENDERSOFT_MAX_THREADS 16
+#define RENDERSOFT_MAX_LIGHTS  8    // lights enabled at once
+#define RENDERSOFT_MAX_LEVELS  13   // mipmap levels, enough for a 4096x4096 texture
+
+struct RenderSoftStats {
+  int   frames;         // # of frames flipped since RenderSoft_Init()
+  float frame_ms;       // average time to render a frame
+  float fps;            // frames per second that time allows
+  int   threads;        // # rasterizing
+  // Last frame
+  int   draws;
+  int   triangles;      // # in the objects drawn
+  int   rasterized;     // # left after culling and clipping
+  int   bin_entries;    // # of (triangle, tile) pairs
+  float vertex_ms;      // transforming, lighting, clipping and setting up triangles
+  float bin_ms;
+  float raster_ms;
+};
+
+// Returns the software backend, which rasterizes into its own frame buffer on the CPU
+RenderBackend *RenderSoft_Backend ();
+
+// Sets the size of the frame buffer, returns false if it can't be allocated
+bool RenderSoft_Init (int width, int height);
+
+// Writes the frame buffer as a 24-bit bmp file, returns true on success
+bool RenderSoft_Write_Image (const char *filename);
+
+// Writes every nth frame to <prefix><frame #>.bmp (0 to stop)
+void RenderSoft_Set_Capture (int every, const char *prefix);
+
+// Returns statistics since RenderSoft_Init()
+void RenderSoft_Get_Stats (RenderSoftStats *stats);
+
+// Writes the statistics to the debug file
+void RenderSoft_Write_Stats ();
+
+// Renders the last frame again a number of times at each size, writes the frame rates to the debug file and
+//  the last image at each size to <image_prefix><width>x<height>.bmp
+void RenderSoft_Benchmark (
+  int        *widths,
+  int        *heights,
+  int         count,
+  int         frames,
+  const char *image_prefix );
+
+// Frees the frame buffer and any objects, textures and lights made by the backend
+void RenderSoft_Free ();
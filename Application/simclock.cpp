@@ -0,0 +1,171 @@
+/*____________________________________________________________________
+|
+| File: simclock.cpp
+|
+| Description: Fixed timestep clock for the simulation.  Real time
+|   (from the high resolution timer, not the millisecond timer) is added
+|   to an accumulator each frame and the simulation is stepped a whole
+|   number of fixed steps to use it up, so it runs the same at any frame
+|   rate.  The remainder, as a fraction of a step, is what the renderer
+|   uses to draw between the last two steps.
+|
+|   A frame never runs more than SIM_CLOCK_MAX_STEPS steps (and never
+|   counts more than SIM_CLOCK_MAX_FRAME_MS), dropping the rest, so a
+|   slow frame can't make the next one slower still.
+|
+| Functions: SimClock_Init
+|            SimClock_Advance
+|            SimClock_Step_Ms
+|            SimClock_Time_Ms
+|            SimClock_Alpha
+|            SimClock_Get_Stats
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+
+#include "dp.h"
+
+#include "timer.h"
+#include "simclock.h"
+
+/*___________________
+|
+| Global variables
+|__________________*/
+
+static double        step_ms = 1000.0 / SIM_CLOCK_DEFAULT_HZ;
+static double        accumulator;     // real time not yet simulated
+static double        sim_time;        // simulated time
+static double        last_ms;         // Timer_Now_Ms() at the last advance
+static bool          started = false;
+
+static SimClockStats stats;
+
+/*____________________________________________________________________
+|
+| Function: SimClock_Init
+|
+| Input: Called from Program_Run()
+| Output: Starts the clock.
+|___________________________________________________________________*/
+
+void SimClock_Init (float hz)
+{
+  if (hz <= 0)
+    hz = SIM_CLOCK_DEFAULT_HZ;
+  step_ms     = 1000.0 / hz;
+  accumulator = 0;
+  sim_time    = 0;
+  started     = false;
+
+  memset (&stats, 0, sizeof(stats));
+  stats.hz = hz;
+}
+
+/*____________________________________________________________________
+|
+| Function: SimClock_Advance
+|
+| Input: Called from Program_Run()
+| Output: Returns # of steps to run this frame.
+|___________________________________________________________________*/
+
+int SimClock_Advance ()
+{
+  int steps;
+  double now, elapsed;
+
+  now = Timer_Now_Ms ();
+  stats.frames++;
+  if (NOT started) {
+    last_ms = now;
+    started = true;
+    return (0);
+  }
+  elapsed = now - last_ms;
+  last_ms = now;
+
+  if (elapsed > SIM_CLOCK_MAX_FRAME_MS) {
+    stats.dropped_ms += elapsed - SIM_CLOCK_MAX_FRAME_MS;
+    elapsed = SIM_CLOCK_MAX_FRAME_MS;
+  }
+  accumulator += elapsed;
+
+  steps = (int)(accumulator / step_ms);
+  if (steps > SIM_CLOCK_MAX_STEPS) {
+    // Keep the fraction of a step so drawing stays smooth
+    accumulator      -= (steps - SIM_CLOCK_MAX_STEPS) * step_ms;
+    stats.dropped_ms += (steps - SIM_CLOCK_MAX_STEPS) * step_ms;
+    stats.capped_frames++;
+    steps = SIM_CLOCK_MAX_STEPS;
+  }
+  accumulator -= steps * step_ms;
+  sim_time    += steps * step_ms;
+  stats.steps += steps;
+
+  return (steps);
+}
+
+/*____________________________________________________________________
+|
+| Function: SimClock_Step_Ms
+|
+| Input: Called from Program_Run()
+| Output: Returns the length of a step in milliseconds.
+|___________________________________________________________________*/
+
+float SimClock_Step_Ms ()
+{
+  return ((float)step_ms);
+}
+
+/*____________________________________________________________________
+|
+| Function: SimClock_Time_Ms
+|
+| Input: Called from Program_Run()
+| Output: Returns the simulated time in milliseconds.
+|___________________________________________________________________*/
+
+double SimClock_Time_Ms ()
+{
+  return (sim_time);
+}
+
+/*____________________________________________________________________
+|
+| Function: SimClock_Alpha
+|
+| Input: Called from Program_Run()
+| Output: Returns the fraction of a step since the last step.
+|___________________________________________________________________*/
+
+float SimClock_Alpha ()
+{
+  float alpha = (float)(accumulator / step_ms);
+
+  if (alpha > 1)
+    alpha = 1;
+  return (alpha);
+}
+
+/*____________________________________________________________________
+|
+| Function: SimClock_Get_Stats
+|
+| Input: Called from Program_Run()
+| Output: Returns statistics since SimClock_Init().
+|___________________________________________________________________*/
+
+void SimClock_Get_Stats (SimClockStats *clock_stats)
+{
+  *clock_stats = stats;
+}
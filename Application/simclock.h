@@ -0,0 +1,38 @@
+/*____________________________________________________________________
+|
+| File: simclock.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+#define SIM_CLOCK_DEFAULT_HZ    60
+#define SIM_CLOCK_MAX_STEPS     5     // per frame, time left over after that is dropped
+#define SIM_CLOCK_MAX_FRAME_MS  250   // longest frame counted (a breakpoint or a stall is not caught up on)
+
+// Statistics since SimClock_Init()
+struct SimClockStats {
+  float  hz;
+  int    frames;            // # of calls to SimClock_Advance()
+  int    steps;             // # of steps run
+  int    capped_frames;     // # of frames that ran SIM_CLOCK_MAX_STEPS and dropped time
+  double dropped_ms;        // time not simulated
+};
+
+// Starts the clock, stepping hz times a second (0 for SIM_CLOCK_DEFAULT_HZ)
+void SimClock_Init (float hz);
+
+// Adds the time since the last call, returns # of steps to run now (0 the first time)
+int SimClock_Advance ();
+
+// Returns the length of a step in milliseconds
+float SimClock_Step_Ms ();
+
+// Returns the simulated time in milliseconds (all steps returned so far run)
+double SimClock_Time_Ms ();
+
+// Returns how far (0-1) the real time is past the last step toward the next, to draw in between
+float SimClock_Alpha ();
+
+// Returns statistics since SimClock_Init()
+void SimClock_Get_Stats (SimClockStats *stats);
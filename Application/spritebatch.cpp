@@ -0,0 +1,192 @@
+/*____________________________________________________________________
+|
+| File: spritebatch.cpp
+|
+| Description: 2D sprite batching for the HUD.  Sprites are added to
+|   a batch through the frame, then drawn grouped by image (object and
+|   texture) with one instanced draw per image, so the texture is set
+|   once per image and a backend with instancing draws each image in a
+|   single call however many sprites use it.
+|
+|   Each sprite is just a matrix.  Flushing counts the sprites of each
+|   image, then places their matrices into one array grouped by image
+|   (keeping the order they were added in).
+|
+| Functions: SpriteBatch_Add_Image
+|            SpriteBatch_Begin
+|            SpriteBatch_Add
+|            SpriteBatch_Flush
+|            SpriteBatch_Get_Stats
+|            SpriteBatch_Free
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+
+#include "dp.h"
+
+#include "render.h"
+#include "spritebatch.h"
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+struct SpriteImage {
+  gx3dObject  *obj;
+  gx3dTexture  tex;
+};
+
+struct Sprite {
+  int        image;
+  gx3dMatrix matrix;
+};
+
+/*___________________
+|
+| Global variables
+|__________________*/
+
+static SpriteImage image_list [SPRITE_BATCH_MAX_IMAGES];
+static int         num_images = 0;
+
+static Sprite     sprite [SPRITE_BATCH_MAX_SPRITES];
+static int        num_sprites = 0;
+static int        num_dropped = 0;
+static gx3dMatrix grouped [SPRITE_BATCH_MAX_SPRITES];     // matrices grouped by image, built by SpriteBatch_Flush()
+
+static SpriteBatchStats stats;
+
+/*____________________________________________________________________
+|
+| Function: SpriteBatch_Add_Image
+|
+| Input: Called from Program_Run()
+| Output: Returns image id of a new image or -1 on error.
+|___________________________________________________________________*/
+
+int SpriteBatch_Add_Image (gx3dObject *obj, gx3dTexture tex)
+{
+  if ((num_images == SPRITE_BATCH_MAX_IMAGES) OR (obj == 0))
+    return (-1);
+
+  image_list[num_images].obj = obj;
+  image_list[num_images].tex = tex;
+
+  return (num_images++);
+}
+
+/*____________________________________________________________________
+|
+| Function: SpriteBatch_Begin
+|
+| Input: Called from Pass_HUD()
+| Output: Empties the batch.
+|___________________________________________________________________*/
+
+void SpriteBatch_Begin ()
+{
+  num_sprites = 0;
+  num_dropped = 0;
+}
+
+/*____________________________________________________________________
+|
+| Function: SpriteBatch_Add
+|
+| Input: Called from Pass_HUD()
+| Output: Adds a sprite to the batch.
+|___________________________________________________________________*/
+
+void SpriteBatch_Add (int image, float x, float y, float scale)
+{
+  gx3dMatrix *m;
+
+  if ((image < 0) OR (image >= num_images))
+    return;
+  if (num_sprites == SPRITE_BATCH_MAX_SPRITES) {
+    num_dropped++;
+    return;
+  }
+
+  sprite[num_sprites].image = image;
+  m = &sprite[num_sprites].matrix;
+  gx3d_GetScaleMatrix (m, scale, scale, scale);
+  m->_30 = x;
+  m->_31 = y;
+  m->_32 = SPRITE_BATCH_Z;
+  num_sprites++;
+}
+
+/*____________________________________________________________________
+|
+| Function: SpriteBatch_Flush
+|
+| Input: Called from Pass_HUD()
+| Output: Draws the sprites in the batch, one instanced draw per image.
+|___________________________________________________________________*/
+
+void SpriteBatch_Flush ()
+{
+  int i, first [SPRITE_BATCH_MAX_IMAGES+1], next [SPRITE_BATCH_MAX_IMAGES];
+
+  // Where each image's matrices start
+  memset (first, 0, sizeof(first));
+  for (i=0; i<num_sprites; i++)
+    first[sprite[i].image+1]++;
+  for (i=0; i<num_images; i++) {
+    first[i+1] += first[i];
+    next[i] = first[i];
+  }
+  for (i=0; i<num_sprites; i++)
+    grouped[next[sprite[i].image]++] = sprite[i].matrix;
+
+  stats.sprites = num_sprites;
+  stats.draws   = 0;
+  stats.dropped = num_dropped;
+  for (i=0; i<num_images; i++)
+    if (first[i+1] > first[i]) {
+      Render_Draw_Instanced (image_list[i].obj, image_list[i].tex, &grouped[first[i]], first[i+1] - first[i]);
+      stats.draws++;
+    }
+
+  num_sprites = 0;
+  num_dropped = 0;
+}
+
+/*____________________________________________________________________
+|
+| Function: SpriteBatch_Get_Stats
+|
+| Input: Called from Program_Run()
+| Output: Returns statistics for the last flush.
+|___________________________________________________________________*/
+
+void SpriteBatch_Get_Stats (SpriteBatchStats *batch_stats)
+{
+  *batch_stats = stats;
+}
+
+/*____________________________________________________________________
+|
+| Function: SpriteBatch_Free
+|
+| Input: Called from Program_Run()
+| Output: Removes all images.
+|___________________________________________________________________*/
+
+void SpriteBatch_Free ()
+{
+  num_images  = 0;
+  num_sprites = 0;
+  num_dropped = 0;
+  memset (&stats, 0, sizeof(stats));
+}
@@ -0,0 +1,40 @@
+/*____________________________________________________________________
+|
+| File: spritebatch.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+#define SPRITE_BATCH_MAX_IMAGES  16
+#define SPRITE_BATCH_MAX_SPRITES 1024   // per batch
+
+// Depth sprites are drawn at in the screen view (camera at (0,0,1) looking at the origin)
+#define SPRITE_BATCH_Z (-0.01f)
+
+// Statistics for the last call to SpriteBatch_Flush()
+struct SpriteBatchStats {
+  int sprites;              // # drawn
+  int draws;                // # of instanced draws (one per image used)
+  int dropped;              // # added after the batch was full
+};
+
+// Adds an image sprites are drawn with: a flat object facing the screen and its texture.  Returns image id
+//  or -1 on error.
+int SpriteBatch_Add_Image (gx3dObject *obj, gx3dTexture tex);
+
+// Empties the batch
+void SpriteBatch_Begin ();
+
+// Adds a sprite of an image at a position in the screen view, scaled about the object's origin
+void SpriteBatch_Add (int image, float x, float y, float scale);
+
+// Draws the batch, the sprites of each image in one instanced draw (in the order added, images in the order
+//  they were added).  Call with the screen view set.
+void SpriteBatch_Flush ();
+
+// Returns statistics for the last call to SpriteBatch_Flush()
+void SpriteBatch_Get_Stats (SpriteBatchStats *stats);
+
+// Removes all images (the objects and textures are not freed)
+void SpriteBatch_Free ();
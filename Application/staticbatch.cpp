@@ -0,0 +1,331 @@
+/*____________________________________________________________________
+|
+| File: staticbatch.cpp
+|
+| Description: Static batching.  Copies of an object that never move
+|   are pre-transformed into world space and merged into a few larger
+|   meshes at load time, one per grid cell (split further if a cell
+|   has too many points for 16-bit indices), so each cell is a single
+|   draw and can still be culled on its own.
+|
+|   The gx3d library builds objects from LWO2 files, so each merged
+|   mesh is written out as a temporary LWO2 file (in the user's temp
+|   directory, not with the game's assets) and read back in.
+|   gx3d scales file units to feet when it reads a file, so the world
+|   matrices are converted to file units before merging.
+|
+| Functions: StaticBatch_Create
+|             Build_Chunk
+|            StaticBatch_Num_Chunks
+|            StaticBatch_Cull
+|            StaticBatch_Submit
+|            StaticBatch_Get_Stats
+|            StaticBatch_Free
+|             Compare_Cells
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#include <first_header.h>
+#include <math.h>
+
+#include "dp.h"
+
+#include "lwo2.h"
+#include "occlusion.h"
+#include "render.h"
+#include "renderqueue.h"
+#include "staticbatch.h"
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+struct StaticBatch {
+  int         material;
+  int         num_chunks;
+  gx3dObject *chunk [STATIC_BATCH_MAX_CHUNKS];
+  bool        in_frustum [STATIC_BATCH_MAX_CHUNKS];   // set by StaticBatch_Cull()
+};
+
+// Grid cell of one copy, used for sorting
+struct CellCopy {
+  int cell_x, cell_z;
+  int copy;
+};
+
+/*___________________
+|
+| Function Prototypes
+|__________________*/
+
+static gx3dObject *Build_Chunk (Lwo2File *src, gx3dMatrix *matrices, int count);
+static int Compare_Cells (const void *a, const void *b);
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define MAX_CHUNK_POINTS 65535  // keep each merged mesh within 16-bit indices
+
+#define TEMP_PREFIX "sbt"       // temporary file names start with this
+
+/*___________________
+|
+| Global variables
+|__________________*/
+
+static StaticBatch      batches [STATIC_BATCH_MAX_BATCHES];
+static int              num_batches = 0;
+static StaticBatchStats stats;
+
+/*____________________________________________________________________
+|
+| Function: StaticBatch_Create
+|
+| Input: Called from Program_Run()
+| Output: Merges copies of an object into chunks.  Returns batch id or
+|   -1 on error.
+|___________________________________________________________________*/
+
+int StaticBatch_Create (
+  const char *lwo_filename,
+  int         material,
+  gx3dMatrix *matrices,
+  int         count,
+  float       cell_size )
+{
+  int i, n, first, points_per_copy, max_copies;
+  StaticBatch *batch;
+  CellCopy *cells;
+  gx3dMatrix *sorted;
+  gx3dObject *obj;
+  Lwo2File src;
+
+  if ((num_batches == STATIC_BATCH_MAX_BATCHES) OR (count <= 0) OR (cell_size <= 0))
+    return (-1);
+  if (NOT Lwo2_Read (lwo_filename, &src))
+    return (-1);
+  points_per_copy = Lwo2_Num_Points (&src);
+  if ((points_per_copy == 0) OR (points_per_copy > MAX_CHUNK_POINTS)) {
+    Lwo2_Free (&src);
+    return (-1);
+  }
+  max_copies = MAX_CHUNK_POINTS / points_per_copy;
+
+  // Sort the copies by grid cell
+  cells  = (CellCopy *)   malloc (count * sizeof(CellCopy));
+  sorted = (gx3dMatrix *) malloc (count * sizeof(gx3dMatrix));
+  for (i=0; i<count; i++) {
+    cells[i].cell_x = (int)floor (matrices[i]._30 / cell_size);
+    cells[i].cell_z = (int)floor (matrices[i]._32 / cell_size);
+    cells[i].copy   = i;
+  }
+  qsort (cells, count, sizeof(CellCopy), Compare_Cells);
+  for (i=0; i<count; i++)
+    sorted[i] = matrices[cells[i].copy];
+
+  batch = &batches[num_batches];
+  memset (batch, 0, sizeof(StaticBatch));
+  batch->material = material;
+
+  // Merge each run of copies in the same cell
+  for (first=0; first<count; first+=n) {
+    for (n=1; first+n<count; n++)
+      if ((n == max_copies) OR
+          (cells[first+n].cell_x != cells[first].cell_x) OR
+          (cells[first+n].cell_z != cells[first].cell_z))
+        break;
+    if (batch->num_chunks == STATIC_BATCH_MAX_CHUNKS)
+      break;
+    obj = Build_Chunk (&src, &sorted[first], n);
+    if (obj == NULL)
+      break;
+    batch->chunk[batch->num_chunks++] = obj;
+  }
+
+  free (cells);
+  free (sorted);
+  Lwo2_Free (&src);
+
+  // Didn't get all the copies?
+  if (first < count) {
+    for (i=0; i<batch->num_chunks; i++)
+      Render_Free_Object (batch->chunk[i]);
+    return (-1);
+  }
+
+  return (num_batches++);
+}
+
+/*____________________________________________________________________
+|
+| Function: Build_Chunk
+|
+| Input: Called from StaticBatch_Create()
+| Output: Returns a new object holding count transformed copies of src,
+|   or NULL on error.
+|___________________________________________________________________*/
+
+static gx3dObject *Build_Chunk (Lwo2File *src, gx3dMatrix *matrices, int count)
+{
+  int i;
+  gx3dObject *obj;
+  gx3dMatrix to_feet, to_units, *file_matrices;
+  Lwo2File merged;
+  char temp_path [MAX_PATH], temp_filename [MAX_PATH];
+
+  // File units to world feet, through the world matrix, and back to file units
+  gx3d_GetScaleMatrix (&to_feet, LWO2_FEET_PER_UNIT, LWO2_FEET_PER_UNIT, LWO2_FEET_PER_UNIT);
+  gx3d_GetScaleMatrix (&to_units, 1 / LWO2_FEET_PER_UNIT, 1 / LWO2_FEET_PER_UNIT, 1 / LWO2_FEET_PER_UNIT);
+  file_matrices = (gx3dMatrix *) malloc (count * sizeof(gx3dMatrix));
+  for (i=0; i<count; i++) {
+    gx3d_MultiplyMatrix (&to_feet, &matrices[i], &file_matrices[i]);
+    gx3d_MultiplyMatrix (&file_matrices[i], &to_units, &file_matrices[i]);
+  }
+
+  obj = NULL;
+  if (Lwo2_Merge (src, file_matrices, count, &merged)) {
+    // A uniquely named file in the temp directory (GetTempFileName() creates it empty)
+    if (GetTempPathA (MAX_PATH, temp_path) AND GetTempFileNameA (temp_path, TEMP_PREFIX, 0, temp_filename)) {
+      if (Lwo2_Write (temp_filename, &merged))
+        obj = Render_Load_Object (temp_filename);
+      DeleteFileA (temp_filename);
+    }
+    Lwo2_Free (&merged);
+  }
+  free (file_matrices);
+
+  return (obj);
+}
+
+/*____________________________________________________________________
+|
+| Function: StaticBatch_Num_Chunks
+|
+| Input: Called from ____
+| Output: Returns # of chunks in a batch.
+|___________________________________________________________________*/
+
+int StaticBatch_Num_Chunks (int batch)
+{
+  if ((batch < 0) OR (batch >= num_batches))
+    return (0);
+  return (batches[batch].num_chunks);
+}
+
+/*____________________________________________________________________
+|
+| Function: StaticBatch_Cull
+|
+| Input: Called from Program_Run()
+| Output: Marks the chunks that may be inside the view frustum.
+|___________________________________________________________________*/
+
+void StaticBatch_Cull ()
+{
+  int i, j;
+
+  memset (&stats, 0, sizeof(stats));
+
+  for (i=0; i<num_batches; i++)
+    for (j=0; j<batches[i].num_chunks; j++) {
+      batches[i].in_frustum[j] = Render_Sphere_Visible (&batches[i].chunk[j]->bound_sphere);
+      stats.chunks++;
+      if (NOT batches[i].in_frustum[j])
+        stats.culled++;
+    }
+}
+
+/*____________________________________________________________________
+|
+| Function: StaticBatch_Submit
+|
+| Input: Called from Record_Fence_And_Hills() (on a recording thread)
+| Output: Records the chunks in the view frustum that aren't occluded
+|   into a render queue command buffer.
+|___________________________________________________________________*/
+
+void StaticBatch_Submit (int buffer)
+{
+  int i, j;
+  gx3dObject *obj;
+  gx3dMatrix m;
+
+  // Chunks are already in world space
+  gx3d_GetIdentityMatrix (&m);
+
+  for (i=0; i<num_batches; i++) {
+    for (j=0; j<batches[i].num_chunks; j++) {
+      if (NOT batches[i].in_frustum[j])
+        continue;
+      obj = batches[i].chunk[j];
+      if (NOT Occlusion_Box_Visible (&obj->bound_box, &m)) {
+        stats.culled++;
+        continue;
+      }
+      RenderQueue_Record (buffer, RQ_PASS_OPAQUE, batches[i].material, obj, &m);
+      stats.drawn++;
+    }
+  }
+}
+
+/*____________________________________________________________________
+|
+| Function: StaticBatch_Get_Stats
+|
+| Input: Called from ____
+| Output: Returns statistics for the last calls to StaticBatch_Cull()
+|   and StaticBatch_Submit().
+|___________________________________________________________________*/
+
+void StaticBatch_Get_Stats (StaticBatchStats *batch_stats)
+{
+  *batch_stats = stats;
+}
+
+/*____________________________________________________________________
+|
+| Function: StaticBatch_Free
+|
+| Input: Called from Program_Run()
+| Output: Frees all batches.
+|___________________________________________________________________*/
+
+void StaticBatch_Free ()
+{
+  int i, j;
+
+  for (i=0; i<num_batches; i++)
+    for (j=0; j<batches[i].num_chunks; j++)
+      Render_Free_Object (batches[i].chunk[j]);
+  num_batches = 0;
+}
+
+/*____________________________________________________________________
+|
+| Function: Compare_Cells
+|
+| Input: Called from qsort()
+| Output: Orders copies by cell, then by original order.
+|___________________________________________________________________*/
+
+static int Compare_Cells (const void *a, const void *b)
+{
+  const CellCopy *ca = (const CellCopy *)a;
+  const CellCopy *cb = (const CellCopy *)b;
+
+  if (ca->cell_z != cb->cell_z)
+    return (ca->cell_z - cb->cell_z);
+  if (ca->cell_x != cb->cell_x)
+    return (ca->cell_x - cb->cell_x);
+  return (ca->copy - cb->copy);
+}
@@ -0,0 +1,41 @@
+/*____________________________________________________________________
+|
+| File: staticbatch.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+#define STATIC_BATCH_MAX_BATCHES 8
+#define STATIC_BATCH_MAX_CHUNKS  32      // per batch
+
+// Per-frame statistics
+struct StaticBatchStats {
+  int chunks;               // total # of chunks in all batches
+  int drawn;                // # submitted
+  int culled;               // # outside the view frustum or occluded
+};
+
+// Merges copies of an object that never move into a few spatially grouped meshes, returns batch id or -1 on error
+int StaticBatch_Create (
+  const char *lwo_filename, // LWO2 file of the object, single layer
+  int         material,     // render queue material
+  gx3dMatrix *matrices,     // world matrix of each copy
+  int         count,
+  float       cell_size );  // copies in the same cell of this size (x,z) are merged together
+
+// Returns # of chunks in a batch
+int StaticBatch_Num_Chunks (int batch);
+
+// Tests the chunks of all batches against the view frustum - call each frame before StaticBatch_Submit()
+void StaticBatch_Cull ();
+
+// Records the chunks in the view frustum that aren't occluded into a render queue command buffer (may
+//  run on a recording thread)
+void StaticBatch_Submit (int buffer);
+
+// Returns statistics for the last calls to StaticBatch_Cull() and StaticBatch_Submit()
+void StaticBatch_Get_Stats (StaticBatchStats *stats);
+
+// Free all batches
+void StaticBatch_Free ();
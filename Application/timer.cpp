@@ -0,0 +1,57 @@
+/*____________________________________________________________________
+|
+| File: timer.cpp
+|
+| Description: The clock every module times itself with.  Times are
+|   milliseconds in a double, counted from the first call so they keep
+|   well under a microsecond of precision for days.  Uses only the
+|   standard steady clock (the performance counter on Windows), so it
+|   builds anywhere.
+|
+| Functions: Timer_Now_Ms
+|            Timer_Elapsed_Ms
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*___________________
+|
+| Include Files
+|__________________*/
+
+#ifdef _WIN32
+#include <first_header.h>
+#endif
+
+#include <chrono>
+
+#include "timer.h"
+
+/*____________________________________________________________________
+|
+| Function: Timer_Now_Ms
+|
+| Input: Called from anywhere
+| Output: Returns milliseconds since the first call.
+|___________________________________________________________________*/
+
+double Timer_Now_Ms ()
+{
+  static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+
+  return (std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now () - start).count ());
+}
+
+/*____________________________________________________________________
+|
+| Function: Timer_Elapsed_Ms
+|
+| Input: Called from anywhere
+| Output: Returns milliseconds since start.
+|___________________________________________________________________*/
+
+float Timer_Elapsed_Ms (double start)
+{
+  return ((float)(Timer_Now_Ms () - start));
+}
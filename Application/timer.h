@@ -0,0 +1,13 @@
+/*____________________________________________________________________
+|
+| File: timer.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+// Returns milliseconds on a steady, high resolution clock, counted from the first call
+double Timer_Now_Ms ();
+
+// Returns milliseconds since start (a time from Timer_Now_Ms())
+float Timer_Elapsed_Ms (double start);
@@ -17,9 +17,12 @@
 |							CMainFrame::EventQueue_Add
 |             CMainFrame::EventQueue_Remove                      
 |             CMainFrame::EventQueue_Flush
+|             CMainFrame::EventQueue_Wait
+|             CMainFrame::EventQueue_Get_Stats
 |             CMainFrame::CallbackQueue_Add
 |             CMainFrame::CallbackQueue_Flush
 |             CMainFrame::CallbackQueue_Process
+|             CMainFrame::CallbackQueue_Get_Stats
 |
 |             CMainFrame::Start_Program_Thread
 |              Program_Thread
@@ -57,16 +60,6 @@
 #include "CMainFrame.h"
 #include "splash.h"
 
-/*____________________
-|
-| Type definitions
-|___________________*/
-
-struct CallbackQueueEntry {
-  void (*callback) (void *params); 
-  void *params;
-};
-
 /*____________________
 |
 | Function prototypes
@@ -115,13 +108,12 @@ CMainFrame::CMainFrame ()
 {
   // Init event queue
   InitializeCriticalSection (&event_critsection);
-  event_queue = queue_Init (SIZE_EVENT_QUEUE, sizeof (EventQueueEntry));
+  event_queue = ring_Init (SIZE_EVENT_QUEUE, sizeof (EventQueueEntry));
   generate_keypress_events = FALSE;
   preferences = NULL;
 
   // Init callback queue
-  InitializeCriticalSection (&callback_critsection);
-  callback_queue = queue_Init (SIZE_CALLBACK_QUEUE, sizeof (CallbackQueueEntry));
+  callback_queue = callqueue_Init (SIZE_CALLBACK_QUEUE);
 
   // Init cursor state (visible by default)
   cursor_state = 1;
@@ -140,11 +132,10 @@ CMainFrame::CMainFrame ()
 CMainFrame::~CMainFrame ()
 {
   // Free callback queue
-  queue_Free (callback_queue);
-  DeleteCriticalSection (&callback_critsection);
+  callqueue_Free (callback_queue);
 
   // Free event queue
-  queue_Free (event_queue);
+  ring_Free (event_queue);
   DeleteCriticalSection (&event_critsection);
 
   // Print abort string?
@@ -281,13 +272,16 @@ void CMainFrame::Abort_Program (char *str)
 |
 |	Function: CMainFrame::EventQueue_Add
 | 
-|	Output: Adds an entry to the event queue.
+|	Output: Adds an entry to the event queue (dropped and counted if
+|   full).  The window thread adds most events but the input library
+|   may add some from another thread, so adding threads take turns.
+|   The program thread removing events never waits on them.
 |___________________________________________________________________*/
 
 void CMainFrame::EventQueue_Add (EventQueueEntry *qentry)
 {
 	EnterCriticalSection (&event_critsection);
-	queue_Add (event_queue, qentry);
+	ring_Add (event_queue, qentry);
 	LeaveCriticalSection (&event_critsection);
 }
 
@@ -295,18 +289,12 @@ void CMainFrame::EventQueue_Add (EventQueueEntry *qentry)
 |
 |	Function: CMainFrame::EventQueue_Remove
 | 
-|	Output: Removes an entry from the event queue.
+|	Output: Removes an entry from the event queue (program thread only).
 |___________________________________________________________________*/
 
 int CMainFrame::EventQueue_Remove (EventQueueEntry *qentry)
 {
-	int event_ready;
-
-  EnterCriticalSection (&event_critsection);
-	event_ready = queue_Remove (event_queue, qentry);
-	LeaveCriticalSection (&event_critsection);
-
-  return (event_ready);
+  return (ring_Remove (event_queue, qentry));
 }
 
 /*___________________________________________________________________
@@ -314,7 +302,8 @@ int CMainFrame::EventQueue_Remove (EventQueueEntry *qentry)
 |	Function: CMainFrame::EventQueue_Flush
 | 
 |	Input: Called from ____
-| Output: Flushes all events contained in the eventmask from the event queue.
+| Output: Flushes all events contained in the eventmask from the event queue
+|   (program thread only).
 |___________________________________________________________________*/
 
 // Callback function
@@ -332,9 +321,34 @@ static int Entry_Is_Type (void *event, void *event_type_mask)
 
 void CMainFrame::EventQueue_Flush (unsigned event_type_mask)
 {
-  EnterCriticalSection (&event_critsection);
-	queue_Remove_Selected_Entries (event_queue, &event_type_mask, Entry_Is_Type);
-	LeaveCriticalSection (&event_critsection);
+	ring_Remove_Selected_Entries (event_queue, &event_type_mask, Entry_Is_Type);
+}
+
+/*___________________________________________________________________
+|
+|	Function: CMainFrame::EventQueue_Wait
+| 
+|	Input: Called from ____
+| Output: Waits up to timeout_ms for an event (program thread only).
+|   Returns TRUE if one is waiting.
+|___________________________________________________________________*/
+
+int CMainFrame::EventQueue_Wait (unsigned timeout_ms)
+{
+  return (ring_Wait (event_queue, timeout_ms));
+}
+
+/*___________________________________________________________________
+|
+|	Function: CMainFrame::EventQueue_Get_Stats
+| 
+|	Input: Called from ____
+| Output: Returns event queue statistics.
+|___________________________________________________________________*/
+
+void CMainFrame::EventQueue_Get_Stats (RingStats *stats)
+{
+  ring_Get_Stats (event_queue, stats);
 }
 
 /*___________________________________________________________________
@@ -346,30 +360,10 @@ void CMainFrame::EventQueue_Flush (unsigned event_type_mask)
 
 void CMainFrame::CallbackQueue_Add (void (*callback) (void *params), void *params, unsigned size_params)
 {
-  int error = FALSE;
-
-  CallbackQueueEntry data;
-
-  // Create a struct for the data
-  data.callback = callback;
-  data.params   = NULL;
-  if (size_params) {
-    data.params = (void *) malloc (size_params);
-    if (data.params) 
-      memcpy (data.params, params, size_params);
-    else 
-      error = TRUE;
-  }
-
-  if (NOT error) {
-    // Add this to the callback queue
-    EnterCriticalSection (&callback_critsection);
-    queue_Add (callback_queue, (byte *)&data);
-    LeaveCriticalSection (&callback_critsection);
-  	  
+  // Add this to the callback queue (parameters are copied into it)
+  if (callqueue_Add (callback_queue, callback, params, size_params))
     // Send a message to indicate an entry has been entered in the callback queue
 	  ::PostMessage (m_hWnd, USER_CALLBACK_MSG, 0, 0);
-  }
 }
 
 /*___________________________________________________________________
@@ -382,13 +376,7 @@ void CMainFrame::CallbackQueue_Add (void (*callback) (void *params), void *param
 
 void CMainFrame::CallbackQueue_Flush (void)
 {
-  CallbackQueueEntry data;
-
-  EnterCriticalSection (&callback_critsection);
-  while (queue_Remove (callback_queue, (byte *)&data))
-    if (data.params)
-      free (data.params);
-	LeaveCriticalSection (&callback_critsection);
+  callqueue_Flush (callback_queue);
 }
 
 /*___________________________________________________________________
@@ -401,19 +389,21 @@ void CMainFrame::CallbackQueue_Flush (void)
 
 void CMainFrame::CallbackQueue_Process (void)
 {
-  CallbackQueueEntry data;
-
-  EnterCriticalSection (&callback_critsection);
-  // If any entry in the queue
-  if (queue_Remove (callback_queue, (byte *)&data)) {
-    // Call back the user function
-    (*data.callback) (data.params);   
-    // Free memory for this queue entry
-    if (data.params)
-      free (data.params);
-  }
-    
-  LeaveCriticalSection (&callback_critsection);
+  // Call back the user function, if any entry in the queue
+  callqueue_Process (callback_queue);
+}
+
+/*___________________________________________________________________
+|
+|	Function: CMainFrame::CallbackQueue_Get_Stats
+| 
+|	Input: Called from win_CallbackQueue_Get_Stats()
+| Output: Returns callback queue statistics.
+|___________________________________________________________________*/
+
+void CMainFrame::CallbackQueue_Get_Stats (CallQueueStats *stats)
+{
+  callqueue_Get_Stats (callback_queue, stats);
 }
 
 /*___________________________________________________________________
@@ -503,9 +493,7 @@ afx_msg void CMainFrame::OnClose ()
 	  // Generate a close event for program thread
     static EventQueueEntry qentry;
 	  qentry.type = evTYPE_WINDOW_CLOSE;
-    EnterCriticalSection (&event_critsection);
-    queue_Add (event_queue, &qentry);
-    LeaveCriticalSection (&event_critsection);
+    EventQueue_Add (&qentry);
 
     // Wait until program thread closes (or 10 seconds max)
 		WaitForSingleObject (program_thread_handle, 10*1000);
@@ -569,9 +557,7 @@ afx_msg void CMainFrame::OnActivateApp (BOOL bActive, DWORD hTask)
     DEBUG_WRITE ("Inside OnActivateApp() - generating evTYPE_WINDOW_INACTIVE")
 #endif
 
-  EnterCriticalSection (&event_critsection);
-  queue_Add (event_queue, &qentry);
-  LeaveCriticalSection (&event_critsection);
+  EventQueue_Add (&qentry);
 }
 
 /*___________________________________________________________________
@@ -705,9 +691,7 @@ void CMainFrame::On_Key_Press (int event_keycode)
 
   qentry.type		 = evTYPE_KEY_PRESS;
   qentry.keycode = event_keycode;
-  EnterCriticalSection (&event_critsection);
-  queue_Add (event_queue, &qentry);
-  LeaveCriticalSection (&event_critsection);
+  EventQueue_Add (&qentry);
 }
 
 /*___________________________________________________________________
@@ -12,6 +12,8 @@
 |___________________*/
                                                           
 #include <events.h>
+#include "ring.h"
+#include "callqueue.h"
 
 /*____________________
 |
@@ -42,10 +44,13 @@ public:
   void EventQueue_Add    (EventQueueEntry *qentry);
   int  EventQueue_Remove (EventQueueEntry *qentry);
   void EventQueue_Flush  (unsigned event_type_mask);
+  int  EventQueue_Wait   (unsigned timeout_ms);
+  void EventQueue_Get_Stats (RingStats *stats);
 
   void CallbackQueue_Add     (void (*callback) (void *params), void *params, unsigned size_params);
   void CallbackQueue_Flush   (void);
   void CallbackQueue_Process (void);
+  void CallbackQueue_Get_Stats (CallQueueStats *stats);
   
   void Start_Program_Thread (void);
 
@@ -66,15 +71,14 @@ private:
   void Show_MFC_Cursor ();
   void Hide_MFC_Cursor ();
 
-	// Event queue
-  Queue event_queue;
+	// Event queue (window thread to program thread), the critical section is taken only by threads adding
+  Ring *event_queue;
   CRITICAL_SECTION event_critsection;
   int generate_keypress_events;
   void *preferences;
 
-  // Callback queue
-  Queue	callback_queue;
-  CRITICAL_SECTION callback_critsection;
+  // Callback queue (any thread to window thread)
+  CallQueue *callback_queue;
 
 	// Program thread object
 	HANDLE program_thread_handle;
@@ -0,0 +1,704 @@
+/*___________________________________________________________________
+|
+|	File: callqueue.cpp
+|
+|	Description: Lock-free queue of callbacks, added to from any thread
+|   and run on one (callbacks from the program thread run on the window
+|   thread).  Bounded, with a sequence number in each slot (after
+|   Dmitry Vyukov's bounded queue):
+|
+|   Adding claims a slot by moving the add position on with a compare
+|   and swap, if the slot's sequence says it's free, then copies the
+|   callback in and sets the sequence to say it's full.  Removing does
+|   the same from the remove position, copying the callback out and
+|   setting the sequence to free the slot for the next time around.
+|   No thread waits on another and a slow callback holds up nothing:
+|   it's copied out of its slot and the slot freed before it runs.
+|
+|   Parameters up to CALLQUEUE_INLINE_PARAMS bytes are copied into the
+|   slot (each slot is one cache line), so adding doesn't allocate.
+|   Bigger ones are malloc'd.
+|
+|   Slot sequences and positions are std::atomic: a sequence is written
+|   with release once a slot is filled (or emptied) and read with
+|   acquire, so what's in a slot is all there when its sequence says so.
+|   It uses only standard C++ threads and timing, so the benchmark can
+|   be built and run on its own anywhere.  With g++:
+|
+|     g++ -O2 -std=c++14 -pthread -DCALLQUEUE_BENCHMARK_MAIN callqueue.cpp
+|
+| Functions:	callqueue_Init
+|             callqueue_Free
+|             callqueue_Add
+|             callqueue_Process
+|              Remove
+|             callqueue_Flush
+|             callqueue_Get_Stats
+|              Aligned_Alloc
+|              Aligned_Free
+|             callqueue_Benchmark
+|              Bench_Run
+|              Bench_Producer
+|              Bench_Consumer
+|              Bench_Add
+|              Bench_Process
+|              Bench_Callback
+|              Bench_Now_Ns
+|              Bench_Wait
+|              debug_WriteFile (not on Windows)
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*____________________
+|
+| Include files
+|___________________*/
+
+#ifdef _WIN32
+#include <first_header.h>
+#include "wdp.h"
+#else
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define TRUE  1
+#define FALSE 0
+#define NOT   !
+#define AND   &&
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#include "callqueue.h"
+
+/*____________________
+|
+|	Constants
+|___________________*/
+
+#define CACHE_LINE 64
+
+#define BENCH_SIZE          64        // callbacks, like the callback queue
+#define BENCH_CALLS         400000    // callbacks added in each run
+#define BENCH_MAX_PRODUCERS 4
+#define BENCH_SLOW_US       2         // how long a slow callback takes
+#define BENCH_SPINS         1000      // times a thread spins waiting before giving up the processor
+
+/*____________________
+|
+| Type definitions
+|___________________*/
+
+struct CallSlot {
+  alignas(CACHE_LINE) std::atomic<unsigned> sequence;   // position it's free for, or position + 1 once full
+  void   (*callback) (void *params);
+  unsigned size_params;
+  void    *heap_params;                         // parameters too big to keep here, else NULL
+  unsigned char params [CALLQUEUE_INLINE_PARAMS];
+};
+
+struct CallQueue {
+  alignas(CACHE_LINE) std::atomic<unsigned> add_position;
+  alignas(CACHE_LINE) std::atomic<unsigned> remove_position;
+  alignas(CACHE_LINE) std::atomic<unsigned> dropped;
+  std::atomic<unsigned> heap_params;
+  alignas(CACHE_LINE) unsigned mask;
+  CallSlot *slot;
+};
+
+// A callback copied out of its slot
+struct Call {
+  void   (*callback) (void *params);
+  unsigned size_params;
+  void    *heap_params;
+  unsigned char params [CALLQUEUE_INLINE_PARAMS];
+};
+
+// How the callback queue used to store an entry
+struct OldEntry {
+  void (*callback) (void *params);
+  void *params;
+};
+
+// The callback queue as it used to be, a fixed size queue behind a lock held while each callback runs
+struct OldQueue {
+  std::mutex lock;
+  unsigned   added, removed;
+  OldEntry   entries [BENCH_SIZE];
+};
+
+// What the benchmark threads share
+struct CallBenchContext {
+  int              use_callqueue;   // else the old queue
+  CallQueue       *callqueue;
+  OldQueue        *queue;
+  int              producers;
+  int              slow;            // callbacks take BENCH_SLOW_US
+  std::atomic<int> added, run;
+  double           add_us;          // mean time an add took
+  double           sum;             // of the parameters run with
+};
+
+struct CallBenchProducer {
+  CallBenchContext *ctx;
+  int               index;
+  double            add_us;          // total time adds took
+};
+
+struct CallBenchParams {
+  CallBenchContext *ctx;
+  unsigned          value;
+};
+
+/*____________________
+|
+| Function prototypes
+|___________________*/
+
+static int       Remove (CallQueue *queue, Call *call);
+static void     *Aligned_Alloc (size_t size);
+static void      Aligned_Free (void *memory);
+static void      Bench_Run (CallBenchContext *ctx, double *ms);
+static void      Bench_Producer (CallBenchProducer *producer);
+static void      Bench_Consumer (CallBenchContext *ctx);
+static void      Bench_Add (CallBenchContext *ctx, CallBenchParams *params);
+static int       Bench_Process (CallBenchContext *ctx);
+static void      Bench_Callback (void *params);
+static long long Bench_Now_Ns ();
+static void      Bench_Wait (int *spins);
+#ifndef _WIN32
+static void      debug_WriteFile (const char *str);
+#endif
+
+/*___________________________________________________________________
+|
+|	Function: callqueue_Init
+|
+|	Input: Called from CMainFrame::CMainFrame(), callqueue_Benchmark()
+| Output: Returns a new queue or 0 on error.
+|___________________________________________________________________*/
+
+CallQueue *callqueue_Init (int size)
+{
+  unsigned i, n;
+  void *memory;
+  CallQueue *queue;
+
+  for (n=1; n<(unsigned)size; n<<=1);
+
+  memory = Aligned_Alloc (sizeof(CallQueue));
+  if (memory == NULL)
+    return (NULL);
+  // Value initialized, so the positions and counts start at 0
+  queue = new (memory) CallQueue ();
+  queue->mask = n - 1;
+  queue->slot = (CallSlot *) Aligned_Alloc (n * sizeof(CallSlot));
+  if (queue->slot == NULL) {
+    callqueue_Free (queue);
+    return (NULL);
+  }
+  for (i=0; i<n; i++) {
+    new (&queue->slot[i]) CallSlot ();
+    queue->slot[i].sequence.store (i, std::memory_order_relaxed);
+  }
+
+  return (queue);
+}
+
+/*___________________________________________________________________
+|
+|	Function: callqueue_Free
+|
+|	Input: Called from CMainFrame::~CMainFrame(), callqueue_Init(),
+|   callqueue_Benchmark()
+| Output: Frees a queue.
+|___________________________________________________________________*/
+
+void callqueue_Free (CallQueue *queue)
+{
+  if (queue) {
+    if (queue->slot) {
+      callqueue_Flush (queue);
+      Aligned_Free (queue->slot);
+    }
+    Aligned_Free (queue);
+  }
+}
+
+/*___________________________________________________________________
+|
+|	Function: callqueue_Add
+|
+|	Input: Called from CMainFrame::CallbackQueue_Add(), Bench_Add()
+| Output: Adds a callback.  Returns FALSE if the queue is full (or the
+|   parameters don't fit and can't be allocated).
+|___________________________________________________________________*/
+
+int callqueue_Add (CallQueue *queue, void (*callback) (void *params), void *params, unsigned size_params)
+{
+  int diff;
+  unsigned position;
+  void *heap_params = NULL;
+  CallSlot *slot;
+
+  if (size_params > CALLQUEUE_INLINE_PARAMS) {
+    heap_params = malloc (size_params);
+    if (heap_params == NULL)
+      return (FALSE);
+    memcpy (heap_params, params, size_params);
+    queue->heap_params.fetch_add (1, std::memory_order_relaxed);
+  }
+
+  // Claim the slot at the add position
+  position = queue->add_position.load (std::memory_order_relaxed);
+  for (;;) {
+    slot = &queue->slot[position & queue->mask];
+    diff = (int)(slot->sequence.load (std::memory_order_acquire) - position);
+    if (diff == 0) {
+      if (queue->add_position.compare_exchange_weak (position, position + 1, std::memory_order_relaxed))
+        break;
+    }
+    else if (diff < 0) {
+      // Full (the slot still holds a callback from the last time around)
+      queue->dropped.fetch_add (1, std::memory_order_relaxed);
+      if (heap_params)
+        free (heap_params);
+      return (FALSE);
+    }
+    else
+      position = queue->add_position.load (std::memory_order_relaxed);
+  }
+
+  slot->callback    = callback;
+  slot->size_params = size_params;
+  slot->heap_params = heap_params;
+  if (size_params AND (heap_params == NULL))
+    memcpy (slot->params, params, size_params);
+  // Full
+  slot->sequence.store (position + 1, std::memory_order_release);
+
+  return (TRUE);
+}
+
+/*___________________________________________________________________
+|
+|	Function: callqueue_Process
+|
+|	Input: Called from CMainFrame::CallbackQueue_Process(),
+|   Bench_Process()
+| Output: Runs the oldest callback.  Returns FALSE if there is none.
+|___________________________________________________________________*/
+
+int callqueue_Process (CallQueue *queue)
+{
+  Call call;
+
+  if (NOT Remove (queue, &call))
+    return (FALSE);
+
+  if (call.heap_params) {
+    (*call.callback) (call.heap_params);
+    free (call.heap_params);
+  }
+  else
+    (*call.callback) (call.size_params ? call.params : NULL);
+
+  return (TRUE);
+}
+
+/*___________________________________________________________________
+|
+|	Function: Remove
+|
+|	Input: Called from callqueue_Process(), callqueue_Flush()
+| Output: Copies the oldest callback out of its slot and frees the
+|   slot.  Returns FALSE if there is none.
+|___________________________________________________________________*/
+
+static int Remove (CallQueue *queue, Call *call)
+{
+  int diff;
+  unsigned position;
+  CallSlot *slot;
+
+  position = queue->remove_position.load (std::memory_order_relaxed);
+  for (;;) {
+    slot = &queue->slot[position & queue->mask];
+    diff = (int)(slot->sequence.load (std::memory_order_acquire) - (position + 1));
+    if (diff == 0) {
+      if (queue->remove_position.compare_exchange_weak (position, position + 1, std::memory_order_relaxed))
+        break;
+    }
+    else if (diff < 0)
+      return (FALSE);
+    else
+      position = queue->remove_position.load (std::memory_order_relaxed);
+  }
+
+  call->callback    = slot->callback;
+  call->size_params = slot->size_params;
+  call->heap_params = slot->heap_params;
+  if (call->size_params AND (call->heap_params == NULL))
+    memcpy (call->params, slot->params, call->size_params);
+  // Free for the add a time around the queue later
+  slot->sequence.store (position + queue->mask + 1, std::memory_order_release);
+
+  return (TRUE);
+}
+
+/*___________________________________________________________________
+|
+|	Function: callqueue_Flush
+|
+|	Input: Called from CMainFrame::CallbackQueue_Flush(),
+|   callqueue_Free()
+| Output: Removes all callbacks without running them.
+|___________________________________________________________________*/
+
+void callqueue_Flush (CallQueue *queue)
+{
+  Call call;
+
+  while (Remove (queue, &call))
+    if (call.heap_params)
+      free (call.heap_params);
+}
+
+/*___________________________________________________________________
+|
+|	Function: callqueue_Get_Stats
+|
+|	Input: Called from CMainFrame::CallbackQueue_Get_Stats()
+| Output: Returns statistics since callqueue_Init().
+|___________________________________________________________________*/
+
+void callqueue_Get_Stats (CallQueue *queue, CallQueueStats *stats)
+{
+  stats->added       = queue->add_position.load ();
+  stats->removed     = queue->remove_position.load ();
+  stats->dropped     = queue->dropped.load ();
+  stats->heap_params = queue->heap_params.load ();
+}
+
+/*___________________________________________________________________
+|
+|	Function: Aligned_Alloc
+|
+|	Input: Called from callqueue_Init()
+| Output: Returns size bytes aligned to a cache line (size is a
+|   multiple of one), or 0 on error.
+|___________________________________________________________________*/
+
+static void *Aligned_Alloc (size_t size)
+{
+#ifdef _WIN32
+  return (_aligned_malloc (size, CACHE_LINE));
+#else
+  return (aligned_alloc (CACHE_LINE, size));
+#endif
+}
+
+/*___________________________________________________________________
+|
+|	Function: Aligned_Free
+|
+|	Input: Called from callqueue_Free()
+| Output: Frees what Aligned_Alloc() returned.
+|___________________________________________________________________*/
+
+static void Aligned_Free (void *memory)
+{
+#ifdef _WIN32
+  _aligned_free (memory);
+#else
+  free (memory);
+#endif
+}
+
+/*___________________________________________________________________
+|
+|	Function: callqueue_Benchmark
+|
+|	Input: Called from Program_Run(), main() (CALLQUEUE_BENCHMARK_MAIN)
+| Output: Writes how fast callbacks are added and run, with 1 or more
+|   threads adding, to the debug file (stdout when built on its own).
+|___________________________________________________________________*/
+
+void callqueue_Benchmark (void)
+{
+  int i, producers;
+  double ms [2], add_us [2];
+  char str [200];
+  CallBenchContext ctx;
+
+  // With one processor the threads only take turns, so what's measured is mostly the scheduler
+  if (std::thread::hardware_concurrency () < 2)
+    debug_WriteFile ("Callback queue benchmark: 1 processor, the threads take turns instead of running at once");
+
+  for (producers=1; producers<=BENCH_MAX_PRODUCERS; producers*=2) {
+    for (i=0; i<2; i++) {
+      ctx.use_callqueue = (i == 0);
+      ctx.callqueue     = NULL;
+      ctx.queue         = NULL;
+      ctx.producers     = producers;
+      ctx.slow          = FALSE;
+      ctx.sum           = 0;
+      if (ctx.use_callqueue)
+        ctx.callqueue = callqueue_Init (BENCH_SIZE);
+      else {
+        ctx.queue = new OldQueue;
+        ctx.queue->added   = 0;
+        ctx.queue->removed = 0;
+      }
+
+      // As fast as callbacks run
+      Bench_Run (&ctx, &ms[i]);
+      // With slow callbacks, how long does an add take?
+      ctx.slow = TRUE;
+      Bench_Run (&ctx, NULL);
+      add_us[i] = ctx.add_us;
+
+      if (ctx.use_callqueue)
+        callqueue_Free (ctx.callqueue);
+      else
+        delete ctx.queue;
+    }
+    sprintf (str, "Callback queue benchmark, %d adding threads: %d callbacks, lock-free %.1f ms, locked %.1f ms",
+      producers, BENCH_CALLS, ms[0], ms[1]);
+    debug_WriteFile (str);
+    sprintf (str, "Callback queue benchmark, %d adding threads: %d us callbacks, mean add lock-free %.2f us, locked %.2f us",
+      producers, BENCH_SLOW_US, add_us[0], add_us[1]);
+    debug_WriteFile (str);
+  }
+}
+
+/*___________________________________________________________________
+|
+|	Function: Bench_Run
+|
+|	Input: Called from callqueue_Benchmark()
+| Output: Adds BENCH_CALLS callbacks from ctx->producers threads while
+|   one thread runs them.  Returns the time taken in *ms, if not NULL.
+|___________________________________________________________________*/
+
+static void Bench_Run (CallBenchContext *ctx, double *ms)
+{
+  int i;
+  long long start;
+  std::thread thread [BENCH_MAX_PRODUCERS+1];
+  CallBenchProducer producer [BENCH_MAX_PRODUCERS];
+
+  ctx->added      = 0;
+  ctx->run        = 0;
+  ctx->add_us     = 0;
+
+  start = Bench_Now_Ns ();
+  thread[0] = std::thread (Bench_Consumer, ctx);
+  for (i=0; i<ctx->producers; i++) {
+    producer[i].ctx        = ctx;
+    producer[i].index      = i;
+    producer[i].add_us     = 0;
+    thread[i+1] = std::thread (Bench_Producer, &producer[i]);
+  }
+  for (i=0; i<=ctx->producers; i++)
+    thread[i].join ();
+
+  for (i=0; i<ctx->producers; i++)
+    ctx->add_us += producer[i].add_us;
+  ctx->add_us /= BENCH_CALLS;
+  if (ms)
+    *ms = (Bench_Now_Ns () - start) / 1000000.0;
+}
+
+/*___________________________________________________________________
+|
+|	Function: Bench_Producer
+|
+|	Input: Called from Bench_Run() (thread)
+| Output: Adds this thread's share of the callbacks, never more than
+|   the queue holds, timing each add.
+|___________________________________________________________________*/
+
+static void Bench_Producer (CallBenchProducer *producer)
+{
+  int n, count, spins = 0;
+  long long start;
+  CallBenchParams params;
+  CallBenchContext *ctx = producer->ctx;
+
+  count = BENCH_CALLS / ctx->producers;
+  if (producer->index == 0)
+    count += BENCH_CALLS % ctx->producers;
+  params.ctx = ctx;
+
+  for (n=0; n<count; n++) {
+    // Leave a slot for each thread adding
+    while (ctx->added.load () - ctx->run.load () >= BENCH_SIZE - BENCH_MAX_PRODUCERS)
+      Bench_Wait (&spins);
+    spins = 0;
+    ctx->added.fetch_add (1);
+    params.value = n;
+
+    start = Bench_Now_Ns ();
+    Bench_Add (ctx, &params);
+    producer->add_us += (Bench_Now_Ns () - start) / 1000.0;
+  }
+}
+
+/*___________________________________________________________________
+|
+|	Function: Bench_Consumer
+|
+|	Input: Called from Bench_Run() (thread)
+| Output: Runs callbacks until all have run.
+|___________________________________________________________________*/
+
+static void Bench_Consumer (CallBenchContext *ctx)
+{
+  int spins = 0;
+
+  while (ctx->run.load () < BENCH_CALLS) {
+    if (Bench_Process (ctx))
+      spins = 0;
+    else
+      Bench_Wait (&spins);
+  }
+}
+
+/*___________________________________________________________________
+|
+|	Function: Bench_Add
+|
+|	Input: Called from Bench_Producer()
+| Output: Adds a callback to the lock-free queue or, the way
+|   CMainFrame::CallbackQueue_Add() used to, to the old queue.
+|___________________________________________________________________*/
+
+static void Bench_Add (CallBenchContext *ctx, CallBenchParams *params)
+{
+  OldEntry entry;
+  OldQueue *queue = ctx->queue;
+
+  if (ctx->use_callqueue)
+    callqueue_Add (ctx->callqueue, Bench_Callback, params, sizeof(CallBenchParams));
+  else {
+    entry.callback = Bench_Callback;
+    entry.params   = malloc (sizeof(CallBenchParams));
+    memcpy (entry.params, params, sizeof(CallBenchParams));
+    std::lock_guard<std::mutex> lock (queue->lock);
+    queue->entries[queue->added % BENCH_SIZE] = entry;
+    queue->added++;
+  }
+}
+
+/*___________________________________________________________________
+|
+|	Function: Bench_Process
+|
+|	Input: Called from Bench_Consumer()
+| Output: Runs the oldest callback from the lock-free queue or, the
+|   way CMainFrame::CallbackQueue_Process() used to, from the old
+|   queue with its lock held.  Returns FALSE if there is none.
+|___________________________________________________________________*/
+
+static int Bench_Process (CallBenchContext *ctx)
+{
+  OldEntry entry;
+  OldQueue *queue = ctx->queue;
+
+  if (ctx->use_callqueue)
+    return (callqueue_Process (ctx->callqueue));
+
+  std::lock_guard<std::mutex> lock (queue->lock);
+  if (queue->added == queue->removed)
+    return (FALSE);
+  entry = queue->entries[queue->removed % BENCH_SIZE];
+  queue->removed++;
+  (*entry.callback) (entry.params);
+  free (entry.params);
+  return (TRUE);
+}
+
+/*___________________________________________________________________
+|
+|	Function: Bench_Callback
+|
+|	Input: Called from callqueue_Process(), Bench_Process()
+| Output: Adds its parameter to a sum, taking BENCH_SLOW_US if the run
+|   is timing slow callbacks.
+|___________________________________________________________________*/
+
+static void Bench_Callback (void *params)
+{
+  long long start;
+  CallBenchParams *p = (CallBenchParams *)params;
+  CallBenchContext *ctx = p->ctx;
+
+  ctx->sum += p->value;
+  if (ctx->slow) {
+    start = Bench_Now_Ns ();
+    while (Bench_Now_Ns () - start < BENCH_SLOW_US * 1000);
+  }
+  ctx->run.fetch_add (1);
+}
+
+/*___________________________________________________________________
+|
+|	Function: Bench_Now_Ns
+|
+|	Input: Called from Bench_Run(), Bench_Producer(), Bench_Callback()
+| Output: Returns the steady clock in ns.
+|___________________________________________________________________*/
+
+static long long Bench_Now_Ns ()
+{
+  return (std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now ().time_since_epoch ()).count ());
+}
+
+/*___________________________________________________________________
+|
+|	Function: Bench_Wait
+|
+|	Input: Called from Bench_Producer(), Bench_Consumer()
+| Output: Spins a while, then gives up the processor (in case another
+|   thread is waiting for it).
+|___________________________________________________________________*/
+
+static void Bench_Wait (int *spins)
+{
+  if (++(*spins) >= BENCH_SPINS)
+    std::this_thread::yield ();
+}
+
+#ifndef _WIN32
+
+/*___________________________________________________________________
+|
+|	Function: debug_WriteFile
+|
+|	Input: Called from callqueue_Benchmark()
+| Output: Writes a line to stdout, in place of the debug file.
+|___________________________________________________________________*/
+
+static void debug_WriteFile (const char *str)
+{
+  puts (str);
+}
+
+#endif
+
+#ifdef CALLQUEUE_BENCHMARK_MAIN
+
+int main ()
+{
+  callqueue_Benchmark ();
+  return (0);
+}
+
+#endif
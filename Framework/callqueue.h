@@ -0,0 +1,62 @@
+/*____________________________________________________________________
+|
+| File: callqueue.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+#ifndef _CALLQUEUE_H_
+#define _CALLQUEUE_H_
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define CALLQUEUE_INLINE_PARAMS 32    // bytes of parameters kept in the queue, bigger ones are malloc'd
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+// A lock-free queue of callbacks to run on one thread, added to from any thread
+struct CallQueue;
+
+// Statistics since callqueue_Init()
+struct CallQueueStats {
+  unsigned added;
+  unsigned removed;       // run or flushed
+  unsigned dropped;       // # of adds to a full queue
+  unsigned heap_params;   // # of adds with parameters too big to keep in the queue
+};
+
+/*___________________
+|
+| Functions
+|__________________*/
+
+// Creates a queue of size callbacks (rounded up to a power of 2), returns 0 on error
+CallQueue *callqueue_Init (int size);
+
+// Frees a queue (callbacks left in it are not run)
+void callqueue_Free (CallQueue *queue);
+
+// Any thread: adds a callback and a copy of its parameters.  Returns FALSE if the queue is full.
+int callqueue_Add (CallQueue *queue, void (*callback) (void *params), void *params, unsigned size_params);
+
+// Runs the oldest callback, outside any lock.  Returns FALSE if the queue is empty.
+int callqueue_Process (CallQueue *queue);
+
+// Removes all callbacks without running them
+void callqueue_Flush (CallQueue *queue);
+
+// Returns statistics since callqueue_Init()
+void callqueue_Get_Stats (CallQueue *queue, CallQueueStats *stats);
+
+// Times adding callbacks from 1 or more threads while one thread runs them, against malloc'd parameters in a
+//  queue behind a lock held while each callback runs.  Writes the results to the debug file.
+void callqueue_Benchmark (void);
+
+#endif
@@ -0,0 +1,588 @@
+/*___________________________________________________________________
+|
+|	File: ring.cpp
+|
+|	Description: Lock-free ring buffer for one producer thread and one
+|   consumer thread (window thread to program thread events).
+|
+|   The producer only writes head (# added) and the consumer only
+|   writes tail (# removed), each on its own cache line, so neither
+|   waits for the other and they don't share a line they write.  Each
+|   side keeps a copy of the other's counter and reads the real one
+|   only when its copy says the ring is full (or empty).  An entry is
+|   copied in before head is moved past it, and copied out before tail
+|   is.  Counters run freely and wrap, a slot is counter & mask.
+|
+|   A consumer that waits sets a flag the producer checks after adding,
+|   signalling a condition variable only then, so adds cost no system
+|   call normally.
+|
+|   head and tail are read with acquire and written with release, so an
+|   entry is all there before the other side sees the counter move.
+|
+|   It uses only standard C++ threads and timing, so the benchmark can
+|   be built and run on its own anywhere.  With g++:
+|
+|     g++ -O2 -std=c++14 -pthread -DRING_BENCHMARK_MAIN ring.cpp
+|
+| Functions:	ring_Init
+|             ring_Free
+|             ring_Add
+|             ring_Remove
+|             ring_Wait
+|             ring_Remove_Selected_Entries
+|             ring_Get_Stats
+|             ring_Benchmark
+|              Bench_Run
+|              Bench_Producer
+|              Bench_Consumer
+|              Bench_Add
+|              Bench_Remove
+|              Bench_Now_Ns
+|              Bench_Wait
+|              debug_WriteFile (not on Windows)
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+/*____________________
+|
+| Include files
+|___________________*/
+
+#ifdef _WIN32
+#include <first_header.h>
+#include "wdp.h"
+#else
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define TRUE  1
+#define FALSE 0
+#define NOT   !
+#define OR    ||
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#include "ring.h"
+
+/*____________________
+|
+|	Constants
+|___________________*/
+
+#define BENCH_SIZE         512      // entries, like the event queue
+#define BENCH_ENTRY_SIZE   16       // sizeof(BenchEntry)
+#define BENCH_THROUGHPUT   2000000  // entries handed over as fast as possible
+#define BENCH_LATENCY      20000    // entries handed over one at a time
+#define BENCH_SPINS        1000     // times a thread spins waiting before giving up the processor
+
+#define SLOT(_ring_,_n_) ((_ring_)->entries + ((_n_) & (_ring_)->mask) * (_ring_)->entry_size)
+
+/*____________________
+|
+| Type definitions
+|___________________*/
+
+struct Ring {
+  // Written by the producer
+  alignas(RING_CACHE_LINE) std::atomic<unsigned> head;
+  unsigned tail_seen;           // tail when the producer last looked
+  unsigned dropped;
+  // Written by the consumer
+  alignas(RING_CACHE_LINE) std::atomic<unsigned> tail;
+  unsigned head_seen;           // head when the consumer last looked
+  unsigned max_used;
+  // Set while the consumer waits in ring_Wait()
+  alignas(RING_CACHE_LINE) std::atomic<int> waiting;
+  std::mutex              ready_lock;
+  std::condition_variable ready;  // signalled when an entry is added to a ring the consumer waits on
+  // Set up by ring_Init()
+  alignas(RING_CACHE_LINE) unsigned size, mask;
+  int            entry_size;
+  unsigned char *entries;
+};
+
+// A fixed size queue behind a lock, what the ring is measured against
+struct BenchQueue {
+  std::mutex lock;
+  unsigned   added, removed;
+  unsigned char entries [BENCH_SIZE * BENCH_ENTRY_SIZE];
+};
+
+// What the benchmark threads share
+struct BenchContext {
+  int              use_ring;      // else the queue
+  Ring            *ring;
+  BenchQueue      *queue;
+  int              count;         // # of entries to hand over
+  int              one_at_a_time; // wait for each entry to be taken before adding the next
+  std::atomic<int> taken;         // # taken by the consumer
+  double           total_latency_us, max_latency_us;
+};
+
+struct BenchEntry {
+  long long sent;               // steady clock ns when added
+  unsigned  n;
+  unsigned  pad;
+};
+
+/*____________________
+|
+| Function prototypes
+|___________________*/
+
+static void      Bench_Run (BenchContext *ctx, double *ms);
+static void      Bench_Producer (BenchContext *ctx);
+static void      Bench_Consumer (BenchContext *ctx);
+static int       Bench_Add (BenchContext *ctx, BenchEntry *entry);
+static int       Bench_Remove (BenchContext *ctx, BenchEntry *entry);
+static long long Bench_Now_Ns ();
+static void      Bench_Wait (int *spins);
+#ifndef _WIN32
+static void      debug_WriteFile (const char *str);
+#endif
+
+/*___________________________________________________________________
+|
+|	Function: ring_Init
+|
+|	Input: Called from CMainFrame::CMainFrame(), ring_Benchmark()
+| Output: Returns a new ring or 0 on error.
+|___________________________________________________________________*/
+
+Ring *ring_Init (int size, int entry_size)
+{
+  unsigned n;
+  void *memory;
+  Ring *ring;
+
+  for (n=1; n<(unsigned)size; n<<=1);
+
+#ifdef _WIN32
+  memory = _aligned_malloc (sizeof(Ring), RING_CACHE_LINE);
+#else
+  memory = aligned_alloc (RING_CACHE_LINE, sizeof(Ring));
+#endif
+  if (memory == NULL)
+    return (NULL);
+  // Value initialized, so the counters start at 0
+  ring = new (memory) Ring ();
+  ring->size       = n;
+  ring->mask       = n - 1;
+  ring->entry_size = entry_size;
+  ring->entries    = (unsigned char *) malloc (n * entry_size);
+  if (ring->entries == NULL) {
+    ring_Free (ring);
+    return (NULL);
+  }
+
+  return (ring);
+}
+
+/*___________________________________________________________________
+|
+|	Function: ring_Free
+|
+|	Input: Called from CMainFrame::~CMainFrame(), ring_Init(),
+|   ring_Benchmark()
+| Output: Frees a ring.
+|___________________________________________________________________*/
+
+void ring_Free (Ring *ring)
+{
+  if (ring) {
+    if (ring->entries)
+      free (ring->entries);
+    ring->~Ring ();
+#ifdef _WIN32
+    _aligned_free (ring);
+#else
+    free (ring);
+#endif
+  }
+}
+
+/*___________________________________________________________________
+|
+|	Function: ring_Add
+|
+|	Input: Called from the producer
+| Output: Copies an entry into the ring.  Returns FALSE if it's full.
+|___________________________________________________________________*/
+
+int ring_Add (Ring *ring, void *entry)
+{
+  unsigned head = ring->head.load (std::memory_order_relaxed);
+
+  if (head - ring->tail_seen == ring->size) {
+    ring->tail_seen = ring->tail.load (std::memory_order_acquire);
+    if (head - ring->tail_seen == ring->size) {
+      ring->dropped++;
+      return (FALSE);
+    }
+  }
+  memcpy (SLOT(ring, head), entry, ring->entry_size);
+  // Sequentially consistent, so waiting is read after head is written (ring_Wait() does the opposite)
+  ring->head.store (head + 1, std::memory_order_seq_cst);
+  if (ring->waiting.load (std::memory_order_seq_cst)) {
+    // Under the lock, so a consumer between checking head and waiting can't miss it
+    std::lock_guard<std::mutex> lock (ring->ready_lock);
+    ring->ready.notify_one ();
+  }
+
+  return (TRUE);
+}
+
+/*___________________________________________________________________
+|
+|	Function: ring_Remove
+|
+|	Input: Called from the consumer
+| Output: Copies the oldest entry out of the ring.  Returns FALSE if
+|   it's empty.
+|___________________________________________________________________*/
+
+int ring_Remove (Ring *ring, void *entry)
+{
+  unsigned tail = ring->tail.load (std::memory_order_relaxed);
+
+  if (tail == ring->head_seen) {
+    ring->head_seen = ring->head.load (std::memory_order_acquire);
+    if (tail == ring->head_seen)
+      return (FALSE);
+  }
+  if (ring->head_seen - tail > ring->max_used)
+    ring->max_used = ring->head_seen - tail;
+  memcpy (entry, SLOT(ring, tail), ring->entry_size);
+  ring->tail.store (tail + 1, std::memory_order_release);
+
+  return (TRUE);
+}
+
+/*___________________________________________________________________
+|
+|	Function: ring_Wait
+|
+|	Input: Called from the consumer
+| Output: Waits for an entry up to timeout_ms.  Returns TRUE if one is
+|   waiting.
+|___________________________________________________________________*/
+
+int ring_Wait (Ring *ring, unsigned timeout_ms)
+{
+  int ready;
+
+  if (ring->tail.load (std::memory_order_relaxed) != ring->head.load (std::memory_order_acquire))
+    return (TRUE);
+
+  // Sequentially consistent, so head is read after waiting is written
+  ring->waiting.store (TRUE, std::memory_order_seq_cst);
+  {
+    std::unique_lock<std::mutex> lock (ring->ready_lock);
+    ready = ring->ready.wait_for (lock, std::chrono::milliseconds (timeout_ms), [ring] {
+      return (ring->tail.load (std::memory_order_relaxed) != ring->head.load (std::memory_order_seq_cst)); });
+  }
+  ring->waiting.store (FALSE, std::memory_order_seq_cst);
+
+  return (ready);
+}
+
+/*___________________________________________________________________
+|
+|	Function: ring_Remove_Selected_Entries
+|
+|	Input: Called from the consumer
+| Output: Removes the entries func returns TRUE for.  The rest are
+|   moved up against head (the producer doesn't touch slots between
+|   tail and head) and tail is moved past the gap left.
+|___________________________________________________________________*/
+
+void ring_Remove_Selected_Entries (Ring *ring, void *data, int (*func) (void *entry, void *data))
+{
+  unsigned n, kept, tail = ring->tail.load (std::memory_order_relaxed);
+
+  ring->head_seen = ring->head.load (std::memory_order_acquire);
+  kept = ring->head_seen;
+  for (n=ring->head_seen; n!=tail; ) {
+    n--;
+    if (NOT (*func) (SLOT(ring, n), data)) {
+      kept--;
+      if (kept != n)
+        memcpy (SLOT(ring, kept), SLOT(ring, n), ring->entry_size);
+    }
+  }
+  ring->tail.store (kept, std::memory_order_release);
+}
+
+/*___________________________________________________________________
+|
+|	Function: ring_Get_Stats
+|
+|	Input: Called from CMainFrame::EventQueue_Get_Stats()
+| Output: Returns statistics since ring_Init().
+|___________________________________________________________________*/
+
+void ring_Get_Stats (Ring *ring, RingStats *stats)
+{
+  stats->added    = ring->head.load ();
+  stats->removed  = ring->tail.load ();
+  stats->dropped  = ring->dropped;
+  stats->max_used = ring->max_used;
+}
+
+/*___________________________________________________________________
+|
+|	Function: ring_Benchmark
+|
+|	Input: Called from Program_Run(), main() (RING_BENCHMARK_MAIN)
+| Output: Writes how fast a ring and a queue behind a lock hand entries
+|   from one thread to another to the debug file (stdout when built
+|   on its own).
+|___________________________________________________________________*/
+
+void ring_Benchmark (void)
+{
+  int i;
+  double ms [2], latency_us [2], max_latency_us [2];
+  char str [200];
+  BenchContext ctx;
+
+  static_assert (sizeof(BenchEntry) == BENCH_ENTRY_SIZE, "BENCH_ENTRY_SIZE must be sizeof(BenchEntry)");
+
+  // With one processor the threads only take turns, so what's measured is mostly the scheduler
+  if (std::thread::hardware_concurrency () < 2)
+    debug_WriteFile ("Event queue benchmark: 1 processor, the threads take turns instead of running at once");
+
+  for (i=0; i<2; i++) {
+    ctx.use_ring         = (i == 0);
+    ctx.ring             = NULL;
+    ctx.queue            = NULL;
+    ctx.one_at_a_time    = FALSE;
+    if (ctx.use_ring)
+      ctx.ring = ring_Init (BENCH_SIZE, sizeof(BenchEntry));
+    else {
+      ctx.queue = new BenchQueue;
+      ctx.queue->added   = 0;
+      ctx.queue->removed = 0;
+    }
+
+    // As fast as the consumer keeps up
+    ctx.count = BENCH_THROUGHPUT;
+    Bench_Run (&ctx, &ms[i]);
+    // One at a time
+    ctx.count = BENCH_LATENCY;
+    ctx.one_at_a_time = TRUE;
+    Bench_Run (&ctx, NULL);
+    latency_us[i]     = ctx.total_latency_us / BENCH_LATENCY;
+    max_latency_us[i] = ctx.max_latency_us;
+
+    if (ctx.use_ring)
+      ring_Free (ctx.ring);
+    else
+      delete ctx.queue;
+  }
+
+  sprintf (str, "Event queue benchmark: %d entries, ring %.1f ms (%.1f M/s), locked queue %.1f ms (%.1f M/s)",
+    BENCH_THROUGHPUT, ms[0], BENCH_THROUGHPUT / ms[0] / 1000, ms[1], BENCH_THROUGHPUT / ms[1] / 1000);
+  debug_WriteFile (str);
+  sprintf (str, "Event queue benchmark: %d handed over one at a time, ring %.2f us (max %.1f), locked queue %.2f us (max %.1f)",
+    BENCH_LATENCY, latency_us[0], max_latency_us[0], latency_us[1], max_latency_us[1]);
+  debug_WriteFile (str);
+}
+
+/*___________________________________________________________________
+|
+|	Function: Bench_Run
+|
+|	Input: Called from ring_Benchmark()
+| Output: Hands ctx->count entries from a producer thread to a consumer
+|   thread.  Returns the time taken in *ms, if not NULL.
+|___________________________________________________________________*/
+
+static void Bench_Run (BenchContext *ctx, double *ms)
+{
+  long long start;
+
+  ctx->taken            = 0;
+  ctx->total_latency_us = 0;
+  ctx->max_latency_us   = 0;
+
+  start = Bench_Now_Ns ();
+  std::thread consumer (Bench_Consumer, ctx);
+  std::thread producer (Bench_Producer, ctx);
+  consumer.join ();
+  producer.join ();
+
+  if (ms)
+    *ms = (Bench_Now_Ns () - start) / 1000000.0;
+}
+
+/*___________________________________________________________________
+|
+|	Function: Bench_Producer
+|
+|	Input: Called from Bench_Run() (thread)
+| Output: Adds entries, never more than the ring or queue holds.
+|___________________________________________________________________*/
+
+static void Bench_Producer (BenchContext *ctx)
+{
+  int n, spins = 0;
+  BenchEntry entry;
+
+  memset (&entry, 0, sizeof(entry));
+  for (n=0; n<ctx->count; n++) {
+    if (ctx->one_at_a_time)
+      while (ctx->taken.load (std::memory_order_acquire) != n)
+        Bench_Wait (&spins);
+    else
+      while (n - ctx->taken.load (std::memory_order_acquire) >= BENCH_SIZE)
+        Bench_Wait (&spins);
+    spins = 0;
+    entry.sent = Bench_Now_Ns ();
+    entry.n    = n;
+    Bench_Add (ctx, &entry);
+  }
+}
+
+/*___________________________________________________________________
+|
+|	Function: Bench_Consumer
+|
+|	Input: Called from Bench_Run() (thread)
+| Output: Removes entries until all are taken, timing how long each
+|   waited.
+|___________________________________________________________________*/
+
+static void Bench_Consumer (BenchContext *ctx)
+{
+  int spins = 0;
+  double us;
+  BenchEntry entry;
+
+  while (ctx->taken.load (std::memory_order_relaxed) < ctx->count) {
+    if (NOT Bench_Remove (ctx, &entry)) {
+      Bench_Wait (&spins);
+      continue;
+    }
+    spins = 0;
+    if (ctx->one_at_a_time) {
+      us = (Bench_Now_Ns () - entry.sent) / 1000.0;
+      ctx->total_latency_us += us;
+      if (us > ctx->max_latency_us)
+        ctx->max_latency_us = us;
+    }
+    ctx->taken.store (ctx->taken.load (std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+}
+
+/*___________________________________________________________________
+|
+|	Function: Bench_Add
+|
+|	Input: Called from Bench_Producer()
+| Output: Adds an entry to the ring or the locked queue.  Returns
+|   FALSE if it's full.
+|___________________________________________________________________*/
+
+static int Bench_Add (BenchContext *ctx, BenchEntry *entry)
+{
+  BenchQueue *queue = ctx->queue;
+
+  if (ctx->use_ring)
+    return (ring_Add (ctx->ring, entry));
+
+  std::lock_guard<std::mutex> lock (queue->lock);
+  if (queue->added - queue->removed == BENCH_SIZE)
+    return (FALSE);
+  memcpy (&queue->entries[(queue->added % BENCH_SIZE) * BENCH_ENTRY_SIZE], entry, BENCH_ENTRY_SIZE);
+  queue->added++;
+  return (TRUE);
+}
+
+/*___________________________________________________________________
+|
+|	Function: Bench_Remove
+|
+|	Input: Called from Bench_Consumer()
+| Output: Removes the oldest entry from the ring or the locked queue.
+|   Returns FALSE if it's empty.
+|___________________________________________________________________*/
+
+static int Bench_Remove (BenchContext *ctx, BenchEntry *entry)
+{
+  BenchQueue *queue = ctx->queue;
+
+  if (ctx->use_ring)
+    return (ring_Remove (ctx->ring, entry));
+
+  std::lock_guard<std::mutex> lock (queue->lock);
+  if (queue->added == queue->removed)
+    return (FALSE);
+  memcpy (entry, &queue->entries[(queue->removed % BENCH_SIZE) * BENCH_ENTRY_SIZE], BENCH_ENTRY_SIZE);
+  queue->removed++;
+  return (TRUE);
+}
+
+/*___________________________________________________________________
+|
+|	Function: Bench_Now_Ns
+|
+|	Input: Called from Bench_Run(), Bench_Producer(), Bench_Consumer()
+| Output: Returns the steady clock in ns.
+|___________________________________________________________________*/
+
+static long long Bench_Now_Ns ()
+{
+  return (std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now ().time_since_epoch ()).count ());
+}
+
+/*___________________________________________________________________
+|
+|	Function: Bench_Wait
+|
+|	Input: Called from Bench_Producer(), Bench_Consumer()
+| Output: Spins a while, then gives up the processor (in case the
+|   other thread is waiting for it).
+|___________________________________________________________________*/
+
+static void Bench_Wait (int *spins)
+{
+  if (++(*spins) >= BENCH_SPINS)
+    std::this_thread::yield ();
+}
+
+#ifndef _WIN32
+
+/*___________________________________________________________________
+|
+|	Function: debug_WriteFile
+|
+|	Input: Called from ring_Benchmark()
+| Output: Writes a line to stdout, in place of the debug file.
+|___________________________________________________________________*/
+
+static void debug_WriteFile (const char *str)
+{
+  puts (str);
+}
+
+#endif
+
+#ifdef RING_BENCHMARK_MAIN
+
+int main ()
+{
+  ring_Benchmark ();
+  return (0);
+}
+
+#endif
@@ -0,0 +1,65 @@
+/*____________________________________________________________________
+|
+| File: ring.h
+|
+| (C) Copyright 2013 Abonvita Software LLC.
+| Licensed under the GX Toolkit License, Version 1.0.
+|___________________________________________________________________*/
+
+#ifndef _RING_H_
+#define _RING_H_
+
+/*___________________
+|
+| Constants
+|__________________*/
+
+#define RING_CACHE_LINE 64
+
+/*___________________
+|
+| Type definitions
+|__________________*/
+
+// A lock-free queue between one producer thread and one consumer thread
+struct Ring;
+
+// Statistics since ring_Init()
+struct RingStats {
+  unsigned added;
+  unsigned removed;
+  unsigned dropped;     // # of adds to a full ring
+  unsigned max_used;    // most entries waiting at once (as seen by the consumer)
+};
+
+/*___________________
+|
+| Functions
+|__________________*/
+
+// Creates a ring of size entries (rounded up to a power of 2) of entry_size bytes, returns 0 on error
+Ring *ring_Init (int size, int entry_size);
+
+// Frees a ring
+void ring_Free (Ring *ring);
+
+// Producer: copies an entry into the ring.  Returns FALSE (and counts it dropped) if the ring is full.
+int ring_Add (Ring *ring, void *entry);
+
+// Consumer: copies the oldest entry out of the ring.  Returns FALSE if the ring is empty.
+int ring_Remove (Ring *ring, void *entry);
+
+// Consumer: waits up to timeout_ms for an entry, without removing it.  Returns TRUE if one is waiting.
+int ring_Wait (Ring *ring, unsigned timeout_ms);
+
+// Consumer: removes the entries func returns TRUE for, keeping the rest in order
+void ring_Remove_Selected_Entries (Ring *ring, void *data, int (*func) (void *entry, void *data));
+
+// Returns statistics since ring_Init()
+void ring_Get_Stats (Ring *ring, RingStats *stats);
+
+// Times a ring against a queue behind a lock, one producer and one consumer thread: throughput with the queue
+//  kept busy, and latency handing over one entry at a time.  Writes the results to the debug file.
+void ring_Benchmark (void);
+
+#endif
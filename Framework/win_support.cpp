@@ -13,8 +13,11 @@
 |							win_EventQueue_Add
 |							win_EventQueue_Remove
 |							win_EventQueue_Flush
+|							win_EventQueue_Wait
+|							win_EventQueue_Get_Stats
 |							win_CallbackQueue_Add
 |							win_CallbackQueue_Flush
+|							win_CallbackQueue_Get_Stats
 |
 | (C) Copyright 2013 Abonvita Software LLC.
 | Licensed under the GX Toolkit License, Version 1.0.
@@ -191,6 +194,32 @@ void win_EventQueue_Flush (unsigned event_type_mask)
   The_window->EventQueue_Flush (event_type_mask);
 }
 
+/*___________________________________________________________________
+|
+|	Function: win_EventQueue_Wait
+| 
+|	Input: Called from ____
+| Output: Waits for an event.  Returns TRUE if one is waiting.
+|___________________________________________________________________*/
+
+int win_EventQueue_Wait (unsigned timeout_ms)
+{
+  return (The_window->EventQueue_Wait (timeout_ms));
+}
+
+/*___________________________________________________________________
+|
+|	Function: win_EventQueue_Get_Stats
+| 
+|	Input: Called from ____
+| Output: Returns event queue statistics.
+|___________________________________________________________________*/
+
+void win_EventQueue_Get_Stats (RingStats *stats)
+{
+  The_window->EventQueue_Get_Stats (stats);
+}
+
 /*___________________________________________________________________
 |
 |	Function: win_CallbackQueue_Add
@@ -216,3 +245,16 @@ void win_CallbackQueue_Flush (void)
 {
   The_window->CallbackQueue_Flush ();
 }
+
+/*___________________________________________________________________
+|
+|	Function: win_CallbackQueue_Get_Stats
+| 
+|	Input: Called from ____
+| Output: Returns callback queue statistics.
+|___________________________________________________________________*/
+
+void win_CallbackQueue_Get_Stats (CallQueueStats *stats)
+{
+  The_window->CallbackQueue_Get_Stats (stats);
+}
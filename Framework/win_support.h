@@ -10,6 +10,8 @@
 #define _WIN_SUPPORT_H_
 
 #include <events.h>
+#include "ring.h"
+#include "callqueue.h"
 
 /*___________________
 |
@@ -46,10 +48,19 @@ int win_EventQueue_Remove (EventQueueEntry *qentry);
 // Flushes the event queue
 void win_EventQueue_Flush (unsigned event_type_mask);
 
+// Waits up to timeout_ms for an event, returns TRUE if one is waiting (not removed)
+int win_EventQueue_Wait (unsigned timeout_ms);
+
+// Returns event queue statistics (events added, removed, dropped when full, most waiting at once)
+void win_EventQueue_Get_Stats (RingStats *stats);
+
 // Adds an entry to the callback queue
 void win_CallbackQueue_Add (void (*callback) (void *params), void *params, unsigned size_params);
 
 // Flushes the callback queue
 void win_CallbackQueue_Flush (void);
 
+// Returns callback queue statistics (callbacks added, removed, dropped when full, with parameters too big to keep in the queue)
+void win_CallbackQueue_Get_Stats (CallQueueStats *stats);
+
 #endif